@@ -0,0 +1,241 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include "benchmark.hpp"
+
+using namespace JikkenBench;
+
+struct Options
+{
+	const char *output;
+	const char *baseline;
+	const char *filter;
+	double threshold;
+	int32_t samples;
+};
+
+struct Result
+{
+	std::string name;
+	uint64_t items;
+	int32_t samples;
+	// Nanoseconds per item over the samples.
+	double median;
+	double min;
+	double max;
+};
+
+static void printUsage()
+{
+	printf("usage: jikken_bench [options]\n");
+	printf("  --out <file>        write results as JSON\n");
+	printf("  --baseline <file>   compare against results saved with --out\n");
+	printf("  --threshold <pct>   slowdown that counts as a regression, default 5\n");
+	printf("  --filter <text>     only run benchmarks whose name contains text\n");
+	printf("  --samples <count>   measured batches per benchmark, default 15\n");
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+	options.output = nullptr;
+	options.baseline = nullptr;
+	options.filter = nullptr;
+	options.threshold = 5.0;
+	options.samples = 15;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+			return false;
+		if (value == nullptr)
+		{
+			printf("Missing value for %s\n", arg);
+			return false;
+		}
+
+		if (strcmp(arg, "--out") == 0)
+			options.output = value;
+		else if (strcmp(arg, "--baseline") == 0)
+			options.baseline = value;
+		else if (strcmp(arg, "--filter") == 0)
+			options.filter = value;
+		else if (strcmp(arg, "--threshold") == 0)
+			options.threshold = atof(value);
+		else if (strcmp(arg, "--samples") == 0)
+			options.samples = std::max(atoi(value), 1);
+		else
+		{
+			printf("Unknown option %s\n", arg);
+			return false;
+		}
+		++i;
+	}
+	return true;
+}
+
+static Result runBenchmark(const Benchmark &benchmark, int32_t samples)
+{
+	// Warm up caches, pools and the allocator before measuring.
+	for (int32_t i = 0; i < 2; ++i)
+	{
+		Timer timer;
+		benchmark.func(timer);
+	}
+
+	std::vector<double> times;
+	uint64_t items = 0;
+	for (int32_t i = 0; i < samples; ++i)
+	{
+		Timer timer;
+		benchmark.func(timer);
+		items = std::max<uint64_t>(timer.getItems(), 1);
+		times.push_back(static_cast<double>(timer.getElapsed()) / static_cast<double>(items));
+	}
+	std::sort(times.begin(), times.end());
+
+	Result result;
+	result.name = benchmark.name;
+	result.items = items;
+	result.samples = samples;
+	result.median = times[times.size() / 2];
+	result.min = times.front();
+	result.max = times.back();
+	return result;
+}
+
+static bool writeResults(const char *file, const std::vector<Result> &results)
+{
+	FILE *out = fopen(file, "w");
+	if (out == nullptr)
+	{
+		printf("Unable to open %s for writing\n", file);
+		return false;
+	}
+
+	fprintf(out, "{\n\t\"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const Result &result = results[i];
+		fprintf(out, "\t\t{ \"name\": \"%s\", \"items\": %llu, \"samples\": %d, \"ns_per_item\": %.4f, \"min_ns_per_item\": %.4f, \"max_ns_per_item\": %.4f }%s\n",
+			result.name.c_str(), static_cast<unsigned long long>(result.items), result.samples, result.median, result.min, result.max,
+			i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "\t]\n}\n");
+	fclose(out);
+	return true;
+}
+
+// Reads back the name and ns_per_item of each benchmark from a file written by
+// writeResults. Only that layout is understood, not JSON in general.
+static bool readBaseline(const char *file, std::map<std::string, double> &baseline)
+{
+	FILE *in = fopen(file, "r");
+	if (in == nullptr)
+	{
+		printf("Unable to open baseline %s\n", file);
+		return false;
+	}
+
+	std::string text;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0)
+		text.append(buffer, read);
+	fclose(in);
+
+	const std::string nameKey = "\"name\": \"";
+	const std::string timeKey = "\"ns_per_item\": ";
+	size_t pos = 0;
+	while ((pos = text.find(nameKey, pos)) != std::string::npos)
+	{
+		size_t start = pos + nameKey.size();
+		size_t end = text.find('"', start);
+		size_t time = text.find(timeKey, end);
+		if (end == std::string::npos || time == std::string::npos)
+			break;
+
+		baseline[text.substr(start, end - start)] = atof(text.c_str() + time + timeKey.size());
+		pos = time;
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 2;
+	}
+
+	std::map<std::string, double> baseline;
+	if (options.baseline != nullptr && !readBaseline(options.baseline, baseline))
+		return 2;
+
+	std::vector<Benchmark> benchmarks;
+	registerCommandQueueBenchmarks(benchmarks);
+	registerMemoryBenchmarks(benchmarks);
+	registerHandleBenchmarks(benchmarks);
+
+	std::vector<Result> results;
+	int32_t regressions = 0;
+	for (const Benchmark &benchmark : benchmarks)
+	{
+		if (options.filter != nullptr && benchmark.name.find(options.filter) == std::string::npos)
+			continue;
+
+		Result result = runBenchmark(benchmark, options.samples);
+		results.push_back(result);
+		printf("%-40s %10.3f ns/item  (min %.3f, max %.3f)", result.name.c_str(), result.median, result.min, result.max);
+
+		auto base = baseline.find(result.name);
+		if (base != baseline.end() && base->second > 0.0)
+		{
+			double change = (result.median - base->second) / base->second * 100.0;
+			bool regressed = change > options.threshold;
+			printf("  %+7.2f%%%s", change, regressed ? "  REGRESSION" : "");
+			if (regressed)
+				++regressions;
+		}
+		printf("\n");
+	}
+
+	if (options.output != nullptr && !writeResults(options.output, results))
+		return 2;
+
+	if (regressions > 0)
+	{
+		printf("%d benchmark(s) slower than the baseline by more than %.1f%%\n", regressions, options.threshold);
+		return 1;
+	}
+	return 0;
+}
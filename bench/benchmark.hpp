@@ -0,0 +1,104 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_BENCH_BENCHMARK_HPP_
+#define _JIKKEN_BENCH_BENCHMARK_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace JikkenBench
+{
+	/// Times the part of a batch that is being measured. A benchmark runs one
+	/// batch per call and wraps the work it wants counted in start()/stop(),
+	/// leaving setup and cleanup out.
+	class Timer
+	{
+	public:
+		Timer() :
+			mElapsed(0),
+			mItems(0)
+		{
+		}
+
+		inline void start()
+		{
+			mStart = std::chrono::steady_clock::now();
+		}
+
+		inline void stop()
+		{
+			mElapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStart).count();
+		}
+
+		/// Number of operations the batch performed, results are reported per item.
+		inline void setItems(uint64_t items)
+		{
+			mItems = items;
+		}
+
+		inline int64_t getElapsed() const
+		{
+			return mElapsed;
+		}
+
+		inline uint64_t getItems() const
+		{
+			return mItems;
+		}
+
+	private:
+		std::chrono::steady_clock::time_point mStart;
+		int64_t mElapsed;
+		uint64_t mItems;
+	};
+
+	typedef void (*BenchmarkFunc)(Timer &timer);
+
+	struct Benchmark
+	{
+		std::string name;
+		BenchmarkFunc func;
+	};
+
+	/// Stores value where the compiler can't see it being unused, so the work
+	/// producing it isn't optimized away. The sink is read back so GCC doesn't
+	/// warn that it is only ever set; the read is volatile too, so it stays.
+	template<typename T>
+	inline void doNotOptimize(T value)
+	{
+		static volatile T sink;
+		sink = value;
+		static_cast<void>(sink);
+	}
+
+	// Each file of benchmarks adds its own to the list.
+	void registerCommandQueueBenchmarks(std::vector<Benchmark> &benchmarks);
+	void registerMemoryBenchmarks(std::vector<Benchmark> &benchmarks);
+	void registerHandleBenchmarks(std::vector<Benchmark> &benchmarks);
+}
+
+#endif
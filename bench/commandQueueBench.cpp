@@ -0,0 +1,238 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "benchmark.hpp"
+#include "jikken/jikken.hpp"
+
+using namespace Jikken;
+
+namespace JikkenBench
+{
+	// Commands recorded or decoded per batch.
+	static const uint32_t CommandsPerBatch = 100000;
+
+	// One null device shared by every benchmark, created on first use.
+	static GraphicsDevice* getDevice()
+	{
+		static GraphicsDevice *device = nullptr;
+		if (device == nullptr)
+			device = createGraphicsDevice(API::eNull, nullptr);
+		return device;
+	}
+
+	static CommandQueue* getQueue()
+	{
+		static CommandQueue *queue = nullptr;
+		if (queue == nullptr)
+			queue = getDevice()->createCommandQueue();
+		return queue;
+	}
+
+	// Handles for commands that the null device validates in debug builds.
+	struct Resources
+	{
+		ShaderHandle shader;
+		BufferHandle vertexBuffer;
+		BufferHandle indexBuffer;
+		BufferHandle constantBuffer;
+		LayoutHandle layout;
+		VertexArrayHandle vao;
+		TextureHandle texture;
+
+		Resources()
+		{
+			GraphicsDevice *device = getDevice();
+			shader = device->createShader({ { "bench.vert", ShaderStage::eVertex }, { "bench.frag", ShaderStage::eFragment } });
+			vertexBuffer = device->createBuffer(BufferType::eVertexBuffer, BufferUsageHint::eStaticDraw, 4096, nullptr);
+			indexBuffer = device->createBuffer(BufferType::eIndexBuffer, BufferUsageHint::eStaticDraw, 4096, nullptr);
+			constantBuffer = device->createBuffer(BufferType::eConstantBuffer, BufferUsageHint::eStreamDraw, MemoryPool::MEGABYTE, nullptr);
+			layout = device->createVertexInputLayout({ { ePOSITION, 3, eFLOAT, 12, 0, false, false, 0, VertexInputRate::eVertex, 0 } });
+			vao = device->createVAO(layout, vertexBuffer, indexBuffer, IndexType::eUInt16);
+			TextureDetails details = { TextureType::e2D, TextureFormat::eRGBA8, 256, 256, 1, 1 };
+			texture = device->createTexture(details);
+		}
+	};
+
+	static const Resources& getResources()
+	{
+		static Resources resources;
+		return resources;
+	}
+
+	// Records count commands with record, timing only the recording. The
+	// queue is submitted afterwards so the next batch starts empty.
+	template<typename Record>
+	static void recordBatch(Timer &timer, uint32_t count, Record record)
+	{
+		CommandQueue *queue = getQueue();
+		const Resources &res = getResources();
+		SetShaderCommand setShader = { res.shader };
+		BindVAOCommand bindVAO = { res.vao };
+		queue->addSetShaderCommand(&setShader);
+		queue->addBindVAOCommand(&bindVAO);
+
+		timer.start();
+		for (uint32_t i = 0; i < count; ++i)
+			record(queue, i);
+		timer.stop();
+		timer.setItems(count);
+
+		getDevice()->submitCommandQueue(queue);
+	}
+
+	static void recordSetShader(Timer &timer)
+	{
+		SetShaderCommand cmd = { getResources().shader };
+		recordBatch(timer, CommandsPerBatch, [&](CommandQueue *queue, uint32_t)
+		{
+			queue->addSetShaderCommand(&cmd);
+		});
+	}
+
+	static void recordDraw(Timer &timer)
+	{
+		recordBatch(timer, CommandsPerBatch, [](CommandQueue *queue, uint32_t i)
+		{
+			DrawCommand cmd = { PrimitiveType::eTriangles, i & 1023, 36, 0 };
+			queue->addDrawCommand(&cmd);
+		});
+	}
+
+	static void recordDrawInstance(Timer &timer)
+	{
+		recordBatch(timer, CommandsPerBatch, [](CommandQueue *queue, uint32_t i)
+		{
+			DrawInstanceCommand cmd = { PrimitiveType::eTriangles, 0, 36, 16, 0, i & 1023 };
+			queue->addDrawInstanceCommand(&cmd);
+		});
+	}
+
+	static void recordBindVertexBuffers(Timer &timer)
+	{
+		const Resources &res = getResources();
+		BindVertexBuffersCommand cmd = {};
+		cmd.layout = res.layout;
+		cmd.bufferCount = 1;
+		cmd.vertexBuffers[0] = res.vertexBuffer;
+		cmd.indexBuffer = res.indexBuffer;
+		cmd.indexType = IndexType::eUInt16;
+		recordBatch(timer, CommandsPerBatch, [&](CommandQueue *queue, uint32_t i)
+		{
+			cmd.offsets[0] = (i & 63) * 64;
+			queue->addBindVertexBuffersCommand(&cmd);
+		});
+	}
+
+	static void recordSetConstantBufferRange(Timer &timer)
+	{
+		BufferHandle buffer = getResources().constantBuffer;
+		recordBatch(timer, CommandsPerBatch, [&](CommandQueue *queue, uint32_t i)
+		{
+			SetConstantBufferRangeCommand cmd = { buffer, 0, (i & 1023) * 256, 256 };
+			queue->addSetConstantBufferRangeCommand(&cmd);
+		});
+	}
+
+	// Commands with data copy it into the queue's data pages too.
+	static void recordUpdateBuffer64(Timer &timer)
+	{
+		uint8_t data[64] = {};
+		BufferHandle buffer = getResources().constantBuffer;
+		recordBatch(timer, CommandsPerBatch / 4, [&](CommandQueue *queue, uint32_t i)
+		{
+			UpdateBufferCommand cmd = { buffer, (i & 1023) * 256, sizeof(data), data };
+			queue->addUpdateBufferCommand(&cmd);
+		});
+	}
+
+	static void recordUpdateTexture4K(Timer &timer)
+	{
+		static uint8_t data[4096] = {};
+		TextureHandle texture = getResources().texture;
+		// 1000 x 4 KB stays within one 4 MB data page.
+		recordBatch(timer, 1000, [&](CommandQueue *queue, uint32_t i)
+		{
+			UpdateTextureCommand cmd = { texture, 0, 0, 0, (i & 15) * 4, 256, 4, sizeof(data), data };
+			queue->addUpdateTextureCommand(&cmd);
+		});
+	}
+
+	// A frame like mix: per object constants, a draw, a shader change every 64 objects.
+	static void recordFrame(CommandQueue *queue, uint32_t objects)
+	{
+		const Resources &res = getResources();
+		BeginFrameCommand begin = { eColor | eDepth, { 0.0f, 0.0f, 0.0f, 1.0f }, 1.0f, 0 };
+		SetShaderCommand setShader = { res.shader };
+		BindVAOCommand bindVAO = { res.vao };
+		queue->addBeginFrameCommand(&begin);
+		queue->addBindVAOCommand(&bindVAO);
+		for (uint32_t i = 0; i < objects; ++i)
+		{
+			if ((i & 63) == 0)
+				queue->addSetShaderCommand(&setShader);
+			SetConstantBufferRangeCommand range = { res.constantBuffer, 0, (i & 1023) * 256, 256 };
+			queue->addSetConstantBufferRangeCommand(&range);
+			DrawCommand draw = { PrimitiveType::eTriangles, 0, 36, 0 };
+			queue->addDrawCommand(&draw);
+		}
+	}
+
+	static void submitNullFrame(Timer &timer)
+	{
+		CommandQueue *queue = getQueue();
+		const uint32_t objects = CommandsPerBatch / 2;
+		recordFrame(queue, objects);
+
+		timer.start();
+		getDevice()->submitCommandQueue(queue);
+		timer.stop();
+		// Two commands per object dominate, the rest is noise.
+		timer.setItems(objects * 2);
+	}
+
+	static void recordAndSubmitNullFrame(Timer &timer)
+	{
+		CommandQueue *queue = getQueue();
+		const uint32_t objects = CommandsPerBatch / 2;
+
+		timer.start();
+		recordFrame(queue, objects);
+		getDevice()->submitCommandQueue(queue);
+		timer.stop();
+		timer.setItems(objects * 2);
+	}
+
+	void registerCommandQueueBenchmarks(std::vector<Benchmark> &benchmarks)
+	{
+		benchmarks.push_back({ "record/set_shader", recordSetShader });
+		benchmarks.push_back({ "record/draw", recordDraw });
+		benchmarks.push_back({ "record/draw_instance", recordDrawInstance });
+		benchmarks.push_back({ "record/bind_vertex_buffers", recordBindVertexBuffers });
+		benchmarks.push_back({ "record/set_constant_buffer_range", recordSetConstantBufferRange });
+		benchmarks.push_back({ "record/update_buffer_64b", recordUpdateBuffer64 });
+		benchmarks.push_back({ "record/update_texture_4kb", recordUpdateTexture4K });
+		benchmarks.push_back({ "submit/null_frame", submitNullFrame });
+		benchmarks.push_back({ "submit/null_record_and_submit", recordAndSubmitNullFrame });
+	}
+}
@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <random>
+#include <unordered_map>
+#include "benchmark.hpp"
+#include "jikken/types.hpp"
+
+using namespace Jikken;
+
+namespace JikkenBench
+{
+	// Matches the backends: handles come from an incrementing counter and
+	// index an unordered_map of per resource state.
+	static const uint32_t TableSize = 4096;
+	static const uint32_t LookupsPerBatch = 100000;
+
+	struct Resource
+	{
+		uint32_t id;
+		uint32_t size;
+		uint32_t flags;
+	};
+
+	static std::unordered_map<BufferHandle, Resource>& getMap()
+	{
+		static std::unordered_map<BufferHandle, Resource> map;
+		if (map.empty())
+		{
+			for (uint32_t i = 0; i < TableSize; ++i)
+				map[i] = { i, i * 16, 0 };
+		}
+		return map;
+	}
+
+	static std::vector<Resource>& getVector()
+	{
+		static std::vector<Resource> vec;
+		if (vec.empty())
+		{
+			for (uint32_t i = 0; i < TableSize; ++i)
+				vec.push_back({ i, i * 16, 0 });
+		}
+		return vec;
+	}
+
+	// Lookup order from a fixed seed, like draws walking objects out of order.
+	static const std::vector<BufferHandle>& getRandomHandles()
+	{
+		static std::vector<BufferHandle> handles;
+		if (handles.empty())
+		{
+			std::mt19937 rng(1337);
+			std::uniform_int_distribution<BufferHandle> dist(0, TableSize - 1);
+			handles.resize(LookupsPerBatch);
+			for (BufferHandle &handle : handles)
+				handle = dist(rng);
+		}
+		return handles;
+	}
+
+	static void mapSequential(Timer &timer)
+	{
+		const std::unordered_map<BufferHandle, Resource> &map = getMap();
+		uint32_t sum = 0;
+		timer.start();
+		for (uint32_t i = 0; i < LookupsPerBatch; ++i)
+			sum += map.find(i % TableSize)->second.size;
+		timer.stop();
+		doNotOptimize(sum);
+		timer.setItems(LookupsPerBatch);
+	}
+
+	static void mapRandom(Timer &timer)
+	{
+		const std::unordered_map<BufferHandle, Resource> &map = getMap();
+		const std::vector<BufferHandle> &handles = getRandomHandles();
+		uint32_t sum = 0;
+		timer.start();
+		for (BufferHandle handle : handles)
+			sum += map.find(handle)->second.size;
+		timer.stop();
+		doNotOptimize(sum);
+		timer.setItems(handles.size());
+	}
+
+	// A miss is what every InvalidHandle check costs.
+	static void mapMiss(Timer &timer)
+	{
+		const std::unordered_map<BufferHandle, Resource> &map = getMap();
+		uint32_t misses = 0;
+		timer.start();
+		for (uint32_t i = 0; i < LookupsPerBatch; ++i)
+			misses += map.find(TableSize + i) == map.end();
+		timer.stop();
+		doNotOptimize(misses);
+		timer.setItems(LookupsPerBatch);
+	}
+
+	// Reference point for a flat table indexed by handle.
+	static void vectorRandom(Timer &timer)
+	{
+		const std::vector<Resource> &vec = getVector();
+		const std::vector<BufferHandle> &handles = getRandomHandles();
+		uint32_t sum = 0;
+		timer.start();
+		for (BufferHandle handle : handles)
+			sum += vec[handle].size;
+		timer.stop();
+		doNotOptimize(sum);
+		timer.setItems(handles.size());
+	}
+
+	void registerHandleBenchmarks(std::vector<Benchmark> &benchmarks)
+	{
+		benchmarks.push_back({ "handle/map_sequential", mapSequential });
+		benchmarks.push_back({ "handle/map_random", mapRandom });
+		benchmarks.push_back({ "handle/map_miss", mapMiss });
+		benchmarks.push_back({ "handle/vector_random", vectorRandom });
+	}
+}
@@ -0,0 +1,116 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <random>
+#include "benchmark.hpp"
+#include "jikken/memory.hpp"
+
+using namespace Jikken;
+
+namespace JikkenBench
+{
+	static const uint32_t AllocationsPerBatch = 100000;
+
+	// Sizes between 8 and 256 bytes from a fixed seed, so every run and the
+	// malloc comparison see the same sequence.
+	static const std::vector<size_t>& getMixedSizes()
+	{
+		static std::vector<size_t> sizes;
+		if (sizes.empty())
+		{
+			std::mt19937 rng(1337);
+			std::uniform_int_distribution<size_t> dist(1, 32);
+			sizes.resize(AllocationsPerBatch);
+			for (size_t &size : sizes)
+				size = dist(rng) * 8;
+		}
+		return sizes;
+	}
+
+	struct SmallObject
+	{
+		uint32_t a;
+		uint32_t b;
+		float c[4];
+	};
+
+	static void poolFixed(Timer &timer)
+	{
+		static MemoryPool pool(MemoryPool::MEGABYTE * 4, 1);
+		timer.start();
+		for (uint32_t i = 0; i < AllocationsPerBatch; ++i)
+			doNotOptimize(pool.malloc<SmallObject>());
+		pool.free();
+		timer.stop();
+		timer.setItems(AllocationsPerBatch);
+	}
+
+	static void poolMixed(Timer &timer)
+	{
+		static MemoryPool pool(MemoryPool::MEGABYTE * 4, 1);
+		const std::vector<size_t> &sizes = getMixedSizes();
+		timer.start();
+		for (size_t size : sizes)
+			doNotOptimize(pool.malloc(size));
+		pool.free();
+		timer.stop();
+		timer.setItems(sizes.size());
+	}
+
+	// malloc has to free each allocation, which is the cost the pool's
+	// single free() avoids.
+	static void mallocFixed(Timer &timer)
+	{
+		static std::vector<void*> pointers(AllocationsPerBatch);
+		timer.start();
+		for (uint32_t i = 0; i < AllocationsPerBatch; ++i)
+			pointers[i] = std::malloc(sizeof(SmallObject));
+		for (void *ptr : pointers)
+			std::free(ptr);
+		timer.stop();
+		timer.setItems(AllocationsPerBatch);
+	}
+
+	static void mallocMixed(Timer &timer)
+	{
+		static std::vector<void*> pointers(AllocationsPerBatch);
+		const std::vector<size_t> &sizes = getMixedSizes();
+		timer.start();
+		for (size_t i = 0; i < sizes.size(); ++i)
+			pointers[i] = std::malloc(sizes[i]);
+		for (size_t i = 0; i < sizes.size(); ++i)
+			std::free(pointers[i]);
+		timer.stop();
+		timer.setItems(sizes.size());
+	}
+
+	void registerMemoryBenchmarks(std::vector<Benchmark> &benchmarks)
+	{
+		benchmarks.push_back({ "memory/pool_fixed", poolFixed });
+		benchmarks.push_back({ "memory/pool_mixed", poolMixed });
+		benchmarks.push_back({ "memory/malloc_fixed", mallocFixed });
+		benchmarks.push_back({ "memory/malloc_mixed", mallocMixed });
+	}
+}
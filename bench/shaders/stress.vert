@@ -0,0 +1,16 @@
+#version 330 core
+layout(location = 0) in vec3 position;
+
+layout(std140) uniform Object
+{
+	vec4 offsetScale;
+	vec4 color;
+};
+
+out vec4 vColor;
+
+void main()
+{
+	gl_Position = vec4(position.xy * offsetScale.z + offsetScale.xy, position.z, 1.0);
+	vColor = color;
+}
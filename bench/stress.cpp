@@ -0,0 +1,403 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+// Scene level stress test: thousands of objects with their own vertex buffers
+// and VAOs, drawn with frequent shader and state changes, per object constant
+// updates and a few instanced batches. Runs the same frames on every backend
+// that can render without a window, so their CPU overhead can be compared.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "jikken/jikken.hpp"
+
+using namespace Jikken;
+
+struct Options
+{
+	const char *api;
+	std::string shaderDir;
+	uint32_t objects;
+	uint32_t shaders;
+	uint32_t frames;
+	uint32_t warmupFrames;
+};
+
+// Matches the Object block of the stress shaders.
+struct ObjectConstants
+{
+	float offsetScale[4];
+	float color[4];
+};
+
+struct Scene
+{
+	ShaderHandle instancedShader;
+	std::vector<ShaderHandle> shaders;
+	BufferHandle indexBuffer;
+	BufferHandle constantBuffer;
+	BufferHandle instanceBuffer;
+	BufferHandle instanceMesh;
+	LayoutHandle layout;
+	LayoutHandle instancedLayout;
+	VertexArrayHandle instancedVAO;
+	std::vector<BufferHandle> vertexBuffers;
+	std::vector<VertexArrayHandle> vaos;
+	std::vector<ObjectConstants> constants;
+	size_t constantStride;
+	uint32_t instancedBatches;
+};
+
+struct FrameTimes
+{
+	double record;
+	double submit;
+	double present;
+};
+
+// Objects switch shader, blend and cull state every so many draws.
+static const uint32_t ShaderRun = 64;
+static const uint32_t StateRun = 256;
+// One object in MovingEvery updates its constants every frame.
+static const uint32_t MovingEvery = 16;
+static const uint32_t InstancesPerBatch = 256;
+static const uint32_t ObjectsPerInstancedBatch = 1000;
+
+static const uint16_t QuadIndices[6] = { 0, 1, 2, 2, 1, 3 };
+
+static void printUsage()
+{
+	printf("usage: jikken_stress [options]\n");
+	printf("  --api <name>        null, gl or vulkan, default every compiled backend\n");
+	printf("  --objects <count>   objects with their own vertex buffer and VAO, default 10000\n");
+	printf("  --shaders <count>   shader programs the objects cycle through, default 16\n");
+	printf("  --frames <count>    measured frames, default 100\n");
+	printf("  --warmup <count>    frames run before measuring, default 10\n");
+	printf("  --shader-dir <dir>  directory holding the stress shaders\n");
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+	options.api = nullptr;
+	options.shaderDir = JIKKEN_BENCH_SHADER_DIR;
+	options.objects = 10000;
+	options.shaders = 16;
+	options.frames = 100;
+	options.warmupFrames = 10;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+			return false;
+		if (value == nullptr)
+		{
+			printf("Missing value for %s\n", arg);
+			return false;
+		}
+
+		if (strcmp(arg, "--api") == 0)
+			options.api = value;
+		else if (strcmp(arg, "--objects") == 0)
+			options.objects = std::max(atoi(value), 1);
+		else if (strcmp(arg, "--shaders") == 0)
+			options.shaders = std::max(atoi(value), 1);
+		else if (strcmp(arg, "--frames") == 0)
+			options.frames = std::max(atoi(value), 1);
+		else if (strcmp(arg, "--warmup") == 0)
+			options.warmupFrames = std::max(atoi(value), 0);
+		else if (strcmp(arg, "--shader-dir") == 0)
+			options.shaderDir = value;
+		else
+		{
+			printf("Unknown option %s\n", arg);
+			return false;
+		}
+		++i;
+	}
+	return true;
+}
+
+static void createScene(GraphicsDevice *device, const Options &options, Scene &scene)
+{
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::string vert = options.shaderDir + "/stress.vert";
+	std::string instancedVert = options.shaderDir + "/stressInstanced.vert";
+	std::string frag = options.shaderDir + "/stress.frag";
+
+	// Every object has its own small quad, so each draw binds a different VAO.
+	scene.layout = device->createVertexInputLayout({
+		{ ePOSITION, 3, eFLOAT, sizeof(float) * 3, 0, false, false, 0, VertexInputRate::eVertex, 0 }
+	});
+	scene.indexBuffer = device->createBuffer(BufferType::eIndexBuffer, BufferUsageHint::eStaticDraw, sizeof(QuadIndices), (float*)QuadIndices);
+	for (uint32_t i = 0; i < options.objects; ++i)
+	{
+		float depth = unit(rng);
+		float quad[12] = {
+			-1.0f, -1.0f, depth,
+			1.0f, -1.0f, depth,
+			-1.0f, 1.0f, depth,
+			1.0f, 1.0f, depth
+		};
+		BufferHandle vbo = device->createBuffer(BufferType::eVertexBuffer, BufferUsageHint::eStaticDraw, sizeof(quad), quad);
+		scene.vertexBuffers.push_back(vbo);
+		scene.vaos.push_back(device->createVAO(scene.layout, vbo, scene.indexBuffer, IndexType::eUInt16));
+	}
+
+	// Per object constants, each at its own aligned offset of one buffer.
+	size_t alignment = device->getConstantBufferAlignment();
+	scene.constantStride = (sizeof(ObjectConstants) + alignment - 1) / alignment * alignment;
+	scene.constants.resize(options.objects);
+	std::vector<uint8_t> constantData(scene.constantStride * options.objects);
+	for (uint32_t i = 0; i < options.objects; ++i)
+	{
+		ObjectConstants &obj = scene.constants[i];
+		// Small quads keep software rasterizers from dominating the frame.
+		obj = { { unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f, 0.01f, 0.0f }, { unit(rng), unit(rng), unit(rng), 1.0f } };
+		memcpy(constantData.data() + scene.constantStride * i, &obj, sizeof(obj));
+	}
+	scene.constantBuffer = device->createBuffer(BufferType::eConstantBuffer, BufferUsageHint::eDynamicDraw, constantData.size(), (float*)constantData.data());
+
+	for (uint32_t i = 0; i < options.shaders; ++i)
+	{
+		ShaderHandle shader = device->createShader({ { vert, ShaderStage::eVertex }, { frag, ShaderStage::eFragment } });
+		device->bindConstantBuffer(shader, scene.constantBuffer, "Object", 0);
+		scene.shaders.push_back(shader);
+	}
+
+	// Instanced batches share one quad and read their offsets from binding 1.
+	float quad[12] = { -1.0f, -1.0f, 0.5f, 1.0f, -1.0f, 0.5f, -1.0f, 1.0f, 0.5f, 1.0f, 1.0f, 0.5f };
+	scene.instanceMesh = device->createBuffer(BufferType::eVertexBuffer, BufferUsageHint::eStaticDraw, sizeof(quad), quad);
+	std::vector<float> instances(InstancesPerBatch * 4);
+	for (uint32_t i = 0; i < InstancesPerBatch; ++i)
+	{
+		instances[i * 4 + 0] = unit(rng) * 2.0f - 1.0f;
+		instances[i * 4 + 1] = unit(rng) * 2.0f - 1.0f;
+		instances[i * 4 + 2] = 0.005f;
+		instances[i * 4 + 3] = 0.0f;
+	}
+	scene.instanceBuffer = device->createBuffer(BufferType::eVertexBuffer, BufferUsageHint::eStaticDraw, instances.size() * sizeof(float), instances.data());
+
+	// The mesh is read per vertex from binding 0, offset and scale once per instance from binding 1.
+	VertexInputLayout position = { ePOSITION, 3, eFLOAT, sizeof(float) * 3, 0, false, false, 0, VertexInputRate::eVertex, 0 };
+	VertexInputLayout offsetScale = { eTEXCOORD1, 4, eFLOAT, sizeof(float) * 4, 0, false, false, 1, VertexInputRate::eInstance, 1 };
+	scene.instancedLayout = device->createVertexInputLayout({ position, offsetScale });
+	scene.instancedVAO = device->createVAO(scene.instancedLayout, { scene.instanceMesh, scene.instanceBuffer }, scene.indexBuffer, IndexType::eUInt16);
+
+	scene.instancedShader = device->createShader({ { instancedVert, ShaderStage::eVertex }, { frag, ShaderStage::eFragment } });
+	device->bindConstantBuffer(scene.instancedShader, scene.constantBuffer, "Object", 0);
+	scene.instancedBatches = std::max(options.objects / ObjectsPerInstancedBatch, 1u);
+}
+
+static void destroyScene(GraphicsDevice *device, Scene &scene)
+{
+	for (VertexArrayHandle vao : scene.vaos)
+		device->deleteVAO(vao);
+	for (BufferHandle vbo : scene.vertexBuffers)
+		device->deleteBuffer(vbo);
+	for (ShaderHandle shader : scene.shaders)
+		device->deleteShader(shader);
+	device->deleteVAO(scene.instancedVAO);
+	device->deleteShader(scene.instancedShader);
+	device->deleteBuffer(scene.instanceMesh);
+	device->deleteBuffer(scene.instanceBuffer);
+	device->deleteBuffer(scene.constantBuffer);
+	device->deleteBuffer(scene.indexBuffer);
+	device->deleteVertexInputLayout(scene.instancedLayout);
+	device->deleteVertexInputLayout(scene.layout);
+}
+
+static void recordFrame(CommandQueue *queue, Scene &scene, uint32_t frame)
+{
+	BeginFrameCommand begin = { eColor | eDepth, { 0.1f, 0.1f, 0.1f, 1.0f }, 1.0f, 0 };
+	queue->addBeginFrameCommand(&begin);
+
+	DepthStencilStateCommand depth = { true, true, DepthFunc::eLess };
+	queue->addDepthStencilStateCommand(&depth);
+
+	for (uint32_t i = 0; i < scene.vaos.size(); ++i)
+	{
+		if (i % ShaderRun == 0)
+		{
+			SetShaderCommand shader = { scene.shaders[(i / ShaderRun) % scene.shaders.size()] };
+			queue->addSetShaderCommand(&shader);
+		}
+		if (i % StateRun == 0)
+		{
+			bool odd = ((i / StateRun) & 1) != 0;
+			BlendStateCommand blend = { odd, BlendState::eSrcAlpha, BlendState::eOneMinusSrcAlpha };
+			CullStateCommand cull = { !odd, CullFaceState::eBack, WindingOrderState::eCCW };
+			queue->addBlendStateCommand(&blend);
+			queue->addCullStateCommand(&cull);
+		}
+
+		size_t offset = scene.constantStride * i;
+		if (i % MovingEvery == frame % MovingEvery)
+		{
+			ObjectConstants &obj = scene.constants[i];
+			obj.offsetScale[0] = obj.offsetScale[0] > 1.0f ? -1.0f : obj.offsetScale[0] + 0.01f;
+			UpdateBufferCommand update = { scene.constantBuffer, offset, sizeof(ObjectConstants), &obj };
+			queue->addUpdateBufferCommand(&update);
+		}
+
+		BindVAOCommand bind = { scene.vaos[i] };
+		SetConstantBufferRangeCommand range = { scene.constantBuffer, 0, offset, sizeof(ObjectConstants) };
+		DrawCommand draw = { PrimitiveType::eTriangles, 0, 6, 0 };
+		queue->addBindVAOCommand(&bind);
+		queue->addSetConstantBufferRangeCommand(&range);
+		queue->addDrawCommand(&draw);
+	}
+
+	SetShaderCommand shader = { scene.instancedShader };
+	BindVAOCommand bind = { scene.instancedVAO };
+	queue->addSetShaderCommand(&shader);
+	queue->addBindVAOCommand(&bind);
+	for (uint32_t i = 0; i < scene.instancedBatches; ++i)
+	{
+		SetConstantBufferRangeCommand range = { scene.constantBuffer, 0, scene.constantStride * i, sizeof(ObjectConstants) };
+		DrawInstanceCommand draw = { PrimitiveType::eTriangles, 0, 6, InstancesPerBatch, 0, 0 };
+		queue->addSetConstantBufferRangeCommand(&range);
+		queue->addDrawInstanceCommand(&draw);
+	}
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool runBackend(const char *name, API api, const Options &options)
+{
+	DeviceConfig config;
+	config.headless = true;
+	config.headlessWidth = 1280;
+	config.headlessHeight = 720;
+	GraphicsDevice *device = createGraphicsDevice(api, nullptr, config);
+	if (device == nullptr)
+	{
+		printf("%-8s unable to create a headless device\n", name);
+		return false;
+	}
+
+	Scene scene;
+	createScene(device, options, scene);
+	CommandQueue *queue = device->createCommandQueue();
+
+	auto runFrame = [&](uint32_t frame, FrameTimes &times)
+	{
+		auto start = std::chrono::steady_clock::now();
+		recordFrame(queue, scene, frame);
+		times.record += millisecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		device->submitCommandQueue(queue);
+		times.submit += millisecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		device->presentFrame();
+		times.present += millisecondsSince(start);
+	};
+
+	// Reading a pixel back waits for the GPU, so frames queued by the driver
+	// are counted in the wall time.
+	uint8_t pixel[4];
+	FrameTimes times = {};
+	for (uint32_t i = 0; i < options.warmupFrames; ++i)
+		runFrame(i, times);
+	device->readPixels(InvalidHandle, 0, 0, 0, 1, 1, pixel);
+
+	times = {};
+	device->resetStats();
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < options.frames; ++i)
+		runFrame(options.warmupFrames + i, times);
+	device->readPixels(InvalidHandle, 0, 0, 0, 1, 1, pixel);
+	double wall = millisecondsSince(start);
+
+	const DeviceStats &stats = device->getStats();
+	double frames = static_cast<double>(options.frames);
+	double drawsPerFrame = static_cast<double>(scene.vaos.size() + scene.instancedBatches);
+	double cpu = (times.record + times.submit + times.present) / frames;
+
+	printf("%-8s %10.0f draws/s  cpu %7.3f ms/frame (record %.3f, submit %.3f, present %.3f)  wall %7.3f ms/frame\n",
+		name, drawsPerFrame * frames / (wall / 1000.0), cpu,
+		times.record / frames, times.submit / frames, times.present / frames, wall / frames);
+	printf("%-8s per frame: %.0f commands, %.0f draw calls, %.0f state calls, %.0f upload calls\n",
+		"", stats.commands / frames, stats.drawCalls / frames, stats.stateCalls / frames, stats.uploadCalls / frames);
+
+	device->deleteCommandQueue(queue);
+	destroyScene(device, scene);
+	destroyGraphicsDevice(device);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 2;
+	}
+
+	printf("%u objects, %u shaders, %u frames\n", options.objects, options.shaders, options.frames);
+
+	bool all = options.api == nullptr;
+	bool ok = true;
+	if (all || strcmp(options.api, "null") == 0)
+		ok &= runBackend("null", API::eNull, options);
+
+	if (all || strcmp(options.api, "gl") == 0)
+	{
+		// Without a window OpenGL needs an EGL context.
+#if defined(JIKKEN_OPENGL) && defined(JIKKEN_EGL)
+		ok &= runBackend("gl", API::eOpenGL, options);
+#else
+		printf("%-8s skipped, build with JIKKEN_OPENGL and JIKKEN_EGL\n", "gl");
+		ok &= all;
+#endif
+	}
+
+	if (all || strcmp(options.api, "vulkan") == 0)
+	{
+		// Headless Vulkan renders into an image of its own, so software
+		// drivers such as lavapipe work without a display.
+#ifdef JIKKEN_VULKAN
+		ok &= runBackend("vulkan", API::eVulkan, options);
+#else
+		printf("%-8s skipped, build with JIKKEN_VULKAN\n", "vulkan");
+		ok &= all;
+#endif
+	}
+
+	return ok ? 0 : 1;
+}
@@ -191,12 +191,114 @@ namespace Jikken
 			writeCmd(cmd, sizeof(BindVAOCommand));
 		}
 
+		inline void addBindVertexBuffersCommand(const BindVertexBuffersCommand *cmd)
+		{
+			writeCmd(eBindVertexBuffers);
+			writeCmd(cmd, sizeof(BindVertexBuffersCommand));
+		}
+
 		inline void addDrawCommand(const DrawCommand *cmd)
 		{
 			writeCmd(eDraw);
 			writeCmd(cmd, sizeof(DrawCommand));
 		}
 
+		inline void addDrawInstanceCommand(const DrawInstanceCommand *cmd)
+		{
+			writeCmd(eDrawInstance);
+			writeCmd(cmd, sizeof(DrawInstanceCommand));
+		}
+
+		inline void addSetConstantBufferRangeCommand(const SetConstantBufferRangeCommand *cmd)
+		{
+			writeCmd(eSetConstantBufferRange);
+			writeCmd(cmd, sizeof(SetConstantBufferRangeCommand));
+		}
+
+		inline void addUpdateTextureCommand(const UpdateTextureCommand *cmd)
+		{
+			writeCmd(eUpdateTexture);
+			writeCmd(cmd->texture);
+			writeCmd(cmd->mipLevel);
+			writeCmd(cmd->layer);
+			writeCmd(cmd->x);
+			writeCmd(cmd->y);
+			writeCmd(cmd->width);
+			writeCmd(cmd->height);
+			writeCmd(cmd->dataSize);
+			//write data
+			writeData(cmd->data, cmd->dataSize);
+		}
+
+		inline void addBindTextureCommand(const BindTextureCommand *cmd)
+		{
+			writeCmd(eBindTexture);
+			writeCmd(cmd, sizeof(BindTextureCommand));
+		}
+
+		inline void addBindRenderTargetCommand(const BindRenderTargetCommand *cmd)
+		{
+			writeCmd(eBindRenderTarget);
+			writeCmd(cmd, sizeof(BindRenderTargetCommand));
+		}
+
+		inline void addResolveRenderTargetCommand(const ResolveRenderTargetCommand *cmd)
+		{
+			writeCmd(eResolveRenderTarget);
+			writeCmd(cmd, sizeof(ResolveRenderTargetCommand));
+		}
+
+		inline void addSetStorageBufferRangeCommand(const SetStorageBufferRangeCommand *cmd)
+		{
+			writeCmd(eSetStorageBufferRange);
+			writeCmd(cmd, sizeof(SetStorageBufferRangeCommand));
+		}
+
+		inline void addDispatchCommand(const DispatchCommand *cmd)
+		{
+			writeCmd(eDispatch);
+			writeCmd(cmd, sizeof(DispatchCommand));
+		}
+
+		inline void addDispatchIndirectCommand(const DispatchIndirectCommand *cmd)
+		{
+			writeCmd(eDispatchIndirect);
+			writeCmd(cmd, sizeof(DispatchIndirectCommand));
+		}
+
+		inline void addMemoryBarrierCommand(const MemoryBarrierCommand *cmd)
+		{
+			writeCmd(eMemoryBarrier);
+			writeCmd(cmd, sizeof(MemoryBarrierCommand));
+		}
+
+		inline void addBeginQueryCommand(const BeginQueryCommand *cmd)
+		{
+			writeCmd(eBeginQuery);
+			writeCmd(cmd, sizeof(BeginQueryCommand));
+		}
+
+		inline void addEndQueryCommand(const EndQueryCommand *cmd)
+		{
+			writeCmd(eEndQuery);
+			writeCmd(cmd, sizeof(EndQueryCommand));
+		}
+
+		inline void addConditionalRenderCommand(const ConditionalRenderCommand *cmd)
+		{
+			writeCmd(eConditionalRender);
+			writeCmd(cmd, sizeof(ConditionalRenderCommand));
+		}
+
+		inline void addSetConstantsCommand(const SetConstantsCommand *cmd)
+		{
+			writeCmd(eSetConstants);
+			writeCmd(cmd->index);
+			writeCmd(cmd->dataSize);
+			//write data
+			writeData(cmd->data, cmd->dataSize);
+		}
+
 
 	private:
 
@@ -45,6 +45,20 @@ namespace Jikken
 		eBlendState,
 		eDepthStencilState,
 		eCullState,
+		eSetConstantBufferRange,
+		eBindVertexBuffers,
+		eBindRenderTarget,
+		eResolveRenderTarget,
+		eUpdateTexture,
+		eBindTexture,
+		eSetStorageBufferRange,
+		eDispatch,
+		eDispatchIndirect,
+		eMemoryBarrier,
+		eBeginQuery,
+		eEndQuery,
+		eConditionalRender,
+		eSetConstants,
 		eFinishQueue //special value, doesn't need command struct
 	};
 
@@ -78,11 +92,21 @@ namespace Jikken
 		BufferUsageHint hint;
 	};
 
+	// For indexed draws, start is the first index to read and baseVertex is
+	// added to every index before fetching vertices. Strip primitives restart
+	// when they read the largest value of the VAO's index type.
+	//
+	// Breaking changes: start used to be a byte offset into the index buffer
+	// for indexed draws, it now counts indices. baseVertex, and baseInstance
+	// of DrawInstanceCommand, were added without defaults so the commands stay
+	// aggregates under C++11. Code that sets the fields one by one has to set
+	// them too, usually to 0, or value initialize the command with {}.
 	struct DrawCommand
 	{
 		PrimitiveType primitive;
 		uint32_t start;
 		uint32_t count;
+		int32_t baseVertex;
 	};
 
 	struct DrawInstanceCommand
@@ -91,6 +115,8 @@ namespace Jikken
 		uint32_t start;
 		uint32_t count;
 		uint32_t instancedCount;
+		int32_t baseVertex;
+		uint32_t baseInstance;
 	};
 
 	struct ClearBufferCommand
@@ -103,6 +129,22 @@ namespace Jikken
 		VertexArrayHandle vertexArray;
 	};
 
+	const uint32_t MaxVertexBufferBindings = 8;
+
+	// Attaches buffers to a vertex input layout for the following draws, instead
+	// of baking them into a VAO. vertexBuffers[i] feeds binding i of the layout,
+	// starting offsets[i] bytes into the buffer. indexBuffer may be InvalidHandle
+	// for non indexed draws.
+	struct BindVertexBuffersCommand
+	{
+		LayoutHandle layout;
+		uint32_t bufferCount;
+		BufferHandle vertexBuffers[MaxVertexBufferBindings];
+		size_t offsets[MaxVertexBufferBindings];
+		BufferHandle indexBuffer;
+		IndexType indexType;
+	};
+
 	struct ViewportCommand
 	{
 		int16_t x;
@@ -132,5 +174,137 @@ namespace Jikken
 		CullFaceState face;
 		WindingOrderState state;
 	};
+
+	// Binds a sub range of a constant buffer to a block index. The offset
+	// must be a multiple of GraphicsDevice::getConstantBufferAlignment().
+	struct SetConstantBufferRangeCommand
+	{
+		BufferHandle buffer;
+		uint32_t index;
+		size_t offset;
+		size_t size;
+	};
+
+	// Sends rendering to a render target. InvalidHandle goes back to the
+	// default framebuffer.
+	struct BindRenderTargetCommand
+	{
+		RenderTargetHandle target;
+	};
+
+	// Copies the buffers in flag (ClearBufferFlags) from source to destination,
+	// resolving multisampled sources. InvalidHandle as destination is the
+	// default framebuffer, which has the size of the window or of the headless
+	// surface. Color is read from colorAttachment of source and written to
+	// every color attachment of destination. Only color can be scaled, and a
+	// multisampled source must match the destination size. Vulkan only
+	// resolves color into the default framebuffer, so depth and stencil
+	// should only be copied between render targets.
+	struct ResolveRenderTargetCommand
+	{
+		RenderTargetHandle source;
+		RenderTargetHandle destination;
+		uint32_t colorAttachment;
+		uint32_t flag;
+	};
+
+	// Uploads a region of one mip level of one layer. Rows are tightly packed.
+	// The data is copied into the queue, so dataSize is limited by the queue's
+	// data page; split large levels into bands of rows.
+	struct UpdateTextureCommand
+	{
+		TextureHandle texture;
+		uint32_t mipLevel;
+		uint32_t layer;
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+		size_t dataSize;
+		void *data;
+	};
+
+	// A sampler of InvalidHandle uses the texture's own sampling state.
+	struct BindTextureCommand
+	{
+		TextureHandle texture;
+		SamplerHandle sampler;
+		uint32_t unit;
+	};
+
+	// Binds a sub range of a storage buffer to a block index. The offset must
+	// be a multiple of GraphicsDevice::getStorageBufferAlignment(). A size of 0
+	// binds the rest of the buffer.
+	struct SetStorageBufferRangeCommand
+	{
+		BufferHandle buffer;
+		uint32_t index;
+		size_t offset;
+		size_t size;
+	};
+
+	// Runs the compute shader set with SetShaderCommand over a grid of work groups.
+	struct DispatchCommand
+	{
+		uint32_t groupsX;
+		uint32_t groupsY;
+		uint32_t groupsZ;
+	};
+
+	// Like DispatchCommand, but the three group counts are read as uint32_t
+	// from a storage buffer at offset, which must be a multiple of 4. Lets a
+	// compute pass size the next one without a round trip to the CPU.
+	struct DispatchIndirectCommand
+	{
+		BufferHandle buffer;
+		size_t offset;
+	};
+
+	// Compute shader writes are not visible to later commands until a barrier
+	// covering the way they are read (MemoryBarrierFlags).
+	struct MemoryBarrierCommand
+	{
+		uint32_t barriers;
+	};
+
+	// Counts the samples that pass the depth and stencil tests in draws
+	// between BeginQueryCommand and EndQueryCommand. Only one query of each
+	// type can be active at a time.
+	struct BeginQueryCommand
+	{
+		QueryHandle query;
+	};
+
+	struct EndQueryCommand
+	{
+		QueryHandle query;
+	};
+
+	// Skips the following draws when the last result of query counted no
+	// samples. The decision is made on the GPU, so the CPU never waits on it.
+	// With wait false, draws are not skipped while the result is still
+	// pending. InvalidHandle ends conditional rendering. On Vulkan, draws
+	// recorded on other threads by submitCommandQueues are never skipped, and
+	// devices without VK_EXT_conditional_rendering decide on the CPU from the
+	// newest result already back.
+	struct ConditionalRenderCommand
+	{
+		QueryHandle query;
+		bool wait;
+	};
+
+	// Largest SetConstantsCommand, the push constant space every Vulkan device has.
+	const uint32_t MaxConstantsSize = 128;
+
+	// Small per draw data, such as a transform or a chunk origin, without a
+	// buffer to manage. The following draws read it as the constant buffer
+	// at index. Vulkan shaders that declare a push_constant block read it
+	// from there instead. The data is copied into the queue.
+	struct SetConstantsCommand
+	{
+		uint32_t index;
+		uint32_t dataSize; // at most MaxConstantsSize
+		void *data;
+	};
 }
 #endif
\ No newline at end of file
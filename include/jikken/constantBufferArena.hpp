@@ -0,0 +1,101 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_CONSTANTBUFFERARENA_HPP_
+#define _JIKKEN_CONSTANTBUFFERARENA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include "jikken/types.hpp"
+
+namespace Jikken
+{
+	class GraphicsDevice;
+	class CommandQueue;
+
+	/// A large constant buffer that is sub-allocated linearly, one block per draw.
+	/// Each allocation starts at the device's constant buffer offset alignment so it
+	/// can be bound with a SetConstantBufferRangeCommand. Constants are written to a
+	/// CPU copy of the buffer and sent to the GPU with a single update by upload().
+	/// Once reset() is called, all allocations are considered to be freed.
+	class ConstantBufferArena
+	{
+	public:
+		/// @param size Size in bytes of the arena. It is uploaded through a
+		/// CommandQueue, so it can't be larger than the queue's data page.
+		ConstantBufferArena(GraphicsDevice *device, size_t size);
+		~ConstantBufferArena();
+
+		/// Sub-allocate a block of constants.
+		/// @param offset Receives the aligned offset of the block within the arena buffer.
+		/// @return A pointer to write the constants to, or nullptr if the arena is full.
+		void* allocate(size_t size, size_t &offset);
+
+		template<class T>
+		T* allocate(size_t &offset)
+		{
+			return static_cast<T*>(allocate(sizeof(T), offset));
+		}
+
+		/// Records one buffer update covering every block allocated since the last reset.
+		/// Must be recorded before any draw that uses the blocks.
+		void upload(CommandQueue *queue);
+
+		/// Records a command binding the block at offset to the constant buffer index.
+		void bindRange(CommandQueue *queue, uint32_t index, size_t offset, size_t size);
+
+		inline void reset()
+		{
+			mPointer = 0;
+		}
+
+		inline BufferHandle getBuffer() const
+		{
+			return mBuffer;
+		}
+
+		inline size_t getUsedSize() const
+		{
+			return mPointer;
+		}
+
+		inline size_t getSize() const
+		{
+			return mSize;
+		}
+
+	private:
+		ConstantBufferArena(const ConstantBufferArena&);
+		ConstantBufferArena& operator=(const ConstantBufferArena&);
+
+		GraphicsDevice *mDevice;
+		BufferHandle mBuffer;
+		uint8_t *mMemory;
+		size_t mSize;
+		size_t mAlignment;
+		size_t mPointer;
+	};
+}
+
+#endif
@@ -90,6 +90,13 @@ namespace Jikken
 		eCompute
 	};
 
+	enum class ShaderStatus : uint8_t
+	{
+		ePending = 0,
+		eReady,
+		eFailed
+	};
+
 	enum ClearBufferFlags : uint32_t
 	{
 		eColor = 1,
@@ -97,11 +104,35 @@ namespace Jikken
 		eStencil = 4
 	};
 
+	// What a MemoryBarrierCommand makes compute shader writes visible to.
+	// eIndirectBarrier covers DispatchIndirectCommand arguments and
+	// eTransferBarrier covers buffer updates and reallocs.
+	enum MemoryBarrierFlags : uint32_t
+	{
+		eStorageBarrier = 1,
+		eVertexBarrier = 2,
+		eIndexBarrier = 4,
+		eIndirectBarrier = 8,
+		eConstantBarrier = 16,
+		eTransferBarrier = 32,
+		eAllBarriers = 0xFFFFFFFF
+	};
+
 	enum class BufferType : uint8_t
 	{
 		eVertexBuffer = 0,
 		eIndexBuffer,
-		eConstantBuffer
+		eConstantBuffer,
+		// Read and written by compute shaders. Can also feed vertex input
+		// and hold DispatchIndirectCommand arguments.
+		eStorageBuffer
+	};
+
+	enum class IndexType : uint8_t
+	{
+		eUInt8 = 0,
+		eUInt16,
+		eUInt32
 	};
 
 	enum class BufferUsageHint : uint8_t
@@ -111,14 +142,96 @@ namespace Jikken
 		eStreamDraw
 	};
 
+	enum class TextureFormat : uint8_t
+	{
+		eNone = 0,
+		eRGBA8,
+		eSRGBA8,
+		eRGBA16F,
+		eRGBA32F,
+		eRG16F,
+		eR32F,
+		eR11G11B10F,
+		eDepth16,
+		eDepth24Stencil8,
+		eDepth32F
+	};
+
+	enum class TextureType : uint8_t
+	{
+		e2D = 0,
+		e2DArray,
+		eCube
+	};
+
+	enum class SamplerFilter : uint8_t
+	{
+		eNearest = 0,
+		eLinear
+	};
+
+	enum class SamplerMipFilter : uint8_t
+	{
+		eNone = 0,
+		eNearest,
+		eLinear
+	};
+
+	enum class SamplerWrap : uint8_t
+	{
+		eRepeat = 0,
+		eMirroredRepeat,
+		eClampToEdge
+	};
+
+	enum class PresentMode : uint8_t
+	{
+		// Waits for vertical blank, frames queue up behind the display.
+		eFifo = 0,
+		// Waits for vertical blank, but a newer frame replaces a queued one,
+		// so rendering never blocks on the display.
+		eMailbox,
+		// Shows frames as soon as they are done, may tear.
+		eImmediate
+	};
+
+	enum class QueryType : uint8_t
+	{
+		eSamplesPassed = 0,
+		eAnySamplesPassed
+	};
+
+	enum class VertexInputRate : uint8_t
+	{
+		eVertex = 0,
+		eInstance
+	};
+
 	enum VertexAttributeName : int32_t
 	{
-		ePOSITION = 0
+		ePOSITION = 0,
+		eNORMAL,
+		eTANGENT,
+		eCOLOR,
+		eTEXCOORD0,
+		eTEXCOORD1,
+		eTEXCOORD2,
+		eTEXCOORD3
 	};
 
 	enum VertexAttributeType : int32_t
 	{
-		eFLOAT = 0
+		eFLOAT = 0,
+		eHALF_FLOAT,
+		eBYTE,
+		eUNSIGNED_BYTE,
+		eSHORT,
+		eUNSIGNED_SHORT,
+		eINT,
+		eUNSIGNED_INT,
+		// One value packs 4 components; componentSize must be 4.
+		eINT_2_10_10_10_REV,
+		eUNSIGNED_INT_2_10_10_10_REV
 	};
 }
 
@@ -46,16 +46,67 @@ namespace Jikken
 
 		void deleteCommandQueue(CommandQueue *cmdQueue);
 
-		virtual ShaderHandle createShader(const std::vector<ShaderDetails> &shaders) = 0;
+		// With async set, the shader is compiled in the background where the driver
+		// supports it. Draws using it are skipped until getShaderStatus() is eReady.
+		virtual ShaderHandle createShader(const std::vector<ShaderDetails> &shaders, bool async = false) = 0;
+
+		virtual ShaderStatus getShaderStatus(ShaderHandle handle) = 0;
 
 		virtual BufferHandle createBuffer(BufferType type, BufferUsageHint hint, size_t dataSize, float *data) = 0;
 
 		virtual LayoutHandle createVertexInputLayout(const std::vector<VertexInputLayout> &attributes) = 0;
 
-		virtual VertexArrayHandle createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer = InvalidHandle) = 0;
+		virtual VertexArrayHandle createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer = InvalidHandle, IndexType indexType = IndexType::eUInt16) = 0;
+
+		// vertexBuffers[i] feeds the layout attributes with binding i.
+		virtual VertexArrayHandle createVAO(LayoutHandle layout, const std::vector<BufferHandle> &vertexBuffers, BufferHandle indexBuffer = InvalidHandle, IndexType indexType = IndexType::eUInt16) = 0;
 
 		virtual void bindConstantBuffer(ShaderHandle shader, BufferHandle cBuffer, const char *name, int32_t index) = 0;
 
+		// Offsets used with SetConstantBufferRangeCommand must be a multiple of this value.
+		virtual size_t getConstantBufferAlignment() = 0;
+
+		virtual void bindStorageBuffer(ShaderHandle shader, BufferHandle sBuffer, const char *name, int32_t index) = 0;
+
+		// Offsets used with SetStorageBufferRangeCommand must be a multiple of this value.
+		virtual size_t getStorageBufferAlignment() = 0;
+
+		// Returns InvalidHandle if the driver can't render to the requested formats.
+		virtual RenderTargetHandle createRenderTarget(const RenderTargetDetails &details) = 0;
+
+		virtual void deleteRenderTarget(RenderTargetHandle handle) = 0;
+
+		// Contents are undefined until uploaded with UpdateTextureCommand. Sampling
+		// is limited to the finest mip level that has every coarser level uploaded,
+		// so textures can be streamed in coarsest level first.
+		virtual TextureHandle createTexture(const TextureDetails &details) = 0;
+
+		virtual void deleteTexture(TextureHandle handle) = 0;
+
+		virtual SamplerHandle createSampler(const SamplerDetails &details) = 0;
+
+		virtual void deleteSampler(SamplerHandle handle) = 0;
+
+		// Points the sampler uniform name of shader at a texture unit used by BindTextureCommand.
+		virtual void bindTextureUnit(ShaderHandle shader, const char *name, int32_t unit) = 0;
+
+		// Copies a region of a color attachment into data as tightly packed RGBA8
+		// rows, bottom row first. Waits for rendering to finish, so it is meant
+		// for screenshots and tests rather than every frame. InvalidHandle reads
+		// the default framebuffer. Multisampled targets must be resolved first.
+		// Vulkan only reads 8 bit RGBA or BGRA attachments between frames, and
+		// the default framebuffer only of headless devices.
+		virtual bool readPixels(RenderTargetHandle target, uint32_t colorAttachment, int32_t x, int32_t y, uint32_t width, uint32_t height, void *data) = 0;
+
+		virtual QueryHandle createQuery(QueryType type) = 0;
+
+		virtual void deleteQuery(QueryHandle handle) = 0;
+
+		// Never blocks. Returns false until the first result of query is back
+		// from the GPU, then the most recent finished result, which trails the
+		// frame being recorded by a few frames.
+		virtual bool getQueryResult(QueryHandle handle, uint64_t &result) = 0;
+
 		virtual void deleteVertexInputLayout(LayoutHandle handle) = 0;
 
 		virtual void deleteVAO(VertexArrayHandle handle) = 0;
@@ -65,11 +116,48 @@ namespace Jikken
 		virtual void deleteShader(ShaderHandle handle) = 0;
 
 		void submitCommandQueue(CommandQueue *queue);
-		virtual bool init(void *glfwWinHandle) = 0;
+
+		// Submits queues in order, as if submitCommandQueue() was called for
+		// each of them. Vulkan translates the queues in parallel, each into its
+		// own secondary command buffer, when called during a frame. Every queue
+		// then starts from the state set before this call, and the state the
+		// last queue leaves behind stays current afterwards. Such queues may
+		// only draw into the render target already bound: BeginFrame, render
+		// target switches, resolves, texture updates, buffer reallocation and
+		// queries are ignored in them. The other backends decode the queues one
+		// after another.
+		virtual void submitCommandQueues(const std::vector<CommandQueue*> &queues);
+
+		// Runs a queue of compute work, such as culling or particle simulation,
+		// alongside rendering. Vulkan records it for the async compute queue
+		// and submits it right away, so it overlaps the graphics work of earlier
+		// frames, and the next frame presentFrame() submits waits for it before
+		// its first draw or dispatch. The queue starts from the current state
+		// and leaves its state behind. It may set state, update buffers and
+		// dispatch; draws and the commands submitCommandQueues() ignores are
+		// ignored. Compute shaders run this way only use buffers, not textures,
+		// and must not write buffers that frames in flight still read. The
+		// other backends run it like submitCommandQueue().
+		virtual void submitAsyncCompute(CommandQueue *queue);
+
+		inline const DeviceStats& getStats() const
+		{
+			return mStats;
+		}
+
+		inline void resetStats()
+		{
+			mStats = {};
+		}
+
+		virtual bool init(const DeviceConfig &config, void *glfwWinHandle) = 0;
 
 		virtual void presentFrame() = 0;
 
 	protected:
+		// Decodes queue and executes its commands, returns how many there were.
+		uint64_t _executeCommandQueue(CommandQueue *queue);
+
 		//queue exec functions
 
 		virtual void _setShaderCmd(SetShaderCommand *cmd) = 0;
@@ -84,7 +172,23 @@ namespace Jikken
 		virtual void _blendStateCmd(BlendStateCommand *cmd) = 0;
 		virtual void _depthStencilStateCmd(DepthStencilStateCommand *cmd) = 0;
 		virtual void _cullStateCmd(CullStateCommand *cmd) = 0;
+		virtual void _setConstantBufferRangeCmd(SetConstantBufferRangeCommand *cmd) = 0;
+		virtual void _bindVertexBuffersCmd(BindVertexBuffersCommand *cmd) = 0;
+		virtual void _bindRenderTargetCmd(BindRenderTargetCommand *cmd) = 0;
+		virtual void _resolveRenderTargetCmd(ResolveRenderTargetCommand *cmd) = 0;
+		virtual void _updateTextureCmd(UpdateTextureCommand *cmd) = 0;
+		virtual void _bindTextureCmd(BindTextureCommand *cmd) = 0;
+		virtual void _setStorageBufferRangeCmd(SetStorageBufferRangeCommand *cmd) = 0;
+		virtual void _dispatchCmd(DispatchCommand *cmd) = 0;
+		virtual void _dispatchIndirectCmd(DispatchIndirectCommand *cmd) = 0;
+		virtual void _memoryBarrierCmd(MemoryBarrierCommand *cmd) = 0;
+		virtual void _beginQueryCmd(BeginQueryCommand *cmd) = 0;
+		virtual void _endQueryCmd(EndQueryCommand *cmd) = 0;
+		virtual void _conditionalRenderCmd(ConditionalRenderCommand *cmd) = 0;
+		virtual void _setConstantsCmd(SetConstantsCommand *cmd) = 0;
 		std::vector<CommandQueue*> mCommandQueuePool;
+		DeviceConfig mConfig;
+		DeviceStats mStats;
 	};
 }
 
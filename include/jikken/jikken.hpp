@@ -27,10 +27,12 @@
 
 #include "jikken/enums.hpp"
 #include "jikken/graphicsDevice.hpp"
+#include "jikken/constantBufferArena.hpp"
+#include "jikken/textureStreamer.hpp"
 
 namespace Jikken
 {
-	GraphicsDevice* createGraphicsDevice(API api, void *glfwWinHandle);
+	GraphicsDevice* createGraphicsDevice(API api, void *glfwWinHandle, const DeviceConfig &config = DeviceConfig());
 	void destroyGraphicsDevice(GraphicsDevice *device);
 }
 
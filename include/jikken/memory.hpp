@@ -28,6 +28,7 @@
 #include <cassert>
 #include <cstdint>
 #include <cstddef>
+#include <cstdio>
 #include <vector>
 
 namespace Jikken
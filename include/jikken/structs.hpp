@@ -26,6 +26,7 @@
 #define _JIKKEN_STRUCTS_HPP_
 
 #include <string>
+#include <vector>
 #include "jikken/enums.hpp"
 
 namespace Jikken
@@ -37,6 +38,30 @@ namespace Jikken
 		VertexAttributeType type;
 		uint32_t stride;
 		size_t offset;
+
+		// Maps integer types to [0,1] (unsigned) or [-1,1] (signed) floats.
+		// Ignored for float types. Integer types with neither normalized nor
+		// integer set are converted to floats as they are. OpenGL accepts this
+		// for every integer type. Vulkan has no such format for eINT and
+		// eUNSIGNED_INT, and createVertexInputLayout returns InvalidHandle.
+		// Vulkan devices also refuse formats they can't read vertices from,
+		// which is common for the converted and 3 component byte and short
+		// formats. Prefer normalized or 4 component attributes there.
+		bool normalized;
+
+		// Integer types are read as ints in the shader (ivec/uvec) instead of
+		// being converted to floats. Not valid for float or packed types, on
+		// either backend.
+		bool integer;
+
+		// Vertex buffer slot the attribute reads from. Attributes sharing a
+		// binding must agree on stride, input rate and divisor.
+		uint32_t binding;
+
+		// eInstance advances the attribute once every divisor instances
+		// instead of once per vertex. A divisor of 0 is treated as 1.
+		VertexInputRate inputRate;
+		uint32_t divisor;
 	};
 
 	struct ShaderDetails
@@ -44,6 +69,107 @@ namespace Jikken
 		std::string file;
 		ShaderStage stage;
 	};
+
+	const uint32_t MaxColorAttachments = 4;
+
+	struct RenderTargetDetails
+	{
+		uint32_t width;
+		uint32_t height;
+
+		// One entry per color attachment, at most MaxColorAttachments. Leave
+		// empty for depth only targets such as shadow maps.
+		std::vector<TextureFormat> colorFormats;
+
+		// eNone creates the target without a depth attachment.
+		TextureFormat depthFormat;
+
+		// Above 1 creates a multisampled target, which has to be resolved into
+		// a single sampled target or the default framebuffer to be used.
+		uint32_t samples;
+	};
+
+	struct TextureDetails
+	{
+		TextureType type;
+		TextureFormat format;
+		uint32_t width;
+		uint32_t height;
+
+		// Number of layers of an e2DArray texture. Cube maps always have 6,
+		// one per face in +X, -X, +Y, -Y, +Z, -Z order.
+		uint32_t layers;
+
+		// 0 is treated as 1.
+		uint32_t mipLevels;
+	};
+
+	struct SamplerDetails
+	{
+		SamplerFilter minFilter;
+		SamplerFilter magFilter;
+		SamplerMipFilter mipFilter;
+		SamplerWrap wrapU;
+		SamplerWrap wrapV;
+		SamplerWrap wrapW;
+
+		// Values above 1 enable anisotropic filtering where supported.
+		float maxAnisotropy;
+	};
+
+	// Counters since the device was created or GraphicsDevice::resetStats()
+	// was last called.
+	struct DeviceStats
+	{
+		// Commands decoded by GraphicsDevice::submitCommandQueue() and
+		// GraphicsDevice::submitCommandQueues().
+		uint64_t commands;
+
+		// Calls made into the backend's API while executing commands, by kind.
+		// Calls skipped by the state cache are not counted.
+		uint64_t drawCalls;
+		uint64_t dispatchCalls;
+		uint64_t stateCalls;
+		uint64_t uploadCalls;
+	};
+
+	struct DeviceConfig
+	{
+		// Directory used to keep compiled shader programs between runs. It must
+		// already exist. Leave empty to disable the disk cache.
+		std::string cacheDirectory;
+
+		// Renders without a window: OpenGL gets an EGL context whose default
+		// framebuffer is an offscreen headlessWidth x headlessHeight surface
+		// (needs a build with JIKKEN_EGL), Vulkan renders into an RGBA8 image
+		// of that size instead of a swapchain. glfwWinHandle is ignored.
+		bool headless = false;
+		uint32_t headlessWidth = 1280;
+		uint32_t headlessHeight = 720;
+
+		// Frames the CPU may record while earlier ones still render, each with
+		// its own command buffers and synchronization. Higher values trade
+		// latency for throughput. Used by Vulkan, clamped to 1-4.
+		uint32_t framesInFlight = 2;
+
+		// Threads GraphicsDevice::submitCommandQueues() translates queues on,
+		// counting the calling thread. 0 uses one per CPU core. Used by Vulkan,
+		// clamped to 1-16.
+		uint32_t recordThreads = 0;
+
+		// Latency versus throughput of presented frames. Vulkan falls back to
+		// eFifo when the surface doesn't support the mode; OpenGL only tells
+		// eImmediate apart, as a swap interval of 0.
+		PresentMode presentMode = PresentMode::eMailbox;
+
+		// Swapchain images to ask for, 0 asks for one more than the minimum.
+		// Used by Vulkan, clamped to what the surface supports.
+		uint32_t swapchainImages = 0;
+
+		// Makes the null device check handles and command arguments in
+		// release builds too, printing each failure. Debug builds always check.
+		bool validate = false;
+	};
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_TEXTURESTREAMER_HPP_
+#define _JIKKEN_TEXTURESTREAMER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "jikken/types.hpp"
+#include "jikken/structs.hpp"
+
+namespace Jikken
+{
+	class CommandQueue;
+
+	/// Streams texture data to the device over several frames. Across all
+	/// streaming textures the smallest pending mip level goes first, so every
+	/// texture gets a low resolution version quickly and then sharpens, and no
+	/// frame records more than the byte budget. Levels larger than the budget
+	/// are sent in bands of rows.
+	class TextureStreamer
+	{
+	public:
+		/// @param budget Bytes of texture data recorded per update(). It is copied
+		/// through a CommandQueue, so it can't be larger than the queue's data page.
+		explicit TextureStreamer(size_t budget);
+
+		/// Queues every mip level and layer of a texture created with details.
+		/// levels[i] points at mip level i with its layers stored back to back, and
+		/// has to stay valid until isStreaming() returns false for the texture.
+		void stream(TextureHandle texture, const TextureDetails &details, const std::vector<const void*> &levels);
+
+		/// Records the next uploads, up to the budget.
+		void update(CommandQueue *queue);
+
+		/// Stops streaming a texture, for example before deleting it.
+		void cancel(TextureHandle texture);
+
+		bool isStreaming(TextureHandle texture) const;
+
+		inline bool isIdle() const
+		{
+			return mJobs.empty();
+		}
+
+		static size_t getTexelSize(TextureFormat format);
+
+	private:
+		struct Job
+		{
+			TextureHandle texture;
+			TextureDetails details;
+			std::vector<const void*> levels;
+
+			// Next rows to send.
+			uint32_t level;
+			uint32_t layer;
+			uint32_t row;
+		};
+
+		std::vector<Job> mJobs;
+		size_t mBudget;
+	};
+}
+
+#endif
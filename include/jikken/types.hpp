@@ -33,6 +33,10 @@ namespace Jikken
 	typedef uint32_t ShaderHandle;
 	typedef uint32_t LayoutHandle;
 	typedef uint32_t VertexArrayHandle;
+	typedef uint32_t RenderTargetHandle;
+	typedef uint32_t TextureHandle;
+	typedef uint32_t SamplerHandle;
+	typedef uint32_t QueryHandle;
 
 	const uint32_t InvalidHandle = 0xffffffff;
 }
@@ -24,6 +24,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <algorithm>
 #include "GL/GLGraphicsDevice.hpp"
 #include "GL/GLUtil.hpp"
 //just temp
@@ -31,6 +32,16 @@
 
 namespace Jikken
 {
+	// Size of the pixel buffer texture uploads are staged through.
+	static const size_t TextureUploadRingSize = MemoryPool::MEGABYTE * 16;
+
+	// Size of the uniform buffer SetConstantsCommand data is streamed through.
+	static const size_t ConstantsRingSize = MemoryPool::MEGABYTE * 4;
+
+	// GL queries behind each query handle. Results are read back this many
+	// queries late at most; older unread results are dropped.
+	static const uint32_t QueryLatency = 4;
+
 	void checkGLErrors()
 	{
 		GLenum err;
@@ -46,36 +57,150 @@ namespace Jikken
 		mVertexArrayHandle = 0;
 		mShaderHandle = 0;
 		mLayoutHandle = 0;
+		mRenderTargetHandle = 0;
+		mTextureHandle = 0;
+		mSamplerHandle = 0;
+		mQueryHandle = 0;
+		mScratchTextureUnit = 0;
 		mCurrentVAO = 0;
+		mCurrentFramebuffer = 0;
+		mCurrentShaderReady = true;
+		mConditionalRender = false;
+		mCurrentIndexed = false;
+		mCurrentIndexType = IndexType::eUInt16;
 		mWindowHandle = nullptr;
+		mConstantBufferAlignment = 256;
+		mCaps.baseInstance = false;
+		mCaps.parallelShaderCompile = false;
+		mCaps.vertexAttribBinding = false;
+		mCaps.textureStorage = false;
+		mCaps.bufferStorage = false;
+		mCaps.separateShaderObjects = false;
+		mCaps.maxAnisotropy = 0.0f;
+		mCaps.compute = false;
+		mStorageBufferAlignment = 256;
 
 		mStateCache.blend.firstSet = true;
 		mStateCache.depthStencil.firstSet = true;
 		mStateCache.cull.firstSet = true;
+		mStateCache.primitiveRestart.enabled = false;
+		mStateCache.primitiveRestart.index = 0;
 
-		glGenVertexArrays(1, &mGlobalVAO);
-		glBindVertexArray(mGlobalVAO);
+		// Created in init, headless devices have no context before that.
+		mGlobalVAO = 0;
+		mBoundVAO = 0;
 	}
 
 	GLGraphicsDevice::~GLGraphicsDevice()
 	{
-		glDeleteVertexArrays(1, &mGlobalVAO);
+		for (auto &target : mRenderTargetToGL)
+			_destroyRenderTarget(target.second);
+		for (auto &texture : mTextureToGL)
+			glDeleteTextures(1, &texture.second.texture);
+		for (auto &sampler : mSamplerToGL)
+			glDeleteSamplers(1, &sampler.second);
+		for (auto &query : mQueryToGL)
+			glDeleteQueries(static_cast<GLsizei>(query.second.queries.size()), query.second.queries.data());
+		for (GLuint buffer : mConstantsFallback)
+		{
+			if (buffer != 0)
+				glDeleteBuffers(1, &buffer);
+		}
+		if (mGlobalVAO != 0)
+			glDeleteVertexArrays(1, &mGlobalVAO);
 	}
 
 	//todo
-	bool GLGraphicsDevice::init(void *glfwWinHandle)
+	bool GLGraphicsDevice::init(const DeviceConfig &config, void *glfwWinHandle)
 	{
-		mWindowHandle = static_cast<GLFWwindow*>(glfwWinHandle);
+		mConfig = config;
+		if (mConfig.headless)
+		{
+#ifdef JIKKEN_EGL
+			if (!mHeadlessContext.create(mConfig.headlessWidth, mConfig.headlessHeight))
+				return false;
+
+			// Nobody else creates the context, so nobody else loaded GL either.
+			glewExperimental = GL_TRUE;
+			if (glewInit() != GLEW_OK)
+			{
+				printf("Unable to load OpenGL functions for the headless context.\n");
+				return false;
+			}
+			// glewInit can leave an error behind on core contexts.
+			glGetError();
+#else
+			printf("Headless devices need Jikken built with JIKKEN_EGL.\n");
+			return false;
+#endif
+		}
+		else
+		{
+			mWindowHandle = static_cast<GLFWwindow*>(glfwWinHandle);
+
+			// GL has no mailbox, only waiting for vertical blank or not.
+			glfwSwapInterval(mConfig.presentMode == PresentMode::eImmediate ? 0 : 1);
+		}
 		glutils::printDeviceInfo();
+
+		glGenVertexArrays(1, &mGlobalVAO);
+		glBindVertexArray(mGlobalVAO);
+		mBoundVAO = mGlobalVAO;
+
+		GLint alignment;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		mConstantBufferAlignment = static_cast<size_t>(alignment);
+
+		GLint maxBindings;
+		glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maxBindings);
+		mStateCache.constantBuffers.resize(maxBindings, { 0, 0, 0 });
+		mConstantsFallback.resize(maxBindings, 0);
+
+		// Storage buffers came in with compute shaders.
+		mCaps.compute = GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object);
+		if (mCaps.compute)
+		{
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			mStorageBufferAlignment = static_cast<size_t>(alignment);
+
+			glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &maxBindings);
+			mStateCache.storageBuffers.resize(maxBindings, { 0, 0, 0 });
+		}
+
+		mProgramCache.init(mConfig.cacheDirectory);
+
+		mCaps.baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+
+		// KHR_parallel_shader_compile shares its tokens with the ARB version.
+		mCaps.parallelShaderCompile = GLEW_ARB_parallel_shader_compile || glutils::hasExtension("GL_KHR_parallel_shader_compile");
+		if (GLEW_ARB_parallel_shader_compile)
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
+		mCaps.vertexAttribBinding = GLEW_VERSION_4_3 || GLEW_ARB_vertex_attrib_binding;
+		mCaps.textureStorage = GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+		mCaps.bufferStorage = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+		mCaps.separateShaderObjects = GLEW_VERSION_4_1 || GLEW_ARB_separate_shader_objects;
+		if (GLEW_EXT_texture_filter_anisotropic)
+			glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &mCaps.maxAnisotropy);
+
+		GLint maxTextureUnits;
+		glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+		mScratchTextureUnit = maxTextureUnits - 1;
+
+		// Uploads and readbacks are tightly packed rows.
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		mUploadRing.init(GL_PIXEL_UNPACK_BUFFER, TextureUploadRingSize, 16, mCaps.bufferStorage);
+		mConstantsRing.init(GL_UNIFORM_BUFFER, ConstantsRingSize, mConstantBufferAlignment, mCaps.bufferStorage);
+
+		checkGLErrors();
 		return true;
 	}
 
-	ShaderHandle GLGraphicsDevice::createShader(const std::vector<ShaderDetails> &shaders)
+	ShaderHandle GLGraphicsDevice::createShader(const std::vector<ShaderDetails> &shaders, bool async)
 	{
-		GLuint program;
-		std::vector<GLuint> shaderAttachments;
-
-		// Grab a GL attachment from each detail
+		// Read every stage up front so the program cache can be checked before compiling.
+		std::vector<std::string> sources;
 		for (const ShaderDetails &details : shaders)
 		{
 			FILE *file = fopen(details.file.c_str(), "r");
@@ -92,71 +217,152 @@ namespace Jikken
 			fileSize = ftell(file);
 			rewind(file);
 
-			// read into buffer
-			char *buffer = new char[fileSize + 1];
-			memset(buffer, 0, fileSize + 1);
-			fread(buffer, 1, static_cast<size_t>(fileSize), file);
+			// read into buffer. Text mode may translate line endings, so trim to what was read.
+			std::string buffer(static_cast<size_t>(fileSize), '\0');
+			size_t read = fread(&buffer[0], 1, static_cast<size_t>(fileSize), file);
+			buffer.resize(read);
 			fclose(file);
 
-			GLuint attachment = glCreateShader(glutils::shaderStageToGL(details.stage));
-			glShaderSource(attachment, 1, &buffer, 0);
-			glCompileShader(attachment);
+			sources.push_back(buffer);
+		}
+
+		GLShader shader;
+		shader.program = 0;
+		shader.status = ShaderStatus::ePending;
+		shader.cacheKey = 0;
+		for (const ShaderDetails &details : shaders)
+			shader.files.push_back(details.file);
 
-			// delete buffer
-			delete[] buffer;
+		if (mProgramCache.isEnabled())
+		{
+			shader.cacheKey = mProgramCache.computeKey(shaders, sources);
+			shader.program = mProgramCache.load(shader.cacheKey);
+			if (shader.program != 0)
+				shader.status = ShaderStatus::eReady;
+		}
+
+		// Cache miss or the driver rejected the binary.
+		if (shader.program == 0)
+		{
+			_submitProgram(shader, shaders, sources);
 
-			// Check for errors in uploading and compiling the shader.
-			GLint success;
-			glGetShaderiv(attachment, GL_COMPILE_STATUS, &success);
-			if (!success)
+			// Synchronous creation keeps the old behaviour of aborting on errors.
+			if (!async)
 			{
-				// TODO: do something better than abort.
-				// TODO: query error log length.
-				const int LENGTH = 2048;
-				GLchar info[LENGTH];
-				glGetShaderInfoLog(attachment, LENGTH, 0, info);
-				printf("Shader %s compile error.\n", details.file.c_str());
-				printf(info);
-				abort();
+				_finishProgram(shader);
+				if (shader.status == ShaderStatus::eFailed)
+				{
+					// TODO: come up with better error handling.
+					abort();
+				}
 			}
+		}
+
+		checkGLErrors();
 
-			shaderAttachments.push_back(attachment);
+		ShaderHandle handle = mShaderHandle++;
+		mShaderToGL[handle] = shader;
+		return handle;
+	}
+
+	ShaderStatus GLGraphicsDevice::getShaderStatus(ShaderHandle handle)
+	{
+		GLShader &shader = mShaderToGL[handle];
+		_pollProgram(shader);
+		return shader.status;
+	}
+
+	void GLGraphicsDevice::_submitProgram(GLShader &shader, const std::vector<ShaderDetails> &shaders, const std::vector<std::string> &sources)
+	{
+		// Grab a GL attachment from each detail. Nothing here waits on the
+		// compiler, so drivers with parallel compilers work in the background.
+		for (size_t i = 0; i < shaders.size(); ++i)
+		{
+			const GLchar *source = sources[i].c_str();
+
+			GLuint attachment = glCreateShader(glutils::shaderStageToGL(shaders[i].stage));
+			glShaderSource(attachment, 1, &source, 0);
+			glCompileShader(attachment);
+			shader.attachments.push_back(attachment);
 		}
 
 		// Create the program. A program is made up of one or more attachments.
 		// When we link it, we can then free attachments.
-		program = glCreateProgram();
-		for (GLuint attachment : shaderAttachments)
-			glAttachShader(program, attachment);
-		glLinkProgram(program);
+		shader.program = glCreateProgram();
+		for (GLuint attachment : shader.attachments)
+			glAttachShader(shader.program, attachment);
+
+		// The binary can only be read back later if we ask for it before linking.
+		if (mProgramCache.isEnabled())
+			glProgramParameteri(shader.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
+		glLinkProgram(shader.program);
+		shader.status = ShaderStatus::ePending;
+	}
+
+	void GLGraphicsDevice::_finishProgram(GLShader &shader)
+	{
 		// Check to see if the shader linked.
 		GLint linked;
-		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		glGetProgramiv(shader.program, GL_LINK_STATUS, &linked);
 		if (!linked)
 		{
+			// Check for errors in uploading and compiling each attachment.
+			for (size_t i = 0; i < shader.attachments.size(); ++i)
+			{
+				GLint success;
+				glGetShaderiv(shader.attachments[i], GL_COMPILE_STATUS, &success);
+				if (!success)
+				{
+					// TODO: query error log length.
+					const int LENGTH = 2048;
+					GLchar info[LENGTH];
+					glGetShaderInfoLog(shader.attachments[i], LENGTH, 0, info);
+					printf("Shader %s compile error.\n", shader.files[i].c_str());
+					printf("%s", info);
+				}
+			}
+
 			GLint length;
-			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+			glGetProgramiv(shader.program, GL_INFO_LOG_LENGTH, &length);
 			char *msg = new char[length + 1];
 			memset(msg, 0, length + 1);
-			glGetProgramInfoLog(program, length, &length, msg);
+			glGetProgramInfoLog(shader.program, length, &length, msg);
 			printf("Failed to link shader!\n");
-			printf(msg);
+			printf("%s", msg);
 			delete[] msg;
 
-			// TODO: come up with better error handling.
-			abort();
+			shader.status = ShaderStatus::eFailed;
+		}
+		else
+		{
+			shader.status = ShaderStatus::eReady;
+			if (mProgramCache.isEnabled())
+				mProgramCache.save(shader.cacheKey, shader.program);
 		}
 
 		// Once it is linked, we can delete the attachments.
-		for (GLuint attachment : shaderAttachments)
+		for (GLuint attachment : shader.attachments)
 			glDeleteShader(attachment);
+		shader.attachments.clear();
+	}
 
-		checkGLErrors();
+	void GLGraphicsDevice::_pollProgram(GLShader &shader)
+	{
+		if (shader.status != ShaderStatus::ePending)
+			return;
 
-		ShaderHandle handle = mShaderHandle++;
-		mShaderToGL[handle] = { program };
-		return handle;
+		// Without parallel shader compile the link status query blocks until
+		// the driver is done, so the wait is only deferred to the first use.
+		if (mCaps.parallelShaderCompile)
+		{
+			GLint completed = GL_FALSE;
+			glGetProgramiv(shader.program, GL_COMPLETION_STATUS_ARB, &completed);
+			if (!completed)
+				return;
+		}
+
+		_finishProgram(shader);
 	}
 
 	BufferHandle GLGraphicsDevice::createBuffer(BufferType type, BufferUsageHint hint, size_t dataSize, float *data)
@@ -164,9 +370,11 @@ namespace Jikken
 		BufferHandle handle = mBufferHandle++;
 		GLuint buffer;
 
+		// Uploads go through the copy target. Binding GL_ELEMENT_ARRAY_BUFFER here
+		// would replace the index buffer of whatever VAO is bound.
 		glGenBuffers(1, &buffer);
-		glBindBuffer(glutils::bufferTypeToGL(type), buffer);
-		glBufferData(glutils::bufferTypeToGL(type), dataSize, data, glutils::bufferUsageHintToGL(hint));
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, dataSize, data, glutils::bufferUsageHintToGL(hint));
 		checkGLErrors();
 
 		mBufferToGL[handle] = { type, buffer };
@@ -181,56 +389,134 @@ namespace Jikken
 			// We need at least 1 attribute.
 			assert(false);
 		}
+		for (const VertexInputLayout &attr : attributes)
+		{
+			// Packed types always hold 4 components.
+			bool packed = attr.type == VertexAttributeType::eINT_2_10_10_10_REV || attr.type == VertexAttributeType::eUNSIGNED_INT_2_10_10_10_REV;
+			if (packed && attr.componentSize != 4)
+				assert(false);
+
+			// Only plain integer types can be read as integers.
+			if (attr.integer && (packed || attr.type == VertexAttributeType::eFLOAT || attr.type == VertexAttributeType::eHALF_FLOAT))
+				assert(false);
+
+			if (attr.binding >= MaxVertexBufferBindings)
+				assert(false);
+
+			// Stride and step rate belong to the binding, not the attribute.
+			for (const VertexInputLayout &other : attributes)
+			{
+				if (other.binding == attr.binding && (other.stride != attr.stride || glutils::attributeDivisor(other) != glutils::attributeDivisor(attr)))
+					assert(false);
+			}
+		}
 #endif
 
-		// Since the VAO handles layout in GL, we just copy it and store it.
-		LayoutHandle layout = mLayoutHandle++;
+		// Bindings index fixed size arrays, so an out of range one is refused in every build.
+		for (const VertexInputLayout &attr : attributes)
+		{
+			if (attr.binding >= MaxVertexBufferBindings)
+			{
+				printf("Vertex attribute %d uses binding %u, only %u bindings are supported.\n", attr.attribute, attr.binding, MaxVertexBufferBindings);
+				return InvalidHandle;
+			}
+		}
+
+		LayoutHandle handle = mLayoutHandle++;
+		GLLayout &layout = mLayoutToGL[handle];
+		layout.attributes = attributes;
+		layout.indexBuffer = 0;
+		for (uint32_t i = 0; i < MaxVertexBufferBindings; ++i)
+		{
+			layout.strides[i] = 0;
+			layout.vertexBuffers[i] = 0;
+			layout.offsets[i] = 0;
+		}
+
 		for (const VertexInputLayout &attr : attributes)
-			mLayoutToGL[layout].push_back(attr);
-		return layout;
+			layout.strides[attr.binding] = attr.stride;
+
+		// The layout gets its own VAO holding just the vertex format. Buffers are
+		// attached per draw with BindVertexBuffers.
+		glGenVertexArrays(1, &layout.vao);
+		_bindVertexArray(layout.vao);
+		for (const VertexInputLayout &attr : attributes)
+		{
+			glEnableVertexAttribArray(attr.attribute);
+
+			// Without ARB_vertex_attrib_binding the format is given together
+			// with the buffer, in _bindVertexBuffersCmd.
+			if (mCaps.vertexAttribBinding)
+			{
+				_vertexAttribFormat(attr);
+				glVertexAttribBinding(attr.attribute, attr.binding);
+				glVertexBindingDivisor(attr.binding, glutils::attributeDivisor(attr));
+			}
+			else
+			{
+				glVertexAttribDivisor(attr.attribute, glutils::attributeDivisor(attr));
+			}
+		}
+		checkGLErrors();
+
+		return handle;
+	}
+
+	VertexArrayHandle GLGraphicsDevice::createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer, IndexType indexType)
+	{
+		return createVAO(layout, std::vector<BufferHandle>(1, vertexBuffer), indexBuffer, indexType);
 	}
 
-	VertexArrayHandle GLGraphicsDevice::createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer)
+	VertexArrayHandle GLGraphicsDevice::createVAO(LayoutHandle layout, const std::vector<BufferHandle> &vertexBuffers, BufferHandle indexBuffer, IndexType indexType)
 	{
 #ifdef _DEBUG
-		if (mBufferToGL[vertexBuffer].type != BufferType::eVertexBuffer)
-			assert(false);
+		for (BufferHandle vertexBuffer : vertexBuffers)
+		{
+			BufferType type = mBufferToGL[vertexBuffer].type;
+			if (type != BufferType::eVertexBuffer && type != BufferType::eStorageBuffer)
+				assert(false);
+		}
 		if (indexBuffer != InvalidHandle && mBufferToGL[indexBuffer].type != BufferType::eIndexBuffer)
 			assert(false);
 #endif
+		// Every binding the layout reads from needs a buffer.
+		const std::vector<VertexInputLayout> &layouts = mLayoutToGL[layout].attributes;
+		for (const VertexInputLayout &attr : layouts)
+		{
+			if (attr.binding >= vertexBuffers.size())
+			{
+#ifdef _DEBUG
+				assert(false);
+#endif
+				printf("Vertex attribute %d uses binding %u, but only %u vertex buffers were given\n", attr.attribute, attr.binding, static_cast<uint32_t>(vertexBuffers.size()));
+				return InvalidHandle;
+			}
+		}
+
 		GLuint vao;
 		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		_bindVertexArray(vao);
 		{
-			// Bind Vertex Buffer
-			glBindBuffer(GL_ARRAY_BUFFER, mBufferToGL[vertexBuffer].buffer);
-
 			// Index buffer is optional. We can draw without index buffers in OpenGL.
 			if (indexBuffer != InvalidHandle)
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBufferToGL[indexBuffer].buffer);
 
-			// Bind input layout.
-			const std::vector<VertexInputLayout> &layouts = mLayoutToGL[layout];
+			// Bind input layout. Each attribute reads from the buffer of its binding.
 			for (const VertexInputLayout &attr : layouts)
 			{
+				glBindBuffer(GL_ARRAY_BUFFER, mBufferToGL[vertexBuffers[attr.binding]].buffer);
 				glEnableVertexAttribArray(attr.attribute);
-				glVertexAttribPointer(
-					attr.attribute, 
-					attr.componentSize, 
-					glutils::layoutTypeToGL(attr.type),
-					GL_FALSE, 
-					attr.stride, 
-					reinterpret_cast<void*>(attr.offset)
-				);
+				_vertexAttribPointer(attr, 0);
+				glVertexAttribDivisor(attr.attribute, glutils::attributeDivisor(attr));
 			}
 		}
 		// Now bind global VAO. The above will now work for "vao"
-		glBindVertexArray(mGlobalVAO);
+		_bindVertexArray(mGlobalVAO);
 		
 		checkGLErrors();
 
 		VertexArrayHandle handle = mVertexArrayHandle++;
-		mVertexArrayToGL[handle] = { vertexBuffer, indexBuffer, layout, vao };
+		mVertexArrayToGL[handle] = { vertexBuffers, indexBuffer, layout, indexType, vao };
 		return handle;
 	}
 
@@ -240,41 +526,464 @@ namespace Jikken
 		if (mBufferToGL[cBuffer].type != BufferType::eConstantBuffer)
 			assert(false);
 #endif
+		// Block lookups need the link result, so this waits on async programs.
+		GLShader &glShader = mShaderToGL[shader];
+		if (glShader.status == ShaderStatus::ePending)
+			_finishProgram(glShader);
+
 		// Bind the uniform block to the shader program at index
-		GLuint glIndex = glGetUniformBlockIndex(mShaderToGL[shader].program, name);
-		glUniformBlockBinding(mShaderToGL[shader].program, glIndex, index);
+		GLuint glIndex = glGetUniformBlockIndex(glShader.program, name);
+		glUniformBlockBinding(glShader.program, glIndex, index);
 		glBindBufferBase(GL_UNIFORM_BUFFER, index, mBufferToGL[cBuffer].buffer);
 		checkGLErrors();
+
+		// A size of 0 marks the binding as covering the whole buffer.
+		mStateCache.constantBuffers[index] = { mBufferToGL[cBuffer].buffer, 0, 0 };
+	}
+
+	size_t GLGraphicsDevice::getConstantBufferAlignment()
+	{
+		return mConstantBufferAlignment;
+	}
+
+	void GLGraphicsDevice::bindStorageBuffer(ShaderHandle shader, BufferHandle sBuffer, const char *name, int32_t index)
+	{
+#ifdef _DEBUG
+		if (mBufferToGL[sBuffer].type != BufferType::eStorageBuffer)
+			assert(false);
+		// Storage buffers need GL 4.3 or ARB_shader_storage_buffer_object.
+		if (!mCaps.compute)
+			assert(false);
+#endif
+		// Without storage buffer support there are no binding points to cache.
+		if (!mCaps.compute || index < 0 || static_cast<size_t>(index) >= mStateCache.storageBuffers.size())
+			return;
+
+		GLShader &glShader = mShaderToGL[shader];
+		if (glShader.status == ShaderStatus::ePending)
+			_finishProgram(glShader);
+
+		// Bind the storage block to the shader program at index
+		GLuint glIndex = glGetProgramResourceIndex(glShader.program, GL_SHADER_STORAGE_BLOCK, name);
+		glShaderStorageBlockBinding(glShader.program, glIndex, index);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, mBufferToGL[sBuffer].buffer);
+		checkGLErrors();
+
+		mStateCache.storageBuffers[index] = { mBufferToGL[sBuffer].buffer, 0, 0 };
+	}
+
+	size_t GLGraphicsDevice::getStorageBufferAlignment()
+	{
+		return mStorageBufferAlignment;
+	}
+
+	RenderTargetHandle GLGraphicsDevice::createRenderTarget(const RenderTargetDetails &details)
+	{
+#ifdef _DEBUG
+		if (details.colorFormats.size() > MaxColorAttachments)
+			assert(false);
+		if (details.width == 0 || details.height == 0)
+			assert(false);
+#endif
+		GLRenderTarget target;
+		target.width = details.width;
+		target.height = details.height;
+		target.samples = details.samples > 1 ? details.samples : 1;
+		target.depthAttachment = 0;
+
+		glGenFramebuffers(1, &target.fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+
+		bool valid = true;
+		std::vector<GLenum> drawBuffers;
+		for (size_t i = 0; i < details.colorFormats.size(); ++i)
+		{
+			GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i);
+			GLuint color = _createAttachment(target, details.colorFormats[i], attachment);
+			valid &= color != 0;
+			target.colorAttachments.push_back(color);
+			drawBuffers.push_back(attachment);
+		}
+		if (details.depthFormat != TextureFormat::eNone)
+		{
+			target.depthAttachment = _createAttachment(target, details.depthFormat, glutils::textureFormatAttachment(details.depthFormat));
+			valid &= target.depthAttachment != 0;
+		}
+
+		// Depth only targets have no color to draw to or read from.
+		if (drawBuffers.empty())
+		{
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		else
+		{
+			glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+		}
+
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, mCurrentFramebuffer);
+		checkGLErrors();
+
+		if (!valid || status != GL_FRAMEBUFFER_COMPLETE)
+		{
+			printf("Render target is incomplete (status 0x%x).\n", status);
+			_destroyRenderTarget(target);
+			return InvalidHandle;
+		}
+
+		RenderTargetHandle handle = mRenderTargetHandle++;
+		mRenderTargetToGL[handle] = target;
+		return handle;
+	}
+
+	GLuint GLGraphicsDevice::_createAttachment(const GLRenderTarget &target, TextureFormat format, GLenum attachment)
+	{
+		GLenum internalFormat, pixelFormat, pixelType;
+		if (!glutils::textureFormatToGL(format, internalFormat, pixelFormat, pixelType))
+			return 0;
+
+		GLuint object;
+		if (target.samples > 1)
+		{
+			// Multisampled attachments are only ever resolved, never sampled,
+			// so renderbuffers are enough.
+			glGenRenderbuffers(1, &object);
+			glBindRenderbuffer(GL_RENDERBUFFER, object);
+			glRenderbufferStorageMultisample(GL_RENDERBUFFER, target.samples, internalFormat, target.width, target.height);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, object);
+		}
+		else
+		{
+			// Single sampled attachments are textures so later passes can read them.
+			glGenTextures(1, &object);
+			_bindScratchTexture(GL_TEXTURE_2D, object);
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, target.width, target.height, 0, pixelFormat, pixelType, nullptr);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, object, 0);
+		}
+		return object;
+	}
+
+	void GLGraphicsDevice::_destroyRenderTarget(GLRenderTarget &target)
+	{
+		std::vector<GLuint> objects = target.colorAttachments;
+		if (target.depthAttachment != 0)
+			objects.push_back(target.depthAttachment);
+
+		if (target.samples > 1)
+			glDeleteRenderbuffers(static_cast<GLsizei>(objects.size()), objects.data());
+		else
+			glDeleteTextures(static_cast<GLsizei>(objects.size()), objects.data());
+		glDeleteFramebuffers(1, &target.fbo);
+	}
+
+	void GLGraphicsDevice::_bindScratchTexture(GLenum target, GLuint texture)
+	{
+		glActiveTexture(GL_TEXTURE0 + mScratchTextureUnit);
+		glBindTexture(target, texture);
+	}
+
+	void GLGraphicsDevice::deleteRenderTarget(RenderTargetHandle handle)
+	{
+		auto it = mRenderTargetToGL.find(handle);
+		if (it == mRenderTargetToGL.end())
+			return;
+
+		// Deleting the bound framebuffer reverts GL to the default one.
+		if (it->second.fbo == mCurrentFramebuffer)
+			mCurrentFramebuffer = 0;
+		_destroyRenderTarget(it->second);
+		mRenderTargetToGL.erase(it);
+	}
+
+	TextureHandle GLGraphicsDevice::createTexture(const TextureDetails &details)
+	{
+		GLenum internalFormat, pixelFormat, pixelType;
+		if (!glutils::textureFormatToGL(details.format, internalFormat, pixelFormat, pixelType))
+		{
+			printf("Unsupported texture format.\n");
+			return InvalidHandle;
+		}
+
+		GLTexture texture;
+		texture.target = glutils::textureTypeToGL(details.type);
+		texture.details = details;
+		texture.levels = details.mipLevels > 0 ? details.mipLevels : 1;
+		if (details.type == TextureType::e2D)
+			texture.details.layers = 1;
+		else if (details.type == TextureType::eCube)
+			texture.details.layers = 6;
+
+		glGenTextures(1, &texture.texture);
+		_bindScratchTexture(texture.target, texture.texture);
+
+		if (mCaps.textureStorage)
+		{
+			if (details.type == TextureType::e2DArray)
+				glTexStorage3D(texture.target, texture.levels, internalFormat, details.width, details.height, texture.details.layers);
+			else
+				glTexStorage2D(texture.target, texture.levels, internalFormat, details.width, details.height);
+		}
+		else
+		{
+			for (uint32_t level = 0; level < texture.levels; ++level)
+			{
+				GLsizei width = std::max(details.width >> level, 1u);
+				GLsizei height = std::max(details.height >> level, 1u);
+				if (details.type == TextureType::e2DArray)
+				{
+					glTexImage3D(texture.target, level, internalFormat, width, height, texture.details.layers, 0, pixelFormat, pixelType, nullptr);
+				}
+				else if (details.type == TextureType::eCube)
+				{
+					for (GLenum face = 0; face < 6; ++face)
+						glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, internalFormat, width, height, 0, pixelFormat, pixelType, nullptr);
+				}
+				else
+				{
+					glTexImage2D(texture.target, level, internalFormat, width, height, 0, pixelFormat, pixelType, nullptr);
+				}
+			}
+		}
+
+		// Nothing is uploaded yet, so sampling starts at the coarsest level.
+		texture.coverage.reset(texture.details.width, texture.details.height, texture.details.layers, texture.levels);
+		texture.baseLevel = texture.levels - 1;
+		glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, texture.baseLevel);
+		glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, texture.levels - 1);
+		checkGLErrors();
+
+		TextureHandle handle = mTextureHandle++;
+		mTextureToGL[handle] = texture;
+		return handle;
+	}
+
+	void GLGraphicsDevice::deleteTexture(TextureHandle handle)
+	{
+		auto it = mTextureToGL.find(handle);
+		if (it == mTextureToGL.end())
+			return;
+
+		glDeleteTextures(1, &it->second.texture);
+		mTextureToGL.erase(it);
+	}
+
+	SamplerHandle GLGraphicsDevice::createSampler(const SamplerDetails &details)
+	{
+		GLuint sampler;
+		glGenSamplers(1, &sampler);
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, glutils::samplerMinFilterToGL(details.minFilter, details.mipFilter));
+		glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, glutils::samplerFilterToGL(details.magFilter));
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, glutils::samplerWrapToGL(details.wrapU));
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, glutils::samplerWrapToGL(details.wrapV));
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, glutils::samplerWrapToGL(details.wrapW));
+		if (details.maxAnisotropy > 1.0f && mCaps.maxAnisotropy > 1.0f)
+			glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(details.maxAnisotropy, mCaps.maxAnisotropy));
+		checkGLErrors();
+
+		SamplerHandle handle = mSamplerHandle++;
+		mSamplerToGL[handle] = sampler;
+		return handle;
+	}
+
+	void GLGraphicsDevice::deleteSampler(SamplerHandle handle)
+	{
+		auto it = mSamplerToGL.find(handle);
+		if (it == mSamplerToGL.end())
+			return;
+
+		glDeleteSamplers(1, &it->second);
+		mSamplerToGL.erase(it);
+	}
+
+	void GLGraphicsDevice::bindTextureUnit(ShaderHandle shader, const char *name, int32_t unit)
+	{
+#ifdef _DEBUG
+		if (static_cast<GLuint>(unit) >= mScratchTextureUnit)
+			assert(false);
+#endif
+		// Uniform lookups need the link result, so this waits on async programs.
+		GLShader &glShader = mShaderToGL[shader];
+		if (glShader.status == ShaderStatus::ePending)
+			_finishProgram(glShader);
+
+		GLint location = glGetUniformLocation(glShader.program, name);
+		if (mCaps.separateShaderObjects)
+		{
+			glProgramUniform1i(glShader.program, location, unit);
+		}
+		else
+		{
+			GLint current;
+			glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+			glUseProgram(glShader.program);
+			glUniform1i(location, unit);
+			glUseProgram(current);
+		}
+		checkGLErrors();
+	}
+
+	bool GLGraphicsDevice::readPixels(RenderTargetHandle target, uint32_t colorAttachment, int32_t x, int32_t y, uint32_t width, uint32_t height, void *data)
+	{
+		GLuint fbo = 0;
+		if (target != InvalidHandle)
+		{
+			auto it = mRenderTargetToGL.find(target);
+			if (it == mRenderTargetToGL.end())
+				return false;
+
+			const GLRenderTarget &renderTarget = it->second;
+			if (renderTarget.samples > 1)
+			{
+				printf("Resolve multisampled render targets before reading their pixels.\n");
+				return false;
+			}
+			if (colorAttachment >= renderTarget.colorAttachments.size())
+				return false;
+			fbo = renderTarget.fbo;
+		}
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+		if (fbo != 0)
+			glReadBuffer(GL_COLOR_ATTACHMENT0 + colorAttachment);
+		glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		glBindFramebuffer(GL_FRAMEBUFFER, mCurrentFramebuffer);
+		checkGLErrors();
+		return true;
+	}
+
+	QueryHandle GLGraphicsDevice::createQuery(QueryType type)
+	{
+		GLQuery query;
+		query.target = glutils::queryTypeToGL(type);
+		query.queries.resize(QueryLatency);
+		glGenQueries(QueryLatency, query.queries.data());
+		query.oldest = 0;
+		query.pending = 0;
+		query.last = -1;
+		query.active = false;
+		query.result = 0;
+		query.hasResult = false;
+		checkGLErrors();
+
+		QueryHandle handle = mQueryHandle++;
+		mQueryToGL[handle] = query;
+		return handle;
+	}
+
+	void GLGraphicsDevice::deleteQuery(QueryHandle handle)
+	{
+		auto it = mQueryToGL.find(handle);
+		if (it == mQueryToGL.end())
+			return;
+
+		glDeleteQueries(static_cast<GLsizei>(it->second.queries.size()), it->second.queries.data());
+		mQueryToGL.erase(it);
+	}
+
+	bool GLGraphicsDevice::getQueryResult(QueryHandle handle, uint64_t &result)
+	{
+		auto it = mQueryToGL.find(handle);
+		if (it == mQueryToGL.end())
+			return false;
+		GLQuery &query = it->second;
+
+		// Queries finish in the order they were issued, so stop at the first
+		// one that is not available yet.
+		while (query.pending > 0)
+		{
+			uint32_t slot = query.oldest;
+			if (query.active && query.pending == 1)
+				break;
+
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(query.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				break;
+
+			GLuint64 samples;
+			glGetQueryObjectui64v(query.queries[slot], GL_QUERY_RESULT, &samples);
+			query.result = static_cast<uint64_t>(samples);
+			query.hasResult = true;
+			query.oldest = (query.oldest + 1) % QueryLatency;
+			--query.pending;
+		}
+		checkGLErrors();
+
+		result = query.result;
+		return query.hasResult;
 	}
 
 	void GLGraphicsDevice::deleteVertexInputLayout(LayoutHandle handle)
 	{
-		// Nothing to delete in side GL, the handle object for us is just simply
-		// a vector of attributes since the VAO handles everything.
+		GLuint vao = mLayoutToGL[handle].vao;
+		if (mBoundVAO == vao)
+			_bindVertexArray(mGlobalVAO);
+		glDeleteVertexArrays(1, &vao);
 		mLayoutToGL.erase(handle);
 	}
 
 	void GLGraphicsDevice::deleteVAO(VertexArrayHandle handle)
 	{
+		if (mBoundVAO == mVertexArrayToGL[handle].vao)
+			_bindVertexArray(mGlobalVAO);
 		glDeleteVertexArrays(1, &mVertexArrayToGL[handle].vao);
 		mVertexArrayToGL.erase(handle);
 	}
 
 	void GLGraphicsDevice::deleteBuffer(BufferHandle handle)
 	{
+		// GL may hand the name out again, so forget any cached bindings of it.
+		for (auto &range : mStateCache.constantBuffers)
+		{
+			if (range.buffer == mBufferToGL[handle].buffer)
+				range = { 0, 0, 0 };
+		}
+		for (auto &range : mStateCache.storageBuffers)
+		{
+			if (range.buffer == mBufferToGL[handle].buffer)
+				range = { 0, 0, 0 };
+		}
+		for (auto &layout : mLayoutToGL)
+		{
+			for (uint32_t i = 0; i < MaxVertexBufferBindings; ++i)
+			{
+				if (layout.second.vertexBuffers[i] == mBufferToGL[handle].buffer)
+					layout.second.vertexBuffers[i] = 0;
+			}
+			if (layout.second.indexBuffer == mBufferToGL[handle].buffer)
+				layout.second.indexBuffer = 0;
+		}
+
 		glDeleteBuffers(1, &mBufferToGL[handle].buffer);
 		mBufferToGL.erase(handle);
 	}
 
 	void GLGraphicsDevice::deleteShader(ShaderHandle handle)
 	{
+		for (GLuint attachment : mShaderToGL[handle].attachments)
+			glDeleteShader(attachment);
 		glDeleteProgram(mShaderToGL[handle].program);
 		mShaderToGL.erase(handle);
 	}
 
 	void GLGraphicsDevice::_setShaderCmd(SetShaderCommand *cmd)
 	{
-		glUseProgram(mShaderToGL[cmd->handle].program);
+		GLShader &shader = mShaderToGL[cmd->handle];
+		_pollProgram(shader);
+
+		// Draws are skipped until the program is ready.
+		mCurrentShaderReady = shader.status == ShaderStatus::eReady;
+		if (mCurrentShaderReady)
+		{
+			glUseProgram(shader.program);
+			++mStats.stateCalls;
+		}
 		checkGLErrors();
 	}
 
@@ -304,68 +1013,132 @@ namespace Jikken
 	void GLGraphicsDevice::_updateBufferCmd(UpdateBufferCommand *cmd)
 	{
 		GLBuffer buffer = mBufferToGL[cmd->buffer];
-		glBindBuffer(glutils::bufferTypeToGL(buffer.type), buffer.buffer);
-		glBufferSubData(glutils::bufferTypeToGL(buffer.type), cmd->offset, cmd->dataSize, cmd->data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, cmd->offset, cmd->dataSize, cmd->data);
+		++mStats.uploadCalls;
 		checkGLErrors();
 	}
 
 	void GLGraphicsDevice::_reallocBufferCmd(ReallocBufferCommand *cmd)
 	{
 		GLBuffer buffer = mBufferToGL[cmd->buffer];
-		glBindBuffer(glutils::bufferTypeToGL(buffer.type), buffer.buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.buffer);
 		glBufferData(
-			glutils::bufferTypeToGL(buffer.type),
+			GL_COPY_WRITE_BUFFER,
 			cmd->stride * cmd->count, 
 			cmd->data, 
 			glutils::bufferUsageHintToGL(cmd->hint)
 		);
+		++mStats.uploadCalls;
+
+		// Ranges bound before cover the old size, so the next bind must not be skipped.
+		for (auto &range : mStateCache.constantBuffers)
+		{
+			if (range.buffer == buffer.buffer)
+				range = { 0, 0, 0 };
+		}
+		for (auto &range : mStateCache.storageBuffers)
+		{
+			if (range.buffer == buffer.buffer)
+				range = { 0, 0, 0 };
+		}
 		checkGLErrors();
 	}
 
 	void GLGraphicsDevice::_drawCmd(DrawCommand *cmd)
 	{
+		if (!mCurrentShaderReady)
+			return;
+
 		GLenum primitive = glutils::drawPrimitiveToGL(cmd->primitive);
 
 		// Check if we are using indexed drawing.
-		if (mVertexArrayToGL[mCurrentVAO].ibo == InvalidHandle)
+		if (!mCurrentIndexed)
 		{
-			glDrawArrays(primitive, cmd->start, cmd->count);
+			glDrawArrays(primitive, cmd->start + cmd->baseVertex, cmd->count);
 		}
 		else
 		{
-#ifdef _MSC_VER
-// warning C4312: 'reinterpret_cast': conversion from 'uint32_t' to 'void *' of greater size
-#pragma warning(push)
-#pragma warning(disable : 4312)
-#endif
-			glDrawElements(primitive, cmd->count, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(cmd->start));
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
+			_setPrimitiveRestart(cmd->primitive);
+
+			GLenum indexType = glutils::indexTypeToGL(mCurrentIndexType);
+			uintptr_t offset = static_cast<uintptr_t>(cmd->start) * glutils::indexTypeSize(mCurrentIndexType);
+			void *indices = reinterpret_cast<void*>(offset);
+
+			if (cmd->baseVertex == 0)
+				glDrawElements(primitive, cmd->count, indexType, indices);
+			else
+				glDrawElementsBaseVertex(primitive, cmd->count, indexType, indices, cmd->baseVertex);
 		}
+		++mStats.drawCalls;
 		checkGLErrors();
 	}
 
 	void GLGraphicsDevice::_drawInstanceCmd(DrawInstanceCommand *cmd)
 	{
+		if (!mCurrentShaderReady)
+			return;
+
 		GLenum primitive = glutils::drawPrimitiveToGL(cmd->primitive);
 
+#ifdef _DEBUG
+		// Base instance needs GL 4.2 or ARB_base_instance.
+		if (cmd->baseInstance != 0 && !mCaps.baseInstance)
+			assert(false);
+#endif
+
 		// Check if we are using indexed drawing.
-		if (mVertexArrayToGL[mCurrentVAO].ibo == InvalidHandle)
+		if (!mCurrentIndexed)
 		{
-			glDrawArraysInstanced(primitive, cmd->start, cmd->count, cmd->instancedCount);
+			GLint first = cmd->start + cmd->baseVertex;
+			if (cmd->baseInstance != 0 && mCaps.baseInstance)
+				glDrawArraysInstancedBaseInstance(primitive, first, cmd->count, cmd->instancedCount, cmd->baseInstance);
+			else
+				glDrawArraysInstanced(primitive, first, cmd->count, cmd->instancedCount);
 		}
 		else
 		{
-#ifdef _MSC_VER
-// warning C4312: 'reinterpret_cast': conversion from 'uint32_t' to 'void *' of greater size
-#pragma warning(push)
-#pragma warning(disable : 4312)
-#endif
-			glDrawElementsInstanced(primitive, cmd->count, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(cmd->start), cmd->instancedCount);
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif		
+			_setPrimitiveRestart(cmd->primitive);
+
+			GLenum indexType = glutils::indexTypeToGL(mCurrentIndexType);
+			uintptr_t offset = static_cast<uintptr_t>(cmd->start) * glutils::indexTypeSize(mCurrentIndexType);
+			void *indices = reinterpret_cast<void*>(offset);
+
+			if (cmd->baseInstance != 0 && mCaps.baseInstance)
+				glDrawElementsInstancedBaseVertexBaseInstance(primitive, cmd->count, indexType, indices, cmd->instancedCount, cmd->baseVertex, cmd->baseInstance);
+			else if (cmd->baseVertex != 0)
+				glDrawElementsInstancedBaseVertex(primitive, cmd->count, indexType, indices, cmd->instancedCount, cmd->baseVertex);
+			else
+				glDrawElementsInstanced(primitive, cmd->count, indexType, indices, cmd->instancedCount);
+		}
+		++mStats.drawCalls;
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_setPrimitiveRestart(PrimitiveType primitive)
+	{
+		// Only strips restart. Lists may legitimately use the largest index.
+		bool enabled = (primitive == PrimitiveType::eTriangleStrip || primitive == PrimitiveType::eLineStrip);
+		if (enabled != mStateCache.primitiveRestart.enabled)
+		{
+			if (enabled)
+				glEnable(GL_PRIMITIVE_RESTART);
+			else
+				glDisable(GL_PRIMITIVE_RESTART);
+			mStateCache.primitiveRestart.enabled = enabled;
+			++mStats.stateCalls;
+		}
+
+		// The restart index is the largest value the index type can hold.
+		if (enabled)
+		{
+			GLuint index = static_cast<GLuint>((1ull << (glutils::indexTypeSize(mCurrentIndexType) * 8)) - 1);
+			if (index != mStateCache.primitiveRestart.index)
+			{
+				glPrimitiveRestartIndex(index);
+				mStateCache.primitiveRestart.index = index;
+				++mStats.stateCalls;
+			}
 		}
 	}
 
@@ -386,13 +1159,232 @@ namespace Jikken
 	{
 		mCurrentVAO = cmd->vertexArray;
 		const GLVAO &vao = mVertexArrayToGL[mCurrentVAO];
-		glBindVertexArray(vao.vao);
+		mCurrentIndexed = vao.ibo != InvalidHandle;
+		mCurrentIndexType = vao.indexType;
+		_bindVertexArray(vao.vao);
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_bindVertexBuffersCmd(BindVertexBuffersCommand *cmd)
+	{
+		GLLayout &layout = mLayoutToGL[cmd->layout];
+		_bindVertexArray(layout.vao);
+
+		for (uint32_t i = 0; i < cmd->bufferCount; ++i)
+		{
+#ifdef _DEBUG
+			BufferType type = mBufferToGL[cmd->vertexBuffers[i]].type;
+			if (type != BufferType::eVertexBuffer && type != BufferType::eStorageBuffer)
+				assert(false);
+#endif
+			GLuint buffer = mBufferToGL[cmd->vertexBuffers[i]].buffer;
+			size_t offset = cmd->offsets[i];
+			if (layout.vertexBuffers[i] == buffer && layout.offsets[i] == offset)
+				continue;
+
+			if (mCaps.vertexAttribBinding)
+			{
+				glBindVertexBuffer(i, buffer, static_cast<GLintptr>(offset), layout.strides[i]);
+			}
+			else
+			{
+				// Respecify the attributes of this binding with the new buffer and offset.
+				glBindBuffer(GL_ARRAY_BUFFER, buffer);
+				for (const VertexInputLayout &attr : layout.attributes)
+				{
+					if (attr.binding == i)
+						_vertexAttribPointer(attr, offset);
+				}
+			}
+			layout.vertexBuffers[i] = buffer;
+			layout.offsets[i] = offset;
+			++mStats.stateCalls;
+		}
+
+		// The index buffer is VAO state too.
+		mCurrentIndexed = cmd->indexBuffer != InvalidHandle;
+		mCurrentIndexType = cmd->indexType;
+		if (mCurrentIndexed)
+		{
+#ifdef _DEBUG
+			if (mBufferToGL[cmd->indexBuffer].type != BufferType::eIndexBuffer)
+				assert(false);
+#endif
+			GLuint indexBuffer = mBufferToGL[cmd->indexBuffer].buffer;
+			if (layout.indexBuffer != indexBuffer)
+			{
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+				layout.indexBuffer = indexBuffer;
+				++mStats.stateCalls;
+			}
+		}
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_bindVertexArray(GLuint vao)
+	{
+		if (mBoundVAO != vao)
+		{
+			glBindVertexArray(vao);
+			mBoundVAO = vao;
+			++mStats.stateCalls;
+		}
+	}
+
+	void GLGraphicsDevice::_vertexAttribPointer(const VertexInputLayout &attr, size_t bufferOffset)
+	{
+		GLenum type = glutils::layoutTypeToGL(attr.type);
+		void *offset = reinterpret_cast<void*>(bufferOffset + attr.offset);
+		if (attr.integer)
+			glVertexAttribIPointer(attr.attribute, attr.componentSize, type, attr.stride, offset);
+		else
+			glVertexAttribPointer(attr.attribute, attr.componentSize, type, attr.normalized ? GL_TRUE : GL_FALSE, attr.stride, offset);
+	}
+
+	void GLGraphicsDevice::_vertexAttribFormat(const VertexInputLayout &attr)
+	{
+		GLenum type = glutils::layoutTypeToGL(attr.type);
+		GLuint offset = static_cast<GLuint>(attr.offset);
+		if (attr.integer)
+			glVertexAttribIFormat(attr.attribute, attr.componentSize, type, offset);
+		else
+			glVertexAttribFormat(attr.attribute, attr.componentSize, type, attr.normalized ? GL_TRUE : GL_FALSE, offset);
+	}
+
+	void GLGraphicsDevice::_bindRenderTargetCmd(BindRenderTargetCommand *cmd)
+	{
+		GLuint fbo = cmd->target == InvalidHandle ? 0 : mRenderTargetToGL[cmd->target].fbo;
+		if (fbo != mCurrentFramebuffer)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			mCurrentFramebuffer = fbo;
+			++mStats.stateCalls;
+		}
+	}
+
+	void GLGraphicsDevice::_resolveRenderTargetCmd(ResolveRenderTargetCommand *cmd)
+	{
+		const GLRenderTarget &source = mRenderTargetToGL[cmd->source];
+
+		// The default framebuffer is the window's, or the headless surface.
+		GLuint destFbo = 0;
+		GLint destWidth = static_cast<GLint>(mConfig.headlessWidth);
+		GLint destHeight = static_cast<GLint>(mConfig.headlessHeight);
+		if (!mConfig.headless)
+			glfwGetFramebufferSize(mWindowHandle, &destWidth, &destHeight);
+		if (cmd->destination != InvalidHandle)
+		{
+			const GLRenderTarget &dest = mRenderTargetToGL[cmd->destination];
+			destFbo = dest.fbo;
+			destWidth = dest.width;
+			destHeight = dest.height;
+		}
+
+		GLbitfield mask = 0;
+		if (cmd->flag & ClearBufferFlags::eColor)
+			mask |= GL_COLOR_BUFFER_BIT;
+		if (cmd->flag & ClearBufferFlags::eDepth)
+			mask |= GL_DEPTH_BUFFER_BIT;
+		if (cmd->flag & ClearBufferFlags::eStencil)
+			mask |= GL_STENCIL_BUFFER_BIT;
+
+		// Only a color only blit may filter.
+		bool scaled = destWidth != static_cast<GLint>(source.width) || destHeight != static_cast<GLint>(source.height);
+		GLenum filter = scaled && mask == GL_COLOR_BUFFER_BIT ? GL_LINEAR : GL_NEAREST;
+
+#ifdef _DEBUG
+		if (scaled && (source.samples > 1 || mask != GL_COLOR_BUFFER_BIT))
+			assert(false);
+		if ((mask & GL_COLOR_BUFFER_BIT) && cmd->colorAttachment >= source.colorAttachments.size())
+			assert(false);
+#endif
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, source.fbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destFbo);
+		if (mask & GL_COLOR_BUFFER_BIT)
+			glReadBuffer(GL_COLOR_ATTACHMENT0 + cmd->colorAttachment);
+		glBlitFramebuffer(0, 0, source.width, source.height, 0, 0, destWidth, destHeight, mask, filter);
+		glBindFramebuffer(GL_FRAMEBUFFER, mCurrentFramebuffer);
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_updateTextureCmd(UpdateTextureCommand *cmd)
+	{
+		GLTexture &texture = mTextureToGL[cmd->texture];
+		GLenum internalFormat, pixelFormat, pixelType;
+		glutils::textureFormatToGL(texture.details.format, internalFormat, pixelFormat, pixelType);
+
+#ifdef _DEBUG
+		if (cmd->mipLevel >= texture.levels || cmd->layer >= texture.details.layers)
+			assert(false);
+#endif
+		if (cmd->mipLevel >= texture.levels || cmd->layer >= texture.details.layers)
+			return;
+
+		// Stage through the upload ring when it has room. Otherwise GL copies
+		// straight from the queue's memory before returning.
+		size_t offset;
+		const void *pixels = cmd->data;
+		bool staged = mUploadRing.write(cmd->data, cmd->dataSize, offset);
+		if (staged)
+			pixels = reinterpret_cast<const void*>(offset);
+
+		_bindScratchTexture(texture.target, texture.texture);
+		switch (texture.details.type)
+		{
+		case TextureType::e2DArray:
+			glTexSubImage3D(texture.target, cmd->mipLevel, cmd->x, cmd->y, cmd->layer, cmd->width, cmd->height, 1, pixelFormat, pixelType, pixels);
+			break;
+		case TextureType::eCube:
+			glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + cmd->layer, cmd->mipLevel, cmd->x, cmd->y, cmd->width, cmd->height, pixelFormat, pixelType, pixels);
+			break;
+		default:
+			glTexSubImage2D(texture.target, cmd->mipLevel, cmd->x, cmd->y, cmd->width, cmd->height, pixelFormat, pixelType, pixels);
+			break;
+		}
+		++mStats.uploadCalls;
+
+		if (staged)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			mUploadRing.fence();
+		}
+
+		// Let sampling reach finer levels as soon as they and everything coarser are in.
+		texture.coverage.add(cmd->mipLevel, cmd->layer, cmd->x, cmd->y, cmd->width, cmd->height);
+		if (texture.coverage.getCompleteFrom() < texture.baseLevel)
+		{
+			texture.baseLevel = texture.coverage.getCompleteFrom();
+			glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, texture.baseLevel);
+		}
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_bindTextureCmd(BindTextureCommand *cmd)
+	{
+#ifdef _DEBUG
+		if (cmd->unit >= mScratchTextureUnit)
+			assert(false);
+#endif
+		glActiveTexture(GL_TEXTURE0 + cmd->unit);
+		if (cmd->texture != InvalidHandle)
+		{
+			const GLTexture &texture = mTextureToGL[cmd->texture];
+			glBindTexture(texture.target, texture.texture);
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		glBindSampler(cmd->unit, cmd->sampler != InvalidHandle ? mSamplerToGL[cmd->sampler] : 0);
+		mStats.stateCalls += 3;
 		checkGLErrors();
 	}
 
 	void GLGraphicsDevice::_viewportCmd(ViewportCommand *cmd)
 	{
 		glViewport(cmd->x, cmd->y, cmd->width, cmd->height);
+		++mStats.stateCalls;
 	}
 
 	void GLGraphicsDevice::_blendStateCmd(BlendStateCommand *cmd)
@@ -409,6 +1401,7 @@ namespace Jikken
 			else
 				glDisable(GL_BLEND);
 			mStateCache.blend.blendStateEnabled = cmd->enabled;
+			++mStats.stateCalls;
 		}
 
 		// Next update the kind of blending we want to perform.
@@ -417,6 +1410,7 @@ namespace Jikken
 			glBlendFunc(glutils::blendStateToGL(cmd->source), glutils::blendStateToGL(cmd->dest));
 			mStateCache.blend.source = cmd->source;
 			mStateCache.blend.dest = cmd->dest;
+			++mStats.stateCalls;
 		}
 
 		// We've set it at least once.
@@ -437,6 +1431,7 @@ namespace Jikken
 			else
 				glDisable(GL_DEPTH_TEST);
 			mStateCache.depthStencil.depthEnabled = cmd->depthEnabled;
+			++mStats.stateCalls;
 		}
 
 		// Enables/Disables writing to the depth buffer.
@@ -444,6 +1439,7 @@ namespace Jikken
 		{
 			glDepthMask(cmd->depthWrite);
 			mStateCache.depthStencil.depthWrite = cmd->depthWrite;
+			++mStats.stateCalls;
 		}
 
 		// Sets depth function.
@@ -451,6 +1447,7 @@ namespace Jikken
 		{
 			glDepthFunc(glutils::depthFuncToGL(cmd->depthFunc));
 			mStateCache.depthStencil.depthFunc = cmd->depthFunc;
+			++mStats.stateCalls;
 		}
 
 		// We've set it at least once.
@@ -471,6 +1468,7 @@ namespace Jikken
 			else
 				glDisable(GL_CULL_FACE);
 			mStateCache.cull.enabled = cmd->enabled;
+			++mStats.stateCalls;
 		}
 
 		// Sets which face to cull
@@ -481,6 +1479,7 @@ namespace Jikken
 			else
 				glCullFace(GL_FRONT);
 			mStateCache.cull.face = cmd->face;
+			++mStats.stateCalls;
 		}
 
 		// Winding order
@@ -491,14 +1490,227 @@ namespace Jikken
 			else
 				glFrontFace(GL_CW);
 			mStateCache.cull.state = cmd->state;
+			++mStats.stateCalls;
 		}
 
 		// We've set it at least once.
 		mStateCache.cull.firstSet = false;
 	}
 
+	void GLGraphicsDevice::_setConstantBufferRangeCmd(SetConstantBufferRangeCommand *cmd)
+	{
+#ifdef _DEBUG
+		if (mBufferToGL[cmd->buffer].type != BufferType::eConstantBuffer)
+			assert(false);
+		if (cmd->offset % mConstantBufferAlignment != 0)
+			assert(false);
+#endif
+		GLuint buffer = mBufferToGL[cmd->buffer].buffer;
+		GLintptr offset = static_cast<GLintptr>(cmd->offset);
+		GLsizeiptr size = static_cast<GLsizeiptr>(cmd->size);
+
+		// Only hit GL if the range actually changed.
+		auto &cache = mStateCache.constantBuffers[cmd->index];
+		if (cache.buffer == buffer && cache.offset == offset && cache.size == size)
+			return;
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, cmd->index, buffer, offset, size);
+		cache = { buffer, offset, size };
+		++mStats.stateCalls;
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_setConstantsCmd(SetConstantsCommand *cmd)
+	{
+#ifdef _DEBUG
+		if (cmd->dataSize > MaxConstantsSize || cmd->index >= mStateCache.constantBuffers.size())
+			assert(false);
+#endif
+		if (cmd->index >= mStateCache.constantBuffers.size())
+			return;
+
+		GLuint buffer;
+		GLintptr offset;
+		size_t ringOffset;
+		if (mConstantsRing.write(cmd->data, cmd->dataSize, ringOffset))
+		{
+			buffer = mConstantsRing.getBuffer();
+			offset = static_cast<GLintptr>(ringOffset);
+		}
+		else
+		{
+			// The ring is still read by earlier frames. Orphaning gives the
+			// binding point's own buffer new storage without waiting on them.
+			GLuint &fallback = mConstantsFallback[cmd->index];
+			if (fallback == 0)
+				glGenBuffers(1, &fallback);
+			glBindBuffer(GL_UNIFORM_BUFFER, fallback);
+			glBufferData(GL_UNIFORM_BUFFER, cmd->dataSize, cmd->data, GL_STREAM_DRAW);
+			buffer = fallback;
+			offset = 0;
+		}
+
+		const GLsizeiptr size = static_cast<GLsizeiptr>(cmd->dataSize);
+		glBindBufferRange(GL_UNIFORM_BUFFER, cmd->index, buffer, offset, size);
+		mStateCache.constantBuffers[cmd->index] = { buffer, offset, size };
+		++mStats.stateCalls;
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_setStorageBufferRangeCmd(SetStorageBufferRangeCommand *cmd)
+	{
+#ifdef _DEBUG
+		if (mBufferToGL[cmd->buffer].type != BufferType::eStorageBuffer)
+			assert(false);
+		if (cmd->offset % mStorageBufferAlignment != 0)
+			assert(false);
+#endif
+		if (!mCaps.compute || cmd->index >= mStateCache.storageBuffers.size())
+			return;
+
+		GLuint buffer = mBufferToGL[cmd->buffer].buffer;
+		GLintptr offset = static_cast<GLintptr>(cmd->offset);
+		GLsizeiptr size = static_cast<GLsizeiptr>(cmd->size);
+
+		auto &cache = mStateCache.storageBuffers[cmd->index];
+		if (cache.buffer == buffer && cache.offset == offset && cache.size == size)
+			return;
+
+		// A size of 0 binds the rest of the buffer. From the start that is the
+		// whole buffer, which follows its size through reallocs.
+		if (size == 0 && offset == 0)
+		{
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cmd->index, buffer);
+		}
+		else if (size == 0)
+		{
+			GLint64 bufferSize;
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glGetBufferParameteri64v(GL_COPY_WRITE_BUFFER, GL_BUFFER_SIZE, &bufferSize);
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, cmd->index, buffer, offset, static_cast<GLsizeiptr>(bufferSize) - offset);
+		}
+		else
+		{
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, cmd->index, buffer, offset, size);
+		}
+		cache = { buffer, offset, size };
+		++mStats.stateCalls;
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_dispatchCmd(DispatchCommand *cmd)
+	{
+		if (!mCurrentShaderReady)
+			return;
+
+#ifdef _DEBUG
+		// Compute needs GL 4.3 or ARB_compute_shader.
+		if (!mCaps.compute)
+			assert(false);
+#endif
+		glDispatchCompute(cmd->groupsX, cmd->groupsY, cmd->groupsZ);
+		++mStats.dispatchCalls;
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_dispatchIndirectCmd(DispatchIndirectCommand *cmd)
+	{
+		if (!mCurrentShaderReady)
+			return;
+
+#ifdef _DEBUG
+		if (!mCaps.compute)
+			assert(false);
+		if (mBufferToGL[cmd->buffer].type != BufferType::eStorageBuffer)
+			assert(false);
+		if (cmd->offset % 4 != 0)
+			assert(false);
+#endif
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, mBufferToGL[cmd->buffer].buffer);
+		glDispatchComputeIndirect(static_cast<GLintptr>(cmd->offset));
+		++mStats.dispatchCalls;
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_memoryBarrierCmd(MemoryBarrierCommand *cmd)
+	{
+		GLbitfield barriers = glutils::memoryBarrierToGL(cmd->barriers);
+		if (barriers != 0)
+			glMemoryBarrier(barriers);
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_beginQueryCmd(BeginQueryCommand *cmd)
+	{
+		auto it = mQueryToGL.find(cmd->query);
+		if (it == mQueryToGL.end())
+			return;
+		GLQuery &query = it->second;
+#ifdef _DEBUG
+		if (query.active)
+			assert(false);
+#endif
+		// Every GL query is waiting on a result nobody read, reuse the oldest.
+		if (query.pending == QueryLatency)
+		{
+			query.oldest = (query.oldest + 1) % QueryLatency;
+			--query.pending;
+		}
+
+		uint32_t slot = (query.oldest + query.pending) % QueryLatency;
+		glBeginQuery(query.target, query.queries[slot]);
+		++query.pending;
+		query.active = true;
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_endQueryCmd(EndQueryCommand *cmd)
+	{
+		auto it = mQueryToGL.find(cmd->query);
+		if (it == mQueryToGL.end())
+			return;
+		GLQuery &query = it->second;
+#ifdef _DEBUG
+		if (!query.active)
+			assert(false);
+#endif
+		glEndQuery(query.target);
+		query.last = static_cast<int32_t>((query.oldest + query.pending - 1) % QueryLatency);
+		query.active = false;
+		checkGLErrors();
+	}
+
+	void GLGraphicsDevice::_conditionalRenderCmd(ConditionalRenderCommand *cmd)
+	{
+		if (mConditionalRender)
+		{
+			glEndConditionalRender();
+			mConditionalRender = false;
+		}
+
+		if (cmd->query == InvalidHandle)
+			return;
+
+		// Nothing to decide on before the query has been issued once.
+		auto it = mQueryToGL.find(cmd->query);
+		if (it == mQueryToGL.end() || it->second.last < 0)
+			return;
+		const GLQuery &query = it->second;
+
+		glBeginConditionalRender(query.queries[query.last], cmd->wait ? GL_QUERY_WAIT : GL_QUERY_NO_WAIT);
+		mConditionalRender = true;
+		checkGLErrors();
+	}
+
 	void GLGraphicsDevice::presentFrame()
 	{
-		glfwSwapBuffers(mWindowHandle);
+		// Constants set during the frame are reused once its draws have run.
+		mConstantsRing.fence();
+
+		// Headless frames have nowhere to go, just hand the work to the driver.
+		if (mConfig.headless)
+			glFlush();
+		else
+			glfwSwapBuffers(mWindowHandle);
 	}
 }
\ No newline at end of file
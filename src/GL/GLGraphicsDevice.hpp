@@ -28,6 +28,12 @@
 #include <unordered_map>
 #include <GL/glew.h>
 #include "jikken/graphicsDevice.hpp"
+#include "GL/GLProgramCache.hpp"
+#include "GL/GLUploadRing.hpp"
+#ifdef JIKKEN_EGL
+#include "GL/GLHeadlessContext.hpp"
+#include "textureCoverage.hpp"
+#endif
 
 //temp forward declare
 struct GLFWwindow;
@@ -44,30 +50,124 @@ namespace Jikken
 
 		struct GLVAO
 		{
-			BufferHandle vbo;
+			std::vector<BufferHandle> vertexBuffers;
 			BufferHandle ibo;
 			LayoutHandle layout;
+			IndexType indexType;
 			GLuint vao;
 		};
 
+		// One VAO per vertex format. Buffers are attached to it by BindVertexBuffers
+		// and the VAO keeps them, so we also remember what is attached to skip rebinds.
+		struct GLLayout
+		{
+			std::vector<VertexInputLayout> attributes;
+			GLuint vao;
+			GLsizei strides[MaxVertexBufferBindings];
+			GLuint vertexBuffers[MaxVertexBufferBindings];
+			size_t offsets[MaxVertexBufferBindings];
+			GLuint indexBuffer;
+		};
+
+		struct GLRenderTarget
+		{
+			GLuint fbo;
+			uint32_t width;
+			uint32_t height;
+			uint32_t samples;
+
+			// Textures, or renderbuffers for multisampled targets.
+			std::vector<GLuint> colorAttachments;
+			GLuint depthAttachment;
+		};
+
+		struct GLTexture
+		{
+			GLuint texture;
+			GLenum target;
+			TextureDetails details;
+			uint32_t levels;
+
+			// What was uploaded so far, to know when a level is complete.
+			TextureCoverage coverage;
+			// GL_TEXTURE_BASE_LEVEL, the finest level sampling may use.
+			uint32_t baseLevel;
+		};
+
+		struct GLQuery
+		{
+			GLenum target;
+			// Ring of GL queries, so a query can be issued again while
+			// earlier results are still on their way back.
+			std::vector<GLuint> queries;
+			// Issued queries whose results have not been read, starting at oldest.
+			uint32_t oldest;
+			uint32_t pending;
+			// Slot of the last ended query, -1 before the first one.
+			int32_t last;
+			// Between BeginQueryCommand and EndQueryCommand.
+			bool active;
+			// Most recent result read back.
+			uint64_t result;
+			bool hasResult;
+		};
+
 		struct GLShader
 		{
 			GLuint program;
+			ShaderStatus status;
+
+			// Only kept while the program is still compiling.
+			std::vector<GLuint> attachments;
+			std::vector<std::string> files;
+			uint64_t cacheKey;
 		};
 	public:
 		GLGraphicsDevice();
 		virtual ~GLGraphicsDevice();
 
-		virtual ShaderHandle createShader(const std::vector<ShaderDetails> &shaders) override;
+		virtual ShaderHandle createShader(const std::vector<ShaderDetails> &shaders, bool async = false) override;
+
+		virtual ShaderStatus getShaderStatus(ShaderHandle handle) override;
 
 		virtual BufferHandle createBuffer(BufferType type, BufferUsageHint hint, size_t dataSize, float *data) override;
 
 		virtual LayoutHandle createVertexInputLayout(const std::vector<VertexInputLayout> &attributes) override;
 
-		virtual VertexArrayHandle createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer = InvalidHandle) override;
+		virtual VertexArrayHandle createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer = InvalidHandle, IndexType indexType = IndexType::eUInt16) override;
+
+		virtual VertexArrayHandle createVAO(LayoutHandle layout, const std::vector<BufferHandle> &vertexBuffers, BufferHandle indexBuffer = InvalidHandle, IndexType indexType = IndexType::eUInt16) override;
 
 		virtual void bindConstantBuffer(ShaderHandle shader, BufferHandle cBuffer, const char *name, int32_t index) override;
 
+		virtual size_t getConstantBufferAlignment() override;
+
+		virtual void bindStorageBuffer(ShaderHandle shader, BufferHandle sBuffer, const char *name, int32_t index) override;
+
+		virtual size_t getStorageBufferAlignment() override;
+
+		virtual RenderTargetHandle createRenderTarget(const RenderTargetDetails &details) override;
+
+		virtual void deleteRenderTarget(RenderTargetHandle handle) override;
+
+		virtual TextureHandle createTexture(const TextureDetails &details) override;
+
+		virtual void deleteTexture(TextureHandle handle) override;
+
+		virtual SamplerHandle createSampler(const SamplerDetails &details) override;
+
+		virtual void deleteSampler(SamplerHandle handle) override;
+
+		virtual void bindTextureUnit(ShaderHandle shader, const char *name, int32_t unit) override;
+
+		virtual bool readPixels(RenderTargetHandle target, uint32_t colorAttachment, int32_t x, int32_t y, uint32_t width, uint32_t height, void *data) override;
+
+		virtual QueryHandle createQuery(QueryType type) override;
+
+		virtual void deleteQuery(QueryHandle handle) override;
+
+		virtual bool getQueryResult(QueryHandle handle, uint64_t &result) override;
+
 		virtual void deleteVertexInputLayout(LayoutHandle handle) override;
 
 		virtual void deleteVAO(VertexArrayHandle handle) override;
@@ -76,7 +176,7 @@ namespace Jikken
 
 		virtual void deleteShader(ShaderHandle handle) override;
 
-		virtual bool init(void *glfwWinHandle) override;
+		virtual bool init(const DeviceConfig &config, void *glfwWinHandle) override;
 
 		virtual void presentFrame() override;
 
@@ -94,26 +194,126 @@ namespace Jikken
 		virtual void _blendStateCmd(BlendStateCommand *cmd) override;
 		virtual void _depthStencilStateCmd(DepthStencilStateCommand *cmd) override;
 		virtual void _cullStateCmd(CullStateCommand *cmd) override;
+		virtual void _setConstantBufferRangeCmd(SetConstantBufferRangeCommand *cmd) override;
+		virtual void _bindVertexBuffersCmd(BindVertexBuffersCommand *cmd) override;
+		virtual void _bindRenderTargetCmd(BindRenderTargetCommand *cmd) override;
+		virtual void _resolveRenderTargetCmd(ResolveRenderTargetCommand *cmd) override;
+		virtual void _updateTextureCmd(UpdateTextureCommand *cmd) override;
+		virtual void _bindTextureCmd(BindTextureCommand *cmd) override;
+		virtual void _setStorageBufferRangeCmd(SetStorageBufferRangeCommand *cmd) override;
+		virtual void _dispatchCmd(DispatchCommand *cmd) override;
+		virtual void _dispatchIndirectCmd(DispatchIndirectCommand *cmd) override;
+		virtual void _memoryBarrierCmd(MemoryBarrierCommand *cmd) override;
+		virtual void _beginQueryCmd(BeginQueryCommand *cmd) override;
+		virtual void _endQueryCmd(EndQueryCommand *cmd) override;
+		virtual void _conditionalRenderCmd(ConditionalRenderCommand *cmd) override;
+		virtual void _setConstantsCmd(SetConstantsCommand *cmd) override;
+
+		void _setPrimitiveRestart(PrimitiveType primitive);
+		void _bindVertexArray(GLuint vao);
+
+		// Specifies an attribute with the float, normalized or integer entry point it asks for.
+		void _vertexAttribPointer(const VertexInputLayout &attr, size_t bufferOffset);
+		void _vertexAttribFormat(const VertexInputLayout &attr);
+
+		// Creates and attaches one attachment to the bound framebuffer. Returns 0 on failure.
+		GLuint _createAttachment(const GLRenderTarget &target, TextureFormat format, GLenum attachment);
+		void _destroyRenderTarget(GLRenderTarget &target);
+
+		// Binds a texture for creation or upload on a unit draws never use, so
+		// the textures bound with BindTextureCommand are left alone.
+		void _bindScratchTexture(GLenum target, GLuint texture);
+
+		// Issues the compile and link of sources without waiting on the result.
+		void _submitProgram(GLShader &shader, const std::vector<ShaderDetails> &shaders, const std::vector<std::string> &sources);
+		// Checks the compile and link result and releases the attachments.
+		void _finishProgram(GLShader &shader);
+		// Finishes the program if the driver is done with it, without blocking where possible.
+		void _pollProgram(GLShader &shader);
 
 		std::unordered_map<BufferHandle, GLBuffer> mBufferToGL;
 		std::unordered_map<VertexArrayHandle, GLVAO> mVertexArrayToGL;
 		std::unordered_map<ShaderHandle, GLShader> mShaderToGL;
-		std::unordered_map<LayoutHandle, std::vector<VertexInputLayout>> mLayoutToGL;
+		std::unordered_map<LayoutHandle, GLLayout> mLayoutToGL;
+		std::unordered_map<RenderTargetHandle, GLRenderTarget> mRenderTargetToGL;
+		std::unordered_map<TextureHandle, GLTexture> mTextureToGL;
+		std::unordered_map<SamplerHandle, GLuint> mSamplerToGL;
+		std::unordered_map<QueryHandle, GLQuery> mQueryToGL;
 
 		BufferHandle mBufferHandle;
 		VertexArrayHandle mVertexArrayHandle;
 		ShaderHandle mShaderHandle;
 		LayoutHandle mLayoutHandle;
+		RenderTargetHandle mRenderTargetHandle;
+		TextureHandle mTextureHandle;
+		SamplerHandle mSamplerHandle;
+		QueryHandle mQueryHandle;
 
 		//temp window handle
 		GLFWwindow *mWindowHandle;
 
+#ifdef JIKKEN_EGL
+		// Context of headless devices. Declared before every member that owns
+		// GL objects, so it is destroyed after them.
+		GLHeadlessContext mHeadlessContext;
+#endif
+
 		// GL needs a VAO bound for most functions.
 		// This will just make a global one.
 		GLuint mGlobalVAO;
 
+		// The GL VAO that is actually bound, either a VAO handle's or a layout's.
+		GLuint mBoundVAO;
+
 		VertexArrayHandle mCurrentVAO;
 
+		// Framebuffer rendering goes to, 0 for the default one.
+		GLuint mCurrentFramebuffer;
+
+		// False while the bound shader is still compiling or failed, so draws are skipped.
+		bool mCurrentShaderReady;
+
+		// Between a ConditionalRenderCommand with a query and one with InvalidHandle.
+		bool mConditionalRender;
+
+		// Index state of the bound VAO, read by every draw.
+		bool mCurrentIndexed;
+		IndexType mCurrentIndexType;
+
+		GLProgramCache mProgramCache;
+
+		// Texture uploads are staged here.
+		GLUploadRing mUploadRing;
+
+		// SetConstantsCommand data is streamed here and fenced once per frame.
+		GLUploadRing mConstantsRing;
+		// Per uniform buffer binding point, for when the ring is full.
+		std::vector<GLuint> mConstantsFallback;
+
+		// The last texture unit, reserved for _bindScratchTexture.
+		GLuint mScratchTextureUnit;
+
+		// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+		size_t mConstantBufferAlignment;
+
+		// GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+		size_t mStorageBufferAlignment;
+
+		// Optional features detected at init.
+		struct Capabilities
+		{
+			bool baseInstance;
+			bool parallelShaderCompile;
+			bool vertexAttribBinding;
+			bool textureStorage;
+			bool bufferStorage;
+			bool separateShaderObjects;
+			// 0 without EXT_texture_filter_anisotropic.
+			float maxAnisotropy;
+			// Compute shaders and storage buffers.
+			bool compute;
+		} mCaps;
+
 		struct StateCache
 		{
 			struct
@@ -142,6 +342,24 @@ namespace Jikken
 				CullFaceState face;
 				WindingOrderState state;
 			} cull;
+
+			struct
+			{
+				bool enabled;
+				GLuint index;
+			} primitiveRestart;
+
+			// What is bound to each uniform buffer binding point, so that
+			// rebinding the same range every draw is skipped.
+			struct ConstantBufferRange
+			{
+				GLuint buffer;
+				GLintptr offset;
+				GLsizeiptr size;
+			};
+			std::vector<ConstantBufferRange> constantBuffers;
+			// Same for the storage buffer binding points.
+			std::vector<ConstantBufferRange> storageBuffers;
 		} mStateCache;
 	};
 }
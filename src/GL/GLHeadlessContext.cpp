@@ -0,0 +1,162 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "GL/GLHeadlessContext.hpp"
+
+namespace Jikken
+{
+	GLHeadlessContext::GLHeadlessContext() :
+		mDisplay(nullptr),
+		mSurface(nullptr),
+		mContext(nullptr)
+	{
+	}
+
+	GLHeadlessContext::~GLHeadlessContext()
+	{
+		destroy();
+	}
+
+	static bool hasClientExtension(const char *name)
+	{
+		const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		if (extensions == nullptr)
+			return false;
+
+		size_t length = strlen(name);
+		for (const char *found = strstr(extensions, name); found != nullptr; found = strstr(found + length, name))
+		{
+			if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+				return true;
+		}
+		return false;
+	}
+
+	bool GLHeadlessContext::create(uint32_t width, uint32_t height)
+	{
+		// The surfaceless platform needs neither X nor a GPU device node.
+		EGLDisplay display = EGL_NO_DISPLAY;
+		if (hasClientExtension("EGL_MESA_platform_surfaceless"))
+		{
+			PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+			if (getPlatformDisplay != nullptr)
+				display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+		if (display == EGL_NO_DISPLAY)
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+		{
+			printf("Unable to initialize an EGL display.\n");
+			return false;
+		}
+		mDisplay = display;
+
+		if (!eglBindAPI(EGL_OPENGL_API))
+		{
+			printf("EGL display can't create OpenGL contexts.\n");
+			destroy();
+			return false;
+		}
+
+		const EGLint configAttribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8,
+			EGL_ALPHA_SIZE, 8,
+			EGL_DEPTH_SIZE, 24,
+			EGL_STENCIL_SIZE, 8,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0)
+		{
+			printf("No EGL config with an RGBA8 pbuffer and depth stencil.\n");
+			destroy();
+			return false;
+		}
+
+		// Core profile drivers hand back the newest version they support.
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		mContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+		if (mContext == EGL_NO_CONTEXT)
+		{
+			printf("Unable to create an OpenGL 3.3 core context through EGL.\n");
+			mContext = nullptr;
+			destroy();
+			return false;
+		}
+
+		const EGLint surfaceAttribs[] = {
+			EGL_WIDTH, static_cast<EGLint>(width),
+			EGL_HEIGHT, static_cast<EGLint>(height),
+			EGL_NONE
+		};
+		mSurface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+		if (mSurface == EGL_NO_SURFACE)
+		{
+			printf("Unable to create a %ux%u EGL pbuffer.\n", width, height);
+			mSurface = nullptr;
+			destroy();
+			return false;
+		}
+
+		if (!eglMakeCurrent(display, mSurface, mSurface, mContext))
+		{
+			printf("Unable to make the EGL context current.\n");
+			destroy();
+			return false;
+		}
+		return true;
+	}
+
+	void GLHeadlessContext::destroy()
+	{
+		if (mDisplay == nullptr)
+			return;
+
+		eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (mSurface != nullptr)
+			eglDestroySurface(mDisplay, mSurface);
+		if (mContext != nullptr)
+			eglDestroyContext(mDisplay, mContext);
+		eglTerminate(mDisplay);
+
+		mDisplay = nullptr;
+		mSurface = nullptr;
+		mContext = nullptr;
+	}
+}
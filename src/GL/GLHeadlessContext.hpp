@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_GL_GLHEADLESSCONTEXT_HPP_
+#define _JIKKEN_GL_GLHEADLESSCONTEXT_HPP_
+
+#include <cstdint>
+
+namespace Jikken
+{
+	/// OpenGL context created through EGL without a window, for rendering on
+	/// machines with no display (Mesa llvmpipe on a build server for example).
+	/// The default framebuffer is a pbuffer surface of the requested size.
+	class GLHeadlessContext
+	{
+	public:
+		GLHeadlessContext();
+		~GLHeadlessContext();
+
+		/// Creates the context and makes it current on the calling thread.
+		/// @return false if EGL has no display or config that can render OpenGL.
+		bool create(uint32_t width, uint32_t height);
+
+		void destroy();
+
+		inline bool isCreated() const
+		{
+			return mContext != nullptr;
+		}
+
+	private:
+		GLHeadlessContext(const GLHeadlessContext&);
+		GLHeadlessContext& operator=(const GLHeadlessContext&);
+
+		// EGLDisplay, EGLSurface and EGLContext, kept opaque so EGL headers
+		// stay out of the rest of the backend.
+		void *mDisplay;
+		void *mSurface;
+		void *mContext;
+	};
+}
+
+#endif
@@ -0,0 +1,200 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <algorithm>
+#include "GL/GLProgramCache.hpp"
+#include "hashUtils.hpp"
+
+namespace Jikken
+{
+	// File layout: header followed by binaryLength bytes of program binary.
+	struct ProgramCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t binaryFormat;
+		uint32_t binaryLength;
+	};
+
+	const uint32_t PROGRAM_CACHE_MAGIC = 0x42504B4A; // "JKPB"
+	const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+	GLProgramCache::GLProgramCache() :
+		mEnabled(false),
+		mDriverHash(0)
+	{
+	}
+
+	void GLProgramCache::init(const std::string &directory)
+	{
+		mEnabled = false;
+		if (directory.empty())
+			return;
+
+		if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+		{
+			std::printf("Program binaries are not supported. Program cache disabled.\n");
+			return;
+		}
+
+		GLint numFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		if (numFormats <= 0)
+		{
+			std::printf("Driver has no program binary formats. Program cache disabled.\n");
+			return;
+		}
+
+		mFormats.resize(numFormats);
+		glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, mFormats.data());
+
+		// Binaries are only valid for the exact driver that produced them.
+		const char *vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+		const char *renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+		const char *version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+		mDriverHash = HashUtils::fnv1a(std::string(vendor ? vendor : ""));
+		mDriverHash = HashUtils::fnv1a(std::string(renderer ? renderer : ""), mDriverHash);
+		mDriverHash = HashUtils::fnv1a(std::string(version ? version : ""), mDriverHash);
+
+		mDirectory = directory;
+		if (mDirectory.back() != '/' && mDirectory.back() != '\\')
+			mDirectory += '/';
+		mEnabled = true;
+	}
+
+	uint64_t GLProgramCache::computeKey(const std::vector<ShaderDetails> &shaders, const std::vector<std::string> &sources) const
+	{
+		uint64_t key = mDriverHash;
+		for (size_t i = 0; i < shaders.size(); ++i)
+		{
+			key = HashUtils::fnv1aValue(shaders[i].stage, key);
+			key = HashUtils::fnv1a(sources[i], key);
+		}
+		return key;
+	}
+
+	std::string GLProgramCache::_getPath(uint64_t key) const
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.glprogram", static_cast<unsigned long long>(key));
+		return mDirectory + name;
+	}
+
+	GLuint GLProgramCache::load(uint64_t key)
+	{
+		std::string path = _getPath(key);
+		FILE *file = fopen(path.c_str(), "rb");
+		if (file == nullptr)
+			return 0;
+
+		ProgramCacheHeader header;
+		bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+			header.magic == PROGRAM_CACHE_MAGIC &&
+			header.version == PROGRAM_CACHE_VERSION &&
+			header.key == key &&
+			header.binaryLength > 0 &&
+			std::find(mFormats.begin(), mFormats.end(), static_cast<GLint>(header.binaryFormat)) != mFormats.end();
+
+		std::vector<uint8_t> binary;
+		if (valid)
+		{
+			binary.resize(header.binaryLength);
+			valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+		}
+		fclose(file);
+
+		if (!valid)
+		{
+			std::remove(path.c_str());
+			return 0;
+		}
+
+		GLuint program = glCreateProgram();
+		glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+		// The driver is free to reject a binary at any time, so fall back to compiling.
+		GLint linked;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked)
+		{
+			glDeleteProgram(program);
+			std::remove(path.c_str());
+			return 0;
+		}
+
+		return program;
+	}
+
+	void GLProgramCache::save(uint64_t key, GLuint program)
+	{
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+
+		std::vector<uint8_t> binary(length);
+		GLenum format;
+		glGetProgramBinary(program, length, &length, &format, binary.data());
+
+		ProgramCacheHeader header;
+		header.magic = PROGRAM_CACHE_MAGIC;
+		header.version = PROGRAM_CACHE_VERSION;
+		header.key = key;
+		header.binaryFormat = format;
+		header.binaryLength = static_cast<uint32_t>(length);
+
+		// Written next to the entry and renamed over it, so a crash or another
+		// process saving the same program never leaves a truncated entry.
+		std::string path = _getPath(key);
+		std::string tempPath = path + ".tmp";
+		FILE *file = fopen(tempPath.c_str(), "wb");
+		if (file == nullptr)
+		{
+			std::printf("Unable to open %s for writing. Program not cached.\n", tempPath.c_str());
+			return;
+		}
+
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(binary.data(), 1, header.binaryLength, file) == header.binaryLength;
+		written = fclose(file) == 0 && written;
+		if (!written)
+		{
+			std::remove(tempPath.c_str());
+			return;
+		}
+
+		// Windows doesn't rename over an existing file.
+		if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+		{
+			std::remove(path.c_str());
+			if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+			{
+				std::printf("Unable to replace %s. Program not cached.\n", path.c_str());
+				std::remove(tempPath.c_str());
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_GL_GLPROGRAMCACHE_HPP_
+#define _JIKKEN_GL_GLPROGRAMCACHE_HPP_
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include "jikken/structs.hpp"
+
+namespace Jikken
+{
+	/// Stores linked program binaries on disk so later runs can skip compiling.
+	/// Entries are keyed by the shader sources and stages together with the
+	/// driver vendor, renderer and version, so a driver update misses the cache.
+	class GLProgramCache
+	{
+	public:
+		GLProgramCache();
+
+		/// Enables the cache if directory is set and the driver can return program binaries.
+		void init(const std::string &directory);
+
+		inline bool isEnabled() const
+		{
+			return mEnabled;
+		}
+
+		uint64_t computeKey(const std::vector<ShaderDetails> &shaders, const std::vector<std::string> &sources) const;
+
+		/// Creates a program from the cached binary for key.
+		/// @return The linked program, or 0 if there was no entry or the driver rejected it.
+		GLuint load(uint64_t key);
+
+		/// Writes the binary of a linked program to the cache. The program must have
+		/// been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+		void save(uint64_t key, GLuint program);
+
+	private:
+		std::string _getPath(uint64_t key) const;
+
+		bool mEnabled;
+		std::string mDirectory;
+		uint64_t mDriverHash;
+		std::vector<GLint> mFormats;
+	};
+}
+
+#endif
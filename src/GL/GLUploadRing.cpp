@@ -0,0 +1,114 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cstring>
+#include "GL/GLUploadRing.hpp"
+
+namespace Jikken
+{
+	GLUploadRing::GLUploadRing() :
+		mTarget(GL_PIXEL_UNPACK_BUFFER),
+		mAlignment(16),
+		mBuffer(0),
+		mMapped(nullptr)
+	{
+	}
+
+	GLUploadRing::~GLUploadRing()
+	{
+		mRing.retire([](GLsync sync)
+		{
+			glDeleteSync(sync);
+			return true;
+		});
+
+		if (mBuffer != 0)
+		{
+			if (mMapped != nullptr)
+			{
+				glBindBuffer(mTarget, mBuffer);
+				glUnmapBuffer(mTarget);
+				glBindBuffer(mTarget, 0);
+			}
+			glDeleteBuffers(1, &mBuffer);
+		}
+	}
+
+	void GLUploadRing::init(GLenum target, size_t size, size_t alignment, bool persistent)
+	{
+		mTarget = target;
+		mAlignment = alignment;
+		glGenBuffers(1, &mBuffer);
+		glBindBuffer(mTarget, mBuffer);
+		if (persistent)
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(mTarget, size, nullptr, flags);
+			mMapped = static_cast<uint8_t*>(glMapBufferRange(mTarget, 0, size, flags));
+		}
+		else
+		{
+			glBufferData(mTarget, size, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(mTarget, 0);
+		mRing.reset(size);
+	}
+
+	bool GLUploadRing::write(const void *data, size_t size, size_t &offset)
+	{
+		// Reclaim whatever the GPU is done with, without waiting.
+		mRing.retire([](GLsync sync)
+		{
+			GLenum status = glClientWaitSync(sync, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				return false;
+			glDeleteSync(sync);
+			return true;
+		});
+
+		if (mBuffer == 0 || !mRing.allocate(size, mAlignment, offset))
+			return false;
+
+		glBindBuffer(mTarget, mBuffer);
+		if (mMapped != nullptr)
+		{
+			memcpy(mMapped + offset, data, size);
+		}
+		else
+		{
+			// The ring guarantees the range is not in use, so skip the driver's sync.
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+			void *mem = glMapBufferRange(mTarget, offset, size, flags);
+			memcpy(mem, data, size);
+			glUnmapBuffer(mTarget);
+		}
+		return true;
+	}
+
+	void GLUploadRing::fence()
+	{
+		if (mRing.hasOpenRegion())
+			mRing.close(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	}
+}
@@ -0,0 +1,74 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_GL_GLUPLOADRING_HPP_
+#define _JIKKEN_GL_GLUPLOADRING_HPP_
+
+#include <GL/glew.h>
+#include "ringAllocator.hpp"
+
+namespace Jikken
+{
+	/// Stream buffer that texture uploads and small constants are staged
+	/// through. Writes go to memory the GPU has finished with, so copying into
+	/// it never waits on the GPU.
+	class GLUploadRing
+	{
+	public:
+		GLUploadRing();
+		~GLUploadRing();
+
+		/// @param target What the ring is bound to, such as GL_PIXEL_UNPACK_BUFFER.
+		/// @param alignment Of the offsets write returns.
+		/// @param persistent Map the buffer once for its whole lifetime. Needs
+		/// GL 4.4 or ARB_buffer_storage.
+		void init(GLenum target, size_t size, size_t alignment, bool persistent);
+
+		/// Copies data into the ring and leaves the ring bound to its target.
+		/// @param offset Receives the offset of the data, to pass as the pixel pointer.
+		/// @return false if the free space can't fit the data right now.
+		bool write(const void *data, size_t size, size_t &offset);
+
+		inline GLuint getBuffer() const
+		{
+			return mBuffer;
+		}
+
+		/// Fences the writes made since the last call. Call after issuing the
+		/// commands that read them.
+		void fence();
+
+	private:
+		GLUploadRing(const GLUploadRing&);
+		GLUploadRing& operator=(const GLUploadRing&);
+
+		GLenum mTarget;
+		size_t mAlignment;
+		GLuint mBuffer;
+		uint8_t *mMapped;
+		RingAllocator<GLsync> mRing;
+	};
+}
+
+#endif
@@ -24,6 +24,7 @@
 
 #include "GL/GLUtil.hpp"
 #include <iostream>
+#include <cstring>
 
 namespace Jikken
 {
@@ -55,6 +56,8 @@ namespace Jikken
 				return GL_ELEMENT_ARRAY_BUFFER;
 			case BufferType::eConstantBuffer:
 				return GL_UNIFORM_BUFFER;
+			case BufferType::eStorageBuffer:
+				return GL_SHADER_STORAGE_BUFFER;
 			default:
 				return GL_INVALID_ENUM;
 			}
@@ -66,6 +69,24 @@ namespace Jikken
 			{
 			case VertexAttributeType::eFLOAT:
 				return GL_FLOAT;
+			case VertexAttributeType::eHALF_FLOAT:
+				return GL_HALF_FLOAT;
+			case VertexAttributeType::eBYTE:
+				return GL_BYTE;
+			case VertexAttributeType::eUNSIGNED_BYTE:
+				return GL_UNSIGNED_BYTE;
+			case VertexAttributeType::eSHORT:
+				return GL_SHORT;
+			case VertexAttributeType::eUNSIGNED_SHORT:
+				return GL_UNSIGNED_SHORT;
+			case VertexAttributeType::eINT:
+				return GL_INT;
+			case VertexAttributeType::eUNSIGNED_INT:
+				return GL_UNSIGNED_INT;
+			case VertexAttributeType::eINT_2_10_10_10_REV:
+				return GL_INT_2_10_10_10_REV;
+			case VertexAttributeType::eUNSIGNED_INT_2_10_10_10_REV:
+				return GL_UNSIGNED_INT_2_10_10_10_REV;
 			default:
 				return GL_INVALID_ENUM;
 			}
@@ -81,6 +102,42 @@ namespace Jikken
 				return GL_FRAGMENT_SHADER;
 			case ShaderStage::eGeometry:
 				return GL_GEOMETRY_SHADER;
+			case ShaderStage::eCompute:
+				return GL_COMPUTE_SHADER;
+			default:
+				return GL_INVALID_ENUM;
+			}
+		}
+
+		GLbitfield memoryBarrierToGL(uint32_t barriers)
+		{
+			if (barriers == MemoryBarrierFlags::eAllBarriers)
+				return GL_ALL_BARRIER_BITS;
+
+			GLbitfield bits = 0;
+			if (barriers & MemoryBarrierFlags::eStorageBarrier)
+				bits |= GL_SHADER_STORAGE_BARRIER_BIT;
+			if (barriers & MemoryBarrierFlags::eVertexBarrier)
+				bits |= GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+			if (barriers & MemoryBarrierFlags::eIndexBarrier)
+				bits |= GL_ELEMENT_ARRAY_BARRIER_BIT;
+			if (barriers & MemoryBarrierFlags::eIndirectBarrier)
+				bits |= GL_COMMAND_BARRIER_BIT;
+			if (barriers & MemoryBarrierFlags::eConstantBarrier)
+				bits |= GL_UNIFORM_BARRIER_BIT;
+			if (barriers & MemoryBarrierFlags::eTransferBarrier)
+				bits |= GL_BUFFER_UPDATE_BARRIER_BIT;
+			return bits;
+		}
+
+		GLenum queryTypeToGL(QueryType type)
+		{
+			switch (type)
+			{
+			case QueryType::eSamplesPassed:
+				return GL_SAMPLES_PASSED;
+			case QueryType::eAnySamplesPassed:
+				return GL_ANY_SAMPLES_PASSED;
 			default:
 				return GL_INVALID_ENUM;
 			}
@@ -141,6 +198,166 @@ namespace Jikken
 			}
 		}
 
+		GLenum indexTypeToGL(IndexType type)
+		{
+			switch (type)
+			{
+			case IndexType::eUInt8:
+				return GL_UNSIGNED_BYTE;
+			case IndexType::eUInt16:
+				return GL_UNSIGNED_SHORT;
+			case IndexType::eUInt32:
+				return GL_UNSIGNED_INT;
+			default:
+				return GL_INVALID_ENUM;
+			}
+		}
+
+		size_t indexTypeSize(IndexType type)
+		{
+			switch (type)
+			{
+			case IndexType::eUInt8:
+				return 1;
+			case IndexType::eUInt16:
+				return 2;
+			case IndexType::eUInt32:
+				return 4;
+			default:
+				return 0;
+			}
+		}
+
+		GLuint attributeDivisor(const VertexInputLayout &attr)
+		{
+			// GL uses a divisor of 0 for per vertex data.
+			if (attr.inputRate == VertexInputRate::eVertex)
+				return 0;
+			return attr.divisor == 0 ? 1 : attr.divisor;
+		}
+
+		bool textureFormatToGL(TextureFormat format, GLenum &internalFormat, GLenum &pixelFormat, GLenum &pixelType)
+		{
+			switch (format)
+			{
+			case TextureFormat::eRGBA8:
+				internalFormat = GL_RGBA8; pixelFormat = GL_RGBA; pixelType = GL_UNSIGNED_BYTE;
+				return true;
+			case TextureFormat::eSRGBA8:
+				internalFormat = GL_SRGB8_ALPHA8; pixelFormat = GL_RGBA; pixelType = GL_UNSIGNED_BYTE;
+				return true;
+			case TextureFormat::eRGBA16F:
+				internalFormat = GL_RGBA16F; pixelFormat = GL_RGBA; pixelType = GL_HALF_FLOAT;
+				return true;
+			case TextureFormat::eRGBA32F:
+				internalFormat = GL_RGBA32F; pixelFormat = GL_RGBA; pixelType = GL_FLOAT;
+				return true;
+			case TextureFormat::eRG16F:
+				internalFormat = GL_RG16F; pixelFormat = GL_RG; pixelType = GL_HALF_FLOAT;
+				return true;
+			case TextureFormat::eR32F:
+				internalFormat = GL_R32F; pixelFormat = GL_RED; pixelType = GL_FLOAT;
+				return true;
+			case TextureFormat::eR11G11B10F:
+				internalFormat = GL_R11F_G11F_B10F; pixelFormat = GL_RGB; pixelType = GL_UNSIGNED_INT_10F_11F_11F_REV;
+				return true;
+			case TextureFormat::eDepth16:
+				internalFormat = GL_DEPTH_COMPONENT16; pixelFormat = GL_DEPTH_COMPONENT; pixelType = GL_UNSIGNED_SHORT;
+				return true;
+			case TextureFormat::eDepth24Stencil8:
+				internalFormat = GL_DEPTH24_STENCIL8; pixelFormat = GL_DEPTH_STENCIL; pixelType = GL_UNSIGNED_INT_24_8;
+				return true;
+			case TextureFormat::eDepth32F:
+				internalFormat = GL_DEPTH_COMPONENT32F; pixelFormat = GL_DEPTH_COMPONENT; pixelType = GL_FLOAT;
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		GLenum textureFormatAttachment(TextureFormat format)
+		{
+			switch (format)
+			{
+			case TextureFormat::eDepth16:
+			case TextureFormat::eDepth32F:
+				return GL_DEPTH_ATTACHMENT;
+			case TextureFormat::eDepth24Stencil8:
+				return GL_DEPTH_STENCIL_ATTACHMENT;
+			default:
+				return GL_COLOR_ATTACHMENT0;
+			}
+		}
+
+		GLenum textureTypeToGL(TextureType type)
+		{
+			switch (type)
+			{
+			case TextureType::e2D:
+				return GL_TEXTURE_2D;
+			case TextureType::e2DArray:
+				return GL_TEXTURE_2D_ARRAY;
+			case TextureType::eCube:
+				return GL_TEXTURE_CUBE_MAP;
+			default:
+				return GL_INVALID_ENUM;
+			}
+		}
+
+		GLenum samplerMinFilterToGL(SamplerFilter filter, SamplerMipFilter mipFilter)
+		{
+			switch (mipFilter)
+			{
+			case SamplerMipFilter::eNearest:
+				return filter == SamplerFilter::eLinear ? GL_LINEAR_MIPMAP_NEAREST : GL_NEAREST_MIPMAP_NEAREST;
+			case SamplerMipFilter::eLinear:
+				return filter == SamplerFilter::eLinear ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_LINEAR;
+			default:
+				return samplerFilterToGL(filter);
+			}
+		}
+
+		GLenum samplerFilterToGL(SamplerFilter filter)
+		{
+			switch (filter)
+			{
+			case SamplerFilter::eNearest:
+				return GL_NEAREST;
+			case SamplerFilter::eLinear:
+				return GL_LINEAR;
+			default:
+				return GL_INVALID_ENUM;
+			}
+		}
+
+		GLenum samplerWrapToGL(SamplerWrap wrap)
+		{
+			switch (wrap)
+			{
+			case SamplerWrap::eRepeat:
+				return GL_REPEAT;
+			case SamplerWrap::eMirroredRepeat:
+				return GL_MIRRORED_REPEAT;
+			case SamplerWrap::eClampToEdge:
+				return GL_CLAMP_TO_EDGE;
+			default:
+				return GL_INVALID_ENUM;
+			}
+		}
+
+		bool hasExtension(const char *name)
+		{
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (GLint i = 0; i < count; ++i)
+			{
+				const char *ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+				if (ext != nullptr && strcmp(ext, name) == 0)
+					return true;
+			}
+			return false;
+		}
+
 		void printDeviceInfo()
 		{
 			std::printf("Vendor: %s\n", glGetString(GL_VENDOR));
@@ -27,6 +27,7 @@
 
 #include <GL/glew.h>
 #include "jikken/enums.hpp"
+#include "jikken/structs.hpp"
 
 namespace Jikken
 {
@@ -36,9 +37,25 @@ namespace Jikken
 		GLenum bufferTypeToGL(BufferType type);
 		GLenum layoutTypeToGL(VertexAttributeType type);
 		GLenum shaderStageToGL(ShaderStage stage);
+		GLbitfield memoryBarrierToGL(uint32_t barriers);
+		GLenum queryTypeToGL(QueryType type);
 		GLenum drawPrimitiveToGL(PrimitiveType type);
 		GLenum blendStateToGL(BlendState state);
 		GLenum depthFuncToGL(DepthFunc func);
+		GLenum indexTypeToGL(IndexType type);
+		size_t indexTypeSize(IndexType type);
+		GLuint attributeDivisor(const VertexInputLayout &attr);
+
+		// Internal format plus the pixel format and type that match it for uploads.
+		bool textureFormatToGL(TextureFormat format, GLenum &internalFormat, GLenum &pixelFormat, GLenum &pixelType);
+		// GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT or GL_DEPTH_STENCIL_ATTACHMENT.
+		GLenum textureFormatAttachment(TextureFormat format);
+		GLenum textureTypeToGL(TextureType type);
+		GLenum samplerMinFilterToGL(SamplerFilter filter, SamplerMipFilter mipFilter);
+		GLenum samplerFilterToGL(SamplerFilter filter);
+		GLenum samplerWrapToGL(SamplerWrap wrap);
+
+		bool hasExtension(const char *name);
 
 		void printDeviceInfo();
 	}
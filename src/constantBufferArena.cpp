@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cassert>
+#include "jikken/constantBufferArena.hpp"
+#include "jikken/graphicsDevice.hpp"
+
+namespace Jikken
+{
+	ConstantBufferArena::ConstantBufferArena(GraphicsDevice *device, size_t size) :
+		mDevice(device),
+		mMemory(new uint8_t[size]),
+		mSize(size),
+		mAlignment(device->getConstantBufferAlignment()),
+		mPointer(0)
+	{
+		assert(size <= MemoryPool::MEGABYTE * 4);
+		mBuffer = mDevice->createBuffer(BufferType::eConstantBuffer, BufferUsageHint::eStreamDraw, size, nullptr);
+	}
+
+	ConstantBufferArena::~ConstantBufferArena()
+	{
+		mDevice->deleteBuffer(mBuffer);
+		delete[] mMemory;
+	}
+
+	void* ConstantBufferArena::allocate(size_t size, size_t &offset)
+	{
+		// Round up to the next aligned offset.
+		size_t start = (mPointer + mAlignment - 1) / mAlignment * mAlignment;
+		if (start + size > mSize)
+			return nullptr;
+
+		mPointer = start + size;
+		offset = start;
+		return mMemory + start;
+	}
+
+	void ConstantBufferArena::upload(CommandQueue *queue)
+	{
+		if (mPointer == 0)
+			return;
+
+		UpdateBufferCommand cmd;
+		cmd.buffer = mBuffer;
+		cmd.offset = 0;
+		cmd.dataSize = mPointer;
+		cmd.data = mMemory;
+		queue->addUpdateBufferCommand(&cmd);
+	}
+
+	void ConstantBufferArena::bindRange(CommandQueue *queue, uint32_t index, size_t offset, size_t size)
+	{
+		SetConstantBufferRangeCommand cmd;
+		cmd.buffer = mBuffer;
+		cmd.index = index;
+		cmd.offset = offset;
+		cmd.size = size;
+		queue->addSetConstantBufferRangeCommand(&cmd);
+	}
+}
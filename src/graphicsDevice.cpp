@@ -27,7 +27,8 @@
 
 namespace Jikken
 {
-	GraphicsDevice::GraphicsDevice()
+	GraphicsDevice::GraphicsDevice() :
+		mStats()
 	{
 	}
 
@@ -57,16 +58,35 @@ namespace Jikken
 	}
 
 	void GraphicsDevice::submitCommandQueue(CommandQueue *queue)
+	{
+		mStats.commands += _executeCommandQueue(queue);
+	}
+
+	void GraphicsDevice::submitCommandQueues(const std::vector<CommandQueue*> &queues)
+	{
+		for (CommandQueue *queue : queues)
+			submitCommandQueue(queue);
+	}
+
+	void GraphicsDevice::submitAsyncCompute(CommandQueue *queue)
+	{
+		submitCommandQueue(queue);
+	}
+
+	uint64_t GraphicsDevice::_executeCommandQueue(CommandQueue *queue)
 	{
 		//mark queue as finished (i.e write eFinishQueue)
 		queue->finish();
 
-	    //decode all commands and execute them
+		//decode all commands and execute them
+		uint64_t commands = 0;
 		bool queueEnd = false;
 		while (!queueEnd)
 		{
 			uint8_t cmdType;
 			queue->readCmd(cmdType);
+			if (cmdType != eFinishQueue)
+				++commands;
 			switch (cmdType)
 			{
 			case eSetShader:
@@ -105,6 +125,15 @@ namespace Jikken
 				break;
 			}
 
+			case eDrawInstance:
+			{
+				DrawInstanceCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_drawInstanceCmd(&cmd);
+				break;
+			}
+
 			case eUpdateBuffer:
 			{
 				UpdateBufferCommand cmd;
@@ -145,6 +174,139 @@ namespace Jikken
 				break;
 			}
 
+			case eBindVertexBuffers:
+			{
+				BindVertexBuffersCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_bindVertexBuffersCmd(&cmd);
+				break;
+			}
+
+			case eUpdateTexture:
+			{
+				UpdateTextureCommand cmd;
+				queue->readCmd(cmd.texture);
+				queue->readCmd(cmd.mipLevel);
+				queue->readCmd(cmd.layer);
+				queue->readCmd(cmd.x);
+				queue->readCmd(cmd.y);
+				queue->readCmd(cmd.width);
+				queue->readCmd(cmd.height);
+				queue->readCmd(cmd.dataSize);
+				//read data pointer address
+				uintptr_t addr;
+				queue->readCmd(addr);
+				cmd.data = reinterpret_cast<void*>(addr);
+				//execute cmd
+				_updateTextureCmd(&cmd);
+				break;
+			}
+
+			case eBindTexture:
+			{
+				BindTextureCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_bindTextureCmd(&cmd);
+				break;
+			}
+
+			case eBindRenderTarget:
+			{
+				BindRenderTargetCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_bindRenderTargetCmd(&cmd);
+				break;
+			}
+
+			case eResolveRenderTarget:
+			{
+				ResolveRenderTargetCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_resolveRenderTargetCmd(&cmd);
+				break;
+			}
+
+			case eSetStorageBufferRange:
+			{
+				SetStorageBufferRangeCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_setStorageBufferRangeCmd(&cmd);
+				break;
+			}
+
+			case eDispatch:
+			{
+				DispatchCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_dispatchCmd(&cmd);
+				break;
+			}
+
+			case eDispatchIndirect:
+			{
+				DispatchIndirectCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_dispatchIndirectCmd(&cmd);
+				break;
+			}
+
+			case eMemoryBarrier:
+			{
+				MemoryBarrierCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_memoryBarrierCmd(&cmd);
+				break;
+			}
+
+			case eBeginQuery:
+			{
+				BeginQueryCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_beginQueryCmd(&cmd);
+				break;
+			}
+
+			case eEndQuery:
+			{
+				EndQueryCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_endQueryCmd(&cmd);
+				break;
+			}
+
+			case eConditionalRender:
+			{
+				ConditionalRenderCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_conditionalRenderCmd(&cmd);
+				break;
+			}
+
+			case eSetConstants:
+			{
+				SetConstantsCommand cmd;
+				queue->readCmd(cmd.index);
+				queue->readCmd(cmd.dataSize);
+				//read data pointer address
+				uintptr_t addr;
+				queue->readCmd(addr);
+				cmd.data = reinterpret_cast<void*>(addr);
+				//execute cmd
+				_setConstantsCmd(&cmd);
+				break;
+			}
+
 			case eCullState:
 			{
 				CullStateCommand cmd;
@@ -181,6 +343,15 @@ namespace Jikken
 				break;
 			}
 
+			case eSetConstantBufferRange:
+			{
+				SetConstantBufferRangeCommand cmd;
+				queue->readCmd(cmd);
+				//execute cmd
+				_setConstantBufferRangeCmd(&cmd);
+				break;
+			}
+
 			case eFinishQueue:
 				queueEnd = true;
 				break;
@@ -193,5 +364,6 @@ namespace Jikken
 
 		//reset queue so it can be used again
 		queue->reset();
+		return commands;
 	}
 }
@@ -0,0 +1,66 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_HASHUTILS_HPP_
+#define _JIKKEN_HASHUTILS_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace Jikken
+{
+	namespace HashUtils
+	{
+		const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+		const uint64_t FNV_PRIME = 1099511628211ull;
+
+		// 64-bit FNV-1a. Pass a previous result as the seed to hash several values together.
+		inline uint64_t fnv1a(const void *data, size_t size, uint64_t seed = FNV_OFFSET_BASIS)
+		{
+			const uint8_t *bytes = static_cast<const uint8_t*>(data);
+			uint64_t hash = seed;
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= bytes[i];
+				hash *= FNV_PRIME;
+			}
+			return hash;
+		}
+
+		inline uint64_t fnv1a(const std::string &str, uint64_t seed = FNV_OFFSET_BASIS)
+		{
+			return fnv1a(str.data(), str.size(), seed);
+		}
+
+		// Hashes the bytes of a plain value, for enums, handles and POD structs.
+		template<typename T>
+		inline uint64_t fnv1aValue(const T &value, uint64_t seed = FNV_OFFSET_BASIS)
+		{
+			return fnv1a(&value, sizeof(T), seed);
+		}
+	}
+}
+
+#endif
@@ -24,6 +24,7 @@
 
 #include <cassert>
 #include "jikken/jikken.hpp"
+#include "null/NullGraphicsDevice.hpp"
 
 #ifdef JIKKEN_OPENGL
 #include "GL/GLGraphicsDevice.hpp"
@@ -36,7 +37,7 @@
 
 namespace Jikken
 {
-	GraphicsDevice* createGraphicsDevice(API api, void *glfwWinHandle)
+	GraphicsDevice* createGraphicsDevice(API api, void *glfwWinHandle, const DeviceConfig &config)
 	{
 		//init glslang process
 		glslang::InitializeProcess();
@@ -60,13 +61,17 @@ namespace Jikken
 			return nullptr;
 #endif
 		}
+		else if (api == API::eNull)
+		{
+			pDevice = new NullGraphicsDevice();
+		}
 		else //not yet implemented
 		{
 			assert(false);
 			return nullptr;
 		}
 
-		if (!pDevice->init(glfwWinHandle))
+		if (!pDevice->init(config, glfwWinHandle))
 		{
 			delete pDevice;
 			pDevice = nullptr;
@@ -0,0 +1,496 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include "null/NullGraphicsDevice.hpp"
+
+namespace Jikken
+{
+	// Matches the worst case the GL backend starts from.
+	static const size_t NullBufferAlignment = 256;
+
+#ifdef _DEBUG
+	static const bool NullValidateByDefault = true;
+#else
+	static const bool NullValidateByDefault = false;
+#endif
+
+	NullGraphicsDevice::NullGraphicsDevice() :
+		mBufferHandle(0),
+		mShaderHandle(0),
+		mLayoutHandle(0),
+		mVertexArrayHandle(0),
+		mRenderTargetHandle(0),
+		mTextureHandle(0),
+		mSamplerHandle(0),
+		mQueryHandle(0),
+		mValidate(NullValidateByDefault),
+		mCurrentShader(InvalidHandle),
+		mVertexInputBound(false)
+	{
+	}
+
+	NullGraphicsDevice::~NullGraphicsDevice()
+	{
+	}
+
+	void NullGraphicsDevice::_invalid(const char *message)
+	{
+		printf("Null device validation failed: %s\n", message);
+#ifdef _DEBUG
+		assert(false);
+#endif
+	}
+
+	template<typename Map>
+	bool NullGraphicsDevice::_validateHandle(const Map &map, uint32_t handle, const char *kind)
+	{
+		if (!mValidate || map.find(handle) != map.end())
+			return true;
+
+		printf("Null device validation failed: unknown %s handle %u\n", kind, handle);
+#ifdef _DEBUG
+		assert(false);
+#endif
+		return false;
+	}
+
+	// The window is never drawn to, so only the config is kept.
+	bool NullGraphicsDevice::init(const DeviceConfig &config, void * /*glfwWinHandle*/)
+	{
+		mConfig = config;
+		mValidate = NullValidateByDefault || config.validate;
+		return true;
+	}
+
+	ShaderHandle NullGraphicsDevice::createShader(const std::vector<ShaderDetails> &shaders, bool /*async*/)
+	{
+		if (mValidate && shaders.empty())
+			_invalid("shader created without stages");
+
+		// Nothing is compiled, so sources are not even read.
+		NullShader shader;
+		shader.compute = shaders.size() == 1 && shaders[0].stage == ShaderStage::eCompute;
+
+		ShaderHandle handle = mShaderHandle++;
+		mShaders[handle] = shader;
+		return handle;
+	}
+
+	ShaderStatus NullGraphicsDevice::getShaderStatus(ShaderHandle handle)
+	{
+		_validateHandle(mShaders, handle, "shader");
+		return ShaderStatus::eReady;
+	}
+
+	BufferHandle NullGraphicsDevice::createBuffer(BufferType type, BufferUsageHint /*hint*/, size_t dataSize, float * /*data*/)
+	{
+		BufferHandle handle = mBufferHandle++;
+		mBuffers[handle] = { type, dataSize };
+		return handle;
+	}
+
+	LayoutHandle NullGraphicsDevice::createVertexInputLayout(const std::vector<VertexInputLayout> &attributes)
+	{
+		if (mValidate)
+		{
+			if (attributes.size() == 0)
+				_invalid("vertex input layout without attributes");
+			for (const VertexInputLayout &attr : attributes)
+			{
+				if (attr.binding >= MaxVertexBufferBindings)
+					_invalid("vertex attribute binding out of range");
+			}
+		}
+
+		LayoutHandle handle = mLayoutHandle++;
+		mLayouts[handle] = attributes;
+		return handle;
+	}
+
+	VertexArrayHandle NullGraphicsDevice::createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer, IndexType indexType)
+	{
+		return createVAO(layout, std::vector<BufferHandle>(1, vertexBuffer), indexBuffer, indexType);
+	}
+
+	VertexArrayHandle NullGraphicsDevice::createVAO(LayoutHandle layout, const std::vector<BufferHandle> &vertexBuffers, BufferHandle indexBuffer, IndexType /*indexType*/)
+	{
+		_validateHandle(mLayouts, layout, "layout");
+		if (mValidate)
+		{
+			for (BufferHandle vertexBuffer : vertexBuffers)
+			{
+				if (!_validateHandle(mBuffers, vertexBuffer, "buffer"))
+					continue;
+				BufferType type = mBuffers[vertexBuffer].type;
+				if (type != BufferType::eVertexBuffer && type != BufferType::eStorageBuffer)
+					_invalid("vertex array buffer is not a vertex or storage buffer");
+			}
+			if (indexBuffer != InvalidHandle && _validateHandle(mBuffers, indexBuffer, "buffer") && mBuffers[indexBuffer].type != BufferType::eIndexBuffer)
+				_invalid("vertex array index buffer is not an index buffer");
+		}
+
+		VertexArrayHandle handle = mVertexArrayHandle++;
+		mVAOs[handle] = { layout, vertexBuffers, indexBuffer };
+		return handle;
+	}
+
+	void NullGraphicsDevice::bindConstantBuffer(ShaderHandle shader, BufferHandle cBuffer, const char * /*name*/, int32_t /*index*/)
+	{
+		_validateHandle(mShaders, shader, "shader");
+		if (mValidate && _validateHandle(mBuffers, cBuffer, "buffer") && mBuffers[cBuffer].type != BufferType::eConstantBuffer)
+			_invalid("bound constant buffer is not a constant buffer");
+	}
+
+	size_t NullGraphicsDevice::getConstantBufferAlignment()
+	{
+		return NullBufferAlignment;
+	}
+
+	void NullGraphicsDevice::bindStorageBuffer(ShaderHandle shader, BufferHandle sBuffer, const char * /*name*/, int32_t /*index*/)
+	{
+		_validateHandle(mShaders, shader, "shader");
+		if (mValidate && _validateHandle(mBuffers, sBuffer, "buffer") && mBuffers[sBuffer].type != BufferType::eStorageBuffer)
+			_invalid("bound storage buffer is not a storage buffer");
+	}
+
+	size_t NullGraphicsDevice::getStorageBufferAlignment()
+	{
+		return NullBufferAlignment;
+	}
+
+	RenderTargetHandle NullGraphicsDevice::createRenderTarget(const RenderTargetDetails &details)
+	{
+		if (details.colorFormats.size() > MaxColorAttachments)
+			return InvalidHandle;
+
+		RenderTargetHandle handle = mRenderTargetHandle++;
+		mRenderTargets[handle] = details;
+		return handle;
+	}
+
+	void NullGraphicsDevice::deleteRenderTarget(RenderTargetHandle handle)
+	{
+		mRenderTargets.erase(handle);
+	}
+
+	TextureHandle NullGraphicsDevice::createTexture(const TextureDetails &details)
+	{
+		TextureHandle handle = mTextureHandle++;
+		mTextures[handle] = details;
+		return handle;
+	}
+
+	void NullGraphicsDevice::deleteTexture(TextureHandle handle)
+	{
+		mTextures.erase(handle);
+	}
+
+	SamplerHandle NullGraphicsDevice::createSampler(const SamplerDetails &details)
+	{
+		SamplerHandle handle = mSamplerHandle++;
+		mSamplers[handle] = details;
+		return handle;
+	}
+
+	void NullGraphicsDevice::deleteSampler(SamplerHandle handle)
+	{
+		mSamplers.erase(handle);
+	}
+
+	void NullGraphicsDevice::bindTextureUnit(ShaderHandle shader, const char * /*name*/, int32_t /*unit*/)
+	{
+		_validateHandle(mShaders, shader, "shader");
+	}
+
+	// Nothing is rendered, so every pixel reads back as zero.
+	bool NullGraphicsDevice::readPixels(RenderTargetHandle target, uint32_t colorAttachment, int32_t /*x*/, int32_t /*y*/, uint32_t width, uint32_t height, void *data)
+	{
+		if (target != InvalidHandle)
+		{
+			auto it = mRenderTargets.find(target);
+			if (it == mRenderTargets.end() || it->second.samples > 1 || colorAttachment >= it->second.colorFormats.size())
+				return false;
+		}
+
+		memset(data, 0, static_cast<size_t>(width) * height * 4);
+		return true;
+	}
+
+	QueryHandle NullGraphicsDevice::createQuery(QueryType type)
+	{
+		QueryHandle handle = mQueryHandle++;
+		mQueries[handle] = { type, false };
+		return handle;
+	}
+
+	void NullGraphicsDevice::deleteQuery(QueryHandle handle)
+	{
+		mQueries.erase(handle);
+	}
+
+	// Results never arrive, so callers keep treating everything as visible.
+	bool NullGraphicsDevice::getQueryResult(QueryHandle handle, uint64_t & /*result*/)
+	{
+		_validateHandle(mQueries, handle, "query");
+		return false;
+	}
+
+	void NullGraphicsDevice::deleteVertexInputLayout(LayoutHandle handle)
+	{
+		mLayouts.erase(handle);
+	}
+
+	void NullGraphicsDevice::deleteVAO(VertexArrayHandle handle)
+	{
+		mVAOs.erase(handle);
+	}
+
+	void NullGraphicsDevice::deleteBuffer(BufferHandle handle)
+	{
+		mBuffers.erase(handle);
+	}
+
+	void NullGraphicsDevice::deleteShader(ShaderHandle handle)
+	{
+		if (mCurrentShader == handle)
+			mCurrentShader = InvalidHandle;
+		mShaders.erase(handle);
+	}
+
+	void NullGraphicsDevice::presentFrame()
+	{
+	}
+
+	void NullGraphicsDevice::_validateDraw()
+	{
+		if (!mValidate)
+			return;
+
+		if (mCurrentShader == InvalidHandle || mShaders[mCurrentShader].compute)
+			_invalid("draw without a graphics shader");
+		if (!mVertexInputBound)
+			_invalid("draw without vertex input");
+	}
+
+	void NullGraphicsDevice::_setShaderCmd(SetShaderCommand *cmd)
+	{
+		_validateHandle(mShaders, cmd->handle, "shader");
+		mCurrentShader = cmd->handle;
+	}
+
+	void NullGraphicsDevice::_beginFrameCmd(BeginFrameCommand * /*cmd*/)
+	{
+	}
+
+	void NullGraphicsDevice::_updateBufferCmd(UpdateBufferCommand *cmd)
+	{
+		if (mValidate && _validateHandle(mBuffers, cmd->buffer, "buffer") && cmd->offset + cmd->dataSize > mBuffers[cmd->buffer].size)
+			_invalid("buffer update past the end of the buffer");
+	}
+
+	void NullGraphicsDevice::_reallocBufferCmd(ReallocBufferCommand *cmd)
+	{
+		_validateHandle(mBuffers, cmd->buffer, "buffer");
+		mBuffers[cmd->buffer].size = cmd->stride * cmd->count;
+	}
+
+	void NullGraphicsDevice::_drawCmd(DrawCommand * /*cmd*/)
+	{
+		_validateDraw();
+	}
+
+	void NullGraphicsDevice::_drawInstanceCmd(DrawInstanceCommand * /*cmd*/)
+	{
+		_validateDraw();
+	}
+
+	void NullGraphicsDevice::_clearBufferCmd(ClearBufferCommand * /*cmd*/)
+	{
+	}
+
+	void NullGraphicsDevice::_bindVAOCmd(BindVAOCommand *cmd)
+	{
+		_validateHandle(mVAOs, cmd->vertexArray, "vertex array");
+		mVertexInputBound = true;
+	}
+
+	void NullGraphicsDevice::_viewportCmd(ViewportCommand * /*cmd*/)
+	{
+	}
+
+	void NullGraphicsDevice::_blendStateCmd(BlendStateCommand * /*cmd*/)
+	{
+	}
+
+	void NullGraphicsDevice::_depthStencilStateCmd(DepthStencilStateCommand * /*cmd*/)
+	{
+	}
+
+	void NullGraphicsDevice::_cullStateCmd(CullStateCommand * /*cmd*/)
+	{
+	}
+
+	void NullGraphicsDevice::_setConstantBufferRangeCmd(SetConstantBufferRangeCommand *cmd)
+	{
+		if (!mValidate || !_validateHandle(mBuffers, cmd->buffer, "buffer"))
+			return;
+
+		const NullBuffer &buffer = mBuffers[cmd->buffer];
+		if (buffer.type != BufferType::eConstantBuffer)
+			_invalid("constant buffer range on a buffer that is not a constant buffer");
+		if (cmd->offset % NullBufferAlignment != 0 || cmd->offset + cmd->size > buffer.size)
+			_invalid("constant buffer range is misaligned or out of bounds");
+	}
+
+	void NullGraphicsDevice::_bindVertexBuffersCmd(BindVertexBuffersCommand *cmd)
+	{
+		mVertexInputBound = true;
+		if (!mValidate)
+			return;
+
+		_validateHandle(mLayouts, cmd->layout, "layout");
+		if (cmd->bufferCount > MaxVertexBufferBindings)
+		{
+			_invalid("too many vertex buffers bound");
+			return;
+		}
+		for (uint32_t i = 0; i < cmd->bufferCount; ++i)
+		{
+			if (!_validateHandle(mBuffers, cmd->vertexBuffers[i], "buffer"))
+				continue;
+			BufferType type = mBuffers[cmd->vertexBuffers[i]].type;
+			if (type != BufferType::eVertexBuffer && type != BufferType::eStorageBuffer)
+				_invalid("bound vertex buffer is not a vertex or storage buffer");
+		}
+		if (cmd->indexBuffer != InvalidHandle && _validateHandle(mBuffers, cmd->indexBuffer, "buffer") && mBuffers[cmd->indexBuffer].type != BufferType::eIndexBuffer)
+			_invalid("bound index buffer is not an index buffer");
+	}
+
+	void NullGraphicsDevice::_bindRenderTargetCmd(BindRenderTargetCommand *cmd)
+	{
+		if (cmd->target != InvalidHandle)
+			_validateHandle(mRenderTargets, cmd->target, "render target");
+	}
+
+	void NullGraphicsDevice::_resolveRenderTargetCmd(ResolveRenderTargetCommand *cmd)
+	{
+		_validateHandle(mRenderTargets, cmd->source, "render target");
+		if (cmd->destination != InvalidHandle)
+			_validateHandle(mRenderTargets, cmd->destination, "render target");
+	}
+
+	void NullGraphicsDevice::_updateTextureCmd(UpdateTextureCommand *cmd)
+	{
+		if (!mValidate || !_validateHandle(mTextures, cmd->texture, "texture"))
+			return;
+
+		const TextureDetails &details = mTextures[cmd->texture];
+		uint32_t levels = details.mipLevels > 0 ? details.mipLevels : 1;
+		if (cmd->mipLevel >= levels)
+		{
+			_invalid("texture update to a mip level that doesn't exist");
+			return;
+		}
+		uint32_t width = details.width >> cmd->mipLevel;
+		uint32_t height = details.height >> cmd->mipLevel;
+		if (cmd->x + cmd->width > (width > 0 ? width : 1) || cmd->y + cmd->height > (height > 0 ? height : 1))
+			_invalid("texture update outside the mip level");
+	}
+
+	void NullGraphicsDevice::_bindTextureCmd(BindTextureCommand *cmd)
+	{
+		_validateHandle(mTextures, cmd->texture, "texture");
+		if (cmd->sampler != InvalidHandle)
+			_validateHandle(mSamplers, cmd->sampler, "sampler");
+	}
+
+	void NullGraphicsDevice::_setStorageBufferRangeCmd(SetStorageBufferRangeCommand *cmd)
+	{
+		if (!mValidate || !_validateHandle(mBuffers, cmd->buffer, "buffer"))
+			return;
+
+		const NullBuffer &buffer = mBuffers[cmd->buffer];
+		if (buffer.type != BufferType::eStorageBuffer)
+			_invalid("storage buffer range on a buffer that is not a storage buffer");
+		if (cmd->offset % NullBufferAlignment != 0 || cmd->offset + cmd->size > buffer.size)
+			_invalid("storage buffer range is misaligned or out of bounds");
+	}
+
+	void NullGraphicsDevice::_dispatchCmd(DispatchCommand * /*cmd*/)
+	{
+		if (mValidate && (mCurrentShader == InvalidHandle || !mShaders[mCurrentShader].compute))
+			_invalid("dispatch without a compute shader");
+	}
+
+	void NullGraphicsDevice::_dispatchIndirectCmd(DispatchIndirectCommand *cmd)
+	{
+		if (!mValidate)
+			return;
+
+		if (mCurrentShader == InvalidHandle || !mShaders[mCurrentShader].compute)
+			_invalid("dispatch without a compute shader");
+		if (!_validateHandle(mBuffers, cmd->buffer, "buffer"))
+			return;
+		const NullBuffer &buffer = mBuffers[cmd->buffer];
+		if (buffer.type != BufferType::eStorageBuffer || cmd->offset % 4 != 0 || cmd->offset + sizeof(uint32_t) * 3 > buffer.size)
+			_invalid("indirect dispatch arguments are not in range of a storage buffer");
+	}
+
+	void NullGraphicsDevice::_memoryBarrierCmd(MemoryBarrierCommand * /*cmd*/)
+	{
+	}
+
+	void NullGraphicsDevice::_beginQueryCmd(BeginQueryCommand *cmd)
+	{
+		if (!_validateHandle(mQueries, cmd->query, "query"))
+			return;
+		if (mValidate && mQueries[cmd->query].active)
+			_invalid("query begun twice");
+		mQueries[cmd->query].active = true;
+	}
+
+	void NullGraphicsDevice::_endQueryCmd(EndQueryCommand *cmd)
+	{
+		if (!_validateHandle(mQueries, cmd->query, "query"))
+			return;
+		if (mValidate && !mQueries[cmd->query].active)
+			_invalid("query ended without being begun");
+		mQueries[cmd->query].active = false;
+	}
+
+	void NullGraphicsDevice::_conditionalRenderCmd(ConditionalRenderCommand *cmd)
+	{
+		if (cmd->query != InvalidHandle)
+			_validateHandle(mQueries, cmd->query, "query");
+	}
+
+	void NullGraphicsDevice::_setConstantsCmd(SetConstantsCommand *cmd)
+	{
+		if (mValidate && cmd->dataSize > MaxConstantsSize)
+			_invalid("constants larger than MaxConstantsSize");
+	}
+}
@@ -0,0 +1,187 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_NULL_NULLGRAPHICSDEVICE_HPP_
+#define _JIKKEN_NULL_NULLGRAPHICSDEVICE_HPP_
+
+#include <unordered_map>
+#include "jikken/graphicsDevice.hpp"
+
+namespace Jikken
+{
+	// Executes command queues without touching a GPU. Resources are only
+	// bookkept, so recording and submission can be profiled on their own and
+	// rendering code can run on machines without a graphics driver. Debug
+	// builds validate handles and command arguments like the other backends,
+	// release builds only when DeviceConfig::validate is set.
+	class NullGraphicsDevice : public GraphicsDevice
+	{
+		struct NullBuffer
+		{
+			BufferType type;
+			size_t size;
+		};
+
+		struct NullShader
+		{
+			bool compute;
+		};
+
+		struct NullVAO
+		{
+			LayoutHandle layout;
+			std::vector<BufferHandle> vertexBuffers;
+			BufferHandle indexBuffer;
+		};
+
+		struct NullQuery
+		{
+			QueryType type;
+			bool active;
+		};
+	public:
+		NullGraphicsDevice();
+		virtual ~NullGraphicsDevice();
+
+		virtual ShaderHandle createShader(const std::vector<ShaderDetails> &shaders, bool async = false) override;
+
+		virtual ShaderStatus getShaderStatus(ShaderHandle handle) override;
+
+		virtual BufferHandle createBuffer(BufferType type, BufferUsageHint hint, size_t dataSize, float *data) override;
+
+		virtual LayoutHandle createVertexInputLayout(const std::vector<VertexInputLayout> &attributes) override;
+
+		virtual VertexArrayHandle createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer = InvalidHandle, IndexType indexType = IndexType::eUInt16) override;
+
+		virtual VertexArrayHandle createVAO(LayoutHandle layout, const std::vector<BufferHandle> &vertexBuffers, BufferHandle indexBuffer = InvalidHandle, IndexType indexType = IndexType::eUInt16) override;
+
+		virtual void bindConstantBuffer(ShaderHandle shader, BufferHandle cBuffer, const char *name, int32_t index) override;
+
+		virtual size_t getConstantBufferAlignment() override;
+
+		virtual void bindStorageBuffer(ShaderHandle shader, BufferHandle sBuffer, const char *name, int32_t index) override;
+
+		virtual size_t getStorageBufferAlignment() override;
+
+		virtual RenderTargetHandle createRenderTarget(const RenderTargetDetails &details) override;
+
+		virtual void deleteRenderTarget(RenderTargetHandle handle) override;
+
+		virtual TextureHandle createTexture(const TextureDetails &details) override;
+
+		virtual void deleteTexture(TextureHandle handle) override;
+
+		virtual SamplerHandle createSampler(const SamplerDetails &details) override;
+
+		virtual void deleteSampler(SamplerHandle handle) override;
+
+		virtual void bindTextureUnit(ShaderHandle shader, const char *name, int32_t unit) override;
+
+		virtual bool readPixels(RenderTargetHandle target, uint32_t colorAttachment, int32_t x, int32_t y, uint32_t width, uint32_t height, void *data) override;
+
+		virtual QueryHandle createQuery(QueryType type) override;
+
+		virtual void deleteQuery(QueryHandle handle) override;
+
+		virtual bool getQueryResult(QueryHandle handle, uint64_t &result) override;
+
+		virtual void deleteVertexInputLayout(LayoutHandle handle) override;
+
+		virtual void deleteVAO(VertexArrayHandle handle) override;
+
+		virtual void deleteBuffer(BufferHandle handle) override;
+
+		virtual void deleteShader(ShaderHandle handle) override;
+
+		virtual bool init(const DeviceConfig &config, void *glfwWinHandle) override;
+
+		virtual void presentFrame() override;
+
+	protected:
+
+		virtual void _setShaderCmd(SetShaderCommand *cmd) override;
+		virtual void _beginFrameCmd(BeginFrameCommand *cmd) override;
+		virtual void _updateBufferCmd(UpdateBufferCommand *cmd) override;
+		virtual void _reallocBufferCmd(ReallocBufferCommand *cmd) override;
+		virtual void _drawCmd(DrawCommand *cmd) override;
+		virtual void _drawInstanceCmd(DrawInstanceCommand *cmd) override;
+		virtual void _clearBufferCmd(ClearBufferCommand *cmd) override;
+		virtual void _bindVAOCmd(BindVAOCommand *cmd) override;
+		virtual void _viewportCmd(ViewportCommand *cmd) override;
+		virtual void _blendStateCmd(BlendStateCommand *cmd) override;
+		virtual void _depthStencilStateCmd(DepthStencilStateCommand *cmd) override;
+		virtual void _cullStateCmd(CullStateCommand *cmd) override;
+		virtual void _setConstantBufferRangeCmd(SetConstantBufferRangeCommand *cmd) override;
+		virtual void _bindVertexBuffersCmd(BindVertexBuffersCommand *cmd) override;
+		virtual void _bindRenderTargetCmd(BindRenderTargetCommand *cmd) override;
+		virtual void _resolveRenderTargetCmd(ResolveRenderTargetCommand *cmd) override;
+		virtual void _updateTextureCmd(UpdateTextureCommand *cmd) override;
+		virtual void _bindTextureCmd(BindTextureCommand *cmd) override;
+		virtual void _setStorageBufferRangeCmd(SetStorageBufferRangeCommand *cmd) override;
+		virtual void _dispatchCmd(DispatchCommand *cmd) override;
+		virtual void _dispatchIndirectCmd(DispatchIndirectCommand *cmd) override;
+		virtual void _memoryBarrierCmd(MemoryBarrierCommand *cmd) override;
+		virtual void _beginQueryCmd(BeginQueryCommand *cmd) override;
+		virtual void _endQueryCmd(EndQueryCommand *cmd) override;
+		virtual void _conditionalRenderCmd(ConditionalRenderCommand *cmd) override;
+		virtual void _setConstantsCmd(SetConstantsCommand *cmd) override;
+
+		// Prints a failed check, and stops on it in debug builds.
+		void _invalid(const char *message);
+
+		// Returns false when validating and the handle is not in the map.
+		template<typename Map>
+		bool _validateHandle(const Map &map, uint32_t handle, const char *kind);
+
+		// Checks a draw has a graphics shader and vertex input to read from.
+		void _validateDraw();
+
+		std::unordered_map<BufferHandle, NullBuffer> mBuffers;
+		std::unordered_map<ShaderHandle, NullShader> mShaders;
+		std::unordered_map<LayoutHandle, std::vector<VertexInputLayout>> mLayouts;
+		std::unordered_map<VertexArrayHandle, NullVAO> mVAOs;
+		std::unordered_map<RenderTargetHandle, RenderTargetDetails> mRenderTargets;
+		std::unordered_map<TextureHandle, TextureDetails> mTextures;
+		std::unordered_map<SamplerHandle, SamplerDetails> mSamplers;
+		std::unordered_map<QueryHandle, NullQuery> mQueries;
+
+		BufferHandle mBufferHandle;
+		ShaderHandle mShaderHandle;
+		LayoutHandle mLayoutHandle;
+		VertexArrayHandle mVertexArrayHandle;
+		RenderTargetHandle mRenderTargetHandle;
+		TextureHandle mTextureHandle;
+		SamplerHandle mSamplerHandle;
+		QueryHandle mQueryHandle;
+
+		// Debug builds or DeviceConfig::validate.
+		bool mValidate;
+
+		// Bound state, only read by validation.
+		ShaderHandle mCurrentShader;
+		bool mVertexInputBound;
+	};
+}
+
+#endif
@@ -0,0 +1,154 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_RINGALLOCATOR_HPP_
+#define _JIKKEN_RINGALLOCATOR_HPP_
+
+#include <cstddef>
+#include <deque>
+
+namespace Jikken
+{
+	/// Hands out ranges of a fixed size buffer in a circle, for staging memory
+	/// the GPU reads from. Allocations made between two close() calls form a
+	/// region that is released as a whole once its fence has signaled, so the
+	/// CPU never writes over memory the GPU may still be reading.
+	/// Only offsets are managed; the memory itself belongs to the backend.
+	template<typename Fence>
+	class RingAllocator
+	{
+	public:
+		RingAllocator() :
+			mSize(0),
+			mHead(0),
+			mTail(0),
+			mOpenStart(0),
+			mOpenUsed(false)
+		{
+		}
+
+		void reset(size_t size)
+		{
+			mSize = size;
+			mHead = 0;
+			mTail = 0;
+			mOpenStart = 0;
+			mOpenUsed = false;
+			mRegions.clear();
+		}
+
+		/// @return false if the free space can't fit size right now.
+		bool allocate(size_t size, size_t alignment, size_t &offset)
+		{
+			if (isEmpty())
+			{
+				mHead = 0;
+				mTail = 0;
+				mOpenStart = 0;
+			}
+
+			size_t start = (mHead + alignment - 1) / alignment * alignment;
+			if (mHead >= mTail)
+			{
+				// Free space is the end of the buffer plus the start up to the tail.
+				if (start + size > mSize)
+				{
+					start = 0;
+					if (!isEmpty() && size > mTail)
+						return false;
+					if (size > mSize)
+						return false;
+				}
+			}
+			else if (start + size > mTail)
+			{
+				return false;
+			}
+
+			// A wrapped ring that filled up exactly has head == tail while not
+			// empty. Keep one byte spare so that case never happens.
+			if (!isEmpty() && start < mTail && start + size == mTail)
+				return false;
+
+			mHead = start + size;
+			mOpenUsed = true;
+			offset = start;
+			return true;
+		}
+
+		/// Ends the open region. Its memory is reused once signaled(fence) is true.
+		void close(const Fence &fence)
+		{
+			mRegions.push_back({ fence, mOpenStart });
+			mOpenStart = mHead;
+			mOpenUsed = false;
+		}
+
+		/// @return true if allocations were made since the last close().
+		inline bool hasOpenRegion() const
+		{
+			return mOpenUsed;
+		}
+
+		/// Releases the oldest regions whose fence has signaled. signaled(fence)
+		/// is called oldest first and should destroy the fence when returning true.
+		template<typename Signaled>
+		void retire(Signaled signaled)
+		{
+			while (!mRegions.empty() && signaled(mRegions.front().fence))
+				mRegions.pop_front();
+
+			if (!mRegions.empty())
+				mTail = mRegions.front().start;
+			else
+				mTail = mOpenStart;
+		}
+
+		inline bool isEmpty() const
+		{
+			return mRegions.empty() && !mOpenUsed;
+		}
+
+		inline size_t getSize() const
+		{
+			return mSize;
+		}
+
+	private:
+		struct Region
+		{
+			Fence fence;
+			size_t start;
+		};
+
+		size_t mSize;
+		size_t mHead;
+		size_t mTail;
+		size_t mOpenStart;
+		bool mOpenUsed;
+		std::deque<Region> mRegions;
+	};
+}
+
+#endif
@@ -184,7 +184,7 @@ namespace Jikken
 			return true;
 		}
 
-		bool convertGlslToSpirv(const ShaderStage &stage, const std::string &glslIn, std::vector<uint32_t> &spirv)
+		bool convertGlslToSpirv(const ShaderStage &stage, const std::string &glslIn, std::vector<uint32_t> &spirv, const bool vulkanRules)
 		{
 			EShLanguage type = _findLanguage(stage);
 			glslang::TShader shader(type);
@@ -192,7 +192,7 @@ namespace Jikken
 			TBuiltInResource Resources;
 			_initResources(Resources);
 
-			EShMessages messages = (EShMessages)(EShMsgSpvRules);
+			EShMessages messages = (EShMessages)(vulkanRules ? EShMsgSpvRules | EShMsgVulkanRules : EShMsgSpvRules);
 
 			const char *shaderSrc[1];
 			shaderSrc[0] = glslIn.c_str();
@@ -220,6 +220,44 @@ namespace Jikken
 			return true;
 		}
 
+		bool reflectSpirv(const std::vector<uint32_t> &spirvIn, std::vector<ShaderResource> &resourcesOut)
+		{
+			try
+			{
+				spirv_cross::Compiler compiler(spirvIn);
+				const spirv_cross::ShaderResources resources = compiler.get_shader_resources();
+
+				auto addResources = [&](const std::vector<spirv_cross::Resource> &list, ShaderResourceType type)
+				{
+					for (const spirv_cross::Resource &resource : list)
+					{
+						const spirv_cross::SPIRType &spirType = compiler.get_type(resource.type_id);
+						ShaderResource out;
+						out.name = resource.name;
+						out.type = type;
+						out.set = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+						out.binding = compiler.get_decoration(resource.id, spv::DecorationBinding);
+						out.count = spirType.array.empty() ? 1 : spirType.array[0];
+						out.size = spirType.basetype == spirv_cross::SPIRType::Struct ? static_cast<uint32_t>(compiler.get_declared_struct_size(spirType)) : 0;
+						resourcesOut.push_back(out);
+					}
+				};
+
+				addResources(resources.uniform_buffers, ShaderResourceType::eConstantBuffer);
+				addResources(resources.storage_buffers, ShaderResourceType::eStorageBuffer);
+				addResources(resources.sampled_images, ShaderResourceType::eTexture);
+				addResources(resources.storage_images, ShaderResourceType::eStorageImage);
+				addResources(resources.push_constant_buffers, ShaderResourceType::ePushConstants);
+			}
+			catch (spirv_cross::CompilerError err)
+			{
+				std::printf("Spir-v Cross error: %s", err.what());
+				return false;
+			}
+
+			return true;
+		}
+
 		bool convertSpirvToGlsl(const ShaderStage &stage, const std::vector<uint32_t> &spirvIn, std::string &glslOut)
 		{
 			try
@@ -33,11 +33,34 @@ namespace Jikken
 {
 	namespace ShaderUtils
 	{
+		enum class ShaderResourceType
+		{
+			eConstantBuffer,
+			eStorageBuffer,
+			eTexture, //combined image and sampler
+			eStorageImage,
+			ePushConstants //vulkan only, has no set or binding
+		};
+
+		//a buffer or texture a shader stage declares
+		struct ShaderResource
+		{
+			std::string name; //block name for buffers, like glGetUniformBlockIndex expects
+			ShaderResourceType type;
+			uint32_t set;
+			uint32_t binding;
+			uint32_t count; //array size, 1 for single resources
+			uint32_t size; //declared size of buffer blocks, 0 for textures
+		};
+
 		//validate glsl source
 		bool validateGlsl(const ShaderStage &stage, const std::string &glslSrc);
 
-		//convert glsl to spir-v
-		bool convertGlslToSpirv(const ShaderStage &stage, const std::string &glslIn, std::vector<uint32_t> &spirvOut);
+		//convert glsl to spir-v, vulkan rules define VULKAN and allow push constants
+		bool convertGlslToSpirv(const ShaderStage &stage, const std::string &glslIn, std::vector<uint32_t> &spirvOut, const bool vulkanRules = false);
+
+		//list the resources spir-v declares with their descriptor set and binding
+		bool reflectSpirv(const std::vector<uint32_t> &spirvIn, std::vector<ShaderResource> &resourcesOut);
 
 		// convert back from spir-v to high level languages
 		bool convertSpirvToGlsl(const ShaderStage &stage, const std::vector<uint32_t> &spirvIn, std::string &glslOut);
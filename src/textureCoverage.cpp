@@ -0,0 +1,94 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include "textureCoverage.hpp"
+
+namespace Jikken
+{
+	TextureCoverage::TextureCoverage() :
+		mLayers(0),
+		mCompleteFrom(0)
+	{
+	}
+
+	void TextureCoverage::reset(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels)
+	{
+		mLevels.assign(levels, Level());
+		for (uint32_t i = 0; i < levels; ++i)
+		{
+			mLevels[i].width = std::max(width >> i, 1u);
+			mLevels[i].height = std::max(height >> i, 1u);
+			mLevels[i].fullRows = 0;
+		}
+		mLayers = layers;
+		mCompleteFrom = levels;
+	}
+
+	void TextureCoverage::add(uint32_t level, uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+	{
+		if (level >= mLevels.size() || layer >= mLayers)
+			return;
+
+		Level &coverage = mLevels[level];
+		const uint64_t levelRows = static_cast<uint64_t>(coverage.height) * mLayers;
+		if (coverage.fullRows == levelRows || x >= coverage.width || y >= coverage.height || width == 0 || height == 0)
+			return;
+
+		if (coverage.rows.empty())
+			coverage.rows.resize(static_cast<size_t>(levelRows));
+
+		const uint32_t begin = x;
+		const uint32_t end = static_cast<uint32_t>(std::min(static_cast<uint64_t>(x) + width, static_cast<uint64_t>(coverage.width)));
+		const uint32_t lastRow = static_cast<uint32_t>(std::min(static_cast<uint64_t>(y) + height, static_cast<uint64_t>(coverage.height)));
+		for (uint32_t row = y; row < lastRow; ++row)
+		{
+			std::vector<Span> &spans = coverage.rows[static_cast<size_t>(layer) * coverage.height + row];
+			if (spans.size() == 1 && spans[0].begin == 0 && spans[0].end == coverage.width)
+				continue;
+
+			// Spans are sorted and never touch, merge every one the upload reaches.
+			Span merged = { begin, end };
+			auto first = std::find_if(spans.begin(), spans.end(), [begin](const Span &span) { return span.end >= begin; });
+			auto last = first;
+			while (last != spans.end() && last->begin <= end)
+			{
+				merged.begin = std::min(merged.begin, last->begin);
+				merged.end = std::max(merged.end, last->end);
+				++last;
+			}
+			spans.insert(spans.erase(first, last), merged);
+
+			if (spans.size() == 1 && spans[0].begin == 0 && spans[0].end == coverage.width)
+				++coverage.fullRows;
+		}
+
+		// A complete level needs no more tracking.
+		if (coverage.fullRows == levelRows)
+			std::vector<std::vector<Span>>().swap(coverage.rows);
+
+		while (mCompleteFrom > 0 && mLevels[mCompleteFrom - 1].fullRows == static_cast<uint64_t>(mLevels[mCompleteFrom - 1].height) * mLayers)
+			--mCompleteFrom;
+	}
+}
@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_TEXTURECOVERAGE_HPP_
+#define _JIKKEN_TEXTURECOVERAGE_HPP_
+
+#include <cstdint>
+#include <vector>
+
+namespace Jikken
+{
+	/// Tracks which texels of every mip level and layer of a texture have been
+	/// uploaded, so backends only let sampling reach levels that are complete.
+	/// Each row keeps the spans written to it, so uploading a region again or
+	/// overlapping an earlier one doesn't count its texels twice.
+	class TextureCoverage
+	{
+	public:
+		TextureCoverage();
+
+		/// Starts over with nothing uploaded.
+		void reset(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels);
+
+		/// Records an upload, clamped to the level.
+		void add(uint32_t level, uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+		/// Every level from this one to the coarsest is complete. Equal to the
+		/// level count while the coarsest level is still missing texels.
+		inline uint32_t getCompleteFrom() const
+		{
+			return mCompleteFrom;
+		}
+
+	private:
+		struct Span
+		{
+			uint32_t begin;
+			uint32_t end;
+		};
+
+		struct Level
+		{
+			uint32_t width;
+			uint32_t height;
+			uint32_t fullRows; //across all layers, the level is complete at height * layers
+			std::vector<std::vector<Span>> rows; //layer * height + y, allocated at the first upload
+		};
+
+		std::vector<Level> mLevels;
+		uint32_t mLayers;
+		uint32_t mCompleteFrom;
+	};
+}
+
+#endif
@@ -0,0 +1,167 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cassert>
+#include "jikken/textureStreamer.hpp"
+#include "jikken/commandQueue.hpp"
+
+namespace Jikken
+{
+	TextureStreamer::TextureStreamer(size_t budget) :
+		mBudget(budget)
+	{
+		assert(budget <= MemoryPool::MEGABYTE * 4);
+	}
+
+	size_t TextureStreamer::getTexelSize(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::eRGBA8:
+		case TextureFormat::eSRGBA8:
+		case TextureFormat::eRG16F:
+		case TextureFormat::eR32F:
+		case TextureFormat::eR11G11B10F:
+		case TextureFormat::eDepth24Stencil8:
+		case TextureFormat::eDepth32F:
+			return 4;
+		case TextureFormat::eRGBA16F:
+			return 8;
+		case TextureFormat::eRGBA32F:
+			return 16;
+		case TextureFormat::eDepth16:
+			return 2;
+		default:
+			return 0;
+		}
+	}
+
+	void TextureStreamer::stream(TextureHandle texture, const TextureDetails &details, const std::vector<const void*> &levels)
+	{
+		Job job;
+		job.texture = texture;
+		job.details = details;
+		job.levels = levels;
+		if (details.type == TextureType::e2D)
+			job.details.layers = 1;
+		else if (details.type == TextureType::eCube)
+			job.details.layers = 6;
+
+		// Start from the coarsest level.
+		job.level = static_cast<uint32_t>(levels.size()) - 1;
+		job.layer = 0;
+		job.row = 0;
+		if (!levels.empty())
+			mJobs.push_back(job);
+	}
+
+	void TextureStreamer::update(CommandQueue *queue)
+	{
+		size_t remaining = mBudget;
+		while (!mJobs.empty())
+		{
+			// Pick the job with the smallest pending level.
+			size_t index = 0;
+			uint64_t smallest = UINT64_MAX;
+			for (size_t i = 0; i < mJobs.size(); ++i)
+			{
+				const Job &job = mJobs[i];
+				uint64_t texels = static_cast<uint64_t>(std::max(job.details.width >> job.level, 1u)) * std::max(job.details.height >> job.level, 1u);
+				if (texels < smallest)
+				{
+					smallest = texels;
+					index = i;
+				}
+			}
+
+			Job &job = mJobs[index];
+			uint32_t width = std::max(job.details.width >> job.level, 1u);
+			uint32_t height = std::max(job.details.height >> job.level, 1u);
+			size_t rowSize = width * getTexelSize(job.details.format);
+			if (rowSize == 0)
+			{
+				// Unknown format, nothing sensible to send.
+				mJobs.erase(mJobs.begin() + index);
+				continue;
+			}
+
+			// Always send at least one row per update so huge rows still progress.
+			if (rowSize > remaining && remaining != mBudget)
+				break;
+			uint32_t rows = static_cast<uint32_t>(std::max<size_t>(remaining / rowSize, 1));
+			rows = std::min(rows, height - job.row);
+
+			const uint8_t *level = static_cast<const uint8_t*>(job.levels[job.level]);
+			UpdateTextureCommand cmd;
+			cmd.texture = job.texture;
+			cmd.mipLevel = job.level;
+			cmd.layer = job.layer;
+			cmd.x = 0;
+			cmd.y = job.row;
+			cmd.width = width;
+			cmd.height = rows;
+			cmd.dataSize = rows * rowSize;
+			cmd.data = const_cast<uint8_t*>(level + (static_cast<size_t>(job.layer) * height + job.row) * rowSize);
+			queue->addUpdateTextureCommand(&cmd);
+			remaining -= std::min(remaining, cmd.dataSize);
+
+			// Advance to the next band, layer, then finer level.
+			job.row += rows;
+			if (job.row == height)
+			{
+				job.row = 0;
+				if (++job.layer == job.details.layers)
+				{
+					job.layer = 0;
+					if (job.level == 0)
+						mJobs.erase(mJobs.begin() + index);
+					else
+						--job.level;
+				}
+			}
+
+			if (remaining == 0)
+				break;
+		}
+	}
+
+	void TextureStreamer::cancel(TextureHandle texture)
+	{
+		mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(), [texture](const Job &job)
+		{
+			return job.texture == texture;
+		}), mJobs.end());
+	}
+
+	bool TextureStreamer::isStreaming(TextureHandle texture) const
+	{
+		for (const Job &job : mJobs)
+		{
+			if (job.texture == texture)
+				return true;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,572 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cassert>
+#include <cstdio>
+#include "vulkan/VulkanAllocator.hpp"
+
+namespace Jikken
+{
+	//blocks are this big unless the heap is small
+	static const VkDeviceSize DefaultBlockSize = 64 * 1024 * 1024;
+
+	//second level lists per power of two
+	static const uint32_t SLBits = 5;
+	static const uint32_t SLCount = 1 << SLBits;
+	//ranges below 256 bytes share the first first level list
+	static const uint32_t SmallShift = 8;
+	static const uint32_t FLCount = 64 - SmallShift + 1;
+
+	static const uint32_t InvalidNode = UINT32_MAX;
+
+	static inline uint32_t highestBit(uint64_t value)
+	{
+		uint32_t bit = 0;
+		while (value >>= 1)
+			++bit;
+		return bit;
+	}
+
+	static inline uint32_t lowestBit(uint64_t value)
+	{
+		uint32_t bit = 0;
+		while ((value & 1) == 0)
+		{
+			value >>= 1;
+			++bit;
+		}
+		return bit;
+	}
+
+	static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	//free list of one VkDeviceMemory block, only offsets are managed
+	class VulkanMemoryBlock
+	{
+	public:
+		VkDeviceMemory memory;
+		uint8_t *mapped;
+		VkDeviceSize size;
+
+		VulkanMemoryBlock(VkDeviceMemory memory, uint8_t *mapped, VkDeviceSize size) :
+			memory(memory),
+			mapped(mapped),
+			size(size),
+			mUsed(0),
+			mRangeCount(0),
+			mFlBitmap(0)
+		{
+			for (uint32_t fl = 0; fl < FLCount; ++fl)
+			{
+				mSlBitmap[fl] = 0;
+				for (uint32_t sl = 0; sl < SLCount; ++sl)
+					mHeads[fl][sl] = InvalidNode;
+			}
+
+			Node whole = { 0, size, InvalidNode, InvalidNode, InvalidNode, InvalidNode, false };
+			mNodes.push_back(whole);
+			_insertFree(0);
+		}
+
+		bool allocate(VkDeviceSize rangeSize, VkDeviceSize alignment, VkDeviceSize &offset, uint32_t &node)
+		{
+			//any range in the found list fits the size plus the worst case alignment padding
+			VkDeviceSize search = rangeSize + alignment - 1;
+			if (search >= (1ull << SmallShift))
+				search += (1ull << (highestBit(search) - SLBits)) - 1;
+			else
+				search += (1ull << (SmallShift - SLBits)) - 1;
+
+			uint32_t fl, sl;
+			_mapping(search, fl, sl);
+			if (fl >= FLCount)
+				return false;
+
+			uint32_t slMap = mSlBitmap[fl] & (~0u << sl);
+			if (slMap == 0)
+			{
+				if (fl + 1 >= FLCount)
+					return false;
+				const uint64_t flMap = mFlBitmap & (~0ull << (fl + 1));
+				if (flMap == 0)
+					return false;
+				fl = lowestBit(flMap);
+				slMap = mSlBitmap[fl];
+			}
+			sl = lowestBit(slMap);
+
+			node = mHeads[fl][sl];
+			_removeFree(node);
+
+			//padding in front of the aligned offset stays free
+			const VkDeviceSize aligned = alignUp(mNodes[node].offset, alignment);
+			const VkDeviceSize padding = aligned - mNodes[node].offset;
+			if (padding > 0)
+			{
+				const uint32_t front = node;
+				node = _split(front, padding);
+				_insertFree(front);
+			}
+
+			//and so does whatever the range doesn't need
+			if (mNodes[node].size > rangeSize)
+				_insertFree(_split(node, rangeSize));
+
+			mNodes[node].used = true;
+			mUsed += rangeSize;
+			++mRangeCount;
+			offset = mNodes[node].offset;
+			return true;
+		}
+
+		void free(uint32_t node)
+		{
+			assert(mNodes[node].used);
+			mNodes[node].used = false;
+			mUsed -= mNodes[node].size;
+			--mRangeCount;
+
+			//merge with free physical neighbours
+			const uint32_t next = mNodes[node].nextPhys;
+			if (next != InvalidNode && !mNodes[next].used)
+			{
+				_removeFree(next);
+				_merge(node, next);
+			}
+
+			const uint32_t prev = mNodes[node].prevPhys;
+			if (prev != InvalidNode && !mNodes[prev].used)
+			{
+				_removeFree(prev);
+				_merge(prev, node);
+				node = prev;
+			}
+
+			_insertFree(node);
+		}
+
+		inline bool isEmpty() const
+		{
+			return mRangeCount == 0;
+		}
+
+		inline VkDeviceSize getUsed() const
+		{
+			return mUsed;
+		}
+
+		inline uint32_t getRangeCount() const
+		{
+			return mRangeCount;
+		}
+
+		VkDeviceSize getLargestFree() const
+		{
+			if (mFlBitmap == 0)
+				return 0;
+
+			//the largest range is in the highest non empty list
+			const uint32_t fl = highestBit(mFlBitmap);
+			const uint32_t sl = highestBit(mSlBitmap[fl]);
+			VkDeviceSize largest = 0;
+			for (uint32_t node = mHeads[fl][sl]; node != InvalidNode; node = mNodes[node].nextFree)
+			{
+				if (mNodes[node].size > largest)
+					largest = mNodes[node].size;
+			}
+			return largest;
+		}
+
+	private:
+		struct Node
+		{
+			VkDeviceSize offset;
+			VkDeviceSize size;
+			uint32_t prevPhys;
+			uint32_t nextPhys;
+			uint32_t prevFree;
+			uint32_t nextFree;
+			bool used;
+		};
+
+		static void _mapping(VkDeviceSize rangeSize, uint32_t &fl, uint32_t &sl)
+		{
+			if (rangeSize < (1ull << SmallShift))
+			{
+				fl = 0;
+				sl = static_cast<uint32_t>(rangeSize >> (SmallShift - SLBits));
+			}
+			else
+			{
+				const uint32_t bit = highestBit(rangeSize);
+				fl = bit - SmallShift + 1;
+				sl = static_cast<uint32_t>(rangeSize >> (bit - SLBits)) - SLCount;
+			}
+		}
+
+		void _insertFree(uint32_t node)
+		{
+			uint32_t fl, sl;
+			_mapping(mNodes[node].size, fl, sl);
+
+			Node &n = mNodes[node];
+			n.used = false;
+			n.prevFree = InvalidNode;
+			n.nextFree = mHeads[fl][sl];
+			if (n.nextFree != InvalidNode)
+				mNodes[n.nextFree].prevFree = node;
+			mHeads[fl][sl] = node;
+
+			mFlBitmap |= 1ull << fl;
+			mSlBitmap[fl] |= 1u << sl;
+		}
+
+		void _removeFree(uint32_t node)
+		{
+			uint32_t fl, sl;
+			_mapping(mNodes[node].size, fl, sl);
+
+			Node &n = mNodes[node];
+			if (n.prevFree != InvalidNode)
+				mNodes[n.prevFree].nextFree = n.nextFree;
+			else
+				mHeads[fl][sl] = n.nextFree;
+			if (n.nextFree != InvalidNode)
+				mNodes[n.nextFree].prevFree = n.prevFree;
+
+			if (mHeads[fl][sl] == InvalidNode)
+			{
+				mSlBitmap[fl] &= ~(1u << sl);
+				if (mSlBitmap[fl] == 0)
+					mFlBitmap &= ~(1ull << fl);
+			}
+		}
+
+		//cuts node after rangeSize bytes, returns the node holding the rest
+		uint32_t _split(uint32_t node, VkDeviceSize rangeSize)
+		{
+			uint32_t rest;
+			if (!mUnusedNodes.empty())
+			{
+				rest = mUnusedNodes.back();
+				mUnusedNodes.pop_back();
+			}
+			else
+			{
+				rest = static_cast<uint32_t>(mNodes.size());
+				mNodes.push_back(Node());
+			}
+
+			Node &n = mNodes[node];
+			Node &r = mNodes[rest];
+			r.offset = n.offset + rangeSize;
+			r.size = n.size - rangeSize;
+			r.prevPhys = node;
+			r.nextPhys = n.nextPhys;
+			r.prevFree = InvalidNode;
+			r.nextFree = InvalidNode;
+			r.used = false;
+			if (n.nextPhys != InvalidNode)
+				mNodes[n.nextPhys].prevPhys = rest;
+			n.nextPhys = rest;
+			n.size = rangeSize;
+			return rest;
+		}
+
+		//folds next into node, next is recycled
+		void _merge(uint32_t node, uint32_t next)
+		{
+			Node &n = mNodes[node];
+			n.size += mNodes[next].size;
+			n.nextPhys = mNodes[next].nextPhys;
+			if (n.nextPhys != InvalidNode)
+				mNodes[n.nextPhys].prevPhys = node;
+			mUnusedNodes.push_back(next);
+		}
+
+		VkDeviceSize mUsed;
+		uint32_t mRangeCount;
+		std::vector<Node> mNodes;
+		std::vector<uint32_t> mUnusedNodes;
+		uint64_t mFlBitmap;
+		uint32_t mSlBitmap[FLCount];
+		uint32_t mHeads[FLCount][SLCount];
+	};
+
+	VulkanAllocator::VulkanAllocator() :
+		mDevice(VK_NULL_HANDLE),
+		mAllocCallback(nullptr),
+		mMemProperties(),
+		mGranularity(1),
+		mMaxAllocations(UINT32_MAX),
+		mAllocationCount(0),
+		mDedicatedBytes(0),
+		mDedicatedCount(0)
+	{
+	}
+
+	VulkanAllocator::~VulkanAllocator()
+	{
+		destroy();
+	}
+
+	void VulkanAllocator::init(VkDevice device, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceLimits &limits, VkAllocationCallbacks *allocCallback)
+	{
+		mDevice = device;
+		mAllocCallback = allocCallback;
+		mGranularity = limits.bufferImageGranularity;
+		mMaxAllocations = limits.maxMemoryAllocationCount;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &mMemProperties);
+
+		mPools.resize(mMemProperties.memoryTypeCount * 2);
+		for (uint32_t i = 0; i < mMemProperties.memoryTypeCount; ++i)
+		{
+			//keep a few blocks within small heaps, such as the host visible part of vram
+			const VkDeviceSize heapSize = mMemProperties.memoryHeaps[mMemProperties.memoryTypes[i].heapIndex].size;
+			VkDeviceSize blockSize = DefaultBlockSize;
+			while (blockSize > heapSize / 8 && blockSize > (1ull << 20))
+				blockSize >>= 1;
+
+			mPools[i * 2].memoryType = i;
+			mPools[i * 2].blockSize = blockSize;
+			mPools[i * 2 + 1].memoryType = i;
+			mPools[i * 2 + 1].blockSize = blockSize;
+		}
+	}
+
+	void VulkanAllocator::destroy()
+	{
+		for (auto &pool : mPools)
+		{
+			for (VulkanMemoryBlock *block : pool.blocks)
+			{
+#ifdef _DEBUG
+				if (!block->isEmpty())
+				{
+					std::printf("Freeing a memory block that still has %u ranges in use\n", block->getRangeCount());
+					assert(false);
+				}
+#endif
+				_freeMemory(block->memory);
+				delete block;
+			}
+			pool.blocks.clear();
+		}
+
+#ifdef _DEBUG
+		if (mDedicatedCount > 0)
+		{
+			std::printf("%u dedicated allocations were not freed\n", mDedicatedCount);
+			assert(false);
+		}
+#endif
+		mDedicatedCount = 0;
+		mDedicatedBytes = 0;
+	}
+
+	bool VulkanAllocator::allocate(const VkMemoryRequirements &requirements, uint32_t memoryType, bool linear, VulkanAllocation &allocation)
+	{
+		Pool &pool = mPools[memoryType * 2 + (!linear && mGranularity > 1 ? 1 : 0)];
+
+		//big resources get their own memory rather than wasting most of a block
+		if (requirements.size > pool.blockSize / 2)
+		{
+			if (!_allocateMemory(memoryType, requirements.size, allocation.memory, allocation.mapped))
+				return false;
+
+			allocation.offset = 0;
+			allocation.size = requirements.size;
+			allocation.block = nullptr;
+			allocation.node = InvalidNode;
+			mDedicatedBytes += requirements.size;
+			++mDedicatedCount;
+			return true;
+		}
+
+		const VkDeviceSize alignment = requirements.alignment > 0 ? requirements.alignment : 1;
+		VulkanMemoryBlock *block = nullptr;
+		VkDeviceSize offset = 0;
+		uint32_t node = InvalidNode;
+		for (VulkanMemoryBlock *candidate : pool.blocks)
+		{
+			if (candidate->allocate(requirements.size, alignment, offset, node))
+			{
+				block = candidate;
+				break;
+			}
+		}
+
+		if (block == nullptr)
+		{
+			VkDeviceMemory memory;
+			uint8_t *mapped;
+			if (!_allocateMemory(memoryType, pool.blockSize, memory, mapped))
+				return false;
+
+			block = new VulkanMemoryBlock(memory, mapped, pool.blockSize);
+			pool.blocks.push_back(block);
+			if (!block->allocate(requirements.size, alignment, offset, node))
+			{
+				std::printf("Allocation of %llu bytes does not fit an empty memory block\n", static_cast<unsigned long long>(requirements.size));
+				return false;
+			}
+		}
+
+		allocation.memory = block->memory;
+		allocation.offset = offset;
+		allocation.size = requirements.size;
+		allocation.mapped = block->mapped ? block->mapped + offset : nullptr;
+		allocation.block = block;
+		allocation.node = node;
+		return true;
+	}
+
+	void VulkanAllocator::free(VulkanAllocation &allocation)
+	{
+		if (allocation.memory == VK_NULL_HANDLE)
+			return;
+
+		VulkanMemoryBlock *block = allocation.block;
+		if (block == nullptr)
+		{
+			_freeMemory(allocation.memory);
+			mDedicatedBytes -= allocation.size;
+			--mDedicatedCount;
+			allocation = VulkanAllocation();
+			return;
+		}
+
+		block->free(allocation.node);
+		allocation = VulkanAllocation();
+		if (!block->isEmpty())
+			return;
+
+		//keep one empty block per pool so a resource that is created and deleted
+		//every frame doesn't allocate device memory every frame
+		for (auto &pool : mPools)
+		{
+			for (size_t i = 0; i < pool.blocks.size(); ++i)
+			{
+				if (pool.blocks[i] != block)
+					continue;
+
+				for (VulkanMemoryBlock *other : pool.blocks)
+				{
+					if (other != block && other->isEmpty())
+					{
+						_freeMemory(block->memory);
+						delete block;
+						pool.blocks.erase(pool.blocks.begin() + i);
+						return;
+					}
+				}
+				return;
+			}
+		}
+	}
+
+	VulkanMemoryStats VulkanAllocator::getStats() const
+	{
+		VulkanMemoryStats stats = {};
+		VkDeviceSize largestSum = 0;
+		for (const auto &pool : mPools)
+		{
+			for (const VulkanMemoryBlock *block : pool.blocks)
+			{
+				stats.blockBytes += block->size;
+				stats.usedBytes += block->getUsed();
+				stats.rangeCount += block->getRangeCount();
+				const VkDeviceSize largest = block->getLargestFree();
+				if (largest > stats.largestFreeRange)
+					stats.largestFreeRange = largest;
+				largestSum += largest;
+				++stats.blockCount;
+			}
+		}
+		stats.dedicatedBytes = mDedicatedBytes;
+		stats.dedicatedCount = mDedicatedCount;
+		stats.allocationCount = mAllocationCount;
+
+		const VkDeviceSize freeBytes = stats.blockBytes - stats.usedBytes;
+		if (freeBytes > 0)
+			stats.fragmentation = 1.0f - static_cast<float>(largestSum) / static_cast<float>(freeBytes);
+		return stats;
+	}
+
+	void VulkanAllocator::printStats() const
+	{
+		const VulkanMemoryStats stats = getStats();
+		const double mb = 1024.0 * 1024.0;
+		std::printf("Vulkan memory: %u/%u allocations, %u blocks %.1f MB (%.1f MB used in %u ranges), %u dedicated %.1f MB, largest free range %.1f MB, fragmentation %.2f\n",
+			stats.allocationCount, mMaxAllocations, stats.blockCount, stats.blockBytes / mb, stats.usedBytes / mb, stats.rangeCount,
+			stats.dedicatedCount, stats.dedicatedBytes / mb, stats.largestFreeRange / mb, stats.fragmentation);
+	}
+
+	bool VulkanAllocator::_allocateMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory &memory, uint8_t *&mapped)
+	{
+		if (mAllocationCount >= mMaxAllocations)
+		{
+			std::printf("Reached maxMemoryAllocationCount of %u\n", mMaxAllocations);
+			return false;
+		}
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		VkResult result = vkAllocateMemory(mDevice, &allocInfo, mAllocCallback, &memory);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkAllocateMemory failed for %llu bytes of memory type %u\n", static_cast<unsigned long long>(size), memoryType);
+			return false;
+		}
+		++mAllocationCount;
+
+		mapped = nullptr;
+		if (mMemProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			void *data;
+			result = vkMapMemory(mDevice, memory, 0, VK_WHOLE_SIZE, 0, &data);
+			if (result != VK_SUCCESS)
+			{
+				std::printf("vkMapMemory failed\n");
+				_freeMemory(memory);
+				return false;
+			}
+			mapped = static_cast<uint8_t*>(data);
+		}
+		return true;
+	}
+
+	void VulkanAllocator::_freeMemory(VkDeviceMemory memory)
+	{
+		//freeing implicitly unmaps
+		vkFreeMemory(mDevice, memory, mAllocCallback);
+		--mAllocationCount;
+	}
+}
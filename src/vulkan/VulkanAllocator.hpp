@@ -0,0 +1,126 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_VULKAN_VULKANALLOCATOR_HPP_
+#define _JIKKEN_VULKAN_VULKANALLOCATOR_HPP_
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Jikken
+{
+	class VulkanMemoryBlock;
+
+	/// A range of device memory handed out by VulkanAllocator.
+	struct VulkanAllocation
+	{
+		VkDeviceMemory memory;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		uint8_t *mapped; //start of the range if the memory is host visible, otherwise nullptr
+		VulkanMemoryBlock *block; //nullptr for dedicated allocations
+		uint32_t node;
+
+		VulkanAllocation() :
+			memory(VK_NULL_HANDLE),
+			offset(0),
+			size(0),
+			mapped(nullptr),
+			block(nullptr),
+			node(UINT32_MAX)
+		{}
+	};
+
+	struct VulkanMemoryStats
+	{
+		VkDeviceSize blockBytes; //device memory held by blocks
+		VkDeviceSize usedBytes; //bytes handed out of blocks
+		VkDeviceSize dedicatedBytes; //bytes in dedicated allocations
+		VkDeviceSize largestFreeRange; //largest range a block could hand out in one piece
+		uint32_t blockCount;
+		uint32_t dedicatedCount;
+		uint32_t allocationCount; //live vkAllocateMemory calls, limited by maxMemoryAllocationCount
+		uint32_t rangeCount; //ranges handed out of blocks
+		float fragmentation; //0 when the free bytes of each block form one range, towards 1 as they scatter
+	};
+
+	/// Sub-allocates buffers and images from large VkDeviceMemory blocks, so the
+	/// number of vkAllocateMemory calls stays far below maxMemoryAllocationCount.
+	/// Each block hands out ranges with a two level segregated fit (TLSF) free
+	/// list: allocating and freeing are O(1) and free neighbours are merged.
+	/// Requests bigger than half a block get a dedicated allocation.
+	/// Linear resources (buffers) and optimal tiled images are kept in separate
+	/// blocks when bufferImageGranularity is above 1, so they never share a page.
+	/// Host visible blocks stay mapped for their whole lifetime.
+	class VulkanAllocator
+	{
+	public:
+		VulkanAllocator();
+		~VulkanAllocator();
+
+		void init(VkDevice device, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceLimits &limits, VkAllocationCallbacks *allocCallback);
+
+		/// Frees every block. Call before destroying the device, after every
+		/// resource bound to allocated memory has been destroyed.
+		void destroy();
+
+		/// @param memoryType Index chosen with vkutils::findMemoryType.
+		/// @param linear true for buffers, false for optimal tiled images.
+		/// @return false if device memory ran out or the allocation count limit was hit.
+		bool allocate(const VkMemoryRequirements &requirements, uint32_t memoryType, bool linear, VulkanAllocation &allocation);
+
+		/// Returns the range to its block. The memory must no longer be in use by the GPU.
+		void free(VulkanAllocation &allocation);
+
+		VulkanMemoryStats getStats() const;
+		void printStats() const;
+
+	private:
+		VulkanAllocator(const VulkanAllocator&);
+		VulkanAllocator& operator=(const VulkanAllocator&);
+
+		struct Pool
+		{
+			uint32_t memoryType;
+			VkDeviceSize blockSize;
+			std::vector<VulkanMemoryBlock*> blocks;
+		};
+
+		bool _allocateMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory &memory, uint8_t *&mapped);
+		void _freeMemory(VkDeviceMemory memory);
+
+		VkDevice mDevice;
+		VkAllocationCallbacks *mAllocCallback;
+		VkPhysicalDeviceMemoryProperties mMemProperties;
+		VkDeviceSize mGranularity;
+		uint32_t mMaxAllocations;
+		uint32_t mAllocationCount;
+		VkDeviceSize mDedicatedBytes;
+		uint32_t mDedicatedCount;
+		//two per memory type, the second for optimal tiled images when the granularity needs them apart
+		std::vector<Pool> mPools;
+	};
+}
+
+#endif
@@ -0,0 +1,269 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include "vulkan/VulkanDescriptorCache.hpp"
+#include "hashUtils.hpp"
+
+namespace Jikken
+{
+	//every pool holds this many sets, with room for a few descriptors of each type per set
+	static const uint32_t PoolSetCount = 256;
+	static const VkDescriptorPoolSize PoolSizes[] =
+	{
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, PoolSetCount * 4 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, PoolSetCount * 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, PoolSetCount * 4 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, PoolSetCount }
+	};
+
+	VulkanDescriptor::VulkanDescriptor() :
+		binding(0),
+		arrayElement(0),
+		type(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+		buffer(),
+		image()
+	{
+	}
+
+	//field by field, padding bytes are undefined
+	uint64_t VulkanDescriptor::computeHash(uint64_t seed) const
+	{
+		uint64_t hash = HashUtils::fnv1aValue(binding, seed);
+		hash = HashUtils::fnv1aValue(arrayElement, hash);
+		hash = HashUtils::fnv1aValue(type, hash);
+		hash = HashUtils::fnv1aValue(buffer.buffer, hash);
+		hash = HashUtils::fnv1aValue(buffer.offset, hash);
+		hash = HashUtils::fnv1aValue(buffer.range, hash);
+		hash = HashUtils::fnv1aValue(image.sampler, hash);
+		hash = HashUtils::fnv1aValue(image.imageView, hash);
+		hash = HashUtils::fnv1aValue(image.imageLayout, hash);
+		return hash;
+	}
+
+	bool VulkanDescriptor::operator==(const VulkanDescriptor &other) const
+	{
+		return binding == other.binding &&
+			arrayElement == other.arrayElement &&
+			type == other.type &&
+			buffer.buffer == other.buffer.buffer &&
+			buffer.offset == other.buffer.offset &&
+			buffer.range == other.buffer.range &&
+			image.sampler == other.image.sampler &&
+			image.imageView == other.image.imageView &&
+			image.imageLayout == other.image.imageLayout;
+	}
+
+	static bool sameBinding(const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b)
+	{
+		return a.binding == b.binding &&
+			a.descriptorType == b.descriptorType &&
+			a.descriptorCount == b.descriptorCount &&
+			a.stageFlags == b.stageFlags;
+	}
+
+	VulkanDescriptorLayoutCache::VulkanDescriptorLayoutCache() :
+		mDevice(VK_NULL_HANDLE),
+		mAllocCallback(nullptr)
+	{
+	}
+
+	void VulkanDescriptorLayoutCache::init(VkDevice device, VkAllocationCallbacks *allocCallback)
+	{
+		mDevice = device;
+		mAllocCallback = allocCallback;
+	}
+
+	void VulkanDescriptorLayoutCache::destroy()
+	{
+		for (auto &layout : mLayouts)
+			vkDestroyDescriptorSetLayout(mDevice, layout.second.layout, mAllocCallback);
+		mLayouts.clear();
+	}
+
+	VkDescriptorSetLayout VulkanDescriptorLayoutCache::get(std::vector<VkDescriptorSetLayoutBinding> bindings)
+	{
+		//the same bindings in another order are the same layout
+		std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b)
+		{
+			return a.binding < b.binding;
+		});
+
+		uint64_t hash = HashUtils::FNV_OFFSET_BASIS;
+		for (const auto &binding : bindings)
+		{
+			hash = HashUtils::fnv1aValue(binding.binding, hash);
+			hash = HashUtils::fnv1aValue(binding.descriptorType, hash);
+			hash = HashUtils::fnv1aValue(binding.descriptorCount, hash);
+			hash = HashUtils::fnv1aValue(binding.stageFlags, hash);
+		}
+
+		auto range = mLayouts.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			const auto &cached = it->second.bindings;
+			if (cached.size() == bindings.size() && std::equal(bindings.begin(), bindings.end(), cached.begin(), sameBinding))
+				return it->second.layout;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+
+		Entry entry;
+		if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, mAllocCallback, &entry.layout) != VK_SUCCESS)
+		{
+			std::printf("vkCreateDescriptorSetLayout failed\n");
+			return VK_NULL_HANDLE;
+		}
+		entry.bindings = std::move(bindings);
+		mLayouts.insert(std::make_pair(hash, entry));
+		return entry.layout;
+	}
+
+	VulkanDescriptorAllocator::VulkanDescriptorAllocator() :
+		mDevice(VK_NULL_HANDLE),
+		mAllocCallback(nullptr),
+		mPool(0)
+	{
+	}
+
+	void VulkanDescriptorAllocator::init(VkDevice device, VkAllocationCallbacks *allocCallback)
+	{
+		mDevice = device;
+		mAllocCallback = allocCallback;
+	}
+
+	void VulkanDescriptorAllocator::destroy()
+	{
+		//destroying a pool frees its sets
+		for (auto &pool : mPools)
+			vkDestroyDescriptorPool(mDevice, pool, mAllocCallback);
+		mPools.clear();
+		mSets.clear();
+		mPool = 0;
+	}
+
+	void VulkanDescriptorAllocator::reset()
+	{
+		//resetting a pool frees all of its sets at once
+		for (uint32_t i = 0; i < mPools.size() && i <= mPool; ++i)
+			vkResetDescriptorPool(mDevice, mPools[i], 0);
+		mSets.clear();
+		mPool = 0;
+	}
+
+	VkDescriptorSet VulkanDescriptorAllocator::get(VkDescriptorSetLayout layout, const VulkanDescriptor *descriptors, uint32_t count)
+	{
+		uint64_t hash = HashUtils::fnv1aValue(layout);
+		for (uint32_t i = 0; i < count; ++i)
+			hash = descriptors[i].computeHash(hash);
+
+		auto range = mSets.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			const Entry &entry = it->second;
+			if (entry.layout == layout && entry.descriptors.size() == count && std::equal(descriptors, descriptors + count, entry.descriptors.begin()))
+				return entry.set;
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		//a full pool fails the allocation, the next one is tried before giving up
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		while (true)
+		{
+			bool created = false;
+			if (mPool == mPools.size())
+			{
+				VkDescriptorPool pool = _createPool();
+				if (pool == VK_NULL_HANDLE)
+					return VK_NULL_HANDLE;
+				mPools.push_back(pool);
+				created = true;
+			}
+
+			allocInfo.descriptorPool = mPools[mPool];
+			if (vkAllocateDescriptorSets(mDevice, &allocInfo, &set) == VK_SUCCESS)
+				break;
+
+			//a new pool that can't hold the set never will
+			if (created)
+			{
+				std::printf("Descriptor set does not fit a descriptor pool\n");
+				return VK_NULL_HANDLE;
+			}
+			++mPool;
+		}
+
+		std::vector<VkWriteDescriptorSet> writes(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const VulkanDescriptor &descriptor = descriptors[i];
+			VkWriteDescriptorSet &write = writes[i];
+			write = {};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = set;
+			write.dstBinding = descriptor.binding;
+			write.dstArrayElement = descriptor.arrayElement;
+			write.descriptorCount = 1;
+			write.descriptorType = descriptor.type;
+			if (descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || descriptor.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+				descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || descriptor.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+				write.pBufferInfo = &descriptor.buffer;
+			else
+				write.pImageInfo = &descriptor.image;
+		}
+		vkUpdateDescriptorSets(mDevice, count, writes.data(), 0, nullptr);
+
+		Entry entry;
+		entry.layout = layout;
+		entry.descriptors.assign(descriptors, descriptors + count);
+		entry.set = set;
+		mSets.insert(std::make_pair(hash, entry));
+		return set;
+	}
+
+	VkDescriptorPool VulkanDescriptorAllocator::_createPool()
+	{
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = PoolSetCount;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(sizeof(PoolSizes) / sizeof(PoolSizes[0]));
+		poolInfo.pPoolSizes = PoolSizes;
+
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		if (vkCreateDescriptorPool(mDevice, &poolInfo, mAllocCallback, &pool) != VK_SUCCESS)
+		{
+			std::printf("vkCreateDescriptorPool failed\n");
+			return VK_NULL_HANDLE;
+		}
+		return pool;
+	}
+}
@@ -0,0 +1,123 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_VULKAN_VULKANDESCRIPTORCACHE_HPP_
+#define _JIKKEN_VULKAN_VULKANDESCRIPTORCACHE_HPP_
+
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Jikken
+{
+	/// One descriptor of a set, buffer is used for buffer types and image for the others.
+	struct VulkanDescriptor
+	{
+		uint32_t binding;
+		uint32_t arrayElement;
+		VkDescriptorType type;
+		VkDescriptorBufferInfo buffer;
+		VkDescriptorImageInfo image;
+
+		VulkanDescriptor();
+
+		uint64_t computeHash(uint64_t seed) const;
+		bool operator==(const VulkanDescriptor &other) const;
+	};
+
+	/// Descriptor set layouts by a hash of their bindings. Shaders declaring
+	/// the same resources share a layout, so their sets are interchangeable.
+	class VulkanDescriptorLayoutCache
+	{
+	public:
+		VulkanDescriptorLayoutCache();
+
+		void init(VkDevice device, VkAllocationCallbacks *allocCallback);
+
+		/// Destroys every layout. No pipeline layout may use them anymore.
+		void destroy();
+
+		/// @param bindings In any order, at most one per binding number.
+		/// @return VK_NULL_HANDLE if the layout could not be created.
+		VkDescriptorSetLayout get(std::vector<VkDescriptorSetLayoutBinding> bindings);
+
+		inline size_t getCount() const
+		{
+			return mLayouts.size();
+		}
+
+	private:
+		VulkanDescriptorLayoutCache(const VulkanDescriptorLayoutCache&);
+		VulkanDescriptorLayoutCache& operator=(const VulkanDescriptorLayoutCache&);
+
+		struct Entry
+		{
+			std::vector<VkDescriptorSetLayoutBinding> bindings;
+			VkDescriptorSetLayout layout;
+		};
+
+		VkDevice mDevice;
+		VkAllocationCallbacks *mAllocCallback;
+		std::unordered_multimap<uint64_t, Entry> mLayouts;
+	};
+
+	/// Hands out the descriptor sets of one frame, for one record thread. Sets
+	/// come from pools that are reset together once the frame has rendered, so
+	/// they are never freed one by one. A set with the same layout and
+	/// descriptors as an earlier one of the frame is reused instead of being
+	/// allocated and written again.
+	class VulkanDescriptorAllocator
+	{
+	public:
+		VulkanDescriptorAllocator();
+
+		void init(VkDevice device, VkAllocationCallbacks *allocCallback);
+
+		void destroy();
+
+		/// Makes every set available again. The frame must have rendered.
+		void reset();
+
+		/// @return VK_NULL_HANDLE if no pool could hold the set.
+		VkDescriptorSet get(VkDescriptorSetLayout layout, const VulkanDescriptor *descriptors, uint32_t count);
+
+	private:
+		VkDescriptorPool _createPool();
+
+		struct Entry
+		{
+			VkDescriptorSetLayout layout;
+			std::vector<VulkanDescriptor> descriptors;
+			VkDescriptorSet set;
+		};
+
+		VkDevice mDevice;
+		VkAllocationCallbacks *mAllocCallback;
+		std::vector<VkDescriptorPool> mPools; //kept across frames, only the first mPool + 1 are in use
+		uint32_t mPool;
+		std::unordered_multimap<uint64_t, Entry> mSets; //written this frame
+	};
+}
+
+#endif
@@ -22,8 +22,10 @@
 // SOFTWARE.
 //-----------------------------------------------------------------------------
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include "vulkan/VulkanGraphicsDevice.hpp"
 #include "vulkan/VulkanUtil.hpp"
 #include <array>
@@ -36,104 +38,159 @@
 
 namespace Jikken
 {
+	//size of the host visible buffer texture uploads are staged through
+	static const VkDeviceSize StagingBufferSize = 16 * 1024 * 1024;
+
+	//queries in the pool of each query handle
+	static const uint32_t QueryLatency = 4;
+
+	//upper bound for DeviceConfig::framesInFlight
+	static const uint32_t MaxFramesInFlight = 4;
+
+	//upper bound for DeviceConfig::recordThreads
+	static const uint32_t MaxRecordThreads = 16;
+
+	//size of the blocks SetConstantsCommand data is copied to, more are added when a frame fills them
+	static const VkDeviceSize ConstantRingBlockSize = 256 * 1024;
+
+	//size of the blocks updates recorded during a frame are copied from, larger updates get a block of their own
+	static const VkDeviceSize UploadRingBlockSize = 1024 * 1024;
+
+	//context of the queue a record thread is translating for submitCommandQueues, null on other threads
+	static thread_local VulkanCommandContext *tRecordContext = nullptr;
 
 	VulkanGraphicsDevice::VulkanGraphicsDevice() :
 		mInstance(VK_NULL_HANDLE),
 		mSurface(VK_NULL_HANDLE),
+		mWindow(nullptr),
 		mPhysicalDevice(VK_NULL_HANDLE),
+		mDeviceProperties(),
+		mEnabledFeatures(),
 		mDevice(VK_NULL_HANDLE),
 		mGraphicsQueue(VK_NULL_HANDLE),
 		mComputeQueue(VK_NULL_HANDLE),
+		mTransferQueue(VK_NULL_HANDLE),
 		mGraphicsQueueIndex(UINT32_MAX),
 		mComputeQueueIndex(UINT32_MAX),
+		mTransferQueueIndex(UINT32_MAX),
 		mRenderPass(VK_NULL_HANDLE),
-		mCommandBuffers(),
-		mSingleCmdBuffer(VK_NULL_HANDLE),
-		mCommandPool(VK_NULL_HANDLE),
+		mLoadRenderPass(VK_NULL_HANDLE),
 		mDebugCallback(VK_NULL_HANDLE),
 		mAllocCallback(nullptr),
-		mImageAvailableSem(VK_NULL_HANDLE),
-		mRenderFinishedSem(VK_NULL_HANDLE),
-		mShaderHandle(0)
+		mSwapChainDirty(false),
+		mPresentLayout(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR),
+		mFrames(),
+		mFrameIndex(0),
+		mFrameNumber(0),
+		mCompletedFrame(0),
+		mContext(),
+		mFrameActive(false),
+		mRenderPassActive(false),
+		mUntrackedReads(false),
+		mRenderPassInfo(),
+		mDefaultCleared(false),
+		mCurrentTarget(InvalidHandle),
+		mClearValues(),
+		mConditionalRendering(false),
+		mCmdBeginConditionalRendering(nullptr),
+		mCmdEndConditionalRendering(nullptr),
+		mPredicateBuffer(),
+		mConditionActive(false),
+		mConditionSkip(false),
+		mDefaultSampler(VK_NULL_HANDLE),
+		mShaderHandle(0),
+		mBufferHandle(0),
+		mLayoutHandle(0),
+		mVAOHandle(0),
+		mRenderTargetHandle(0),
+		mTextureHandle(0),
+		mSamplerHandle(0),
+		mQueryHandle(0)
 	{
+		mContext.stats = &mStats;
+		mContext.secondary = false;
+		mContext.asyncCompute = false;
+		mContext.boundComputePipeline = VK_NULL_HANDLE;
+		mContext.pipelineDirty = true;
+		mContext.vertexInputDirty = true;
+		mContext.descriptorsDirty = true;
+		for (uint32_t i = 0; i < MaxDescriptorSlots; ++i)
+		{
+			mContext.constantBuffers[i] = { InvalidHandle, VK_NULL_HANDLE, 0, 0 };
+			mContext.storageBuffers[i] = { InvalidHandle, VK_NULL_HANDLE, 0, 0 };
+			mContext.textures[i] = { InvalidHandle, InvalidHandle };
+		}
 	}
 
 	VulkanGraphicsDevice::~VulkanGraphicsDevice()
 	{
+		mRecordThreads.stop();
+
 		//wait for device to be idle
 		if (mDevice)
+		{
 			vkDeviceWaitIdle(mDevice);
+			mCompletedFrame = mFrameNumber;
+#ifdef _DEBUG
+			mMemory.printStats();
+#endif
+		}
+
+		//pipelines go first, they reference shaders and render passes
+		mPipelineCache.destroy();
 
 		//delete shaders
 		for (auto &shader : mShaders)
-		{
-			for(auto &module : shader.second.modules)
-				vkDestroyShaderModule(mDevice,module,mAllocCallback);
-		}
+			_destroyShader(shader.second);
 
 		mShaders.clear();
 
-		//destory semaphores
-		if (mImageAvailableSem)
-			vkDestroySemaphore(mDevice, mImageAvailableSem, mAllocCallback);
-		if (mRenderFinishedSem)
-			vkDestroySemaphore(mDevice, mRenderFinishedSem, mAllocCallback);
+		//delete render targets
+		for (auto &target : mRenderTargets)
+			_destroyRenderTarget(target.second);
 
-		//free command buffer
-		if (mCommandBuffers.size() > 0)
-		{
-			vkFreeCommandBuffers(mDevice, mCommandPool, static_cast<uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
-			mCommandBuffers.clear();
-		}
+		mRenderTargets.clear();
 
-		//free single command buffer
-		if (mSingleCmdBuffer)
-			vkFreeCommandBuffers(mDevice, mCommandPool, 1, &mSingleCmdBuffer);
+		for (auto &buffer : mBuffers)
+			_destroyBuffer(buffer.second);
+		mBuffers.clear();
+		_destroyBuffer(mPredicateBuffer);
 
-		// delete command pool
-		if(mCommandPool)
-			vkDestroyCommandPool(mDevice, mCommandPool, mAllocCallback);
+		//the device is idle, so every upload has finished
+		mUploader.destroy();
 
-		// destroy render pass
-		if (mRenderPass)
-			vkDestroyRenderPass(mDevice, mRenderPass, mAllocCallback);
+		for (auto &texture : mTextures)
+			_destroyImage(texture.second.image);
+		mTextures.clear();
 
-		//delete color image views from the framebuffer
-		for (auto &color : mSwapChainParams.colorImages)
-		{
-			if (color.view != VK_NULL_HANDLE)
-			{
-				vkDestroyImageView(mDevice, color.view, nullptr);
-				color.view = VK_NULL_HANDLE;
-			}
-		}
+		for (auto &sampler : mSamplers)
+			vkDestroySampler(mDevice, sampler.second, mAllocCallback);
+		mSamplers.clear();
+		if (mDefaultSampler)
+			vkDestroySampler(mDevice, mDefaultSampler, mAllocCallback);
 
-		mSwapChainParams.colorImages.clear();
+		for (auto &query : mQueries)
+			vkDestroyQueryPool(mDevice, query.second.pool, mAllocCallback);
+		mQueries.clear();
 
-		//delete depth/stencil imageview
-		if (mSwapChainParams.depthStencilImage.view)
-		{
-			vkDestroyImageView(mDevice, mSwapChainParams.depthStencilImage.view, nullptr);
-			mSwapChainParams.depthStencilImage.view = nullptr;
-		}
+		//destroy frames along with what was deleted during them
+		for (auto &frame : mFrames)
+			_destroyFrame(frame);
+		mFrames.clear();
 
-		//delete depth/stencil image
-		if (mSwapChainParams.depthStencilImage.image)
-		{
-			vkDestroyImage(mDevice, mSwapChainParams.depthStencilImage.image, nullptr);
-			mSwapChainParams.depthStencilImage.image = nullptr;
-		}
+		//no pipeline layout or descriptor set is left to use them
+		mDescriptorLayouts.destroy();
 
-		if (mSwapChainParams.swapChain)
-		{
-			vkDestroySwapchainKHR(mDevice, mSwapChainParams.swapChain, mAllocCallback);
-		}
+		// destroy render pass
+		if (mRenderPass)
+			vkDestroyRenderPass(mDevice, mRenderPass, mAllocCallback);
+		if (mLoadRenderPass)
+			vkDestroyRenderPass(mDevice, mLoadRenderPass, mAllocCallback);
 
-		//delete framebuffers
-		for (auto &fb : mSwapChainParams.frameBuffers)
-		{
-			vkDestroyFramebuffer(mDevice, fb, mAllocCallback);
-		}
+		_destroySwapchain(mSwapChainParams);
+
+		//every resource is gone, release the memory blocks
+		mMemory.destroy();
 
 		// destroy logical device
 		if (mDevice)
@@ -155,9 +212,15 @@ namespace Jikken
 			vkDestroyInstance(mInstance, mAllocCallback);
 	}
 
-	bool VulkanGraphicsDevice::init(void *glfwWinHandle)
+	bool VulkanGraphicsDevice::init(const DeviceConfig &config, void *glfwWinHandle)
 	{
-		if (!glfwVulkanSupported())
+		mConfig = config;
+
+		//without a window there is no surface or swapchain, and no need for glfw
+		if (mConfig.headless)
+			mPresentLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+		if (!mConfig.headless && !glfwVulkanSupported())
 		{
 			std::printf("Vulkan is not supported\n");
 			return false;
@@ -189,16 +252,19 @@ namespace Jikken
 		}
 
 		//get required extensions from glfw
-		uint32_t glfwExtCount = 0;
-		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtCount);
-		if (glfwExtCount == 0)
+		std::vector<const char*> requiredExtensions;
+		if (!mConfig.headless)
 		{
-			std::printf("Failed to find any required extensions\n");
-			return false;
+			uint32_t glfwExtCount = 0;
+			const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+			if (glfwExtCount == 0)
+			{
+				std::printf("Failed to find any required extensions\n");
+				return false;
+			}
+			requiredExtensions.assign(glfwExtensions, glfwExtensions + glfwExtCount);
 		}
 
-		std::vector<const char*> requiredExtensions(glfwExtensions, glfwExtensions + glfwExtCount);
-
 		if (validationLayersEnabled)
 			requiredExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 
@@ -294,11 +360,15 @@ namespace Jikken
 		}
 
 		//create window surface
-		result = glfwCreateWindowSurface(mInstance, static_cast<GLFWwindow*>(glfwWinHandle), mAllocCallback, &mSurface);
-		if (result != VK_SUCCESS)
+		if (!mConfig.headless)
 		{
-			std::printf("Failed to create vulkan window surface\n");
-			return false;
+			mWindow = static_cast<GLFWwindow*>(glfwWinHandle);
+			result = glfwCreateWindowSurface(mInstance, mWindow, mAllocCallback, &mSurface);
+			if (result != VK_SUCCESS)
+			{
+				std::printf("Failed to create vulkan window surface\n");
+				return false;
+			}
 		}
 
 		//find physical devices
@@ -343,6 +413,13 @@ namespace Jikken
 
 		VkPhysicalDeviceMemoryProperties memProperties;
 		vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &memProperties);
+		vkGetPhysicalDeviceProperties(mPhysicalDevice, &mDeviceProperties);
+
+		//optional features are enabled where the device has them
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(mPhysicalDevice, &supportedFeatures);
+		mEnabledFeatures = {};
+		mEnabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
 
 		//print some information about our physical device
 		vkutils::printDeviceInfo(mPhysicalDevice);
@@ -353,22 +430,51 @@ namespace Jikken
 		VkDeviceQueueCreateInfo queueCreateInfo = {};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueCreateInfo.flags = 0;
-		queueCreateInfo.queueFamilyIndex = mGraphicsQueueIndex;
 		queueCreateInfo.queueCount = 1;
 		queueCreateInfo.pQueuePriorities = &queuePriority;
-		queueCreateInfos.push_back(queueCreateInfo);
+
+		//one queue from each family in use, the families may coincide
+		mComputeQueueIndex = vkutils::findComputeQueue(mPhysicalDevice, mGraphicsQueueIndex);
+		mTransferQueueIndex = vkutils::findTransferQueue(mPhysicalDevice, mGraphicsQueueIndex);
+		for (const uint32_t family : { mGraphicsQueueIndex, mComputeQueueIndex, mTransferQueueIndex })
+		{
+			auto sameFamily = [family](const VkDeviceQueueCreateInfo &info) { return info.queueFamilyIndex == family; };
+			if (std::find_if(queueCreateInfos.begin(), queueCreateInfos.end(), sameFamily) != queueCreateInfos.end())
+				continue;
+			queueCreateInfo.queueFamilyIndex = family;
+			queueCreateInfos.push_back(queueCreateInfo);
+		}
+
+		//buffers compute shaders use are shared with a separate compute family rather than transferred between queues every frame
+		mSharedFamilies.clear();
+		if (mComputeQueueIndex != mGraphicsQueueIndex)
+		{
+			for (const auto &info : queueCreateInfos)
+				mSharedFamilies.push_back(info.queueFamilyIndex);
+		}
 
 		//need swap chain extension - this extension is already checked above with checkPhysicalDevice, no need to check again
-		std::vector<const char*> requiredDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		std::vector<const char*> requiredDeviceExtensions;
+		if (!mConfig.headless)
+			requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+		//conditional rendering is optional, without it draws are skipped on the cpu
+		uint32_t deviceExtensionsCount = 0;
+		vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &deviceExtensionsCount, nullptr);
+		std::vector<VkExtensionProperties> deviceExtensionList(deviceExtensionsCount);
+		if (deviceExtensionsCount > 0 && vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &deviceExtensionsCount, deviceExtensionList.data()) == VK_SUCCESS)
+			mConditionalRendering = vkutils::checkExtension(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME, deviceExtensionList);
+		if (mConditionalRendering)
+			requiredDeviceExtensions.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
 
 		VkDeviceCreateInfo deviceCreateInfo = {};
 		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		deviceCreateInfo.flags = 0;
 		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
 		deviceCreateInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
-		deviceCreateInfo.queueCreateInfoCount = 1;
 		deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 		deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+		deviceCreateInfo.pEnabledFeatures = &mEnabledFeatures;
 
 		deviceCreateInfo.enabledLayerCount = 0;
 		if (validationLayersEnabled)
@@ -387,47 +493,61 @@ namespace Jikken
 			return false;
 		}
 
-		//grab graphics queue handle
-		vkGetDeviceQueue(mDevice, mGraphicsQueueIndex, 0, &mGraphicsQueue);
-		//grab compute queue handle
-		vkGetDeviceQueue(mDevice, mComputeQueueIndex, 0, &mComputeQueue);
+		mMemory.init(mDevice, mPhysicalDevice, mDeviceProperties.limits, mAllocCallback);
 
-		if (!mGraphicsQueue || !mComputeQueue)
+		if (mConditionalRendering)
 		{
-			std::printf("Failed to retrieve graphics or compute queue\n");
-			return false;
+			mCmdBeginConditionalRendering = (PFN_vkCmdBeginConditionalRenderingEXT)vkGetDeviceProcAddr(mDevice, "vkCmdBeginConditionalRenderingEXT");
+			mCmdEndConditionalRendering = (PFN_vkCmdEndConditionalRenderingEXT)vkGetDeviceProcAddr(mDevice, "vkCmdEndConditionalRenderingEXT");
+			const VkBufferUsageFlags usage = VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			if (!mCmdBeginConditionalRendering || !mCmdEndConditionalRendering ||
+				!_createHostBuffer(mPredicateBuffer, sizeof(uint32_t), usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+			{
+				std::printf("VK_EXT_conditional_rendering is unusable, draws are skipped on the cpu instead\n");
+				_destroyBuffer(mPredicateBuffer);
+				mConditionalRendering = false;
+			}
 		}
 
-		//command pool
-		VkCommandPoolCreateInfo cmdPoolCreateInfo;
-		cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-		cmdPoolCreateInfo.pNext = nullptr;
-		cmdPoolCreateInfo.queueFamilyIndex = mGraphicsQueueIndex;
+		if (!mPipelineCache.init(mDevice, mDeviceProperties, mConfig.cacheDirectory, mAllocCallback))
+			return false;
 
-		result = vkCreateCommandPool(mDevice, &cmdPoolCreateInfo, mAllocCallback, &mCommandPool);
-		if (result != VK_SUCCESS)
+		mDescriptorLayouts.init(mDevice, mAllocCallback);
+
+		//textures bound without a sampler are filtered linearly, like an opengl texture with default parameters
+		VkSamplerCreateInfo samplerInfo = {};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		samplerInfo.maxAnisotropy = 1.0f;
+		if (vkCreateSampler(mDevice, &samplerInfo, mAllocCallback, &mDefaultSampler) != VK_SUCCESS)
 		{
-			std::printf("vkCreateCommandPool failed\n");
+			std::printf("vkCreateSampler failed for the default sampler\n");
 			return false;
 		}
 
-		//single command buffer - used to execute single commands
-		VkCommandBufferAllocateInfo cmdBufAllocInfo = {};		
-		cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		cmdBufAllocInfo.pNext = nullptr;
-		cmdBufAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		cmdBufAllocInfo.commandPool = mCommandPool;
-		cmdBufAllocInfo.commandBufferCount = 1;
-
-		result = vkAllocateCommandBuffers(mDevice, &cmdBufAllocInfo, &mSingleCmdBuffer);
+		//grab graphics queue handle
+		vkGetDeviceQueue(mDevice, mGraphicsQueueIndex, 0, &mGraphicsQueue);
+		//grab compute queue handle
+		vkGetDeviceQueue(mDevice, mComputeQueueIndex, 0, &mComputeQueue);
+		//grab transfer queue handle
+		vkGetDeviceQueue(mDevice, mTransferQueueIndex, 0, &mTransferQueue);
 
-		if (result != VK_SUCCESS)
+		if (!mGraphicsQueue || !mComputeQueue || !mTransferQueue)
 		{
-			std::printf("vkAllocateCommandBuffers failed\n");
+			std::printf("Failed to retrieve graphics, compute or transfer queue\n");
 			return false;
 		}
 
+		//uploads go through the transfer queue when they can
+		if (!mUploader.init(mDevice, mPhysicalDevice, &mMemory, mGraphicsQueue, mGraphicsQueueIndex, mTransferQueue, mTransferQueueIndex, StagingBufferSize, mAllocCallback))
+			return false;
+
 		//setup swapchain and framebuffers
 		if (!_createSwapchain())
 		{
@@ -449,63 +569,84 @@ namespace Jikken
 			return false;
 		}
 
-		//regular command buffers - one per swapchain color image
-		mCommandBuffers.resize(mSwapChainParams.colorImages.size());
-		cmdBufAllocInfo.commandBufferCount = static_cast<uint32_t>(mSwapChainParams.colorImages.size());
+		//each record thread gets command pools of its own
+		uint32_t recordThreads = mConfig.recordThreads;
+		if (recordThreads == 0)
+			recordThreads = std::thread::hardware_concurrency();
+		mRecordThreads.start(std::min(std::max(recordThreads, 1u), MaxRecordThreads));
 
-		result = vkAllocateCommandBuffers(mDevice, &cmdBufAllocInfo, mCommandBuffers.data());
-		if (result != VK_SUCCESS)
+		//command buffers and synchronization for each frame in flight
+		if (!_createFrames())
 		{
-			std::printf("vkAllocateCommandBuffers failed\n");
+			std::printf("Failed to create frames in flight\n");
 			return false;
 		}
 
-		//create semaphores
-		VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		semaphoreCreateInfo.pNext = nullptr;
-		//Image available sempahore
-		result = vkCreateSemaphore(mDevice, &semaphoreCreateInfo, mAllocCallback, &mImageAvailableSem);
-		if (result != VK_SUCCESS)
-		{
-			std::printf("vkCreateSemaphore failed\n");
-			return false;
-		}
-		//Rendering finished semaphore
-		result = vkCreateSemaphore(mDevice, &semaphoreCreateInfo, mAllocCallback, &mRenderFinishedSem);
-		if (result != VK_SUCCESS)
+		return true;
+	}
+
+	//orders a render pass after earlier attachment writes and transfers to its images, such as those of the previous frame
+	static VkSubpassDependency getExternalDependency()
+	{
+		VkSubpassDependency dependency = {};
+		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependency.dstSubpass = 0;
+		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		return dependency;
+	}
+
+	//grows the range of a buffer's current copy commands of the frame read or copy to, writes to it are then recorded in order with them
+	static inline void markBufferRead(VulkanBuffer &buffer, const VkDeviceSize begin, const VkDeviceSize end)
+	{
+		if (buffer.copies < 2)
+			return;
+		if (buffer.readBegin == buffer.readEnd)
 		{
-			std::printf("vkCreateSemaphore failed\n");
-			return false;
+			buffer.readBegin = begin;
+			buffer.readEnd = end;
+			return;
 		}
+		buffer.readBegin = std::min(buffer.readBegin, begin);
+		buffer.readEnd = std::max(buffer.readEnd, end);
+	}
 
+	bool VulkanGraphicsDevice::_createDefaultRenderPass()
+	{
+		//the first render pass of a frame clears, later ones keep what was drawn before a render target or transfer
+		if (!_createRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, mRenderPass))
+			return false;
 
-		return true;
+		return _createRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD, mPresentLayout, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, mLoadRenderPass);
 	}
 
-	bool VulkanGraphicsDevice::_createDefaultRenderPass()
+	bool VulkanGraphicsDevice::_createRenderPass(const VkAttachmentLoadOp loadOp, const VkImageLayout colorLayout, const VkImageLayout depthLayout, VkRenderPass &renderPass)
 	{
 		//render pass for default framebuffers
 		VkAttachmentDescription colorAttachment = {};
 		colorAttachment.flags = 0;
 		colorAttachment.format = mSwapChainParams.colorFormat;
 		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.loadOp = loadOp;
 		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.initialLayout = colorLayout;
+		colorAttachment.finalLayout = mPresentLayout;
 
+		//depth is stored so a later render pass of the frame can continue with it
 		VkAttachmentDescription depthAttachment = {};
 		depthAttachment.flags = 0;
 		depthAttachment.format = mSwapChainParams.depthStencilFormat;
 		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		depthAttachment.loadOp = loadOp;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depthAttachment.stencilLoadOp = loadOp;
+		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depthAttachment.initialLayout = depthLayout;
 		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 		VkAttachmentReference colorAttachmentRef = {};
@@ -523,13 +664,7 @@ namespace Jikken
 		subpass.pColorAttachments = &colorAttachmentRef;
 		subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-		VkSubpassDependency dependency = {};
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.dstSubpass = 0;
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.srcAccessMask = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		VkSubpassDependency dependency = getExternalDependency();
 
 		std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
 		VkRenderPassCreateInfo renderPassInfo = {};
@@ -541,7 +676,7 @@ namespace Jikken
 		renderPassInfo.dependencyCount = 1;
 		renderPassInfo.pDependencies = &dependency;
 
-		VkResult result = vkCreateRenderPass(mDevice, &renderPassInfo, mAllocCallback, &mRenderPass);
+		VkResult result = vkCreateRenderPass(mDevice, &renderPassInfo, mAllocCallback, &renderPass);
 		if (result != VK_SUCCESS)
 		{
 			std::printf("vkCreateRenderPass failed\n");
@@ -591,34 +726,77 @@ namespace Jikken
 		return true;
 	}
 
-	bool VulkanGraphicsDevice::_createSwapchain()
+	//frames in flight may still render to the old images, they are destroyed with the frame being recorded instead of idling the device
+	bool VulkanGraphicsDevice::_recreateSwapchain()
 	{
-		//delete color image views from the framebuffer
-		for (auto &color : mSwapChainParams.colorImages)
+		//a minimized window has nothing to present to, the old swapchain stays until it has a size again
+		int width = 0;
+		int height = 0;
+		glfwGetFramebufferSize(mWindow, &width, &height);
+		if (width == 0 || height == 0)
 		{
-			if (color.view != VK_NULL_HANDLE)
-			{
-				vkDestroyImageView(mDevice, color.view, nullptr);
-				color.view = VK_NULL_HANDLE;
-			}
+			mSwapChainDirty = true;
+			return false;
 		}
 
+		if (mSwapChainParams.swapChain != VK_NULL_HANDLE)
+			mFrames[mFrameIndex].retiredSwapChains.push_back(mSwapChainParams);
 		mSwapChainParams.colorImages.clear();
+		mSwapChainParams.depthStencilImage = ImageParams();
+		mSwapChainParams.frameBuffers.clear();
+
+		//the render passes stay, the surface format doesn't change with the window
+		mSwapChainDirty = !_createSwapchain() || !_createFramebuffers();
+		return !mSwapChainDirty;
+	}
+
+	void VulkanGraphicsDevice::_destroySwapchain(SwapChainParams &swapChain)
+	{
+		for (auto &fb : swapChain.frameBuffers)
+			vkDestroyFramebuffer(mDevice, fb, mAllocCallback);
 
-		//delete depth/stencil imageview
-		if (mSwapChainParams.depthStencilImage.view)
+		//the swapchain owns its color images, only the views are ours, a headless device owns its image
+		for (auto &color : swapChain.colorImages)
 		{
-			vkDestroyImageView(mDevice, mSwapChainParams.depthStencilImage.view, nullptr);
-			mSwapChainParams.depthStencilImage.view = nullptr;
+			if (mConfig.headless)
+				_destroyImage(color);
+			else if (color.view != VK_NULL_HANDLE)
+				vkDestroyImageView(mDevice, color.view, mAllocCallback);
 		}
+		_destroyImage(swapChain.depthStencilImage);
 
-		//delete depth/stencil image
-		if (mSwapChainParams.depthStencilImage.image)
+		if (swapChain.swapChain)
+			vkDestroySwapchainKHR(mDevice, swapChain.swapChain, mAllocCallback);
+		swapChain = SwapChainParams();
+	}
+
+	//mSwapChainParams holds no images or framebuffers, its swapchain handle is only passed on as the old one
+	bool VulkanGraphicsDevice::_createSwapchain()
+	{
+		//headless devices render into a color image of their own, which is never presented
+		if (mConfig.headless)
 		{
-			vkDestroyImage(mDevice, mSwapChainParams.depthStencilImage.image, nullptr);
-			mSwapChainParams.depthStencilImage.image = nullptr;
+			mSwapChainParams.colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+			mSwapChainParams.depthStencilFormat = VK_FORMAT_D24_UNORM_S8_UINT;
+			mSwapChainParams.extent = { std::max(mConfig.headlessWidth, 1u), std::max(mConfig.headlessHeight, 1u) };
+			mSwapChainParams.colorImages.resize(1);
+			mSwapChainParams.currentImageIndex = 0;
+
+			ImageParams &color = mSwapChainParams.colorImages[0];
+			color.format = mSwapChainParams.colorFormat;
+			const VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			if (!_createImage(color, mSwapChainParams.extent, VK_SAMPLE_COUNT_1_BIT, usage, VK_IMAGE_ASPECT_COLOR_BIT))
+				return false;
+
+			//a presented image would be acquired in this layout, so frames that load it find it the same way
+			VkCommandBuffer cmdBuffer = mUploader.getGraphicsCmdBuffer();
+			vkutils::setImageLayout(cmdBuffer, color.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, mPresentLayout);
+			return _createDepthStencil();
 		}
 
+		VkSwapchainKHR oldSwapChain = mSwapChainParams.swapChain;
+		mSwapChainParams.swapChain = VK_NULL_HANDLE;
+
 		VkSurfaceCapabilitiesKHR surfaceCaps;
 		VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(mPhysicalDevice, mSurface, &surfaceCaps);
 		if (result != VK_SUCCESS)
@@ -659,12 +837,19 @@ namespace Jikken
 			return false;
 		}
 
-		uint32_t swapImageCount = vkutils::getSwapChainNumImages(surfaceCaps);
+		int windowWidth = 0;
+		int windowHeight = 0;
+		glfwGetFramebufferSize(mWindow, &windowWidth, &windowHeight);
+		const VkExtent2D windowExtent = { static_cast<uint32_t>(windowWidth), static_cast<uint32_t>(windowHeight) };
+
+		uint32_t swapImageCount = vkutils::getSwapChainNumImages(surfaceCaps, mConfig.swapchainImages);
 		VkSurfaceFormatKHR desiredFormat = vkutils::getSwapChainFormat(surfaceFormats);
 		VkImageUsageFlags desiredUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		//render targets are resolved into the swapchain image with transfers
+		if (surfaceCaps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+			desiredUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		VkSurfaceTransformFlagBitsKHR desiredTransform = vkutils::getSwapChainTransform(surfaceCaps);
-		VkPresentModeKHR desiredPresentMode = vkutils::getSwapChainPresentMode(presentModes);
-		VkSwapchainKHR oldSwapChain = mSwapChainParams.swapChain;
+		VkPresentModeKHR desiredPresentMode = vkutils::getSwapChainPresentMode(presentModes, mConfig.presentMode);
 
 		if (static_cast<int32_t>(desiredUsage) == -1)
 			return false;
@@ -672,6 +857,11 @@ namespace Jikken
 		if (static_cast<int32_t>(desiredPresentMode) == -1)
 			return false;
 
+		//a minimized window has nothing to present to
+		const VkExtent2D extent = vkutils::chooseSwapExtent(surfaceCaps, windowExtent);
+		if (extent.width == 0 || extent.height == 0)
+			return false;
+
 		//swapchain create info
 		VkSwapchainCreateInfoKHR createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -681,7 +871,7 @@ namespace Jikken
 		createInfo.minImageCount = swapImageCount;
 		createInfo.imageFormat = desiredFormat.format;
 		createInfo.imageColorSpace = desiredFormat.colorSpace;
-		createInfo.imageExtent = vkutils::chooseSwapExtent(surfaceCaps);
+		createInfo.imageExtent = extent;
 		createInfo.imageArrayLayers = 1;
 		createInfo.imageUsage = desiredUsage;
 		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -693,16 +883,15 @@ namespace Jikken
 		createInfo.clipped = VK_TRUE;
 		createInfo.oldSwapchain = oldSwapChain;
 
+		//the old swapchain is retired either way, whoever owns it destroys it
 		result = vkCreateSwapchainKHR(mDevice, &createInfo, mAllocCallback, &mSwapChainParams.swapChain);
 		if (result != VK_SUCCESS)
 		{
+			mSwapChainParams.swapChain = VK_NULL_HANDLE;
 			std::printf("vkCreateSwapchainKHR failed\n");
 			return false;
 		}
 
-		if (oldSwapChain != VK_NULL_HANDLE)
-			vkDestroySwapchainKHR(mDevice, mSwapChainParams.swapChain, mAllocCallback);
-
 		mSwapChainParams.colorFormat = desiredFormat.format;
 		mSwapChainParams.depthStencilFormat = VK_FORMAT_D24_UNORM_S8_UINT;//todo format passed in from client
 		mSwapChainParams.extent = createInfo.imageExtent;
@@ -751,6 +940,14 @@ namespace Jikken
 			}
 		}
 
+		return _createDepthStencil();
+	}
+
+	//the depth/stencil image of the default framebuffer, sized like its color images
+	bool VulkanGraphicsDevice::_createDepthStencil()
+	{
+		VkComponentMapping mapping = { VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY };
+
 		//depth/stencil - only a single one
 		VkImageCreateInfo imageCreateInfo = {};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -772,7 +969,7 @@ namespace Jikken
 		imageCreateInfo.pQueueFamilyIndices = nullptr;
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
 
-		result = vkCreateImage(mDevice, &imageCreateInfo, mAllocCallback, &mSwapChainParams.depthStencilImage.image);
+		VkResult result = vkCreateImage(mDevice, &imageCreateInfo, mAllocCallback, &mSwapChainParams.depthStencilImage.image);
 
 		if (result != VK_SUCCESS)
 		{
@@ -790,21 +987,14 @@ namespace Jikken
 			return false;
 		}
 
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memReq.size;
-		allocInfo.memoryTypeIndex = memType;
-		allocInfo.pNext = nullptr;
-
-		result = vkAllocateMemory(mDevice, &allocInfo, mAllocCallback, &mSwapChainParams.depthStencilImage.memory);
-
-		if (result != VK_SUCCESS)
+		VulkanAllocation &depthAllocation = mSwapChainParams.depthStencilImage.allocation;
+		if (!mMemory.allocate(memReq, memType, false, depthAllocation))
 		{
-			std::printf("vkAllocateMemory failed for depth/stencil creation\n");
+			std::printf("Failed to allocate memory for depth/stencil creation\n");
 			return false;
 		}
 
-		result = vkBindImageMemory(mDevice, mSwapChainParams.depthStencilImage.image, mSwapChainParams.depthStencilImage.memory, 0);
+		result = vkBindImageMemory(mDevice, mSwapChainParams.depthStencilImage.image, depthAllocation.memory, depthAllocation.offset);
 
 		if (result != VK_SUCCESS)
 		{
@@ -841,6 +1031,7 @@ namespace Jikken
 		mViewPortParams.viewport.maxDepth = 1.0f;
 		mViewPortParams.scissor.offset = { 0, 0 };
 		mViewPortParams.scissor.extent = mSwapChainParams.extent;
+		mContext.viewport = mViewPortParams.viewport;
 
 		//Store present info struct, only thing that changes is the pImageIndices per frame but that is stored as a pointer so it gets the new value as it changes
 		mPresentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -848,13 +1039,13 @@ namespace Jikken
 		mPresentInfo.swapchainCount = 1;
 		mPresentInfo.pSwapchains = &mSwapChainParams.swapChain;
 		mPresentInfo.waitSemaphoreCount = 1;
-		mPresentInfo.pWaitSemaphores = &mRenderFinishedSem;
+		mPresentInfo.pWaitSemaphores = nullptr; //the semaphore of the frame being presented
 		mPresentInfo.pResults = nullptr;
 
 		return true;
 	}
 
-	ShaderHandle VulkanGraphicsDevice::createShader(const std::vector<ShaderDetails> &shaders)
+	ShaderHandle VulkanGraphicsDevice::createShader(const std::vector<ShaderDetails> &shaders, bool async)
 	{
 		//check if this will put us over the maximum number of shader handles
 		if ((mShaderHandle + 1) == InvalidHandle)
@@ -864,6 +1055,10 @@ namespace Jikken
 		}
 
 		VulkanShader shader;
+		shader.pipelineLayout = VK_NULL_HANDLE;
+		shader.pushConstantStages = 0;
+		shader.pushConstantSize = 0;
+		shader.computePipeline = VK_NULL_HANDLE;
 
 		for (const ShaderDetails &details : shaders)
 		{
@@ -879,7 +1074,7 @@ namespace Jikken
 			buffer << stream.rdbuf();
 
 			std::vector<uint32_t> spirvData;
-			if (!ShaderUtils::convertGlslToSpirv(details.stage, buffer.str(), spirvData))
+			if (!ShaderUtils::convertGlslToSpirv(details.stage, buffer.str(), spirvData, true))
 			{
 				std::printf("Unable to open convert %s to spirv format! Aborting!", details.file.c_str());
 				return InvalidHandle;
@@ -910,186 +1105,2992 @@ namespace Jikken
 			piplineStage.stage = vkutils::getShaderStageFlag(details.stage);
 
 			shader.stages.push_back(piplineStage);
+
+			//stages that declare the same set and binding share the descriptor
+			std::vector<ShaderUtils::ShaderResource> resources;
+			if (!ShaderUtils::reflectSpirv(spirvData, resources))
+			{
+				std::printf("Unable to reflect the resources of %s! Aborting!", details.file.c_str());
+				for (auto &stageModule : shader.modules)
+					vkDestroyShaderModule(mDevice, stageModule, mAllocCallback);
+				return InvalidHandle;
+			}
+			for (const auto &resource : resources)
+			{
+				//every stage sees the same push constant block
+				if (resource.type == ShaderUtils::ShaderResourceType::ePushConstants)
+				{
+					shader.pushConstantStages |= piplineStage.stage;
+					shader.pushConstantSize = std::max(shader.pushConstantSize, resource.size);
+					continue;
+				}
+
+				auto sameBinding = [&resource](const VulkanShaderResource &other)
+				{
+					return other.details.set == resource.set && other.details.binding == resource.binding;
+				};
+				auto it = std::find_if(shader.resources.begin(), shader.resources.end(), sameBinding);
+				if (it != shader.resources.end())
+				{
+					it->stages |= piplineStage.stage;
+					continue;
+				}
+				shader.resources.push_back({ resource, static_cast<VkShaderStageFlags>(piplineStage.stage), resource.binding });
+			}
 		}
 
-		ShaderHandle handle = mShaderHandle++;
-		mShaders[handle] = { shader };
-		return handle;
-	}
+		//dynamic offsets are passed in set and binding order
+		std::sort(shader.resources.begin(), shader.resources.end(), [](const VulkanShaderResource &a, const VulkanShaderResource &b)
+		{
+			return a.details.set != b.details.set ? a.details.set < b.details.set : a.details.binding < b.details.binding;
+		});
 
-	BufferHandle VulkanGraphicsDevice::createBuffer(BufferType type, BufferUsageHint hint, size_t dataSize, float *data)
-	{
-		return InvalidHandle;
-	}
+		//one set layout per set number, gaps get empty layouts
+		std::vector<std::vector<VkDescriptorSetLayoutBinding>> setBindings;
+		uint32_t dynamicCount = 0;
+		for (const auto &resource : shader.resources)
+		{
+			VkDescriptorSetLayoutBinding binding = {};
+			binding.binding = resource.details.binding;
+			binding.descriptorCount = resource.details.count;
+			binding.stageFlags = resource.stages;
+			switch (resource.details.type)
+			{
+			case ShaderUtils::ShaderResourceType::eConstantBuffer:
+				binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+				dynamicCount += resource.details.count;
+				break;
+			case ShaderUtils::ShaderResourceType::eStorageBuffer:
+				binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				break;
+			case ShaderUtils::ShaderResourceType::eTexture:
+				binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				break;
+			default:
+				//nothing binds images for writing yet
+				std::printf("Storage image %s is not supported\n", resource.details.name.c_str());
+				for (auto &module : shader.modules)
+					vkDestroyShaderModule(mDevice, module, mAllocCallback);
+				return InvalidHandle;
+			}
 
-	LayoutHandle VulkanGraphicsDevice::createVertexInputLayout(const std::vector<VertexInputLayout> &attributes)
-	{
-		return InvalidHandle;
-	}
+			if (resource.details.set >= setBindings.size())
+				setBindings.resize(resource.details.set + 1);
+			setBindings[resource.details.set].push_back(binding);
+		}
 
-	VertexArrayHandle VulkanGraphicsDevice::createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer)
-	{
-		return InvalidHandle;
-	}
+		const uint32_t maxDynamic = std::min(MaxDynamicOffsets, mDeviceProperties.limits.maxDescriptorSetUniformBuffersDynamic);
+		if (setBindings.size() > MaxDescriptorSets || dynamicCount > maxDynamic || shader.pushConstantSize > mDeviceProperties.limits.maxPushConstantsSize)
+		{
+			std::printf("Shader uses more descriptor sets, constant buffers or push constants than supported\n");
+			for (auto &module : shader.modules)
+				vkDestroyShaderModule(mDevice, module, mAllocCallback);
+			return InvalidHandle;
+		}
 
-	void VulkanGraphicsDevice::bindConstantBuffer(ShaderHandle shader, BufferHandle cBuffer, const char *name, int32_t index)
-	{
-	}
+		for (const auto &bindings : setBindings)
+		{
+			VkDescriptorSetLayout setLayout = mDescriptorLayouts.get(bindings);
+			if (setLayout == VK_NULL_HANDLE)
+			{
+				for (auto &module : shader.modules)
+					vkDestroyShaderModule(mDevice, module, mAllocCallback);
+				return InvalidHandle;
+			}
+			shader.setLayouts.push_back(setLayout);
+		}
 
-	void VulkanGraphicsDevice::deleteVertexInputLayout(LayoutHandle handle)
-	{
-	}
+		VkPipelineLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.setLayoutCount = static_cast<uint32_t>(shader.setLayouts.size());
+		layoutInfo.pSetLayouts = shader.setLayouts.data();
+		VkPushConstantRange pushConstantRange = { shader.pushConstantStages, 0, shader.pushConstantSize };
+		if (shader.pushConstantStages != 0)
+		{
+			layoutInfo.pushConstantRangeCount = 1;
+			layoutInfo.pPushConstantRanges = &pushConstantRange;
+		}
+		VkResult result = vkCreatePipelineLayout(mDevice, &layoutInfo, mAllocCallback, &shader.pipelineLayout);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreatePipelineLayout failed\n");
+			for (auto &module : shader.modules)
+				vkDestroyShaderModule(mDevice, module, mAllocCallback);
+			return InvalidHandle;
+		}
 
-	void VulkanGraphicsDevice::deleteVAO(VertexArrayHandle handle)
-	{
-	}
+		//a compute pipeline depends on nothing but the shader, so unlike graphics ones it is created right away
+		if (shader.stages.size() == 1 && shader.stages[0].stage == VK_SHADER_STAGE_COMPUTE_BIT)
+		{
+			VkComputePipelineCreateInfo pipelineInfo = {};
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			pipelineInfo.stage = shader.stages[0];
+			pipelineInfo.layout = shader.pipelineLayout;
+			result = vkCreateComputePipelines(mDevice, mPipelineCache.getCache(), 1, &pipelineInfo, mAllocCallback, &shader.computePipeline);
+			if (result != VK_SUCCESS)
+			{
+				std::printf("vkCreateComputePipelines failed\n");
+				vkDestroyPipelineLayout(mDevice, shader.pipelineLayout, mAllocCallback);
+				for (auto &module : shader.modules)
+					vkDestroyShaderModule(mDevice, module, mAllocCallback);
+				return InvalidHandle;
+			}
+		}
 
-	void VulkanGraphicsDevice::deleteBuffer(BufferHandle handle)
-	{
+		ShaderHandle handle = mShaderHandle++;
+		mShaders[handle] = { shader };
+		return handle;
 	}
 
-	void VulkanGraphicsDevice::deleteShader(ShaderHandle handle)
+	//shader modules are created synchronously, so there is nothing to wait on
+	ShaderStatus VulkanGraphicsDevice::getShaderStatus(ShaderHandle handle)
 	{
+		return mShaders.count(handle) ? ShaderStatus::eReady : ShaderStatus::eFailed;
 	}
-	
-	void VulkanGraphicsDevice::presentFrame()
+
+	BufferHandle VulkanGraphicsDevice::createBuffer(BufferType type, BufferUsageHint hint, size_t dataSize, float *data)
 	{
-		vkQueueWaitIdle(mGraphicsQueue);
-		VkResult result = vkQueuePresentKHR(mGraphicsQueue, &mPresentInfo);
+		if ((mBufferHandle + 1) == InvalidHandle)
+		{
+			std::printf("Too many buffer handles");
+			return InvalidHandle;
+		}
 
-		switch (result)
+		VulkanBuffer buffer = {};
+		buffer.type = type;
+		buffer.hint = hint;
+		buffer.copies = _getBufferCopies(type, hint);
+		if (!_createBuffer(buffer, dataSize, data))
 		{
-		case VK_SUCCESS:
-			break;
-		case VK_ERROR_OUT_OF_DATE_KHR:
-		case VK_SUBOPTIMAL_KHR:
-			break; //TODO: handle re-creating swapchain,mostly likely unhandled window resize
-		default:
-			std::printf("Problem occurred during image presentation\n");
-			break;
+			_destroyBuffer(buffer);
+			return InvalidHandle;
 		}
+
+		BufferHandle handle = mBufferHandle++;
+		mBuffers[handle] = buffer;
+		return handle;
 	}
 
-	//Commands
-	void VulkanGraphicsDevice::_setShaderCmd(SetShaderCommand *cmd)
+	//the gpu may read a copy until the frame that moved away from it has rendered, which is framesInFlight frames later,
+	//storage buffers are also written by the gpu and stay in place
+	uint32_t VulkanGraphicsDevice::_getBufferCopies(const BufferType type, const BufferUsageHint hint) const
 	{
+		if (hint == BufferUsageHint::eStaticDraw || type == BufferType::eStorageBuffer)
+			return 1;
+		return static_cast<uint32_t>(mFrames.size()) + 1;
 	}
 
-	void VulkanGraphicsDevice::_beginFrameCmd(BeginFrameCommand *cmd)
+	bool VulkanGraphicsDevice::_createBuffer(VulkanBuffer &buffer, VkDeviceSize size, const void *data)
 	{
-		VkClearValue clearValue[2];
-		bool clearDepthStencil = false;
-		if (cmd->clearFlag & ClearBufferFlags::eColor)
+		//vulkan buffers can't be empty
+		buffer.size = size > 0 ? size : 4;
+
+		//copies start where dynamic uniform offsets and index buffers may
+		const VkDeviceSize alignment = std::max(mDeviceProperties.limits.minUniformBufferOffsetAlignment, static_cast<VkDeviceSize>(4));
+		buffer.copies = std::max(buffer.copies, 1u);
+		buffer.copy = 0;
+		buffer.stride = (buffer.size + alignment - 1) / alignment * alignment;
+		buffer.copyFrame = mFrameNumber + 1;
+		buffer.contents.clear();
+		if (buffer.copies > 1)
+			buffer.contents.resize(static_cast<size_t>(buffer.size), 0);
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = buffer.copies > 1 ? buffer.stride * buffer.copies : buffer.size;
+		bufferInfo.usage = vkutils::getBufferUsage(buffer.type);
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		//async compute only reads constant and storage buffers
+		buffer.concurrent = !mSharedFamilies.empty() && (buffer.type == BufferType::eConstantBuffer || buffer.type == BufferType::eStorageBuffer);
+		if (buffer.concurrent)
 		{
-			clearValue[0].color = { {cmd->clearColor[0], cmd->clearColor[1], cmd->clearColor[2], cmd->clearColor[3]} };
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(mSharedFamilies.size());
+			bufferInfo.pQueueFamilyIndices = mSharedFamilies.data();
 		}
 
-		if (cmd->clearFlag & ClearBufferFlags::eDepth)
+		VkResult result = vkCreateBuffer(mDevice, &bufferInfo, mAllocCallback, &buffer.buffer);
+		if (result != VK_SUCCESS)
 		{
-			clearValue[1].depthStencil.depth = cmd->depth;
-			//we give stencil a default value of 0
-			clearValue[1].depthStencil.stencil = 0;
-			clearDepthStencil = true;
+			std::printf("vkCreateBuffer failed\n");
+			return false;
 		}
 
-		if (cmd->clearFlag & ClearBufferFlags::eStencil)
+		VkMemoryRequirements memReq;
+		vkGetBufferMemoryRequirements(mDevice, buffer.buffer, &memReq);
+
+		//static buffers live in device local memory and are filled through the staging buffer,
+		//the others are written in place, preferably in the part of device memory the host can see
+		uint32_t memType;
+		if (buffer.hint == BufferUsageHint::eStaticDraw)
+		{
+			memType = vkutils::findMemoryType(mPhysicalDevice, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
+		else
 		{
-			//give depth a default value
-			if (!clearDepthStencil)
-				clearValue[1].depthStencil.depth = 1.0f;
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			memType = vkutils::findMemoryType(mPhysicalDevice, memReq.memoryTypeBits, hostVisible | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (memType == UINT32_MAX)
+				memType = vkutils::findMemoryType(mPhysicalDevice, memReq.memoryTypeBits, hostVisible);
+		}
 
-			clearValue[1].depthStencil.stencil = cmd->stencil;
-			clearDepthStencil = true;
+		if (memType == UINT32_MAX)
+		{
+			std::printf("Could not find valid memory type for buffer\n");
+			return false;
 		}
 
-		//get the next image in the swap chain
-		//todo check result for VK_ERROR_OUT_OF_DATE_KHR and if found we need to rebuild the swapchain as it will be out of date (possibly a window resize missed)
-		VkResult result = vkAcquireNextImageKHR(mDevice, mSwapChainParams.swapChain, UINT64_MAX, mImageAvailableSem, VK_NULL_HANDLE, &mSwapChainParams.currentImageIndex);
+		if (!mMemory.allocate(memReq, memType, true, buffer.allocation))
+		{
+			std::printf("Failed to allocate memory for buffer\n");
+			return false;
+		}
 
-		//set image index for present info
-		mPresentInfo.pImageIndices = &mSwapChainParams.currentImageIndex;
+		result = vkBindBufferMemory(mDevice, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkBindBufferMemory failed for buffer\n");
+			return false;
+		}
 
-		VkCommandBuffer cmdBuffer = mCommandBuffers[mSwapChainParams.currentImageIndex];
+		if (data != nullptr && size > 0)
+			return _writeBuffer(buffer, 0, size, data, true);
+		return true;
+	}
 
-		VkRenderPassBeginInfo renderPassBeginInfo = {};
-		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassBeginInfo.pNext = nullptr;
-		renderPassBeginInfo.renderPass = mRenderPass;
-		renderPassBeginInfo.renderArea.offset.x = 0;
-		renderPassBeginInfo.renderArea.offset.y = 0;
-		renderPassBeginInfo.renderArea.extent.width = mSwapChainParams.extent.width;
-		renderPassBeginInfo.renderArea.extent.height = mSwapChainParams.extent.height;
-		renderPassBeginInfo.clearValueCount = clearDepthStencil ? 2 : 1;
-		renderPassBeginInfo.pClearValues = clearValue;
-		renderPassBeginInfo.framebuffer = mSwapChainParams.frameBuffers[mSwapChainParams.currentImageIndex];
+	//coherent memory spares flushing and invalidating it, preferred is only used if a memory type has it
+	bool VulkanGraphicsDevice::_createHostBuffer(VulkanBuffer &buffer, VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags preferred)
+	{
+		buffer.size = size;
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(mDevice, &bufferInfo, mAllocCallback, &buffer.buffer) != VK_SUCCESS)
+			return false;
 
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VkMemoryRequirements memReq;
+		vkGetBufferMemoryRequirements(mDevice, buffer.buffer, &memReq);
+		const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		uint32_t memType = vkutils::findMemoryType(mPhysicalDevice, memReq.memoryTypeBits, hostVisible | preferred);
+		if (memType == UINT32_MAX)
+			memType = vkutils::findMemoryType(mPhysicalDevice, memReq.memoryTypeBits, hostVisible);
+		if (memType == UINT32_MAX || !mMemory.allocate(memReq, memType, true, buffer.allocation) || buffer.allocation.mapped == nullptr)
+			return false;
+		return vkBindBufferMemory(mDevice, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset) == VK_SUCCESS;
+	}
+
+	//the data stays until the frame has rendered, alignment covers buffer to image copies of any texel size
+	bool VulkanGraphicsDevice::_stageFrameData(const void *data, VkDeviceSize size, VkBuffer &source, VkDeviceSize &sourceOffset)
+	{
+		VulkanConstantRing &ring = mFrames[mFrameIndex].uploadRing;
+		const VkDeviceSize alignment = 16;
+		VkDeviceSize used = (ring.used + alignment - 1) / alignment * alignment;
+		while (ring.block < ring.blocks.size() && used + size > ring.blocks[ring.block].size)
+		{
+			++ring.block;
+			used = 0;
+		}
+		if (ring.block == ring.blocks.size())
+		{
+			VulkanBuffer block = {};
+			if (!_createHostBuffer(block, std::max(size, UploadRingBlockSize), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 0))
+			{
+				std::printf("Failed to create a block of the upload ring\n");
+				_destroyBuffer(block);
+				return false;
+			}
+			ring.blocks.push_back(block);
+		}
+
+		const VulkanBuffer &block = ring.blocks[ring.block];
+		memcpy(block.allocation.mapped + used, data, static_cast<size_t>(size));
+		source = block.buffer;
+		sourceOffset = used;
+		ring.used = used + size;
+		return true;
+	}
+
+	//copies recorded mid-frame run in order with the draws around them, which happen in a render pass
+	void VulkanGraphicsDevice::_recordBufferCopy(VkBuffer source, VkDeviceSize sourceOffset, VkBuffer dest, VkDeviceSize destOffset, VkDeviceSize size)
+	{
+		_endRenderPass();
+
+		//earlier commands finish reading before the copy overwrites the range
+		vkCmdPipelineBarrier(mContext.cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy region = {};
+		region.srcOffset = sourceOffset;
+		region.dstOffset = destOffset;
+		region.size = size;
+		vkCmdCopyBuffer(mContext.cmdBuffer, source, dest, 1, &region);
+
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = dest;
+		barrier.offset = destOffset;
+		barrier.size = size;
+		vkCmdPipelineBarrier(mContext.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	void VulkanGraphicsDevice::_destroyBuffer(VulkanBuffer &buffer)
+	{
+		if (buffer.buffer)
+			vkDestroyBuffer(mDevice, buffer.buffer, mAllocCallback);
+		buffer.buffer = VK_NULL_HANDLE;
+		mMemory.free(buffer.allocation);
+	}
+
+	bool VulkanGraphicsDevice::_writeBuffer(VulkanBuffer &buffer, VkDeviceSize offset, VkDeviceSize size, const void *data, const bool newBuffer)
+	{
+		if (offset + size > buffer.size)
+		{
+			std::printf("Buffer write of %llu bytes at offset %llu is out of range\n", static_cast<unsigned long long>(size), static_cast<unsigned long long>(offset));
+			return false;
+		}
+
+		++_context().stats->uploadCalls;
+
+		//nothing reads a new buffer yet
+		if (buffer.allocation.mapped != nullptr && newBuffer)
+		{
+			memcpy(buffer.allocation.mapped + offset, data, static_cast<size_t>(size));
+			if (!buffer.contents.empty())
+				memcpy(buffer.contents.data() + offset, data, static_cast<size_t>(size));
+			return true;
+		}
+
+		//the first write of a frame moves to the next copy, later ones of the frame write it in place,
+		//record threads can't move a buffer others may be binding and take the staged path instead
+		const VkDeviceSize copyOffset = buffer.copy * buffer.stride;
+		if (buffer.copies > 1 && buffer.allocation.mapped != nullptr && tRecordContext == nullptr)
+		{
+			if (buffer.copyFrame != mFrameNumber + 1)
+			{
+				buffer.copy = (buffer.copy + 1) % buffer.copies;
+				buffer.copyFrame = mFrameNumber + 1;
+				buffer.readBegin = 0;
+				buffer.readEnd = 0;
+				if (offset > 0 || size < buffer.size)
+					memcpy(buffer.allocation.mapped + buffer.copy * buffer.stride, buffer.contents.data(), buffer.contents.size());
+				mContext.vertexInputDirty = true;
+				mContext.offsetsDirty = true;
+			}
+			memcpy(buffer.contents.data() + offset, data, static_cast<size_t>(size));
+
+			//a range draws of the frame read is overwritten in order with them
+			const bool read = mUntrackedReads || (offset < buffer.readEnd && offset + size > buffer.readBegin);
+			if (!read || !mFrameActive)
+			{
+				memcpy(buffer.allocation.mapped + buffer.copy * buffer.stride + offset, data, static_cast<size_t>(size));
+				return true;
+			}
+
+			VkBuffer source;
+			VkDeviceSize sourceOffset;
+			if (!_stageFrameData(data, size, source, sourceOffset))
+				return false;
+			_recordBufferCopy(source, sourceOffset, buffer.buffer, buffer.copy * buffer.stride + offset, size);
+			markBufferRead(buffer, offset, offset + size);
+			return true;
+		}
+
+		if (!buffer.contents.empty())
+			memcpy(buffer.contents.data() + offset, data, static_cast<size_t>(size));
+
+		//the frame's draws recorded before an update read the old data, like they would with opengl
+		if (mFrameActive && tRecordContext == nullptr && !newBuffer)
+		{
+			VkBuffer source;
+			VkDeviceSize sourceOffset;
+			if (!_stageFrameData(data, size, source, sourceOffset))
+				return false;
+			_recordBufferCopy(source, sourceOffset, buffer.buffer, copyOffset + offset, size);
+			return true;
+		}
+
+		//updates between frames and from record threads, which share the uploader, are made ahead of the next frame
+		std::lock_guard<std::mutex> lock(mUploadMutex);
+		size_t stagingOffset;
+		if (!mUploader.stage(data, static_cast<size_t>(size), stagingOffset))
+			return false;
+
+		//nothing reads a new buffer yet, so it can be filled alongside rendering
+		if (newBuffer)
+		{
+			mUploader.copyToNewBuffer(buffer.buffer, offset, size, stagingOffset, buffer.concurrent);
+			return true;
+		}
+
+		VkCommandBuffer cmdBuffer = mUploader.getGraphicsCmdBuffer();
+		VkBufferCopy region = {};
+		region.srcOffset = stagingOffset;
+		region.dstOffset = copyOffset + offset;
+		region.size = size;
+		vkCmdCopyBuffer(cmdBuffer, mUploader.getStagingBuffer(), buffer.buffer, 1, &region);
+
+		//make the copy visible to whatever reads the buffer next
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer.buffer;
+		barrier.offset = region.dstOffset;
+		barrier.size = size;
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		return true;
+	}
+
+	LayoutHandle VulkanGraphicsDevice::createVertexInputLayout(const std::vector<VertexInputLayout> &attributes)
+	{
+		if ((mLayoutHandle + 1) == InvalidHandle)
+		{
+			std::printf("Too many layout handles");
+			return InvalidHandle;
+		}
+
+		VulkanLayout layout;
+		for (const VertexInputLayout &attr : attributes)
+		{
+			//bindings index the fixed size arrays of VulkanVertexInput
+			if (attr.binding >= MaxVertexBufferBindings)
+			{
+				std::printf("Vertex attribute %d uses binding %u, only %u bindings are supported\n", attr.attribute, attr.binding, MaxVertexBufferBindings);
+				return InvalidHandle;
+			}
+
+			VkVertexInputAttributeDescription desc = {};
+			desc.location = attr.attribute;
+			desc.binding = attr.binding;
+			desc.format = vkutils::getVertexAttributeFormat(attr);
+			desc.offset = static_cast<uint32_t>(attr.offset);
+			if (desc.format == VK_FORMAT_UNDEFINED)
+			{
+				std::printf("Vertex attribute %d has no matching vulkan format\n", attr.attribute);
+				return InvalidHandle;
+			}
+			//only some formats are guaranteed to work as vertex input, refuse the rest here instead of failing pipeline creation at draw time
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, desc.format, &formatProperties);
+			if (!(formatProperties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT))
+			{
+				std::printf("Vertex attribute %d uses a format this device can't read vertices from\n", attr.attribute);
+				return InvalidHandle;
+			}
+			//core vulkan steps instance data once per instance only
+			if (attr.inputRate == VertexInputRate::eInstance && attr.divisor > 1)
+			{
+				std::printf("Vertex attribute %d uses divisor %u, which needs VK_EXT_vertex_attribute_divisor\n", attr.attribute, attr.divisor);
+				return InvalidHandle;
+			}
+			layout.attributes.push_back(desc);
+
+			//one binding description per buffer slot
+			bool found = false;
+			for (const VkVertexInputBindingDescription &binding : layout.bindings)
+				found |= binding.binding == attr.binding;
+			if (!found)
+			{
+				VkVertexInputBindingDescription binding = {};
+				binding.binding = attr.binding;
+				binding.stride = attr.stride;
+				binding.inputRate = attr.inputRate == VertexInputRate::eInstance ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
+				layout.bindings.push_back(binding);
+			}
+		}
+
+		LayoutHandle handle = mLayoutHandle++;
+		mLayouts[handle] = layout;
+		return handle;
+	}
+
+	VertexArrayHandle VulkanGraphicsDevice::createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer, IndexType indexType)
+	{
+		return createVAO(layout, std::vector<BufferHandle>(1, vertexBuffer), indexBuffer, indexType);
+	}
+
+	VertexArrayHandle VulkanGraphicsDevice::createVAO(LayoutHandle layout, const std::vector<BufferHandle> &vertexBuffers, BufferHandle indexBuffer, IndexType indexType)
+	{
+		if ((mVAOHandle + 1) == InvalidHandle)
+		{
+			std::printf("Too many vertex array handles");
+			return InvalidHandle;
+		}
+
+		if (vertexBuffers.size() > MaxVertexBufferBindings)
+		{
+			std::printf("A vertex array can hold at most %u vertex buffers\n", MaxVertexBufferBindings);
+			return InvalidHandle;
+		}
+
+		//vulkan has no 8 bit indices
+		if (indexBuffer != InvalidHandle && indexType == IndexType::eUInt8)
+		{
+			std::printf("8 bit indices are not supported by vulkan\n");
+			return InvalidHandle;
+		}
+
+		VulkanVAO vao = {};
+		vao.layout = layout;
+		vao.input.bufferCount = static_cast<uint32_t>(vertexBuffers.size());
+		for (size_t i = 0; i < vertexBuffers.size(); ++i)
+			vao.input.vertexBuffers[i] = vertexBuffers[i];
+		vao.input.indexBuffer = indexBuffer;
+		vao.input.indexType = indexType;
+
+		VertexArrayHandle handle = mVAOHandle++;
+		mVAOs[handle] = vao;
+		return handle;
+	}
+
+	void VulkanGraphicsDevice::bindConstantBuffer(ShaderHandle shader, BufferHandle cBuffer, const char *name, int32_t index)
+	{
+#ifdef _DEBUG
+		if (mBuffers.count(cBuffer) && mBuffers[cBuffer].type != BufferType::eConstantBuffer)
+			assert(false);
+#endif
+		if (index < 0 || static_cast<uint32_t>(index) >= MaxDescriptorSlots)
+			return;
+
+		_setResourceSlot(shader, name, ShaderUtils::ShaderResourceType::eConstantBuffer, index);
+		mContext.constantBuffers[index] = { cBuffer, VK_NULL_HANDLE, 0, 0 };
+		mContext.descriptorsDirty = true;
+	}
+
+	size_t VulkanGraphicsDevice::getConstantBufferAlignment()
+	{
+		return static_cast<size_t>(mDeviceProperties.limits.minUniformBufferOffsetAlignment);
+	}
+
+	void VulkanGraphicsDevice::bindStorageBuffer(ShaderHandle shader, BufferHandle sBuffer, const char *name, int32_t index)
+	{
+#ifdef _DEBUG
+		if (mBuffers.count(sBuffer) && mBuffers[sBuffer].type != BufferType::eStorageBuffer)
+			assert(false);
+#endif
+		if (index < 0 || static_cast<uint32_t>(index) >= MaxDescriptorSlots)
+			return;
+
+		_setResourceSlot(shader, name, ShaderUtils::ShaderResourceType::eStorageBuffer, index);
+		mContext.storageBuffers[index] = { sBuffer, VK_NULL_HANDLE, 0, 0 };
+		mContext.descriptorsDirty = true;
+	}
+
+	size_t VulkanGraphicsDevice::getStorageBufferAlignment()
+	{
+		return static_cast<size_t>(mDeviceProperties.limits.minStorageBufferOffsetAlignment);
+	}
+
+	bool VulkanGraphicsDevice::_createImage(ImageParams &image, const VkExtent2D extent, const VkSampleCountFlagBits samples, const VkImageUsageFlags usage, const VkImageAspectFlags aspect,
+		const uint32_t mipLevels, const uint32_t layers, const VkImageViewType viewType, const VkImageCreateFlags flags)
+	{
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.flags = flags;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = image.format;
+		imageCreateInfo.extent.width = extent.width;
+		imageCreateInfo.extent.height = extent.height;
+		imageCreateInfo.extent.depth = 1;
+		imageCreateInfo.mipLevels = mipLevels;
+		imageCreateInfo.arrayLayers = layers;
+		imageCreateInfo.samples = samples;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = usage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkResult result = vkCreateImage(mDevice, &imageCreateInfo, mAllocCallback, &image.image);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreateImage failed\n");
+			return false;
+		}
+
+		VkMemoryRequirements memReq;
+		vkGetImageMemoryRequirements(mDevice, image.image, &memReq);
+
+		uint32_t memType = vkutils::findMemoryType(mPhysicalDevice, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (memType == UINT32_MAX)
+		{
+			std::printf("Could not find valid memory type for image\n");
+			return false;
+		}
+
+		if (!mMemory.allocate(memReq, memType, false, image.allocation))
+		{
+			std::printf("Failed to allocate memory for image\n");
+			return false;
+		}
+
+		result = vkBindImageMemory(mDevice, image.image, image.allocation.memory, image.allocation.offset);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkBindImageMemory failed for image\n");
+			return false;
+		}
+
+		VkImageViewCreateInfo imageViewCreateInfo = {};
+		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		imageViewCreateInfo.image = image.image;
+		imageViewCreateInfo.viewType = viewType;
+		imageViewCreateInfo.format = image.format;
+		imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+		imageViewCreateInfo.subresourceRange = { aspect, 0, mipLevels, 0, layers };
+
+		result = vkCreateImageView(mDevice, &imageViewCreateInfo, mAllocCallback, &image.view);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreateImageView failed for image\n");
+			return false;
+		}
+
+		image.extent = extent;
+		return true;
+	}
+
+	void VulkanGraphicsDevice::_destroyImage(ImageParams &image)
+	{
+		if (image.view)
+			vkDestroyImageView(mDevice, image.view, mAllocCallback);
+		if (image.image)
+			vkDestroyImage(mDevice, image.image, mAllocCallback);
+		mMemory.free(image.allocation);
+
+		image = ImageParams();
+	}
+
+	void VulkanGraphicsDevice::_destroyRenderTarget(VulkanRenderTarget &target)
+	{
+		if (target.framebuffer)
+			vkDestroyFramebuffer(mDevice, target.framebuffer, mAllocCallback);
+		if (target.renderPass)
+			vkDestroyRenderPass(mDevice, target.renderPass, mAllocCallback);
+
+		for (auto &color : target.colorImages)
+			_destroyImage(color);
+		_destroyImage(target.depthImage);
+	}
+
+	void VulkanGraphicsDevice::_destroyShader(VulkanShader &shader)
+	{
+		for (auto &module : shader.modules)
+			vkDestroyShaderModule(mDevice, module, mAllocCallback);
+		if (shader.computePipeline)
+			vkDestroyPipeline(mDevice, shader.computePipeline, mAllocCallback);
+		if (shader.pipelineLayout)
+			vkDestroyPipelineLayout(mDevice, shader.pipelineLayout, mAllocCallback);
+	}
+
+	RenderTargetHandle VulkanGraphicsDevice::createRenderTarget(const RenderTargetDetails &details)
+	{
+		if ((mRenderTargetHandle + 1) == InvalidHandle)
+		{
+			std::printf("Too many render target handles");
+			return InvalidHandle;
+		}
+
+		VulkanRenderTarget target = {};
+		target.samples = vkutils::getSampleCount(details.samples);
+		const VkExtent2D extent = { details.width, details.height };
+		target.extent = extent;
+		const bool multisampled = target.samples != VK_SAMPLE_COUNT_1_BIT;
+
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkAttachmentReference> colorRefs;
+		std::vector<VkImageView> views;
+		bool valid = true;
+
+		//multisampled images are only resolved, single sampled ones can also be sampled by later passes
+		for (const TextureFormat format : details.colorFormats)
+		{
+			ImageParams image;
+			image.format = vkutils::getTextureFormat(format);
+			VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			if (!multisampled)
+				usage |= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			valid = valid && image.format != VK_FORMAT_UNDEFINED && _createImage(image, extent, target.samples, usage, VK_IMAGE_ASPECT_COLOR_BIT);
+			target.colorImages.push_back(image);
+
+			//attachments stay in their layout between render passes and are only cleared by ClearBufferCommand
+			VkAttachmentDescription desc = {};
+			desc.format = image.format;
+			desc.samples = target.samples;
+			desc.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			desc.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			desc.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			colorRefs.push_back({ static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+			attachments.push_back(desc);
+			views.push_back(image.view);
+		}
+
+		VkAttachmentReference depthRef = {};
+		if (details.depthFormat != TextureFormat::eNone)
+		{
+			target.depthImage.format = vkutils::getTextureFormat(details.depthFormat);
+			VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			if (!multisampled)
+				usage |= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			valid = valid && target.depthImage.format != VK_FORMAT_UNDEFINED &&
+				_createImage(target.depthImage, extent, target.samples, usage, vkutils::getImageAspect(details.depthFormat));
+
+			//depth is stored so shadow maps can be read back
+			VkAttachmentDescription desc = {};
+			desc.format = target.depthImage.format;
+			desc.samples = target.samples;
+			desc.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+			desc.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			desc.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			depthRef = { static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			attachments.push_back(desc);
+			views.push_back(target.depthImage.view);
+		}
+
+		if (!valid)
+		{
+			std::printf("Failed to create render target images\n");
+			_destroyRenderTarget(target);
+			return InvalidHandle;
+		}
+
+		//move the images into the layouts the render pass expects, ahead of the next frame
+		VkCommandBuffer cmdBuffer = mUploader.getGraphicsCmdBuffer();
+		for (auto &color : target.colorImages)
+			vkutils::setImageLayout(cmdBuffer, color.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		if (target.depthImage.image)
+			vkutils::setImageLayout(cmdBuffer, target.depthImage.image, vkutils::getDepthAspect(target.depthImage.format),
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+		subpass.pColorAttachments = colorRefs.data();
+		subpass.pDepthStencilAttachment = details.depthFormat != TextureFormat::eNone ? &depthRef : nullptr;
+
+		VkSubpassDependency dependency = getExternalDependency();
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 1;
+		renderPassInfo.pDependencies = &dependency;
+
+		VkResult result = vkCreateRenderPass(mDevice, &renderPassInfo, mAllocCallback, &target.renderPass);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreateRenderPass failed for render target\n");
+			_destroyRenderTarget(target);
+			return InvalidHandle;
+		}
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = target.renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+		framebufferInfo.pAttachments = views.data();
+		framebufferInfo.width = extent.width;
+		framebufferInfo.height = extent.height;
+		framebufferInfo.layers = 1;
+
+		result = vkCreateFramebuffer(mDevice, &framebufferInfo, mAllocCallback, &target.framebuffer);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreateFramebuffer failed for render target\n");
+			_destroyRenderTarget(target);
+			return InvalidHandle;
+		}
+
+		RenderTargetHandle handle = mRenderTargetHandle++;
+		mRenderTargets[handle] = target;
+		return handle;
+	}
+
+	void VulkanGraphicsDevice::deleteRenderTarget(RenderTargetHandle handle)
+	{
+		auto it = mRenderTargets.find(handle);
+		if (it == mRenderTargets.end())
+			return;
+
+		//the target and pipelines built for its render pass may still be used by frames in flight
+		VulkanFrame &frame = mFrames[mFrameIndex];
+		const VkRenderPass renderPass = it->second.renderPass;
+		mPipelineCache.erase([renderPass](const VulkanPipelineState &state) { return state.renderPass == renderPass; }, frame.deletedPipelines);
+		mContext.pipelineDirty = true;
+		frame.deletedRenderTargets.push_back(it->second);
+		mRenderTargets.erase(it);
+	}
+
+	TextureHandle VulkanGraphicsDevice::createTexture(const TextureDetails &details)
+	{
+		if ((mTextureHandle + 1) == InvalidHandle)
+		{
+			std::printf("Too many texture handles");
+			return InvalidHandle;
+		}
+
+		VulkanTexture texture;
+		texture.details = details;
+		texture.levels = details.mipLevels > 0 ? details.mipLevels : 1;
+		texture.aspect = vkutils::getImageAspect(details.format);
+		texture.image.format = vkutils::getTextureFormat(details.format);
+		if (texture.image.format == VK_FORMAT_UNDEFINED)
+		{
+			std::printf("Unsupported texture format\n");
+			return InvalidHandle;
+		}
+
+		VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D;
+		VkImageCreateFlags flags = 0;
+		if (details.type == TextureType::e2D)
+		{
+			texture.details.layers = 1;
+		}
+		else if (details.type == TextureType::e2DArray)
+		{
+			viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		}
+		else if (details.type == TextureType::eCube)
+		{
+			texture.details.layers = 6;
+			viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+			flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+		}
+
+		const VkExtent2D extent = { details.width, details.height };
+		const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		texture.viewType = viewType;
+		if (!_createImage(texture.image, extent, VK_SAMPLE_COUNT_1_BIT, usage, texture.aspect, texture.levels, texture.details.layers, viewType, flags))
+		{
+			_destroyImage(texture.image);
+			return InvalidHandle;
+		}
+
+		//nothing is uploaded yet, so sampling starts at the coarsest level
+		texture.coverage.reset(texture.details.width, texture.details.height, texture.details.layers, texture.levels);
+		texture.baseLevel = texture.levels - 1;
+		vkDestroyImageView(mDevice, texture.image.view, mAllocCallback);
+		texture.image.view = _createTextureView(texture, texture.baseLevel);
+		if (texture.image.view == VK_NULL_HANDLE)
+		{
+			_destroyImage(texture.image);
+			return InvalidHandle;
+		}
+
+		//the whole image moves to the layout it is sampled in ahead of the next frame, so copies never track what is still undefined
+		{
+			std::lock_guard<std::mutex> lock(mUploadMutex);
+			const VkImageSubresourceRange range = { texture.aspect, 0, texture.levels, 0, texture.details.layers };
+			vkutils::setImageLayout(mUploader.getGraphicsCmdBuffer(), texture.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, range);
+		}
+
+		TextureHandle handle = mTextureHandle++;
+		mTextures[handle] = texture;
+		return handle;
+	}
+
+	//the view covers baseLevel to the coarsest level, so sampling never reaches levels that aren't uploaded
+	VkImageView VulkanGraphicsDevice::_createTextureView(const VulkanTexture &texture, const uint32_t baseLevel)
+	{
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = texture.image.image;
+		viewInfo.viewType = texture.viewType;
+		viewInfo.format = texture.image.format;
+		viewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+		viewInfo.subresourceRange = { texture.aspect, baseLevel, texture.levels - baseLevel, 0, texture.details.layers };
+
+		VkImageView view = VK_NULL_HANDLE;
+		if (vkCreateImageView(mDevice, &viewInfo, mAllocCallback, &view) != VK_SUCCESS)
+		{
+			std::printf("vkCreateImageView failed for texture\n");
+			return VK_NULL_HANDLE;
+		}
+		return view;
+	}
+
+	void VulkanGraphicsDevice::deleteTexture(TextureHandle handle)
+	{
+		auto it = mTextures.find(handle);
+		if (it == mTextures.end())
+			return;
+
+		//destroyed once every frame that may use the texture has rendered
+		mFrames[mFrameIndex].deletedImages.push_back(it->second.image);
+		mTextures.erase(it);
+	}
+
+	SamplerHandle VulkanGraphicsDevice::createSampler(const SamplerDetails &details)
+	{
+		if ((mSamplerHandle + 1) == InvalidHandle)
+		{
+			std::printf("Too many sampler handles");
+			return InvalidHandle;
+		}
+
+		VkSamplerCreateInfo samplerInfo = {};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.minFilter = vkutils::getFilter(details.minFilter);
+		samplerInfo.magFilter = vkutils::getFilter(details.magFilter);
+		samplerInfo.mipmapMode = vkutils::getMipmapMode(details.mipFilter);
+		samplerInfo.addressModeU = vkutils::getAddressMode(details.wrapU);
+		samplerInfo.addressModeV = vkutils::getAddressMode(details.wrapV);
+		samplerInfo.addressModeW = vkutils::getAddressMode(details.wrapW);
+		samplerInfo.minLod = 0.0f;
+		//without mip filtering only the base level is sampled
+		samplerInfo.maxLod = details.mipFilter == SamplerMipFilter::eNone ? 0.25f : VK_LOD_CLAMP_NONE;
+		//devices without the samplerAnisotropy feature filter isotropically, like opengl without the extension
+		samplerInfo.anisotropyEnable = VK_FALSE;
+		samplerInfo.maxAnisotropy = 1.0f;
+		if (details.maxAnisotropy > 1.0f && mEnabledFeatures.samplerAnisotropy)
+		{
+			samplerInfo.anisotropyEnable = VK_TRUE;
+			samplerInfo.maxAnisotropy = std::min(details.maxAnisotropy, mDeviceProperties.limits.maxSamplerAnisotropy);
+		}
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+
+		VkSampler sampler;
+		VkResult result = vkCreateSampler(mDevice, &samplerInfo, mAllocCallback, &sampler);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreateSampler failed\n");
+			return InvalidHandle;
+		}
+
+		SamplerHandle handle = mSamplerHandle++;
+		mSamplers[handle] = sampler;
+		return handle;
+	}
+
+	void VulkanGraphicsDevice::deleteSampler(SamplerHandle handle)
+	{
+		auto it = mSamplers.find(handle);
+		if (it == mSamplers.end())
+			return;
+
+		//descriptor sets of frames in flight may still use the sampler
+		mFrames[mFrameIndex].deletedSamplers.push_back(it->second);
+		mSamplers.erase(it);
+	}
+
+	//the sampler named reads the texture bound to unit by BindTextureCommand
+	void VulkanGraphicsDevice::bindTextureUnit(ShaderHandle shader, const char *name, int32_t unit)
+	{
+		if (unit < 0 || static_cast<uint32_t>(unit) >= MaxDescriptorSlots)
+			return;
+
+		_setResourceSlot(shader, name, ShaderUtils::ShaderResourceType::eTexture, unit);
+		mContext.descriptorsDirty = true;
+	}
+
+	//copied on the graphics queue behind every submitted frame, then waited for with the uploader's fence
+	bool VulkanGraphicsDevice::readPixels(RenderTargetHandle target, uint32_t colorAttachment, int32_t x, int32_t y, uint32_t width, uint32_t height, void *data)
+	{
+		//commands of the frame being recorded aren't submitted yet
+		if (mFrameActive)
+		{
+#ifdef _DEBUG
+			assert(false);
+#endif
+			std::printf("Pixels can only be read between frames\n");
+			return false;
+		}
+
+		const ImageParams *image = nullptr;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		if (target != InvalidHandle)
+		{
+			auto it = mRenderTargets.find(target);
+			if (it == mRenderTargets.end())
+				return false;
+
+			const VulkanRenderTarget &renderTarget = it->second;
+			if (renderTarget.samples != VK_SAMPLE_COUNT_1_BIT)
+			{
+				std::printf("Resolve multisampled render targets before reading their pixels.\n");
+				return false;
+			}
+			if (colorAttachment >= renderTarget.colorImages.size())
+				return false;
+			image = &renderTarget.colorImages[colorAttachment];
+		}
+		else
+		{
+			//swapchain images can't be copied from once presented
+			if (!mConfig.headless)
+			{
+				std::printf("The default framebuffer can only be read by headless Vulkan devices\n");
+				return false;
+			}
+			image = &mSwapChainParams.colorImages[mSwapChainParams.currentImageIndex];
+			layout = mPresentLayout;
+		}
+
+		const bool bgra = image->format == VK_FORMAT_B8G8R8A8_UNORM || image->format == VK_FORMAT_B8G8R8A8_SRGB;
+		if (!bgra && image->format != VK_FORMAT_R8G8B8A8_UNORM && image->format != VK_FORMAT_R8G8B8A8_SRGB)
+		{
+			std::printf("Only 8 bit RGBA and BGRA attachments can be read\n");
+			return false;
+		}
+
+		if (width == 0 || height == 0)
+			return true;
+		if (x < 0 || y < 0 || static_cast<uint32_t>(x) + width > image->extent.width || static_cast<uint32_t>(y) + height > image->extent.height)
+		{
+			std::printf("Pixel read out of range of the framebuffer\n");
+			return false;
+		}
+
+		//cached memory reads a lot faster from the host
+		VulkanBuffer readback = {};
+		if (!_createHostBuffer(readback, static_cast<VkDeviceSize>(width) * height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT))
+		{
+			std::printf("Failed to create a buffer for pixel read\n");
+			_destroyBuffer(readback);
+			return false;
+		}
+
+		//vulkan's origin is the top left, the rows are read from the bottom of the region up below
+		VkBufferImageCopy region = {};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageOffset = { x, static_cast<int32_t>(image->extent.height - y - height), 0 };
+		region.imageExtent = { width, height, 1 };
+
+		std::unique_lock<std::mutex> lock(mUploadMutex);
+		VkCommandBuffer cmdBuffer = mUploader.getGraphicsCmdBuffer();
+		if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+			vkutils::setImageLayout(cmdBuffer, image->image, VK_IMAGE_ASPECT_COLOR_BIT, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		vkCmdCopyImageToBuffer(cmdBuffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+		if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+			vkutils::setImageLayout(cmdBuffer, image->image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout);
+
+		VkMemoryBarrier hostBarrier = {};
+		hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+		mUploader.wait(mUploader.flush());
+		lock.unlock();
+
+		const uint32_t rowSize = width * 4;
+		const uint8_t *src = readback.allocation.mapped;
+		uint8_t *dest = static_cast<uint8_t*>(data);
+		for (uint32_t row = 0; row < height; ++row)
+		{
+			const uint8_t *srcRow = src + (height - 1 - row) * rowSize;
+			uint8_t *destRow = dest + row * rowSize;
+			if (!bgra)
+			{
+				memcpy(destRow, srcRow, rowSize);
+				continue;
+			}
+			for (uint32_t i = 0; i < rowSize; i += 4)
+			{
+				destRow[i] = srcRow[i + 2];
+				destRow[i + 1] = srcRow[i + 1];
+				destRow[i + 2] = srcRow[i];
+				destRow[i + 3] = srcRow[i + 3];
+			}
+		}
+
+		_destroyBuffer(readback);
+		return true;
+	}
+
+	QueryHandle VulkanGraphicsDevice::createQuery(QueryType type)
+	{
+		if ((mQueryHandle + 1) == InvalidHandle)
+		{
+			std::printf("Too many query handles");
+			return InvalidHandle;
+		}
+
+		//todo eSamplesPassed only counts exact samples with the occlusionQueryPrecise feature enabled
+		VkQueryPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+		poolInfo.queryCount = QueryLatency;
+
+		VulkanQuery query = {};
+		query.frames.resize(QueryLatency, 0);
+		query.last = -1;
+		VkResult result = vkCreateQueryPool(mDevice, &poolInfo, mAllocCallback, &query.pool);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreateQueryPool failed\n");
+			return InvalidHandle;
+		}
+
+		//every slot is reset ahead of the next frame, so the query can begin in it right away
+		{
+			std::lock_guard<std::mutex> lock(mUploadMutex);
+			_resetQuerySlots(mUploader.getGraphicsCmdBuffer(), query);
+		}
+
+		QueryHandle handle = mQueryHandle++;
+		mQueries[handle] = query;
+		return handle;
+	}
+
+	void VulkanGraphicsDevice::deleteQuery(QueryHandle handle)
+	{
+		auto it = mQueries.find(handle);
+		if (it == mQueries.end())
+			return;
+
+		//frames in flight may still write its results
+		mFrames[mFrameIndex].deletedQueryPools.push_back(it->second.pool);
+		mQueries.erase(it);
+	}
+
+	bool VulkanGraphicsDevice::getQueryResult(QueryHandle handle, uint64_t &result)
+	{
+		VulkanQuery &query = mQueries[handle];
+
+		//queries finish in order, stop at the first one that isn't ready
+		while (query.pending > 0)
+		{
+			if (query.active && query.pending == 1)
+				break;
+
+			//a reused slot holds the old result until its reset has run
+			if (query.frames[query.oldest] > mCompletedFrame)
+				break;
+
+			uint64_t samples;
+			VkResult status = vkGetQueryPoolResults(mDevice, query.pool, query.oldest, 1, sizeof(samples), &samples, sizeof(samples), VK_QUERY_RESULT_64_BIT);
+			if (status != VK_SUCCESS)
+				break;
+
+			query.result = samples;
+			query.hasResult = true;
+			query.oldest = (query.oldest + 1) % QueryLatency;
+			--query.pending;
+		}
+
+		result = query.result;
+		return query.hasResult;
+	}
+
+	//resets can't be recorded inside a render pass, so the slots read since the last reset are reset together
+	void VulkanGraphicsDevice::_resetQuerySlots(VkCommandBuffer cmdBuffer, VulkanQuery &query)
+	{
+		//every slot is waiting on a result nobody read, reuse the oldest
+		if (query.pending == QueryLatency)
+		{
+			query.oldest = (query.oldest + 1) % QueryLatency;
+			--query.pending;
+		}
+
+		uint32_t first = (query.oldest + query.pending + query.reset) % QueryLatency;
+		uint32_t count = QueryLatency - query.pending - query.reset;
+		while (count > 0)
+		{
+			const uint32_t run = std::min(count, QueryLatency - first);
+			vkCmdResetQueryPool(cmdBuffer, query.pool, first, run);
+			first = 0;
+			count -= run;
+		}
+		query.reset = QueryLatency - query.pending;
+	}
+
+	bool VulkanGraphicsDevice::_createFrames()
+	{
+		const uint32_t frameCount = std::min(std::max(mConfig.framesInFlight, 1u), MaxFramesInFlight);
+		mFrames.resize(frameCount);
+		mFrameIndex = 0;
+
+		VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
+		cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		cmdPoolCreateInfo.queueFamilyIndex = mGraphicsQueueIndex;
+
+		//fences start signaled so the first use of a frame doesn't wait
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		for (auto &frame : mFrames)
+		{
+			frame = VulkanFrame();
+			if (vkCreateCommandPool(mDevice, &cmdPoolCreateInfo, mAllocCallback, &frame.commandPool) != VK_SUCCESS)
+			{
+				std::printf("vkCreateCommandPool failed\n");
+				return false;
+			}
+
+			VkCommandBufferAllocateInfo cmdBufAllocInfo = {};
+			cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdBufAllocInfo.commandPool = frame.commandPool;
+			cmdBufAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			cmdBufAllocInfo.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(mDevice, &cmdBufAllocInfo, &frame.cmdBuffer) != VK_SUCCESS)
+			{
+				std::printf("vkAllocateCommandBuffers failed\n");
+				return false;
+			}
+
+			//descriptor pools are created as the frame's draws need them
+			frame.descriptorAllocators.resize(mRecordThreads.getCount());
+			for (auto &descriptors : frame.descriptorAllocators)
+				descriptors.init(mDevice, mAllocCallback);
+
+			//constant ring blocks are created as SetConstantsCommand needs them
+			frame.constantRings.resize(mRecordThreads.getCount());
+
+			//secondary command buffers are allocated as submitCommandQueues needs them
+			frame.secondaryPools.resize(mRecordThreads.getCount());
+			for (auto &pool : frame.secondaryPools)
+			{
+				pool = VulkanCommandPool();
+				if (vkCreateCommandPool(mDevice, &cmdPoolCreateInfo, mAllocCallback, &pool.commandPool) != VK_SUCCESS)
+				{
+					std::printf("vkCreateCommandPool failed\n");
+					return false;
+				}
+			}
+
+			//and async compute ones as submitAsyncCompute needs them
+			VkCommandPoolCreateInfo computePoolCreateInfo = cmdPoolCreateInfo;
+			computePoolCreateInfo.queueFamilyIndex = mComputeQueueIndex;
+			if (vkCreateCommandPool(mDevice, &computePoolCreateInfo, mAllocCallback, &frame.computePool.commandPool) != VK_SUCCESS)
+			{
+				std::printf("vkCreateCommandPool failed\n");
+				return false;
+			}
+
+			if (vkCreateFence(mDevice, &fenceInfo, mAllocCallback, &frame.fence) != VK_SUCCESS)
+			{
+				std::printf("vkCreateFence failed\n");
+				return false;
+			}
+
+			if (vkCreateSemaphore(mDevice, &semaphoreCreateInfo, mAllocCallback, &frame.imageAvailableSem) != VK_SUCCESS ||
+				vkCreateSemaphore(mDevice, &semaphoreCreateInfo, mAllocCallback, &frame.renderFinishedSem) != VK_SUCCESS)
+			{
+				std::printf("vkCreateSemaphore failed\n");
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void VulkanGraphicsDevice::_waitFrame(VulkanFrame &frame)
+	{
+		//the fence is reset right before the next submit, a frame that is never submitted must not block
+		vkWaitForFences(mDevice, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+		mCompletedFrame = std::max(mCompletedFrame, frame.number);
+		_destroyDeleted(frame);
+
+		vkResetCommandPool(mDevice, frame.commandPool, 0);
+		for (auto &pool : frame.secondaryPools)
+		{
+			vkResetCommandPool(mDevice, pool.commandPool, 0);
+			pool.used = 0;
+		}
+
+		//the frame's submit waited for its async compute work, so that has completed too
+		vkResetCommandPool(mDevice, frame.computePool.commandPool, 0);
+		frame.computePool.used = 0;
+		frame.semaphoresUsed = 0;
+		for (auto &descriptors : frame.descriptorAllocators)
+			descriptors.reset();
+		for (auto &ring : frame.constantRings)
+		{
+			ring.block = 0;
+			ring.used = 0;
+		}
+		frame.uploadRing.block = 0;
+		frame.uploadRing.used = 0;
+	}
+
+	void VulkanGraphicsDevice::_destroyDeleted(VulkanFrame &frame)
+	{
+		//pipelines go first, they reference shaders and render passes
+		for (auto pipeline : frame.deletedPipelines)
+			vkDestroyPipeline(mDevice, pipeline, mAllocCallback);
+		frame.deletedPipelines.clear();
+
+		for (auto &shader : frame.deletedShaders)
+			_destroyShader(shader);
+		frame.deletedShaders.clear();
+
+		for (auto &target : frame.deletedRenderTargets)
+			_destroyRenderTarget(target);
+		frame.deletedRenderTargets.clear();
+
+		for (auto &buffer : frame.deletedBuffers)
+			_destroyBuffer(buffer);
+		frame.deletedBuffers.clear();
+
+		for (auto &image : frame.deletedImages)
+			_destroyImage(image);
+		frame.deletedImages.clear();
+
+		for (auto &swapChain : frame.retiredSwapChains)
+			_destroySwapchain(swapChain);
+		frame.retiredSwapChains.clear();
+
+		for (auto sampler : frame.deletedSamplers)
+			vkDestroySampler(mDevice, sampler, mAllocCallback);
+		frame.deletedSamplers.clear();
+
+		for (auto pool : frame.deletedQueryPools)
+			vkDestroyQueryPool(mDevice, pool, mAllocCallback);
+		frame.deletedQueryPools.clear();
+	}
+
+	void VulkanGraphicsDevice::_destroyFrame(VulkanFrame &frame)
+	{
+		_destroyDeleted(frame);
+
+		if (frame.imageAvailableSem)
+			vkDestroySemaphore(mDevice, frame.imageAvailableSem, mAllocCallback);
+		if (frame.renderFinishedSem)
+			vkDestroySemaphore(mDevice, frame.renderFinishedSem, mAllocCallback);
+		if (frame.fence)
+			vkDestroyFence(mDevice, frame.fence, mAllocCallback);
+		for (auto &semaphore : frame.semaphores)
+			vkDestroySemaphore(mDevice, semaphore, mAllocCallback);
+
+		//destroying the pool frees its command buffer
+		if (frame.commandPool)
+			vkDestroyCommandPool(mDevice, frame.commandPool, mAllocCallback);
+		for (auto &pool : frame.secondaryPools)
+		{
+			if (pool.commandPool)
+				vkDestroyCommandPool(mDevice, pool.commandPool, mAllocCallback);
+		}
+		if (frame.computePool.commandPool)
+			vkDestroyCommandPool(mDevice, frame.computePool.commandPool, mAllocCallback);
+		for (auto &descriptors : frame.descriptorAllocators)
+			descriptors.destroy();
+		for (auto &ring : frame.constantRings)
+		{
+			for (auto &block : ring.blocks)
+				_destroyBuffer(block);
+		}
+		for (auto &block : frame.uploadRing.blocks)
+			_destroyBuffer(block);
+		frame = VulkanFrame();
+	}
+
+	VkCommandBuffer VulkanGraphicsDevice::_getPoolCmdBuffer(VulkanCommandPool &pool, const VkCommandBufferLevel level)
+	{
+		//command buffers stay allocated, resetting the pool with the frame makes them reusable
+		if (pool.used == pool.cmdBuffers.size())
+		{
+			VkCommandBufferAllocateInfo cmdBufAllocInfo = {};
+			cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdBufAllocInfo.commandPool = pool.commandPool;
+			cmdBufAllocInfo.level = level;
+			cmdBufAllocInfo.commandBufferCount = 1;
+			VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+			if (vkAllocateCommandBuffers(mDevice, &cmdBufAllocInfo, &cmdBuffer) != VK_SUCCESS)
+			{
+				std::printf("vkAllocateCommandBuffers failed\n");
+				return VK_NULL_HANDLE;
+			}
+			pool.cmdBuffers.push_back(cmdBuffer);
+		}
+		return pool.cmdBuffers[pool.used++];
+	}
+
+	VkSemaphore VulkanGraphicsDevice::_getFrameSemaphore(VulkanFrame &frame)
+	{
+		//semaphores stay created, every wait on them has completed once the frame is reused
+		if (frame.semaphoresUsed == frame.semaphores.size())
+		{
+			VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+			semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			VkSemaphore semaphore = VK_NULL_HANDLE;
+			if (vkCreateSemaphore(mDevice, &semaphoreCreateInfo, mAllocCallback, &semaphore) != VK_SUCCESS)
+			{
+				std::printf("vkCreateSemaphore failed\n");
+				return VK_NULL_HANDLE;
+			}
+			frame.semaphores.push_back(semaphore);
+		}
+		return frame.semaphores[frame.semaphoresUsed++];
+	}
+
+	VulkanCommandContext& VulkanGraphicsDevice::_context()
+	{
+		return tRecordContext != nullptr ? *tRecordContext : mContext;
+	}
+
+	//commands that end the render pass or change resources other threads may read can't be recorded into a secondary command buffer
+	bool VulkanGraphicsDevice::_rejectSecondary()
+	{
+		if (tRecordContext == nullptr)
+			return false;
+#ifdef _DEBUG
+		assert(false);
+#endif
+		return true;
+	}
+
+	VkPipeline VulkanGraphicsDevice::_getPipeline(VulkanCommandContext &context)
+	{
+		if (!context.pipelineDirty)
+			return context.pipeline;
+
+		//a failed creation isn't retried until the state changes again
+		const uint64_t hash = context.pipelineState.computeHash();
+		std::lock_guard<std::mutex> lock(mPipelineMutex);
+		context.pipeline = mPipelineCache.find(context.pipelineState, hash);
+		if (context.pipeline == VK_NULL_HANDLE)
+		{
+			context.pipeline = _createPipeline(context.pipelineState);
+			if (context.pipeline != VK_NULL_HANDLE)
+				mPipelineCache.insert(context.pipelineState, hash, context.pipeline);
+		}
+		context.pipelineDirty = false;
+		return context.pipeline;
+	}
+
+	VkPipeline VulkanGraphicsDevice::_createPipeline(const VulkanPipelineState &state)
+	{
+		auto shaderIt = mShaders.find(state.shader);
+		if (shaderIt == mShaders.end() || state.renderPass == VK_NULL_HANDLE)
+		{
+			std::printf("Draw without a shader or render pass\n");
+			return VK_NULL_HANDLE;
+		}
+		const VulkanShader &shader = shaderIt->second;
+
+		//draws without a layout pull no vertex attributes
+		VkPipelineVertexInputStateCreateInfo vertexInput = {};
+		vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		auto layoutIt = mLayouts.find(state.layout);
+		if (layoutIt != mLayouts.end())
+		{
+			vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(layoutIt->second.bindings.size());
+			vertexInput.pVertexBindingDescriptions = layoutIt->second.bindings.data();
+			vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(layoutIt->second.attributes.size());
+			vertexInput.pVertexAttributeDescriptions = layoutIt->second.attributes.data();
+		}
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = vkutils::getPrimitiveTopology(state.primitive);
+		//strips restart at the largest index like in opengl, lists can't restart in vulkan
+		inputAssembly.primitiveRestartEnable = state.primitive == PrimitiveType::eTriangleStrip || state.primitive == PrimitiveType::eLineStrip ? VK_TRUE : VK_FALSE;
+
+		//viewport and scissor are set per command buffer
+		VkPipelineViewportStateCreateInfo viewportState = {};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicState = {};
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = 2;
+		dynamicState.pDynamicStates = dynamicStates;
+
+		VkPipelineRasterizationStateCreateInfo rasterization = {};
+		rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterization.cullMode = vkutils::getCullMode(state.cullEnabled, state.cullFace);
+		rasterization.frontFace = vkutils::getFrontFace(state.winding);
+		rasterization.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisample = {};
+		multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisample.rasterizationSamples = state.samples;
+
+		//like opengl, depth is only written while the depth test is on
+		VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencil.depthTestEnable = state.depthEnabled ? VK_TRUE : VK_FALSE;
+		depthStencil.depthWriteEnable = state.depthEnabled && state.depthWrite ? VK_TRUE : VK_FALSE;
+		depthStencil.depthCompareOp = vkutils::getCompareOp(state.depthFunc);
+
+		//the same blend function for color and alpha, as glBlendFunc
+		VkPipelineColorBlendAttachmentState blendAttachment = {};
+		blendAttachment.blendEnable = state.blendEnabled ? VK_TRUE : VK_FALSE;
+		blendAttachment.srcColorBlendFactor = vkutils::getBlendFactor(state.blendSource);
+		blendAttachment.dstColorBlendFactor = vkutils::getBlendFactor(state.blendDest);
+		blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		blendAttachment.srcAlphaBlendFactor = blendAttachment.srcColorBlendFactor;
+		blendAttachment.dstAlphaBlendFactor = blendAttachment.dstColorBlendFactor;
+		blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+		blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(state.colorAttachments, blendAttachment);
+
+		VkPipelineColorBlendStateCreateInfo colorBlend = {};
+		colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlend.attachmentCount = state.colorAttachments;
+		colorBlend.pAttachments = blendAttachments.data();
+
+		//compute stages can't be part of a graphics pipeline
+		std::vector<VkPipelineShaderStageCreateInfo> stages;
+		for (const VkPipelineShaderStageCreateInfo &stage : shader.stages)
+		{
+			if (stage.stage != VK_SHADER_STAGE_COMPUTE_BIT)
+				stages.push_back(stage);
+		}
+
+		VkGraphicsPipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+		pipelineInfo.pStages = stages.data();
+		pipelineInfo.pVertexInputState = &vertexInput;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterization;
+		pipelineInfo.pMultisampleState = &multisample;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &colorBlend;
+		pipelineInfo.pDynamicState = &dynamicState;
+		pipelineInfo.layout = shader.pipelineLayout;
+		pipelineInfo.renderPass = state.renderPass;
+		pipelineInfo.subpass = 0;
+		pipelineInfo.basePipelineIndex = -1;
+
+		VkPipeline pipeline;
+		VkResult result = vkCreateGraphicsPipelines(mDevice, mPipelineCache.getCache(), 1, &pipelineInfo, mAllocCallback, &pipeline);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreateGraphicsPipelines failed\n");
+			return VK_NULL_HANDLE;
+		}
+		return pipeline;
+	}
+
+	void VulkanGraphicsDevice::_beginRenderPass(const VkSubpassContents contents)
+	{
+		if (mRenderPassActive)
+			return;
+
+		mRenderPassInfo = {};
+		mRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		auto it = mRenderTargets.find(mCurrentTarget);
+		if (it != mRenderTargets.end())
+		{
+			mRenderPassInfo.renderPass = it->second.renderPass;
+			mRenderPassInfo.framebuffer = it->second.framebuffer;
+			mRenderPassInfo.renderArea.extent = it->second.extent;
+		}
+		else
+		{
+			//only the first render pass of the frame clears the swapchain image
+			mRenderPassInfo.renderPass = mDefaultCleared ? mLoadRenderPass : mRenderPass;
+			mRenderPassInfo.framebuffer = mSwapChainParams.frameBuffers[mSwapChainParams.currentImageIndex];
+			mRenderPassInfo.renderArea.extent = mSwapChainParams.extent;
+			mRenderPassInfo.clearValueCount = 2;
+			mRenderPassInfo.pClearValues = mClearValues;
+			mDefaultCleared = true;
+		}
+
+		vkCmdBeginRenderPass(mContext.cmdBuffer, &mRenderPassInfo, contents);
+		mRenderPassActive = true;
+
+		//secondary command buffers set their own dynamic state
+		if (contents != VK_SUBPASS_CONTENTS_INLINE)
+			return;
+
+		//there is no scissor test, the scissor covers the whole framebuffer
+		vkCmdSetViewport(mContext.cmdBuffer, 0, 1, &mContext.viewport);
+		vkCmdSetScissor(mContext.cmdBuffer, 0, 1, &mRenderPassInfo.renderArea);
+	}
+
+	void VulkanGraphicsDevice::_endRenderPass()
+	{
+		if (!mRenderPassActive)
+			return;
+
+		vkCmdEndRenderPass(mContext.cmdBuffer);
+		mRenderPassActive = false;
+	}
+
+	bool VulkanGraphicsDevice::_prepareDraw(VulkanCommandContext &context)
+	{
+		if (!mFrameActive || context.asyncCompute || (mConditionSkip && !context.secondary))
+			return false;
+
+		VkPipeline pipeline = _getPipeline(context);
+		if (pipeline == VK_NULL_HANDLE)
+			return false;
+
+		//vulkan has no 8 bit indices, createVAO already refuses them
+		const VulkanVertexInput &input = context.vertexInput;
+		const bool indexed = input.indexBuffer != InvalidHandle;
+		if (indexed && input.indexType == IndexType::eUInt8)
+			return false;
+
+		//secondary command buffers run inside the render pass submitCommandQueues began
+		if (!context.secondary)
+			_beginRenderPass();
+		if (pipeline != context.boundPipeline)
+		{
+			vkCmdBindPipeline(context.cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			context.boundPipeline = pipeline;
+			++context.stats->stateCalls;
+		}
+
+		if (context.vertexInputDirty)
+		{
+			VkBuffer vertexBuffers[MaxVertexBufferBindings];
+			VkDeviceSize offsets[MaxVertexBufferBindings];
+			for (uint32_t i = 0; i < input.bufferCount; ++i)
+			{
+				auto it = mBuffers.find(input.vertexBuffers[i]);
+				if (it == mBuffers.end())
+					return false;
+				vertexBuffers[i] = it->second.buffer;
+				offsets[i] = it->second.copy * it->second.stride + input.offsets[i];
+				if (&context == &mContext)
+					markBufferRead(it->second, 0, it->second.size);
+			}
+			if (input.bufferCount > 0)
+				vkCmdBindVertexBuffers(context.cmdBuffer, 0, input.bufferCount, vertexBuffers, offsets);
+
+			if (indexed)
+			{
+				auto it = mBuffers.find(input.indexBuffer);
+				if (it == mBuffers.end())
+					return false;
+				const VkIndexType indexType = input.indexType == IndexType::eUInt32 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+				if (&context == &mContext)
+					markBufferRead(it->second, 0, it->second.size);
+				vkCmdBindIndexBuffer(context.cmdBuffer, it->second.buffer, it->second.copy * it->second.stride, indexType);
+			}
+
+			context.vertexInputDirty = false;
+			++context.stats->stateCalls;
+		}
+
+		if (context.constantsDirty || context.descriptorsDirty || context.offsetsDirty)
+		{
+			auto it = mShaders.find(context.pipelineState.shader);
+			if (it == mShaders.end())
+				return false;
+			if (context.constantsDirty && !_applyConstants(context, it->second))
+				return false;
+			if ((context.descriptorsDirty || context.offsetsDirty) && !_bindDescriptors(context, it->second, VK_PIPELINE_BIND_POINT_GRAPHICS))
+				return false;
+		}
+		return true;
+	}
+
+	//dispatches are recorded outside render passes, into the frame's command buffer or an async compute one
+	bool VulkanGraphicsDevice::_prepareDispatch(VulkanCommandContext &context)
+	{
+		if (!context.asyncCompute)
+		{
+			if (!mFrameActive || _rejectSecondary() || mConditionSkip)
+				return false;
+			_endRenderPass();
+		}
+
+		auto it = mShaders.find(context.pipelineState.shader);
+		if (it == mShaders.end() || it->second.computePipeline == VK_NULL_HANDLE)
+			return false;
+
+		const VulkanShader &shader = it->second;
+		if (shader.computePipeline != context.boundComputePipeline)
+		{
+			vkCmdBindPipeline(context.cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, shader.computePipeline);
+			context.boundComputePipeline = shader.computePipeline;
+			++context.stats->stateCalls;
+		}
+
+		//the compute bind point has sets of its own, draws bind theirs again afterwards
+		context.descriptorsDirty = true;
+		if (context.constantsSize > 0 && !_applyConstants(context, shader))
+			return false;
+		const bool bound = _bindDescriptors(context, shader, VK_PIPELINE_BIND_POINT_COMPUTE);
+		context.descriptorsDirty = true;
+		context.constantsDirty = context.constantsSize > 0;
+		return bound;
+	}
+
+	bool VulkanGraphicsDevice::_bindDescriptors(VulkanCommandContext &context, const VulkanShader &shader, const VkPipelineBindPoint bindPoint)
+	{
+		if (shader.setLayouts.empty())
+		{
+			context.descriptorsDirty = false;
+			context.offsetsDirty = false;
+			return true;
+		}
+
+		//a resource without anything bound to it would leave the draw reading an unwritten descriptor
+		if (context.descriptorsDirty)
+		{
+			std::vector<VulkanDescriptor> descriptors;
+			context.setCount = static_cast<uint32_t>(shader.setLayouts.size());
+			for (uint32_t set = 0; set < context.setCount; ++set)
+			{
+				descriptors.clear();
+				for (const auto &resource : shader.resources)
+				{
+					if (resource.details.set != set)
+						continue;
+
+					for (uint32_t element = 0; element < resource.details.count; ++element)
+					{
+						const uint32_t slot = resource.slot + element;
+						if (slot >= MaxDescriptorSlots)
+							return false;
+
+						VulkanDescriptor descriptor;
+						descriptor.binding = resource.details.binding;
+						descriptor.arrayElement = element;
+						if (resource.details.type == ShaderUtils::ShaderResourceType::eTexture)
+						{
+							//images are owned by the graphics family
+							if (context.asyncCompute && !mSharedFamilies.empty())
+								return false;
+
+							const VulkanTextureSlot &bound = context.textures[slot];
+							auto texture = mTextures.find(bound.texture);
+							if (texture == mTextures.end())
+								return false;
+							auto sampler = mSamplers.find(bound.sampler);
+							descriptor.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+							descriptor.image.imageView = texture->second.image.view;
+							descriptor.image.sampler = sampler != mSamplers.end() ? sampler->second : mDefaultSampler;
+							descriptor.image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+						}
+						else if (resource.details.type == ShaderUtils::ShaderResourceType::eConstantBuffer)
+						{
+							//the offset is passed at bind time, so sets don't change as it moves
+							const VulkanBufferSlot &bound = context.constantBuffers[slot];
+							descriptor.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+							if (bound.constants != VK_NULL_HANDLE)
+							{
+								descriptor.buffer.buffer = bound.constants;
+								descriptor.buffer.range = bound.size;
+							}
+							else
+							{
+								auto buffer = mBuffers.find(bound.buffer);
+								if (buffer == mBuffers.end() || bound.offset >= buffer->second.size)
+									return false;
+								const VkDeviceSize range = bound.size > 0 ? bound.size : buffer->second.size - bound.offset;
+								descriptor.buffer.buffer = buffer->second.buffer;
+								descriptor.buffer.range = std::min(range, static_cast<VkDeviceSize>(mDeviceProperties.limits.maxUniformBufferRange));
+							}
+						}
+						else
+						{
+							const VulkanBufferSlot &bound = context.storageBuffers[slot];
+							auto buffer = mBuffers.find(bound.buffer);
+							if (buffer == mBuffers.end())
+								return false;
+							descriptor.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+							descriptor.buffer.buffer = buffer->second.buffer;
+							descriptor.buffer.offset = bound.offset;
+							descriptor.buffer.range = bound.size > 0 ? bound.size : VK_WHOLE_SIZE;
+						}
+						descriptors.push_back(descriptor);
+					}
+				}
+
+				context.sets[set] = context.descriptors->get(shader.setLayouts[set], descriptors.data(), static_cast<uint32_t>(descriptors.size()));
+				if (context.sets[set] == VK_NULL_HANDLE)
+					return false;
+			}
+		}
+
+		//resources are sorted by set and binding, the order dynamic offsets are consumed in
+		uint32_t offsets[MaxDynamicOffsets];
+		uint32_t offsetCount = 0;
+		for (const auto &resource : shader.resources)
+		{
+			if (resource.details.type != ShaderUtils::ShaderResourceType::eConstantBuffer)
+				continue;
+			for (uint32_t element = 0; element < resource.details.count; ++element)
+			{
+				//buffers move between copies, the frame's constant ring doesn't
+				const VulkanBufferSlot &bound = context.constantBuffers[resource.slot + element];
+				VkDeviceSize offset = bound.offset;
+				if (bound.constants == VK_NULL_HANDLE)
+				{
+					auto buffer = mBuffers.find(bound.buffer);
+					if (buffer != mBuffers.end())
+					{
+						offset += buffer->second.copy * buffer->second.stride;
+						if (&context == &mContext)
+							markBufferRead(buffer->second, bound.offset, bound.size > 0 ? bound.offset + bound.size : buffer->second.size);
+					}
+				}
+				offsets[offsetCount++] = static_cast<uint32_t>(offset);
+			}
+		}
+
+		vkCmdBindDescriptorSets(context.cmdBuffer, bindPoint, shader.pipelineLayout, 0, context.setCount, context.sets, offsetCount, offsets);
+		context.descriptorsDirty = false;
+		context.offsetsDirty = false;
+		++context.stats->stateCalls;
+		return true;
+	}
+
+	bool VulkanGraphicsDevice::_applyConstants(VulkanCommandContext &context, const VulkanShader &shader)
+	{
+		context.constantsDirty = false;
+
+		//push constants live in the command buffer, nothing is allocated
+		if (shader.pushConstantStages != 0)
+		{
+			const uint32_t size = std::min(context.constantsSize, shader.pushConstantSize);
+			vkCmdPushConstants(context.cmdBuffer, shader.pipelineLayout, shader.pushConstantStages, 0, size, context.constants);
+			++context.stats->stateCalls;
+			return true;
+		}
+
+		//otherwise the data is copied to the frame's ring and bound as a constant buffer range
+		VulkanConstantRing &ring = *context.constantRing;
+		const VkDeviceSize alignment = mDeviceProperties.limits.minUniformBufferOffsetAlignment;
+		const VkDeviceSize stride = (MaxConstantsSize + alignment - 1) / alignment * alignment;
+		if (ring.block < ring.blocks.size() && ring.used + stride > ring.blocks[ring.block].size)
+		{
+			++ring.block;
+			ring.used = 0;
+		}
+		if (ring.block == ring.blocks.size())
+		{
+			VulkanBuffer block = {};
+			block.type = BufferType::eConstantBuffer;
+			block.hint = BufferUsageHint::eStreamDraw;
+			std::lock_guard<std::mutex> lock(mUploadMutex);
+			if (!_createBuffer(block, ConstantRingBlockSize, nullptr) || block.allocation.mapped == nullptr)
+			{
+				_destroyBuffer(block);
+				return false;
+			}
+			ring.blocks.push_back(block);
+		}
+
+		const VulkanBuffer &block = ring.blocks[ring.block];
+		memcpy(block.allocation.mapped + ring.used, context.constants, context.constantsSize);
+
+		//only a new block needs a new set, moving within one is a dynamic offset
+		VulkanBufferSlot &slot = context.constantBuffers[context.constantsIndex];
+		if (slot.constants != block.buffer || slot.size != MaxConstantsSize)
+			context.descriptorsDirty = true;
+		else
+			context.offsetsDirty = true;
+		slot = { InvalidHandle, block.buffer, ring.used, MaxConstantsSize };
+		ring.used += stride;
+		return true;
+	}
+
+	//like glUniformBlockBinding, the named resources of shader take what is bound to slot
+	void VulkanGraphicsDevice::_setResourceSlot(ShaderHandle shader, const char *name, const ShaderUtils::ShaderResourceType type, const int32_t slot)
+	{
+		auto it = mShaders.find(shader);
+		if (it == mShaders.end())
+			return;
+
+		for (auto &resource : it->second.resources)
+		{
+			if (resource.details.type == type && resource.details.name == name)
+				resource.slot = static_cast<uint32_t>(slot);
+		}
+	}
+
+	void VulkanGraphicsDevice::deleteVertexInputLayout(LayoutHandle handle)
+	{
+		auto it = mLayouts.find(handle);
+		if (it == mLayouts.end())
+			return;
+
+		//pipelines built with the layout may still be used by frames in flight
+		mPipelineCache.erase([handle](const VulkanPipelineState &state) { return state.layout == handle; }, mFrames[mFrameIndex].deletedPipelines);
+		mContext.pipelineDirty = true;
+		mLayouts.erase(it);
+	}
+
+	void VulkanGraphicsDevice::deleteVAO(VertexArrayHandle handle)
+	{
+		mVAOs.erase(handle);
+	}
+
+	void VulkanGraphicsDevice::deleteBuffer(BufferHandle handle)
+	{
+		auto it = mBuffers.find(handle);
+		if (it == mBuffers.end())
+			return;
+
+		//destroyed once every frame that may use the buffer has rendered
+		mFrames[mFrameIndex].deletedBuffers.push_back(it->second);
+		mBuffers.erase(it);
+	}
+
+	void VulkanGraphicsDevice::deleteShader(ShaderHandle handle)
+	{
+		auto it = mShaders.find(handle);
+		if (it == mShaders.end())
+			return;
+
+		//the shader and its pipelines may still be used by frames in flight
+		VulkanFrame &frame = mFrames[mFrameIndex];
+		mPipelineCache.erase([handle](const VulkanPipelineState &state) { return state.shader == handle; }, frame.deletedPipelines);
+		mContext.pipelineDirty = true;
+
+		if (it->second.computePipeline == mContext.boundComputePipeline)
+			mContext.boundComputePipeline = VK_NULL_HANDLE;
+
+		frame.deletedShaders.push_back(it->second);
+		mShaders.erase(it);
+	}
+	
+	void VulkanGraphicsDevice::presentFrame()
+	{
+		//no swapchain image was acquired without a BeginFrame, but async compute work still retires with a frame
+		VulkanFrame &frame = mFrames[mFrameIndex];
+		if (!mFrameActive && frame.computeDone.empty())
+			return;
 
-		vkBeginCommandBuffer(cmdBuffer, &beginInfo);
-		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdEndRenderPass(cmdBuffer);
-		vkEndCommandBuffer(cmdBuffer);
+		if (mFrameActive)
+		{
+			_endRenderPass();
+			if (mConditionActive)
+				_recordConditionalRender(false);
+			vkEndCommandBuffer(frame.cmdBuffer);
+		}
+
+		//uploads made during the frame are submitted ahead of it
+		{
+			std::lock_guard<std::mutex> lock(mUploadMutex);
+			mUploader.flush();
+		}
 
 		// Pipeline stage at which the queue submission will wait (via pWaitSemaphores)
-		VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		// The submit info structure specifices a command buffer queue submission batch
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStageMasks;
+		const bool presenting = mFrameActive && !mConfig.headless;
+		if (presenting)
+		{
+			waitSemaphores.push_back(frame.imageAvailableSem);
+			waitStageMasks.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		}
+
+		//async compute results are read from the first indirect draw or shader on, and copies mid-frame may overwrite its inputs
+		const VkPipelineStageFlags computeReadStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+		for (const VkSemaphore semaphore : frame.computeDone)
+		{
+			waitSemaphores.push_back(semaphore);
+			waitStageMasks.push_back(computeReadStages);
+		}
+
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.pWaitDstStageMask = &waitStageMask;
-		submitInfo.pWaitSemaphores = &mImageAvailableSem;
-		submitInfo.waitSemaphoreCount = 1;																		
-		submitInfo.pSignalSemaphores = &mRenderFinishedSem;
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pCommandBuffers = &cmdBuffer;
-		submitInfo.commandBufferCount = 1;
-		
-		result = vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		submitInfo.pWaitDstStageMask = waitStageMasks.data();
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pSignalSemaphores = &frame.renderFinishedSem;
+		submitInfo.signalSemaphoreCount = presenting ? 1 : 0;
+		submitInfo.pCommandBuffers = &frame.cmdBuffer;
+		submitInfo.commandBufferCount = mFrameActive ? 1 : 0;
+
+		vkResetFences(mDevice, 1, &frame.fence);
+		VkResult result = vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, frame.fence);
 		if (result != VK_SUCCESS)
 		{
-			std::printf("vkQueueSubmit failed\n");			
+			std::printf("vkQueueSubmit failed\n");
+		}
+		frame.computeDone.clear();
+		frame.number = ++mFrameNumber;
+		mUntrackedReads = false;
+
+		//a frame without an image only retired async compute work, a headless one is never presented
+		if (!presenting)
+		{
+			mFrameActive = false;
+			mFrameIndex = (mFrameIndex + 1) % static_cast<uint32_t>(mFrames.size());
+			_waitFrame(mFrames[mFrameIndex]);
+			return;
+		}
+		mFrameActive = false;
+
+		//presentation waits on the gpu, not the cpu
+		mPresentInfo.pWaitSemaphores = &frame.renderFinishedSem;
+		result = vkQueuePresentKHR(mGraphicsQueue, &mPresentInfo);
+
+		switch (result)
+		{
+		case VK_SUCCESS:
+			break;
+		case VK_ERROR_OUT_OF_DATE_KHR:
+		case VK_SUBOPTIMAL_KHR:
+			//most likely a window resize, the next BeginFrame replaces the swapchain
+			mSwapChainDirty = true;
+			break;
+		default:
+			std::printf("Problem occurred during image presentation\n");
+			break;
+		}
+
+		//only block if the gpu is still on the frame recorded framesInFlight frames ago
+		mFrameIndex = (mFrameIndex + 1) % static_cast<uint32_t>(mFrames.size());
+		_waitFrame(mFrames[mFrameIndex]);
+	}
+
+	void VulkanGraphicsDevice::submitCommandQueues(const std::vector<CommandQueue*> &queues)
+	{
+		//secondary command buffers run inside a render pass, which only exists during a frame
+		if (!mFrameActive || queues.size() < 2 || mRecordThreads.getCount() < 2)
+		{
+			GraphicsDevice::submitCommandQueues(queues);
+			return;
+		}
+
+		//queue i is recorded by thread i % threadCount, into a command buffer of that thread's pool
+		VulkanFrame &frame = mFrames[mFrameIndex];
+		const uint32_t queueCount = static_cast<uint32_t>(queues.size());
+		const uint32_t threadCount = std::min(mRecordThreads.getCount(), queueCount);
+		std::vector<VkCommandBuffer> cmdBuffers(queueCount, VK_NULL_HANDLE);
+		for (uint32_t i = 0; i < queueCount; ++i)
+		{
+			cmdBuffers[i] = _getPoolCmdBuffer(frame.secondaryPools[i % threadCount], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+			if (cmdBuffers[i] == VK_NULL_HANDLE)
+			{
+				GraphicsDevice::submitCommandQueues(queues);
+				return;
+			}
+		}
+
+		//a render pass holds either inline commands or secondary command buffers,
+		//which can't run predicated without the inheritedConditionalRendering feature
+		_endRenderPass();
+		if (mConditionActive)
+			_recordConditionalRender(false);
+		_beginRenderPass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		mUntrackedReads = true;
+
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = mRenderPassInfo.renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = mRenderPassInfo.framebuffer;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		//every queue starts from the current state, its stats are added up afterwards
+		std::vector<VulkanCommandContext> contexts(queueCount, mContext);
+		std::vector<DeviceStats> stats(queueCount, DeviceStats());
+		mRecordThreads.run([&](uint32_t worker)
+		{
+			for (uint32_t i = worker; i < queueCount; i += threadCount)
+			{
+				VulkanCommandContext &context = contexts[i];
+				context.cmdBuffer = cmdBuffers[i];
+				context.secondary = true;
+				context.stats = &stats[i];
+				context.boundPipeline = VK_NULL_HANDLE;
+				context.boundComputePipeline = VK_NULL_HANDLE;
+				context.vertexInputDirty = true;
+				context.descriptorsDirty = true;
+				context.descriptors = &frame.descriptorAllocators[worker];
+				context.constantRing = &frame.constantRings[worker];
+				context.constantsDirty = context.constantsSize > 0;
+
+				vkBeginCommandBuffer(context.cmdBuffer, &beginInfo);
+				vkCmdSetViewport(context.cmdBuffer, 0, 1, &context.viewport);
+				vkCmdSetScissor(context.cmdBuffer, 0, 1, &mRenderPassInfo.renderArea);
+
+				tRecordContext = &context;
+				stats[i].commands += _executeCommandQueue(queues[i]);
+				tRecordContext = nullptr;
+
+				vkEndCommandBuffer(context.cmdBuffer);
+			}
+		});
+
+		//run in submission order, the next inline command begins a new render pass
+		vkCmdExecuteCommands(mContext.cmdBuffer, queueCount, cmdBuffers.data());
+		_endRenderPass();
+		if (mConditionActive)
+			_recordConditionalRender(true);
+
+		for (const DeviceStats &queueStats : stats)
+		{
+			mStats.commands += queueStats.commands;
+			mStats.drawCalls += queueStats.drawCalls;
+			mStats.dispatchCalls += queueStats.dispatchCalls;
+			mStats.stateCalls += queueStats.stateCalls;
+			mStats.uploadCalls += queueStats.uploadCalls;
+		}
+
+		//bindings made by secondary command buffers don't carry over to the frame's
+		const VulkanCommandContext &last = contexts.back();
+		mContext.pipelineState = last.pipelineState;
+		mContext.pipelineDirty = last.pipelineDirty;
+		mContext.pipeline = last.pipeline;
+		mContext.boundPipeline = VK_NULL_HANDLE;
+		mContext.vertexInput = last.vertexInput;
+		mContext.vertexInputDirty = true;
+		mContext.viewport = last.viewport;
+		std::copy(last.constantBuffers, last.constantBuffers + MaxDescriptorSlots, mContext.constantBuffers);
+		std::copy(last.storageBuffers, last.storageBuffers + MaxDescriptorSlots, mContext.storageBuffers);
+		std::copy(last.textures, last.textures + MaxDescriptorSlots, mContext.textures);
+		mContext.descriptorsDirty = true;
+		std::copy(last.constants, last.constants + last.constantsSize, mContext.constants);
+		mContext.constantsSize = last.constantsSize;
+		mContext.constantsIndex = last.constantsIndex;
+		mContext.constantsDirty = last.constantsSize > 0;
+	}
+
+	void VulkanGraphicsDevice::submitAsyncCompute(CommandQueue *queue)
+	{
+		if (mFrames.empty())
+		{
+			GraphicsDevice::submitAsyncCompute(queue);
+			return;
+		}
+
+		//recorded for the frame presentFrame submits next, which waits for it
+		VulkanFrame &frame = mFrames[mFrameIndex];
+		VkCommandBuffer cmdBuffer = _getPoolCmdBuffer(frame.computePool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		VkSemaphore uploadSem = _getFrameSemaphore(frame);
+		VkSemaphore doneSem = _getFrameSemaphore(frame);
+		if (cmdBuffer == VK_NULL_HANDLE || uploadSem == VK_NULL_HANDLE || doneSem == VK_NULL_HANDLE)
+		{
+			GraphicsDevice::submitAsyncCompute(queue);
+			return;
+		}
+
+		//the queue starts from the current state, like one of submitCommandQueues
+		mUntrackedReads = true;
+		VulkanCommandContext context = mContext;
+		context.cmdBuffer = cmdBuffer;
+		context.secondary = false;
+		context.asyncCompute = true;
+		context.stats = &mStats;
+		context.boundComputePipeline = VK_NULL_HANDLE;
+		context.descriptorsDirty = true;
+		context.descriptors = &frame.descriptorAllocators[0];
+		context.constantRing = &frame.constantRings[0];
+		context.constantsDirty = context.constantsSize > 0;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+
+		tRecordContext = &context;
+		mStats.commands += _executeCommandQueue(queue);
+		tRecordContext = nullptr;
+
+		vkEndCommandBuffer(cmdBuffer);
+
+		{
+			//the queue waits for uploads still in flight, including its own, and signals the frame
+			std::lock_guard<std::mutex> lock(mUploadMutex);
+			const bool uploading = mUploader.flush(uploadSem);
+
+			const VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.waitSemaphoreCount = uploading ? 1 : 0;
+			submitInfo.pWaitSemaphores = &uploadSem;
+			submitInfo.pWaitDstStageMask = &waitStageMask;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &cmdBuffer;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &doneSem;
+			if (vkQueueSubmit(mComputeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+				std::printf("vkQueueSubmit failed for compute queue\n");
+			else
+				frame.computeDone.push_back(doneSem);
+		}
+
+		//state set by the queue carries over, its bindings don't
+		mContext.pipelineState = context.pipelineState;
+		mContext.pipelineDirty = context.pipelineDirty;
+		mContext.pipeline = context.pipeline;
+		mContext.vertexInput = context.vertexInput;
+		mContext.vertexInputDirty = true;
+		mContext.viewport = context.viewport;
+		if (mRenderPassActive)
+			vkCmdSetViewport(mContext.cmdBuffer, 0, 1, &mContext.viewport);
+		std::copy(context.constantBuffers, context.constantBuffers + MaxDescriptorSlots, mContext.constantBuffers);
+		std::copy(context.storageBuffers, context.storageBuffers + MaxDescriptorSlots, mContext.storageBuffers);
+		std::copy(context.textures, context.textures + MaxDescriptorSlots, mContext.textures);
+		mContext.descriptorsDirty = true;
+		std::copy(context.constants, context.constants + context.constantsSize, mContext.constants);
+		mContext.constantsSize = context.constantsSize;
+		mContext.constantsIndex = context.constantsIndex;
+		mContext.constantsDirty = context.constantsSize > 0;
+	}
+
+	//marks the pipeline for lookup at the next draw when value changes
+	template<typename T>
+	static inline void setPipelineState(T &field, const T value, bool &dirty)
+	{
+		if (field != value)
+		{
+			field = value;
+			dirty = true;
+		}
+	}
+
+	//Commands
+	void VulkanGraphicsDevice::_setShaderCmd(SetShaderCommand *cmd)
+	{
+		VulkanCommandContext &context = _context();
+		if (context.pipelineState.shader != cmd->handle)
+		{
+			//the new shader may take the constants as push constants instead of a constant buffer
+			context.descriptorsDirty = true;
+			context.constantsDirty = context.constantsSize > 0;
+		}
+		setPipelineState(context.pipelineState.shader, cmd->handle, context.pipelineDirty);
+	}
+
+	void VulkanGraphicsDevice::_beginFrameCmd(BeginFrameCommand *cmd)
+	{
+#ifdef _DEBUG
+		//every BeginFrame needs a presentFrame
+		if (mFrameActive)
+			assert(false);
+#endif
+		if (mFrameActive || _rejectSecondary())
+			return;
+
+		//like glClearColor and friends, values that aren't cleared keep their last setting
+		if (cmd->clearFlag & ClearBufferFlags::eColor)
+		{
+			mClearValues[0].color = { {cmd->clearColor[0], cmd->clearColor[1], cmd->clearColor[2], cmd->clearColor[3]} };
+		}
+
+		if (cmd->clearFlag & ClearBufferFlags::eDepth)
+		{
+			mClearValues[1].depthStencil.depth = cmd->depth;
+		}
+
+		if (cmd->clearFlag & ClearBufferFlags::eStencil)
+		{
+			mClearValues[1].depthStencil.stencil = static_cast<uint32_t>(cmd->stencil);
+		}
+
+		//until the swapchain can be replaced, such as while the window is minimized, frames are skipped
+		if (mSwapChainDirty && !_recreateSwapchain())
+			return;
+
+		//get the next image in the swap chain, an out of date one doesn't signal the semaphore so it can be tried again
+		VulkanFrame &frame = mFrames[mFrameIndex];
+		VkResult result = mConfig.headless ? VK_SUCCESS : vkAcquireNextImageKHR(mDevice, mSwapChainParams.swapChain, UINT64_MAX, frame.imageAvailableSem, VK_NULL_HANDLE, &mSwapChainParams.currentImageIndex);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			if (!_recreateSwapchain())
+				return;
+			result = vkAcquireNextImageKHR(mDevice, mSwapChainParams.swapChain, UINT64_MAX, frame.imageAvailableSem, VK_NULL_HANDLE, &mSwapChainParams.currentImageIndex);
+		}
+
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		{
+			std::printf("vkAcquireNextImageKHR failed\n");
+			return;
 		}
+
+		//a suboptimal image still presents, the swapchain is replaced for the next frame
+		if (result == VK_SUBOPTIMAL_KHR)
+			mSwapChainDirty = true;
+
+		//set image index for present info
+		mPresentInfo.pImageIndices = &mSwapChainParams.currentImageIndex;
+
+		//commands up to presentFrame are recorded into the frame's command buffer
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(frame.cmdBuffer, &beginInfo);
+
+		mFrameActive = true;
+		mRenderPassActive = false;
+		mDefaultCleared = false;
+		mCurrentTarget = InvalidHandle;
+		mContext.cmdBuffer = frame.cmdBuffer;
+		mContext.boundPipeline = VK_NULL_HANDLE;
+		mContext.boundComputePipeline = VK_NULL_HANDLE;
+		mContext.vertexInputDirty = true;
+		mContext.descriptorsDirty = true;
+		mContext.descriptors = &frame.descriptorAllocators[0];
+		mContext.constantRing = &frame.constantRings[0];
+		mContext.constantsDirty = mContext.constantsSize > 0;
+
+		//queries begin in the render pass, their slots are reset before it starts
+		for (auto &query : mQueries)
+			_resetQuerySlots(frame.cmdBuffer, query.second);
+
+		//the predicate outlives the frame, like opengl's conditional render
+		if (mConditionActive)
+			_recordConditionalRender(true);
+
+		//frames start on the swapchain's render pass
+		setPipelineState(mContext.pipelineState.renderPass, mRenderPass, mContext.pipelineDirty);
+		setPipelineState(mContext.pipelineState.samples, VK_SAMPLE_COUNT_1_BIT, mContext.pipelineDirty);
+		setPipelineState(mContext.pipelineState.colorAttachments, 1u, mContext.pipelineDirty);
+
+		//the swapchain image is cleared even if nothing draws to it
+		_beginRenderPass();
 	}
 
 	void VulkanGraphicsDevice::_updateBufferCmd(UpdateBufferCommand *cmd)
 	{
+		auto it = mBuffers.find(cmd->buffer);
+		if (it == mBuffers.end())
+			return;
+
+		_writeBuffer(it->second, cmd->offset, cmd->dataSize, cmd->data);
 	}
 
 	void VulkanGraphicsDevice::_reallocBufferCmd(ReallocBufferCommand *cmd)
 	{
+		auto it = mBuffers.find(cmd->buffer);
+		if (it == mBuffers.end() || _rejectSecondary())
+			return;
+
+		//the old buffer is destroyed once every frame that may use it has rendered
+		VulkanBuffer &buffer = it->second;
+		mFrames[mFrameIndex].deletedBuffers.push_back(buffer);
+		buffer.hint = cmd->hint;
+		buffer.copies = _getBufferCopies(buffer.type, buffer.hint);
+		mContext.vertexInputDirty = true;
+		if (!_createBuffer(buffer, cmd->stride * cmd->count, cmd->data))
+		{
+			_destroyBuffer(buffer);
+			mBuffers.erase(it);
+		}
 	}
 
 	void VulkanGraphicsDevice::_drawCmd(DrawCommand *cmd)
 	{
+		VulkanCommandContext &context = _context();
+		setPipelineState(context.pipelineState.primitive, cmd->primitive, context.pipelineDirty);
+		if (!_prepareDraw(context))
+			return;
+
+		if (context.vertexInput.indexBuffer != InvalidHandle)
+			vkCmdDrawIndexed(context.cmdBuffer, cmd->count, 1, cmd->start, cmd->baseVertex, 0);
+		else
+			vkCmdDraw(context.cmdBuffer, cmd->count, 1, cmd->start, 0);
+		++context.stats->drawCalls;
 	}
 
 	void VulkanGraphicsDevice::_drawInstanceCmd(DrawInstanceCommand *cmd)
 	{
+		VulkanCommandContext &context = _context();
+		setPipelineState(context.pipelineState.primitive, cmd->primitive, context.pipelineDirty);
+		if (!_prepareDraw(context))
+			return;
+
+		if (context.vertexInput.indexBuffer != InvalidHandle)
+			vkCmdDrawIndexed(context.cmdBuffer, cmd->count, cmd->instancedCount, cmd->start, cmd->baseVertex, cmd->baseInstance);
+		else
+			vkCmdDraw(context.cmdBuffer, cmd->count, cmd->instancedCount, cmd->start, cmd->baseInstance);
+		++context.stats->drawCalls;
 	}
 
 	void VulkanGraphicsDevice::_clearBufferCmd(ClearBufferCommand *cmd)
 	{
+		VulkanCommandContext &context = _context();
+		if (!mFrameActive || context.asyncCompute || (mConditionSkip && !context.secondary))
+			return;
+
+		uint32_t colorCount = 1;
+		VkExtent2D extent = mSwapChainParams.extent;
+		VkImageAspectFlags depthAspect = vkutils::getDepthAspect(mSwapChainParams.depthStencilFormat);
+		auto it = mRenderTargets.find(mCurrentTarget);
+		if (it != mRenderTargets.end())
+		{
+			colorCount = static_cast<uint32_t>(it->second.colorImages.size());
+			extent = it->second.extent;
+			depthAspect = it->second.depthImage.image ? vkutils::getDepthAspect(it->second.depthImage.format) : 0;
+		}
+
+		//cleared to the values of the last BeginFrame, as glClear
+		std::vector<VkClearAttachment> attachments;
+		if (cmd->flag & ClearBufferFlags::eColor)
+		{
+			for (uint32_t i = 0; i < colorCount; ++i)
+				attachments.push_back({ VK_IMAGE_ASPECT_COLOR_BIT, i, mClearValues[0] });
+		}
+
+		VkImageAspectFlags aspect = 0;
+		if (cmd->flag & ClearBufferFlags::eDepth)
+			aspect |= VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (cmd->flag & ClearBufferFlags::eStencil)
+			aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		aspect &= depthAspect;
+		if (aspect != 0)
+			attachments.push_back({ aspect, 0, mClearValues[1] });
+
+		if (attachments.empty())
+			return;
+
+		if (!context.secondary)
+			_beginRenderPass();
+		VkClearRect rect = {};
+		rect.rect.extent = extent;
+		rect.layerCount = 1;
+		vkCmdClearAttachments(context.cmdBuffer, static_cast<uint32_t>(attachments.size()), attachments.data(), 1, &rect);
 	}
 
 	//we have to fake this as VAO is an opengl only concept
 	void VulkanGraphicsDevice::_bindVAOCmd(BindVAOCommand *cmd)
 	{
+		auto it = mVAOs.find(cmd->vertexArray);
+		if (it == mVAOs.end())
+			return;
+
+		VulkanCommandContext &context = _context();
+		setPipelineState(context.pipelineState.layout, it->second.layout, context.pipelineDirty);
+		context.vertexInput = it->second.input;
+		context.vertexInputDirty = true;
 	}
 
+	//todo: opengl puts the origin at the bottom left, vulkan at the top left
 	void VulkanGraphicsDevice::_viewportCmd(ViewportCommand *cmd)
 	{
+		VulkanCommandContext &context = _context();
+		context.viewport.x = static_cast<float>(cmd->x);
+		context.viewport.y = static_cast<float>(cmd->y);
+		context.viewport.width = static_cast<float>(cmd->width);
+		context.viewport.height = static_cast<float>(cmd->height);
+
+		//otherwise set when the next render pass begins
+		if (context.secondary || (mRenderPassActive && !context.asyncCompute))
+			vkCmdSetViewport(context.cmdBuffer, 0, 1, &context.viewport);
+		++context.stats->stateCalls;
 	}
 
 	void VulkanGraphicsDevice::_blendStateCmd(BlendStateCommand *cmd)
 	{
+		VulkanCommandContext &context = _context();
+		setPipelineState(context.pipelineState.blendEnabled, cmd->enabled, context.pipelineDirty);
+		setPipelineState(context.pipelineState.blendSource, cmd->source, context.pipelineDirty);
+		setPipelineState(context.pipelineState.blendDest, cmd->dest, context.pipelineDirty);
 	}
 
 	void VulkanGraphicsDevice::_depthStencilStateCmd(DepthStencilStateCommand *cmd)
 	{
+		VulkanCommandContext &context = _context();
+		setPipelineState(context.pipelineState.depthEnabled, cmd->depthEnabled, context.pipelineDirty);
+		setPipelineState(context.pipelineState.depthWrite, cmd->depthWrite, context.pipelineDirty);
+		setPipelineState(context.pipelineState.depthFunc, cmd->depthFunc, context.pipelineDirty);
 	}
 
 	void VulkanGraphicsDevice::_cullStateCmd(CullStateCommand *cmd)
 	{
+		VulkanCommandContext &context = _context();
+		setPipelineState(context.pipelineState.cullEnabled, cmd->enabled, context.pipelineDirty);
+		setPipelineState(context.pipelineState.cullFace, cmd->face, context.pipelineDirty);
+		setPipelineState(context.pipelineState.winding, cmd->state, context.pipelineDirty);
+	}
+
+	void VulkanGraphicsDevice::_setConstantBufferRangeCmd(SetConstantBufferRangeCommand *cmd)
+	{
+#ifdef _DEBUG
+		if (cmd->index >= MaxDescriptorSlots || cmd->offset % getConstantBufferAlignment() != 0)
+			assert(false);
+#endif
+		if (cmd->index >= MaxDescriptorSlots)
+			return;
+
+		//the offset is dynamic, moving a sized range within the same buffer keeps the sets
+		VulkanCommandContext &context = _context();
+		VulkanBufferSlot &slot = context.constantBuffers[cmd->index];
+		if (slot.buffer == cmd->buffer && slot.constants == VK_NULL_HANDLE && cmd->size > 0 && slot.size == cmd->size)
+			context.offsetsDirty = true;
+		else
+			context.descriptorsDirty = true;
+		slot = { cmd->buffer, VK_NULL_HANDLE, cmd->offset, cmd->size };
+	}
+
+	void VulkanGraphicsDevice::_bindVertexBuffersCmd(BindVertexBuffersCommand *cmd)
+	{
+		VulkanCommandContext &context = _context();
+		setPipelineState(context.pipelineState.layout, cmd->layout, context.pipelineDirty);
+		VulkanVertexInput &input = context.vertexInput;
+		input.bufferCount = cmd->bufferCount;
+		for (uint32_t i = 0; i < cmd->bufferCount; ++i)
+		{
+			input.vertexBuffers[i] = cmd->vertexBuffers[i];
+			input.offsets[i] = cmd->offsets[i];
+		}
+		input.indexBuffer = cmd->indexBuffer;
+		input.indexType = cmd->indexType;
+		context.vertexInputDirty = true;
+#ifdef _DEBUG
+		//vulkan has no 8 bit indices
+		if (cmd->indexBuffer != InvalidHandle && cmd->indexType == IndexType::eUInt8)
+			assert(false);
+#endif
+	}
+
+	void VulkanGraphicsDevice::_bindRenderTargetCmd(BindRenderTargetCommand *cmd)
+	{
+		auto it = mRenderTargets.find(cmd->target);
+		const RenderTargetHandle handle = it != mRenderTargets.end() ? cmd->target : InvalidHandle;
+		if (handle != mCurrentTarget)
+		{
+			//secondary command buffers draw into the target bound when they were submitted
+			if (_rejectSecondary())
+				return;
+
+			//the target's render pass begins at the next command that draws
+			_endRenderPass();
+			mCurrentTarget = handle;
+			++mStats.stateCalls;
+		}
+
+		VulkanCommandContext &context = _context();
+		if (it == mRenderTargets.end())
+		{
+			setPipelineState(context.pipelineState.renderPass, mRenderPass, context.pipelineDirty);
+			setPipelineState(context.pipelineState.samples, VK_SAMPLE_COUNT_1_BIT, context.pipelineDirty);
+			setPipelineState(context.pipelineState.colorAttachments, 1u, context.pipelineDirty);
+			return;
+		}
+
+		const VulkanRenderTarget &target = it->second;
+		setPipelineState(context.pipelineState.renderPass, target.renderPass, context.pipelineDirty);
+		setPipelineState(context.pipelineState.samples, target.samples, context.pipelineDirty);
+		setPipelineState(context.pipelineState.colorAttachments, static_cast<uint32_t>(target.colorImages.size()), context.pipelineDirty);
+	}
+
+	//multisampled sources are resolved, others blitted, which also scales color
+	void VulkanGraphicsDevice::_resolveRenderTargetCmd(ResolveRenderTargetCommand *cmd)
+	{
+		auto sourceIt = mRenderTargets.find(cmd->source);
+		if (!mFrameActive || sourceIt == mRenderTargets.end() || _rejectSecondary())
+			return;
+		const VulkanRenderTarget &source = sourceIt->second;
+
+		//the default framebuffer is one color image, in the present layout between render passes
+		std::vector<VkImage> destColors;
+		VkImageLayout destColorLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		VkExtent2D destExtent = mSwapChainParams.extent;
+		const ImageParams *destDepth = nullptr;
+		if (cmd->destination == InvalidHandle)
+		{
+			destColors.push_back(mSwapChainParams.colorImages[mSwapChainParams.currentImageIndex].image);
+			destColorLayout = mPresentLayout;
+		}
+		else
+		{
+			auto destIt = mRenderTargets.find(cmd->destination);
+			if (destIt == mRenderTargets.end())
+				return;
+			for (auto &color : destIt->second.colorImages)
+				destColors.push_back(color.image);
+			destExtent = destIt->second.extent;
+			if (destIt->second.depthImage.image)
+				destDepth = &destIt->second.depthImage;
+		}
+
+		//transfers can't be recorded inside a render pass
+		_endRenderPass();
+		VkCommandBuffer cmdBuffer = mContext.cmdBuffer;
+		const bool multisampled = source.samples != VK_SAMPLE_COUNT_1_BIT;
+		const bool scaled = destExtent.width != source.extent.width || destExtent.height != source.extent.height;
+#ifdef _DEBUG
+		if (scaled && (multisampled || (cmd->flag & ~ClearBufferFlags::eColor) != 0))
+			assert(false);
+#endif
+
+		if ((cmd->flag & ClearBufferFlags::eColor) && cmd->colorAttachment < source.colorImages.size())
+		{
+			VkImage sourceImage = source.colorImages[cmd->colorAttachment].image;
+			const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			const VkImageSubresourceLayers layers = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+
+			vkutils::setImageLayout(cmdBuffer, sourceImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, range);
+			for (VkImage destImage : destColors)
+			{
+				vkutils::setImageLayout(cmdBuffer, destImage, destColorLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+				if (multisampled)
+				{
+					VkImageResolve region = {};
+					region.srcSubresource = layers;
+					region.dstSubresource = layers;
+					region.extent = { std::min(source.extent.width, destExtent.width), std::min(source.extent.height, destExtent.height), 1 };
+					vkCmdResolveImage(cmdBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+				}
+				else
+				{
+					VkImageBlit region = {};
+					region.srcSubresource = layers;
+					region.srcOffsets[1] = { static_cast<int32_t>(source.extent.width), static_cast<int32_t>(source.extent.height), 1 };
+					region.dstSubresource = layers;
+					region.dstOffsets[1] = { static_cast<int32_t>(destExtent.width), static_cast<int32_t>(destExtent.height), 1 };
+					vkCmdBlitImage(cmdBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region,
+						scaled ? VK_FILTER_LINEAR : VK_FILTER_NEAREST);
+				}
+				vkutils::setImageLayout(cmdBuffer, destImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, destColorLayout, range);
+			}
+			vkutils::setImageLayout(cmdBuffer, sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, range);
+		}
+
+		VkImageAspectFlags aspect = 0;
+		if (cmd->flag & ClearBufferFlags::eDepth)
+			aspect |= VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (cmd->flag & ClearBufferFlags::eStencil)
+			aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+		if (aspect == 0 || source.depthImage.image == VK_NULL_HANDLE)
+			return;
+
+		//the swapchain depth image isn't a transfer destination
+		if (cmd->destination == InvalidHandle)
+		{
+#ifdef _DEBUG
+			assert(false);
+#endif
+			std::printf("Depth and stencil can't be resolved to the default framebuffer\n");
+			return;
+		}
+		if (destDepth == nullptr)
+			return;
+		//vulkan 1.0 can't resolve depth
+		if (multisampled || scaled)
+		{
+			std::printf("Only single sampled depth of the same size can be copied between render targets\n");
+			return;
+		}
+
+		aspect &= vkutils::getDepthAspect(source.depthImage.format);
+		const VkImageSubresourceRange range = { aspect, 0, 1, 0, 1 };
+		const VkImageSubresourceLayers layers = { aspect, 0, 0, 1 };
+
+		VkImageBlit region = {};
+		region.srcSubresource = layers;
+		region.srcOffsets[1] = { static_cast<int32_t>(source.extent.width), static_cast<int32_t>(source.extent.height), 1 };
+		region.dstSubresource = layers;
+		region.dstOffsets[1] = region.srcOffsets[1];
+
+		vkutils::setImageLayout(cmdBuffer, source.depthImage.image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, range);
+		vkutils::setImageLayout(cmdBuffer, destDepth->image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+		vkCmdBlitImage(cmdBuffer, source.depthImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destDepth->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_NEAREST);
+		vkutils::setImageLayout(cmdBuffer, destDepth->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, range);
+		vkutils::setImageLayout(cmdBuffer, source.depthImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, range);
+	}
+
+	void VulkanGraphicsDevice::_updateTextureCmd(UpdateTextureCommand *cmd)
+	{
+		auto it = mTextures.find(cmd->texture);
+		if (it == mTextures.end() || _rejectSecondary())
+			return;
+		VulkanTexture &texture = it->second;
+#ifdef _DEBUG
+		if (cmd->mipLevel >= texture.levels || cmd->layer >= texture.details.layers)
+			assert(false);
+#endif
+		if (cmd->mipLevel >= texture.levels || cmd->layer >= texture.details.layers)
+			return;
+
+		//during a frame the copy is recorded in order with the draws, otherwise it is made ahead of the next frame
+		std::unique_lock<std::mutex> lock(mUploadMutex, std::defer_lock);
+		VkCommandBuffer cmdBuffer = mContext.cmdBuffer;
+		VkBuffer source;
+		VkDeviceSize offset;
+		if (mFrameActive)
+		{
+			if (!_stageFrameData(cmd->data, cmd->dataSize, source, offset))
+				return;
+			_endRenderPass();
+		}
+		else
+		{
+			lock.lock();
+			size_t stagingOffset;
+			if (!mUploader.stage(cmd->data, cmd->dataSize, stagingOffset))
+				return;
+			cmdBuffer = mUploader.getGraphicsCmdBuffer();
+			source = mUploader.getStagingBuffer();
+			offset = stagingOffset;
+		}
+		++mStats.uploadCalls;
+
+		const VkImageSubresourceRange range = { texture.aspect, cmd->mipLevel, 1, cmd->layer, 1 };
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = offset;
+		region.imageSubresource = { texture.aspect, cmd->mipLevel, cmd->layer, 1 };
+		region.imageOffset = { static_cast<int32_t>(cmd->x), static_cast<int32_t>(cmd->y), 0 };
+		region.imageExtent = { cmd->width, cmd->height, 1 };
+
+		vkutils::setImageLayout(cmdBuffer, texture.image.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+		vkCmdCopyBufferToImage(cmdBuffer, source, texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		vkutils::setImageLayout(cmdBuffer, texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, range);
+		if (lock.owns_lock())
+			lock.unlock();
+
+		//sampling reaches finer levels as soon as they and everything coarser are in
+		texture.coverage.add(cmd->mipLevel, cmd->layer, cmd->x, cmd->y, cmd->width, cmd->height);
+		const uint32_t completeFrom = texture.coverage.getCompleteFrom();
+		if (completeFrom < texture.baseLevel)
+		{
+			//frames in flight may still sample through the old view
+			VkImageView view = _createTextureView(texture, completeFrom);
+			if (view == VK_NULL_HANDLE)
+				return;
+			ImageParams oldView;
+			oldView.view = texture.image.view;
+			mFrames[mFrameIndex].deletedImages.push_back(oldView);
+			texture.image.view = view;
+			texture.baseLevel = completeFrom;
+			mContext.descriptorsDirty = true;
+		}
+	}
+
+	void VulkanGraphicsDevice::_bindTextureCmd(BindTextureCommand *cmd)
+	{
+#ifdef _DEBUG
+		if (cmd->unit >= MaxDescriptorSlots)
+			assert(false);
+#endif
+		if (cmd->unit >= MaxDescriptorSlots)
+			return;
+
+		VulkanCommandContext &context = _context();
+		context.textures[cmd->unit] = { cmd->texture, cmd->sampler };
+		context.descriptorsDirty = true;
+	}
+
+	void VulkanGraphicsDevice::_setStorageBufferRangeCmd(SetStorageBufferRangeCommand *cmd)
+	{
+#ifdef _DEBUG
+		if (cmd->index >= MaxDescriptorSlots || cmd->offset % getStorageBufferAlignment() != 0)
+			assert(false);
+#endif
+		if (cmd->index >= MaxDescriptorSlots)
+			return;
+
+		VulkanCommandContext &context = _context();
+		context.storageBuffers[cmd->index] = { cmd->buffer, VK_NULL_HANDLE, cmd->offset, cmd->size };
+		context.descriptorsDirty = true;
+	}
+
+	//kept until the next draw, when the bound shader decides how it is delivered
+	void VulkanGraphicsDevice::_setConstantsCmd(SetConstantsCommand *cmd)
+	{
+#ifdef _DEBUG
+		if (cmd->index >= MaxDescriptorSlots || cmd->dataSize > MaxConstantsSize)
+			assert(false);
+#endif
+		if (cmd->index >= MaxDescriptorSlots || cmd->dataSize > MaxConstantsSize)
+			return;
+
+		VulkanCommandContext &context = _context();
+		memcpy(context.constants, cmd->data, cmd->dataSize);
+		context.constantsSize = cmd->dataSize;
+		context.constantsIndex = cmd->index;
+		context.constantsDirty = cmd->dataSize > 0;
+	}
+
+	void VulkanGraphicsDevice::_dispatchCmd(DispatchCommand *cmd)
+	{
+		VulkanCommandContext &context = _context();
+		if (!_prepareDispatch(context))
+			return;
+
+		vkCmdDispatch(context.cmdBuffer, cmd->groupsX, cmd->groupsY, cmd->groupsZ);
+		++context.stats->dispatchCalls;
+	}
+
+	void VulkanGraphicsDevice::_dispatchIndirectCmd(DispatchIndirectCommand *cmd)
+	{
+		VulkanCommandContext &context = _context();
+		auto it = mBuffers.find(cmd->buffer);
+		if (it == mBuffers.end() || !_prepareDispatch(context))
+			return;
+
+		vkCmdDispatchIndirect(context.cmdBuffer, it->second.buffer, it->second.copy * it->second.stride + cmd->offset);
+		++context.stats->dispatchCalls;
+	}
+
+	//makes compute shader writes visible to the stages cmd->barriers reads them in
+	void VulkanGraphicsDevice::_memoryBarrierCmd(MemoryBarrierCommand *cmd)
+	{
+		VulkanCommandContext &context = _context();
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		vkutils::getMemoryBarrier(cmd->barriers, stages, access);
+
+		if (context.asyncCompute)
+		{
+			//a compute queue has no graphics stages, the semaphore the frame waits on covers those
+			stages &= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+			access &= VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+				VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		}
+		else
+		{
+			if (!mFrameActive || _rejectSecondary())
+				return;
+			//barriers inside a render pass need a self dependency, the render passes only have external ones
+			_endRenderPass();
+		}
+
+		if (stages == 0)
+			return;
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = access;
+		vkCmdPipelineBarrier(context.cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	//the query counts within the render pass it begins in, so it must end before the render target changes
+	void VulkanGraphicsDevice::_beginQueryCmd(BeginQueryCommand *cmd)
+	{
+		auto it = mQueries.find(cmd->query);
+		if (!mFrameActive || it == mQueries.end() || _rejectSecondary())
+			return;
+		VulkanQuery &query = it->second;
+#ifdef _DEBUG
+		if (query.active)
+			assert(false);
+#endif
+		//slots are reset at BeginFrame, only a query issued more often than that in one frame splits the render pass
+		if (query.reset == 0)
+		{
+			_endRenderPass();
+			_resetQuerySlots(mContext.cmdBuffer, query);
+		}
+
+		const uint32_t slot = (query.oldest + query.pending) % QueryLatency;
+		_beginRenderPass();
+		vkCmdBeginQuery(mContext.cmdBuffer, query.pool, slot, 0);
+
+		query.frames[slot] = mFrameNumber + 1;
+		++query.pending;
+		--query.reset;
+		query.active = true;
+	}
+
+	void VulkanGraphicsDevice::_endQueryCmd(EndQueryCommand *cmd)
+	{
+		auto it = mQueries.find(cmd->query);
+		if (!mFrameActive || it == mQueries.end() || _rejectSecondary())
+			return;
+		VulkanQuery &query = it->second;
+#ifdef _DEBUG
+		if (!query.active)
+			assert(false);
+#endif
+		const uint32_t slot = (query.oldest + query.pending - 1) % QueryLatency;
+		vkCmdEndQuery(mContext.cmdBuffer, query.pool, slot);
+		query.last = static_cast<int32_t>(slot);
+		query.active = false;
+	}
+
+	//the predicate is written outside a render pass, conditional rendering begun there may span several
+	void VulkanGraphicsDevice::_conditionalRenderCmd(ConditionalRenderCommand *cmd)
+	{
+		if (!mFrameActive || _rejectSecondary())
+			return;
+
+		if (mConditionActive)
+		{
+			_endRenderPass();
+			_recordConditionalRender(false);
+			mConditionActive = false;
+		}
+		mConditionSkip = false;
+
+		if (cmd->query == InvalidHandle)
+			return;
+
+		//nothing to decide on before the query has been issued once
+		auto it = mQueries.find(cmd->query);
+		if (it == mQueries.end() || it->second.last < 0)
+			return;
+		const VulkanQuery &query = it->second;
+
+		//without the extension the newest result already back decides, as if wait was false
+		if (!mConditionalRendering)
+		{
+			uint64_t samples;
+			mConditionSkip = getQueryResult(cmd->query, samples) && samples == 0;
+			return;
+		}
+
+		_endRenderPass();
+		VkCommandBuffer cmdBuffer = mContext.cmdBuffer;
+		VkBuffer predicate = mPredicateBuffer.buffer;
+
+		//earlier predicated commands, maybe of an earlier frame, finish reading the old value
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		//a result that was read is known, and its slot may have been reset since
+		const uint32_t slot = static_cast<uint32_t>(query.last);
+		if ((slot + QueryLatency - query.oldest) % QueryLatency >= query.pending)
+		{
+			vkCmdFillBuffer(cmdBuffer, predicate, 0, sizeof(uint32_t), query.result != 0 ? 1 : 0);
+		}
+		else
+		{
+			//without waiting, a result that isn't available writes nothing and the draws go ahead
+			if (!cmd->wait)
+			{
+				vkCmdFillBuffer(cmdBuffer, predicate, 0, sizeof(uint32_t), 1);
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			}
+			vkCmdCopyQueryPoolResults(cmdBuffer, query.pool, slot, 1, predicate, 0, sizeof(uint32_t), cmd->wait ? VK_QUERY_RESULT_WAIT_BIT : 0);
+		}
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT;
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		_recordConditionalRender(true);
+		mConditionActive = true;
+	}
+
+	//recorded outside render passes only, conditional rendering begun outside one can't end inside one
+	void VulkanGraphicsDevice::_recordConditionalRender(const bool begin)
+	{
+		if (!begin)
+		{
+			mCmdEndConditionalRendering(mContext.cmdBuffer);
+			return;
+		}
+
+		VkConditionalRenderingBeginInfoEXT beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT;
+		beginInfo.buffer = mPredicateBuffer.buffer;
+		beginInfo.offset = 0;
+		mCmdBeginConditionalRendering(mContext.cmdBuffer, &beginInfo);
 	}
 }
\ No newline at end of file
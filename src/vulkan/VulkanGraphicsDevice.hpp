@@ -25,17 +25,226 @@
 #ifndef _JIKKEN_VULKAN_VULKANGRAPHICSDEVICE_HPP_
 #define _JIKKEN_VULKAN_VULKANGRAPHICSDEVICE_HPP_
 
+#include <mutex>
 #include <unordered_map>
 #include <vulkan/vulkan.h>
 #include "jikken/graphicsDevice.hpp"
 #include "vulkan/VulkanStructs.hpp"
+#include "vulkan/VulkanAllocator.hpp"
+#include "vulkan/VulkanDescriptorCache.hpp"
+#include "vulkan/VulkanPipelineCache.hpp"
+#include "vulkan/VulkanUploader.hpp"
+#include "workerPool.hpp"
+#include "textureCoverage.hpp"
+#include "shaderUtils.hpp"
+
+struct GLFWwindow;
 
 namespace Jikken
 {
+	//constant buffer, storage buffer and texture indices, like opengl's binding points and texture units
+	const uint32_t MaxDescriptorSlots = 16;
+
+	//descriptor sets a shader may use, every vulkan device can bind this many
+	const uint32_t MaxDescriptorSets = 4;
+
+	//constant buffer descriptors a shader may use, each takes a dynamic offset
+	const uint32_t MaxDynamicOffsets = 8;
+
+	//a buffer or texture a shader reads, it takes what is bound to slot like an opengl block or sampler uniform
+	struct VulkanShaderResource
+	{
+		ShaderUtils::ShaderResource details;
+		VkShaderStageFlags stages;
+		uint32_t slot; //the binding until bindConstantBuffer and friends remap it
+	};
+
 	struct VulkanShader
 	{
 		std::vector<VkShaderModule> modules; //see ShaderStage for order
 		std::vector<VkPipelineShaderStageCreateInfo> stages;
+		std::vector<VulkanShaderResource> resources;
+		std::vector<VkDescriptorSetLayout> setLayouts; //per set number, owned by the layout cache
+		VkPipelineLayout pipelineLayout;
+		VkShaderStageFlags pushConstantStages; //0 without a push_constant block
+		uint32_t pushConstantSize;
+		VkPipeline computePipeline; //VK_NULL_HANDLE unless the only stage is compute
+	};
+
+	struct VulkanBuffer
+	{
+		VkBuffer buffer;
+		VulkanAllocation allocation;
+		BufferType type;
+		BufferUsageHint hint;
+		VkDeviceSize size;
+		bool concurrent; //shared with the async compute family instead of owned by one family
+
+		//host written buffers hold several copies, each frame writes one no frame in flight reads
+		uint32_t copies; //0 and 1 both mean the buffer is written in place
+		uint32_t copy; //the one commands recorded now read
+		VkDeviceSize stride; //between copies
+		uint64_t copyFrame; //number of the frame that moved to copy
+		std::vector<uint8_t> contents; //latest data, the next copy starts from it
+		VkDeviceSize readBegin; //range of copy the frame's commands read or copy to so far
+		VkDeviceSize readEnd;
+	};
+
+	struct VulkanLayout
+	{
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+	};
+
+	//vertex and index buffers the following draws read, from a VAO or BindVertexBuffersCommand
+	struct VulkanVertexInput
+	{
+		uint32_t bufferCount;
+		BufferHandle vertexBuffers[MaxVertexBufferBindings];
+		VkDeviceSize offsets[MaxVertexBufferBindings];
+		BufferHandle indexBuffer;
+		IndexType indexType;
+	};
+
+	//vulkan has no vertex array objects, they only remember what to bind
+	struct VulkanVAO
+	{
+		LayoutHandle layout;
+		VulkanVertexInput input;
+	};
+
+	struct VulkanRenderTarget
+	{
+		std::vector<ImageParams> colorImages;
+		ImageParams depthImage;
+		VkSampleCountFlagBits samples;
+		VkExtent2D extent;
+		VkRenderPass renderPass; //keeps the attachment contents, like an opengl framebuffer
+		VkFramebuffer framebuffer;
+	};
+
+	//every level and layer is in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL between copies
+	struct VulkanTexture
+	{
+		ImageParams image; //its view starts at baseLevel
+		TextureDetails details;
+		uint32_t levels;
+		VkImageAspectFlags aspect;
+		VkImageViewType viewType;
+		TextureCoverage coverage; //what was uploaded so far, to know when a level is complete
+		uint32_t baseLevel; //the finest level sampling may use, like GL_TEXTURE_BASE_LEVEL
+	};
+
+	struct VulkanQuery
+	{
+		//ring of queries, so a query can be issued again while earlier results are in flight
+		VkQueryPool pool;
+		std::vector<uint64_t> frames; //frame number each slot was last issued in
+		uint32_t oldest;
+		uint32_t pending;
+		uint32_t reset; //slots after the pending ones that are already reset, so they can begin inside a render pass
+		int32_t last;
+		bool active;
+		uint64_t result;
+		bool hasResult;
+	};
+
+	//command buffers one thread allocated for a frame, command pools must only be used by one thread at a time
+	struct VulkanCommandPool
+	{
+		VkCommandPool commandPool;
+		std::vector<VkCommandBuffer> cmdBuffers;
+		uint32_t used;
+	};
+
+	//a size of 0 covers the rest of the buffer
+	struct VulkanBufferSlot
+	{
+		BufferHandle buffer;
+		VkBuffer constants; //a block of the constant ring instead of buffer, for SetConstantsCommand
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	//host visible blocks data recorded into a frame is copied to, such as SetConstantsCommand data read through dynamic offsets
+	struct VulkanConstantRing
+	{
+		std::vector<VulkanBuffer> blocks;
+		uint32_t block;
+		VkDeviceSize used; //of blocks[block]
+	};
+
+	struct VulkanTextureSlot
+	{
+		TextureHandle texture;
+		SamplerHandle sampler; //InvalidHandle uses the default sampler
+	};
+
+	//state a command buffer is recorded with, the frame's own or a secondary one filled by a record thread
+	struct VulkanCommandContext
+	{
+		VkCommandBuffer cmdBuffer;
+		bool secondary; //runs inside the frame's current render pass, which it can't end
+		bool asyncCompute; //runs on mComputeQueue ahead of the frame, it only dispatches
+		DeviceStats *stats;
+
+		//pipelines are looked up at the first draw after the state changed
+		VulkanPipelineState pipelineState;
+		bool pipelineDirty;
+		VkPipeline pipeline;
+		VkPipeline boundPipeline;
+		VkPipeline boundComputePipeline;
+
+		VulkanVertexInput vertexInput;
+		bool vertexInputDirty;
+		VkViewport viewport;
+
+		//descriptor sets are written at the first draw after a binding changed, constant buffers
+		//use dynamic offsets so moving within the same buffer only binds the sets again
+		VulkanBufferSlot constantBuffers[MaxDescriptorSlots];
+		VulkanBufferSlot storageBuffers[MaxDescriptorSlots];
+		VulkanTextureSlot textures[MaxDescriptorSlots];
+		bool descriptorsDirty;
+		bool offsetsDirty;
+		VkDescriptorSet sets[MaxDescriptorSets];
+		uint32_t setCount;
+		VulkanDescriptorAllocator *descriptors; //of the frame, for the thread recording
+
+		//SetConstantsCommand data, pushed or copied to the constant ring at the next draw
+		uint8_t constants[MaxConstantsSize];
+		uint32_t constantsSize;
+		uint32_t constantsIndex;
+		bool constantsDirty;
+		VulkanConstantRing *constantRing; //of the frame, for the thread recording
+	};
+
+	//a frame in flight, its objects are reused once the fence has signaled
+	struct VulkanFrame
+	{
+		VkCommandPool commandPool; //reset as a whole when the frame is reused
+		VkCommandBuffer cmdBuffer;
+		std::vector<VulkanCommandPool> secondaryPools; //one per record thread
+		VulkanCommandPool computePool; //of the compute family, for submitAsyncCompute
+		std::vector<VulkanDescriptorAllocator> descriptorAllocators; //one per record thread, reset with the frame
+		std::vector<VulkanConstantRing> constantRings; //one per record thread, reset with the frame
+		VulkanConstantRing uploadRing; //updates recorded during the frame are copied from it, reset with the frame
+		VkFence fence;
+		VkSemaphore imageAvailableSem;
+		VkSemaphore renderFinishedSem;
+		std::vector<VkSemaphore> semaphores; //between async compute and the other queues, reused with the frame
+		uint32_t semaphoresUsed;
+		std::vector<VkSemaphore> computeDone; //signaled by async compute submits the frame's submit waits for
+		uint64_t number; //last frame submitted with these objects
+
+		//resources deleted while the frame was recorded, destroyed after it has rendered
+		std::vector<VulkanBuffer> deletedBuffers;
+		std::vector<ImageParams> deletedImages;
+		std::vector<VulkanRenderTarget> deletedRenderTargets;
+		std::vector<VulkanShader> deletedShaders;
+		std::vector<VkPipeline> deletedPipelines;
+		std::vector<VkSampler> deletedSamplers;
+		std::vector<VkQueryPool> deletedQueryPools;
+		std::vector<SwapChainParams> retiredSwapChains; //replaced by a resize while frames still used them
 	};
 
 	class VulkanGraphicsDevice : public GraphicsDevice
@@ -45,16 +254,48 @@ namespace Jikken
 		VulkanGraphicsDevice();
 		virtual ~VulkanGraphicsDevice();
 
-		virtual ShaderHandle createShader(const std::vector<ShaderDetails> &shaders) override;
+		virtual ShaderHandle createShader(const std::vector<ShaderDetails> &shaders, bool async = false) override;
+
+		virtual ShaderStatus getShaderStatus(ShaderHandle handle) override;
 
 		virtual BufferHandle createBuffer(BufferType type, BufferUsageHint hint, size_t dataSize, float *data) override;
 
 		virtual LayoutHandle createVertexInputLayout(const std::vector<VertexInputLayout> &attributes) override;
 
-		virtual VertexArrayHandle createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer = 0) override;
+		virtual VertexArrayHandle createVAO(LayoutHandle layout, BufferHandle vertexBuffer, BufferHandle indexBuffer = 0, IndexType indexType = IndexType::eUInt16) override;
+
+		virtual VertexArrayHandle createVAO(LayoutHandle layout, const std::vector<BufferHandle> &vertexBuffers, BufferHandle indexBuffer = InvalidHandle, IndexType indexType = IndexType::eUInt16) override;
 
 		virtual void bindConstantBuffer(ShaderHandle shader, BufferHandle cBuffer, const char *name, int32_t index) override;
 
+		virtual size_t getConstantBufferAlignment() override;
+
+		virtual void bindStorageBuffer(ShaderHandle shader, BufferHandle sBuffer, const char *name, int32_t index) override;
+
+		virtual size_t getStorageBufferAlignment() override;
+
+		virtual RenderTargetHandle createRenderTarget(const RenderTargetDetails &details) override;
+
+		virtual void deleteRenderTarget(RenderTargetHandle handle) override;
+
+		virtual TextureHandle createTexture(const TextureDetails &details) override;
+
+		virtual void deleteTexture(TextureHandle handle) override;
+
+		virtual SamplerHandle createSampler(const SamplerDetails &details) override;
+
+		virtual void deleteSampler(SamplerHandle handle) override;
+
+		virtual void bindTextureUnit(ShaderHandle shader, const char *name, int32_t unit) override;
+
+		virtual bool readPixels(RenderTargetHandle target, uint32_t colorAttachment, int32_t x, int32_t y, uint32_t width, uint32_t height, void *data) override;
+
+		virtual QueryHandle createQuery(QueryType type) override;
+
+		virtual void deleteQuery(QueryHandle handle) override;
+
+		virtual bool getQueryResult(QueryHandle handle, uint64_t &result) override;
+
 		virtual void deleteVertexInputLayout(LayoutHandle handle) override;
 
 		virtual void deleteVAO(VertexArrayHandle handle) override;
@@ -63,10 +304,14 @@ namespace Jikken
 
 		virtual void deleteShader(ShaderHandle handle) override;
 
-		virtual bool init(void *glfwWinHandle) override;
+		virtual bool init(const DeviceConfig &config, void *glfwWinHandle) override;
 
 		virtual void presentFrame() override;
 
+		virtual void submitCommandQueues(const std::vector<CommandQueue*> &queues) override;
+
+		virtual void submitAsyncCompute(CommandQueue *queue) override;
+
 	protected:
 		virtual void _setShaderCmd(SetShaderCommand *cmd) override;
 		virtual void _beginFrameCmd(BeginFrameCommand *cmd) override;
@@ -80,38 +325,153 @@ namespace Jikken
 		virtual void _blendStateCmd(BlendStateCommand *cmd) override;
 		virtual void _depthStencilStateCmd(DepthStencilStateCommand *cmd) override;
 		virtual void _cullStateCmd(CullStateCommand *cmd) override;
+		virtual void _setConstantBufferRangeCmd(SetConstantBufferRangeCommand *cmd) override;
+		virtual void _bindVertexBuffersCmd(BindVertexBuffersCommand *cmd) override;
+		virtual void _bindRenderTargetCmd(BindRenderTargetCommand *cmd) override;
+		virtual void _resolveRenderTargetCmd(ResolveRenderTargetCommand *cmd) override;
+		virtual void _updateTextureCmd(UpdateTextureCommand *cmd) override;
+		virtual void _bindTextureCmd(BindTextureCommand *cmd) override;
+		virtual void _setStorageBufferRangeCmd(SetStorageBufferRangeCommand *cmd) override;
+		virtual void _dispatchCmd(DispatchCommand *cmd) override;
+		virtual void _dispatchIndirectCmd(DispatchIndirectCommand *cmd) override;
+		virtual void _memoryBarrierCmd(MemoryBarrierCommand *cmd) override;
+		virtual void _beginQueryCmd(BeginQueryCommand *cmd) override;
+		virtual void _endQueryCmd(EndQueryCommand *cmd) override;
+		virtual void _conditionalRenderCmd(ConditionalRenderCommand *cmd) override;
+		virtual void _setConstantsCmd(SetConstantsCommand *cmd) override;
 
 	private:
 
 		//private functions
 		bool _createSwapchain();
+		bool _createDepthStencil();
+		bool _recreateSwapchain();
+		void _destroySwapchain(SwapChainParams &swapChain);
 		bool _createDefaultRenderPass();
+		bool _createRenderPass(const VkAttachmentLoadOp loadOp, const VkImageLayout colorLayout, const VkImageLayout depthLayout, VkRenderPass &renderPass);
 		bool _createFramebuffers();
+		VkImageView _createTextureView(const VulkanTexture &texture, const uint32_t baseLevel);
+		bool _createImage(ImageParams &image, const VkExtent2D extent, const VkSampleCountFlagBits samples, const VkImageUsageFlags usage, const VkImageAspectFlags aspect,
+			const uint32_t mipLevels = 1, const uint32_t layers = 1, const VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D, const VkImageCreateFlags flags = 0);
+		bool _createBuffer(VulkanBuffer &buffer, VkDeviceSize size, const void *data);
+		uint32_t _getBufferCopies(const BufferType type, const BufferUsageHint hint) const;
+		bool _createHostBuffer(VulkanBuffer &buffer, VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags preferred);
+		bool _stageFrameData(const void *data, VkDeviceSize size, VkBuffer &source, VkDeviceSize &sourceOffset);
+		void _recordBufferCopy(VkBuffer source, VkDeviceSize sourceOffset, VkBuffer dest, VkDeviceSize destOffset, VkDeviceSize size);
+		void _destroyBuffer(VulkanBuffer &buffer);
+		bool _writeBuffer(VulkanBuffer &buffer, VkDeviceSize offset, VkDeviceSize size, const void *data, const bool newBuffer = false);
+		bool _createFrames();
+		void _waitFrame(VulkanFrame &frame);
+		void _destroyFrame(VulkanFrame &frame);
+		void _destroyDeleted(VulkanFrame &frame);
+		void _resetQuerySlots(VkCommandBuffer cmdBuffer, VulkanQuery &query);
+		VkCommandBuffer _getPoolCmdBuffer(VulkanCommandPool &pool, const VkCommandBufferLevel level);
+		VkSemaphore _getFrameSemaphore(VulkanFrame &frame);
+		VulkanCommandContext& _context();
+		bool _rejectSecondary();
+		VkPipeline _getPipeline(VulkanCommandContext &context);
+		VkPipeline _createPipeline(const VulkanPipelineState &state);
+		void _beginRenderPass(const VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+		void _endRenderPass();
+		void _recordConditionalRender(const bool begin);
+		bool _prepareDraw(VulkanCommandContext &context);
+		bool _prepareDispatch(VulkanCommandContext &context);
+		bool _bindDescriptors(VulkanCommandContext &context, const VulkanShader &shader, const VkPipelineBindPoint bindPoint);
+		bool _applyConstants(VulkanCommandContext &context, const VulkanShader &shader);
+		void _setResourceSlot(ShaderHandle shader, const char *name, const ShaderUtils::ShaderResourceType type, const int32_t slot);
+		void _destroyImage(ImageParams &image);
+		void _destroyRenderTarget(VulkanRenderTarget &target);
+		void _destroyShader(VulkanShader &shader);
 
 		//private variables
 		VkInstance mInstance; //vulkan app instance
 		VkSurfaceKHR mSurface; //window surface
+		GLFWwindow *mWindow; //window the surface belongs to
 		VkPhysicalDevice mPhysicalDevice; //physical device
+		VkPhysicalDeviceProperties mDeviceProperties; //physical device properties and limits
+		VkPhysicalDeviceFeatures mEnabledFeatures; //optional features the device has, enabled at creation
 		VkDevice mDevice; // logical device
 		VkQueue mGraphicsQueue; //graphics queue
 		VkQueue mComputeQueue; //compute queue
+		VkQueue mTransferQueue; //transfer queue, mGraphicsQueue if there is no separate one
 		uint32_t mGraphicsQueueIndex; //graphics queue index
 		uint32_t mComputeQueueIndex; // compute queue index
-		VkRenderPass mRenderPass; //render pass
-		std::vector<VkCommandBuffer> mCommandBuffers;
-		VkCommandBuffer mSingleCmdBuffer; //special command buffer used for single command execution
-		VkCommandPool mCommandPool;
+		uint32_t mTransferQueueIndex; //transfer queue index
+		std::vector<uint32_t> mSharedFamilies; //families concurrent buffers are shared by, empty when compute runs on the graphics family
+		VkRenderPass mRenderPass; //render pass, clears the swapchain image at the start of a frame
+		VkRenderPass mLoadRenderPass; //compatible with mRenderPass, resumes drawing to the swapchain image
 		VkDebugReportCallbackEXT mDebugCallback; //debug callback
 		VkAllocationCallbacks *mAllocCallback; //allocation callback
 		SwapChainParams mSwapChainParams; //swap chain paramaters
 		ViewportParams mViewPortParams; //viewport paramaters
 		VkPresentInfoKHR mPresentInfo; //present struct
+		bool mSwapChainDirty; //out of date or suboptimal, replaced before the next frame acquires an image
+		VkImageLayout mPresentLayout; //of the default framebuffer's color image between render passes, a transfer source when headless
+
+		//frames in flight, the one at mFrameIndex is being recorded
+		std::vector<VulkanFrame> mFrames;
+		uint32_t mFrameIndex;
+		uint64_t mFrameNumber; //frames submitted so far
+		uint64_t mCompletedFrame; //newest frame known to have rendered
+
+		//recording state of the frame command buffer, render passes begin at the first command that needs one
+		VulkanCommandContext mContext;
+		bool mFrameActive; //between BeginFrame and presentFrame
+		bool mRenderPassActive;
+		bool mUntrackedReads; //record threads or async compute read buffers this frame, so any write may overlap a read
+		VkRenderPassBeginInfo mRenderPassInfo; //of the active render pass, secondary command buffers inherit it
+		bool mDefaultCleared; //the swapchain image was cleared this frame
+		RenderTargetHandle mCurrentTarget;
+		VkClearValue mClearValues[2]; //color and depth/stencil, set by BeginFrame
+
+		//ConditionalRenderCommand goes through VK_EXT_conditional_rendering where the device has it
+		bool mConditionalRendering; //the extension is enabled
+		PFN_vkCmdBeginConditionalRenderingEXT mCmdBeginConditionalRendering;
+		PFN_vkCmdEndConditionalRenderingEXT mCmdEndConditionalRendering;
+		VulkanBuffer mPredicateBuffer; //32 bit value, draws are discarded while it is zero
+		bool mConditionActive; //draws are predicated on mPredicateBuffer, every frame until InvalidHandle ends it
+		bool mConditionSkip; //without the extension, draws are skipped on the cpu instead
+
+		//submitCommandQueues records one secondary command buffer per queue on these threads
+		WorkerPool mRecordThreads;
+		std::mutex mPipelineMutex; //held while looking up or creating pipelines
+		std::mutex mUploadMutex; //held while using mUploader, or mMemory on a record thread
 
-		VkSemaphore mImageAvailableSem;
-		VkSemaphore mRenderFinishedSem;
+		//device memory every buffer and image is sub-allocated from
+		VulkanAllocator mMemory;
+
+		//shaders with the same resources share set layouts
+		VulkanDescriptorLayoutCache mDescriptorLayouts;
+		VkSampler mDefaultSampler; //for textures bound without a sampler
 
 		ShaderHandle mShaderHandle;
 		std::unordered_map<ShaderHandle, VulkanShader> mShaders;
+
+		BufferHandle mBufferHandle;
+		std::unordered_map<BufferHandle, VulkanBuffer> mBuffers;
+
+		LayoutHandle mLayoutHandle;
+		std::unordered_map<LayoutHandle, VulkanLayout> mLayouts;
+
+		VertexArrayHandle mVAOHandle;
+		std::unordered_map<VertexArrayHandle, VulkanVAO> mVAOs;
+
+		RenderTargetHandle mRenderTargetHandle;
+		std::unordered_map<RenderTargetHandle, VulkanRenderTarget> mRenderTargets;
+
+		TextureHandle mTextureHandle;
+		std::unordered_map<TextureHandle, VulkanTexture> mTextures;
+
+		SamplerHandle mSamplerHandle;
+		std::unordered_map<SamplerHandle, VkSampler> mSamplers;
+
+		QueryHandle mQueryHandle;
+		std::unordered_map<QueryHandle, VulkanQuery> mQueries;
+
+		VulkanPipelineCache mPipelineCache;
+
+		//buffer and texture data is staged through it, copies recorded during a frame are submitted ahead of it
+		VulkanUploader mUploader;
 	};
 }
 
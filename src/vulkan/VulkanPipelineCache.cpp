@@ -0,0 +1,267 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include "vulkan/VulkanPipelineCache.hpp"
+#include "hashUtils.hpp"
+
+namespace Jikken
+{
+	// File layout: header followed by blobSize bytes of VkPipelineCache data.
+	struct PipelineCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t uuid[VK_UUID_SIZE];
+		uint64_t blobSize;
+	};
+
+	const uint32_t PIPELINE_CACHE_MAGIC = 0x4C504B4A; // "JKPL"
+	const uint32_t PIPELINE_CACHE_VERSION = 1;
+
+	VulkanPipelineState::VulkanPipelineState() :
+		shader(InvalidHandle),
+		layout(InvalidHandle),
+		renderPass(VK_NULL_HANDLE),
+		samples(VK_SAMPLE_COUNT_1_BIT),
+		colorAttachments(1),
+		primitive(PrimitiveType::eTriangles),
+		blendEnabled(false),
+		blendSource(BlendState::eOne),
+		blendDest(BlendState::eZero),
+		depthEnabled(false),
+		depthWrite(true),
+		depthFunc(DepthFunc::eLess),
+		cullEnabled(false),
+		cullFace(CullFaceState::eBack),
+		winding(WindingOrderState::eCCW)
+	{
+	}
+
+	//field by field, padding bytes are undefined
+	uint64_t VulkanPipelineState::computeHash() const
+	{
+		uint64_t hash = HashUtils::fnv1aValue(shader);
+		hash = HashUtils::fnv1aValue(layout, hash);
+		hash = HashUtils::fnv1aValue(renderPass, hash);
+		hash = HashUtils::fnv1aValue(samples, hash);
+		hash = HashUtils::fnv1aValue(colorAttachments, hash);
+		hash = HashUtils::fnv1aValue(primitive, hash);
+		hash = HashUtils::fnv1aValue(blendEnabled, hash);
+		hash = HashUtils::fnv1aValue(blendSource, hash);
+		hash = HashUtils::fnv1aValue(blendDest, hash);
+		hash = HashUtils::fnv1aValue(depthEnabled, hash);
+		hash = HashUtils::fnv1aValue(depthWrite, hash);
+		hash = HashUtils::fnv1aValue(depthFunc, hash);
+		hash = HashUtils::fnv1aValue(cullEnabled, hash);
+		hash = HashUtils::fnv1aValue(cullFace, hash);
+		hash = HashUtils::fnv1aValue(winding, hash);
+		return hash;
+	}
+
+	bool VulkanPipelineState::operator==(const VulkanPipelineState &other) const
+	{
+		return shader == other.shader &&
+			layout == other.layout &&
+			renderPass == other.renderPass &&
+			samples == other.samples &&
+			colorAttachments == other.colorAttachments &&
+			primitive == other.primitive &&
+			blendEnabled == other.blendEnabled &&
+			blendSource == other.blendSource &&
+			blendDest == other.blendDest &&
+			depthEnabled == other.depthEnabled &&
+			depthWrite == other.depthWrite &&
+			depthFunc == other.depthFunc &&
+			cullEnabled == other.cullEnabled &&
+			cullFace == other.cullFace &&
+			winding == other.winding;
+	}
+
+	VulkanPipelineCache::VulkanPipelineCache() :
+		mDevice(VK_NULL_HANDLE),
+		mAllocCallback(nullptr),
+		mCache(VK_NULL_HANDLE),
+		mProperties()
+	{
+	}
+
+	bool VulkanPipelineCache::init(VkDevice device, const VkPhysicalDeviceProperties &properties, const std::string &directory, VkAllocationCallbacks *allocCallback)
+	{
+		mDevice = device;
+		mAllocCallback = allocCallback;
+		mProperties = properties;
+
+		std::vector<uint8_t> blob;
+		if (!directory.empty())
+		{
+			mPath = directory;
+			if (mPath.back() != '/' && mPath.back() != '\\')
+				mPath += '/';
+			mPath += "vulkan.pipelinecache";
+			_load(blob);
+		}
+
+		VkPipelineCacheCreateInfo cacheInfo = {};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = blob.size();
+		cacheInfo.pInitialData = blob.empty() ? nullptr : blob.data();
+
+		VkResult result = vkCreatePipelineCache(mDevice, &cacheInfo, mAllocCallback, &mCache);
+		if (result != VK_SUCCESS && !blob.empty())
+		{
+			//the driver may still refuse a blob we think matches, start empty instead
+			std::remove(mPath.c_str());
+			cacheInfo.initialDataSize = 0;
+			cacheInfo.pInitialData = nullptr;
+			result = vkCreatePipelineCache(mDevice, &cacheInfo, mAllocCallback, &mCache);
+		}
+
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreatePipelineCache failed\n");
+			return false;
+		}
+		return true;
+	}
+
+	void VulkanPipelineCache::destroy()
+	{
+		for (auto &entry : mPipelines)
+			vkDestroyPipeline(mDevice, entry.second.pipeline, mAllocCallback);
+		mPipelines.clear();
+
+		if (mCache)
+		{
+			if (!mPath.empty())
+				_save();
+			vkDestroyPipelineCache(mDevice, mCache, mAllocCallback);
+			mCache = VK_NULL_HANDLE;
+		}
+	}
+
+	VkPipeline VulkanPipelineCache::find(const VulkanPipelineState &state, uint64_t hash) const
+	{
+		auto range = mPipelines.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second.state == state)
+				return it->second.pipeline;
+		}
+		return VK_NULL_HANDLE;
+	}
+
+	void VulkanPipelineCache::insert(const VulkanPipelineState &state, uint64_t hash, VkPipeline pipeline)
+	{
+		Entry entry = { state, pipeline };
+		mPipelines.insert(std::make_pair(hash, entry));
+	}
+
+	bool VulkanPipelineCache::_load(std::vector<uint8_t> &blob) const
+	{
+		FILE *file = fopen(mPath.c_str(), "rb");
+		if (file == nullptr)
+			return false;
+
+		//blobs are only valid for the exact device and driver that produced them
+		PipelineCacheHeader header;
+		bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+			header.magic == PIPELINE_CACHE_MAGIC &&
+			header.version == PIPELINE_CACHE_VERSION &&
+			header.vendorID == mProperties.vendorID &&
+			header.deviceID == mProperties.deviceID &&
+			header.driverVersion == mProperties.driverVersion &&
+			memcmp(header.uuid, mProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+			header.blobSize > 0;
+
+		if (valid)
+		{
+			blob.resize(static_cast<size_t>(header.blobSize));
+			valid = fread(blob.data(), 1, blob.size(), file) == blob.size();
+		}
+		fclose(file);
+
+		if (!valid)
+		{
+			blob.clear();
+			std::remove(mPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	void VulkanPipelineCache::_save() const
+	{
+		size_t size = 0;
+		if (vkGetPipelineCacheData(mDevice, mCache, &size, nullptr) != VK_SUCCESS || size == 0)
+			return;
+
+		std::vector<uint8_t> blob(size);
+		if (vkGetPipelineCacheData(mDevice, mCache, &size, blob.data()) != VK_SUCCESS)
+			return;
+
+		PipelineCacheHeader header = {};
+		header.magic = PIPELINE_CACHE_MAGIC;
+		header.version = PIPELINE_CACHE_VERSION;
+		header.vendorID = mProperties.vendorID;
+		header.deviceID = mProperties.deviceID;
+		header.driverVersion = mProperties.driverVersion;
+		memcpy(header.uuid, mProperties.pipelineCacheUUID, VK_UUID_SIZE);
+		header.blobSize = size;
+
+		// Written next to the cache and renamed over it, so a crash or another
+		// process saving at the same time never leaves a truncated cache.
+		const std::string tempPath = mPath + ".tmp";
+		FILE *file = fopen(tempPath.c_str(), "wb");
+		if (file == nullptr)
+		{
+			std::printf("Unable to open %s for writing. Pipeline cache not saved.\n", tempPath.c_str());
+			return;
+		}
+
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(blob.data(), 1, size, file) == size;
+		written = fclose(file) == 0 && written;
+		if (!written)
+		{
+			std::remove(tempPath.c_str());
+			return;
+		}
+
+		// Windows doesn't rename over an existing file.
+		if (std::rename(tempPath.c_str(), mPath.c_str()) != 0)
+		{
+			std::remove(mPath.c_str());
+			if (std::rename(tempPath.c_str(), mPath.c_str()) != 0)
+			{
+				std::printf("Unable to replace %s. Pipeline cache not saved.\n", mPath.c_str());
+				std::remove(tempPath.c_str());
+			}
+		}
+	}
+}
@@ -0,0 +1,139 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_VULKAN_VULKANPIPELINECACHE_HPP_
+#define _JIKKEN_VULKAN_VULKANPIPELINECACHE_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "jikken/enums.hpp"
+#include "jikken/types.hpp"
+
+namespace Jikken
+{
+	/// Everything a graphics pipeline is built from. Viewport and scissor are
+	/// dynamic state, so they never cause a new pipeline.
+	struct VulkanPipelineState
+	{
+		ShaderHandle shader;
+		LayoutHandle layout;
+		VkRenderPass renderPass;
+		VkSampleCountFlagBits samples;
+		uint32_t colorAttachments;
+		PrimitiveType primitive;
+
+		bool blendEnabled;
+		BlendState blendSource;
+		BlendState blendDest;
+
+		bool depthEnabled;
+		bool depthWrite;
+		DepthFunc depthFunc;
+
+		bool cullEnabled;
+		CullFaceState cullFace;
+		WindingOrderState winding;
+
+		VulkanPipelineState();
+
+		uint64_t computeHash() const;
+		bool operator==(const VulkanPipelineState &other) const;
+	};
+
+	/// Graphics pipelines by a hash of their state, created once and found in
+	/// O(1) afterwards. Creation goes through a VkPipelineCache whose blob is
+	/// saved in the device cache directory, so pipelines seen in earlier runs
+	/// skip most of the driver's compile work.
+	class VulkanPipelineCache
+	{
+	public:
+		VulkanPipelineCache();
+
+		/// Seeds the VkPipelineCache from directory. Empty disables the disk cache.
+		bool init(VkDevice device, const VkPhysicalDeviceProperties &properties, const std::string &directory, VkAllocationCallbacks *allocCallback);
+
+		/// Saves the VkPipelineCache blob and destroys every pipeline.
+		void destroy();
+
+		/// @return The pipeline built for state, or VK_NULL_HANDLE if there is none yet.
+		VkPipeline find(const VulkanPipelineState &state, uint64_t hash) const;
+
+		void insert(const VulkanPipelineState &state, uint64_t hash, VkPipeline pipeline);
+
+		/// Removes the pipelines matches(state) returns true for, such as those of a
+		/// deleted shader. They are appended to removed, for the caller to destroy
+		/// once the GPU no longer uses them.
+		template<typename Matches>
+		void erase(Matches matches, std::vector<VkPipeline> &removed)
+		{
+			for (auto it = mPipelines.begin(); it != mPipelines.end();)
+			{
+				if (matches(it->second.state))
+				{
+					removed.push_back(it->second.pipeline);
+					it = mPipelines.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+
+		inline VkPipelineCache getCache() const
+		{
+			return mCache;
+		}
+
+		inline size_t getCount() const
+		{
+			return mPipelines.size();
+		}
+
+	private:
+		VulkanPipelineCache(const VulkanPipelineCache&);
+		VulkanPipelineCache& operator=(const VulkanPipelineCache&);
+
+		bool _load(std::vector<uint8_t> &blob) const;
+		void _save() const;
+
+		struct Entry
+		{
+			VulkanPipelineState state;
+			VkPipeline pipeline;
+		};
+
+		VkDevice mDevice;
+		VkAllocationCallbacks *mAllocCallback;
+		VkPipelineCache mCache;
+		VkPhysicalDeviceProperties mProperties;
+		std::string mPath;
+		//hashes are 64 bit, a collision only costs a second lookup
+		std::unordered_multimap<uint64_t, Entry> mPipelines;
+	};
+}
+
+#endif
@@ -26,6 +26,7 @@
 #define _JIKKEN_VULKAN_VULKANSTRUCTS_HPP_
 
 #include <vulkan/vulkan.h>
+#include "vulkan/VulkanAllocator.hpp"
 
 namespace Jikken
 {
@@ -35,7 +36,7 @@ namespace Jikken
 		VkImage image;
 		VkImageView view;
 		VkSampler sampler;
-		VkDeviceMemory memory;
+		VulkanAllocation allocation;
 		VkFormat format;
 
 		ImageParams() :
@@ -43,7 +44,7 @@ namespace Jikken
 			image(VK_NULL_HANDLE),
 			view(VK_NULL_HANDLE),
 			sampler(VK_NULL_HANDLE),
-			memory(VK_NULL_HANDLE),
+			allocation(),
 			format(VK_FORMAT_UNDEFINED)
 		{}
 	};
@@ -0,0 +1,461 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include "vulkan/VulkanUploader.hpp"
+#include "vulkan/VulkanUtil.hpp"
+
+namespace Jikken
+{
+	VulkanUploader::VulkanUploader() :
+		mDevice(VK_NULL_HANDLE),
+		mPhysicalDevice(VK_NULL_HANDLE),
+		mMemory(nullptr),
+		mAllocCallback(nullptr),
+		mGraphicsQueue(VK_NULL_HANDLE),
+		mTransferQueue(VK_NULL_HANDLE),
+		mGraphicsFamily(UINT32_MAX),
+		mTransferFamily(UINT32_MAX),
+		mStagingSize(0),
+		mStagingBuffer(VK_NULL_HANDLE),
+		mStagingAllocation(),
+		mTransferCmdBuffer(VK_NULL_HANDLE),
+		mGraphicsCmdBuffer(VK_NULL_HANDLE),
+		mSubmittedTicket(0),
+		mCompletedTicket(0),
+		mTransferPool(VK_NULL_HANDLE),
+		mGraphicsPool(VK_NULL_HANDLE)
+	{
+	}
+
+	VulkanUploader::~VulkanUploader()
+	{
+		destroy();
+	}
+
+	bool VulkanUploader::init(VkDevice device, VkPhysicalDevice physicalDevice, VulkanAllocator *memory, VkQueue graphicsQueue, uint32_t graphicsFamily,
+		VkQueue transferQueue, uint32_t transferFamily, VkDeviceSize stagingSize, VkAllocationCallbacks *allocCallback)
+	{
+		mDevice = device;
+		mPhysicalDevice = physicalDevice;
+		mMemory = memory;
+		mAllocCallback = allocCallback;
+		mGraphicsQueue = graphicsQueue;
+		mGraphicsFamily = graphicsFamily;
+		mTransferQueue = transferQueue;
+		mTransferFamily = transferFamily;
+		mStagingSize = stagingSize;
+
+		//command buffers are reset when they are begun again
+		VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
+		cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		cmdPoolCreateInfo.queueFamilyIndex = mTransferFamily;
+		if (vkCreateCommandPool(mDevice, &cmdPoolCreateInfo, mAllocCallback, &mTransferPool) != VK_SUCCESS)
+		{
+			std::printf("vkCreateCommandPool failed for transfer queue\n");
+			return false;
+		}
+
+		cmdPoolCreateInfo.queueFamilyIndex = mGraphicsFamily;
+		if (vkCreateCommandPool(mDevice, &cmdPoolCreateInfo, mAllocCallback, &mGraphicsPool) != VK_SUCCESS)
+		{
+			std::printf("vkCreateCommandPool failed\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	void VulkanUploader::destroy()
+	{
+		if (mDevice == VK_NULL_HANDLE)
+			return;
+
+		for (auto &submission : mSubmissions)
+			_recycle(submission);
+		mSubmissions.clear();
+
+		for (VkFence fence : mFreeFences)
+			vkDestroyFence(mDevice, fence, mAllocCallback);
+		mFreeFences.clear();
+
+		for (VkSemaphore semaphore : mFreeSemaphores)
+			vkDestroySemaphore(mDevice, semaphore, mAllocCallback);
+		mFreeSemaphores.clear();
+
+		//destroying the pools frees their command buffers, including ones never submitted
+		if (mTransferPool)
+			vkDestroyCommandPool(mDevice, mTransferPool, mAllocCallback);
+		if (mGraphicsPool)
+			vkDestroyCommandPool(mDevice, mGraphicsPool, mAllocCallback);
+		mTransferPool = VK_NULL_HANDLE;
+		mGraphicsPool = VK_NULL_HANDLE;
+		mFreeTransferCmdBuffers.clear();
+		mFreeGraphicsCmdBuffers.clear();
+		mTransferCmdBuffer = VK_NULL_HANDLE;
+		mGraphicsCmdBuffer = VK_NULL_HANDLE;
+		mOwnershipBarriers.clear();
+
+		if (mStagingBuffer)
+			vkDestroyBuffer(mDevice, mStagingBuffer, mAllocCallback);
+		mStagingBuffer = VK_NULL_HANDLE;
+		mMemory->free(mStagingAllocation);
+
+		mDevice = VK_NULL_HANDLE;
+	}
+
+	bool VulkanUploader::_createStagingBuffer()
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = mStagingSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = vkCreateBuffer(mDevice, &bufferInfo, mAllocCallback, &mStagingBuffer);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkCreateBuffer failed for staging buffer\n");
+			return false;
+		}
+
+		VkMemoryRequirements memReq;
+		vkGetBufferMemoryRequirements(mDevice, mStagingBuffer, &memReq);
+
+		uint32_t memType = vkutils::findMemoryType(mPhysicalDevice, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (memType == UINT32_MAX)
+		{
+			std::printf("Could not find valid memory type for staging buffer\n");
+			return false;
+		}
+
+		if (!mMemory->allocate(memReq, memType, true, mStagingAllocation))
+		{
+			std::printf("Failed to allocate memory for staging buffer\n");
+			return false;
+		}
+
+		result = vkBindBufferMemory(mDevice, mStagingBuffer, mStagingAllocation.memory, mStagingAllocation.offset);
+		if (result != VK_SUCCESS)
+		{
+			std::printf("vkBindBufferMemory failed for staging buffer\n");
+			return false;
+		}
+
+		mStagingRing.reset(static_cast<size_t>(mStagingSize));
+		return true;
+	}
+
+	bool VulkanUploader::stage(const void *data, size_t size, size_t &offset)
+	{
+		if (size > mStagingSize)
+		{
+			std::printf("Upload of %zu bytes does not fit the staging buffer\n", size);
+			return false;
+		}
+
+		if (mStagingAllocation.mapped == nullptr && !_createStagingBuffer())
+			return false;
+
+		//copy into staging memory the gpu is done with, only waiting when the ring is full
+		_update();
+		if (!mStagingRing.allocate(size, 16, offset))
+		{
+			//the copies recorded so far hold on to their staging memory until they are submitted
+			flush();
+			while (!mStagingRing.allocate(size, 16, offset))
+			{
+				if (mSubmissions.empty())
+					return false;
+				vkWaitForFences(mDevice, 1, &mSubmissions.front().fence, VK_TRUE, UINT64_MAX);
+				_update();
+			}
+		}
+
+		memcpy(mStagingAllocation.mapped + offset, data, size);
+		return true;
+	}
+
+	void VulkanUploader::copyToNewBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, size_t stagingOffset, bool concurrent)
+	{
+		if (mTransferCmdBuffer == VK_NULL_HANDLE)
+			mTransferCmdBuffer = _beginCmdBuffer(mTransferPool, mFreeTransferCmdBuffers);
+
+		VkBufferCopy region = {};
+		region.srcOffset = stagingOffset;
+		region.dstOffset = offset;
+		region.size = size;
+		vkCmdCopyBuffer(mTransferCmdBuffer, mStagingBuffer, buffer, 1, &region);
+
+		//within one family, or for a shared buffer, the semaphore of the flush is enough to make the copy visible
+		if (mTransferFamily == mGraphicsFamily || concurrent)
+			return;
+
+		//ownership goes to the graphics family at the flush
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = mTransferFamily;
+		barrier.dstQueueFamilyIndex = mGraphicsFamily;
+		barrier.buffer = buffer;
+		barrier.offset = offset;
+		barrier.size = size;
+		mOwnershipBarriers.push_back(barrier);
+	}
+
+	VkCommandBuffer VulkanUploader::getGraphicsCmdBuffer()
+	{
+		if (mGraphicsCmdBuffer == VK_NULL_HANDLE)
+		{
+			mGraphicsCmdBuffer = _beginCmdBuffer(mGraphicsPool, mFreeGraphicsCmdBuffers);
+
+			//copies must not overwrite data that frames in flight still read
+			vkCmdPipelineBarrier(mGraphicsCmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+		}
+		return mGraphicsCmdBuffer;
+	}
+
+	uint64_t VulkanUploader::flush()
+	{
+		if (mTransferCmdBuffer == VK_NULL_HANDLE && mGraphicsCmdBuffer == VK_NULL_HANDLE)
+			return mSubmittedTicket;
+		return _submit(VK_NULL_HANDLE);
+	}
+
+	bool VulkanUploader::flush(VkSemaphore signalSemaphore)
+	{
+		if (mTransferCmdBuffer != VK_NULL_HANDLE || mGraphicsCmdBuffer != VK_NULL_HANDLE)
+		{
+			_submit(signalSemaphore);
+			return true;
+		}
+
+		if (isComplete(mSubmittedTicket))
+			return false;
+
+		//the semaphore signals after everything submitted to the graphics queue before it, earlier copies included
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &signalSemaphore;
+		if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			std::printf("vkQueueSubmit failed\n");
+			wait(mSubmittedTicket);
+			return false;
+		}
+		return true;
+	}
+
+	uint64_t VulkanUploader::_submit(VkSemaphore signalSemaphore)
+	{
+		Submission submission = {};
+		submission.ticket = ++mSubmittedTicket;
+		VkCommandBuffer cmdBuffers[2];
+		uint32_t cmdBufferCount = 0;
+
+		if (mTransferCmdBuffer)
+		{
+			if (!mOwnershipBarriers.empty())
+			{
+				//release on the transfer queue, then acquire on the graphics queue ahead of any other graphics copy
+				const uint32_t barrierCount = static_cast<uint32_t>(mOwnershipBarriers.size());
+				for (auto &barrier : mOwnershipBarriers)
+				{
+					barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					barrier.dstAccessMask = 0;
+				}
+				vkCmdPipelineBarrier(mTransferCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, barrierCount, mOwnershipBarriers.data(), 0, nullptr);
+
+				for (auto &barrier : mOwnershipBarriers)
+				{
+					barrier.srcAccessMask = 0;
+					barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+				}
+				submission.acquireCmdBuffer = _beginCmdBuffer(mGraphicsPool, mFreeGraphicsCmdBuffers);
+				vkCmdPipelineBarrier(submission.acquireCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, barrierCount, mOwnershipBarriers.data(), 0, nullptr);
+				vkEndCommandBuffer(submission.acquireCmdBuffer);
+				cmdBuffers[cmdBufferCount++] = submission.acquireCmdBuffer;
+				mOwnershipBarriers.clear();
+			}
+
+			vkEndCommandBuffer(mTransferCmdBuffer);
+			submission.transferCmdBuffer = mTransferCmdBuffer;
+			mTransferCmdBuffer = VK_NULL_HANDLE;
+
+			VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+			semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			if (!mFreeSemaphores.empty())
+			{
+				submission.semaphore = mFreeSemaphores.back();
+				mFreeSemaphores.pop_back();
+			}
+			else if (vkCreateSemaphore(mDevice, &semaphoreCreateInfo, mAllocCallback, &submission.semaphore) != VK_SUCCESS)
+			{
+				std::printf("vkCreateSemaphore failed\n");
+				submission.semaphore = VK_NULL_HANDLE;
+			}
+
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &submission.transferCmdBuffer;
+			submitInfo.signalSemaphoreCount = submission.semaphore ? 1 : 0;
+			submitInfo.pSignalSemaphores = &submission.semaphore;
+			if (vkQueueSubmit(mTransferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+				std::printf("vkQueueSubmit failed for transfer queue\n");
+
+			//without a semaphore the graphics queue can't wait for the copies on the gpu
+			if (submission.semaphore == VK_NULL_HANDLE)
+				vkQueueWaitIdle(mTransferQueue);
+		}
+
+		if (mGraphicsCmdBuffer)
+		{
+			vkEndCommandBuffer(mGraphicsCmdBuffer);
+			submission.graphicsCmdBuffer = mGraphicsCmdBuffer;
+			cmdBuffers[cmdBufferCount++] = mGraphicsCmdBuffer;
+			mGraphicsCmdBuffer = VK_NULL_HANDLE;
+		}
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (!mFreeFences.empty())
+		{
+			submission.fence = mFreeFences.back();
+			mFreeFences.pop_back();
+		}
+		else if (vkCreateFence(mDevice, &fenceInfo, mAllocCallback, &submission.fence) != VK_SUCCESS)
+		{
+			std::printf("vkCreateFence failed\n");
+			submission.fence = VK_NULL_HANDLE;
+		}
+
+		//later graphics submits are ordered after this one, which waits for the transfer queue
+		VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.waitSemaphoreCount = submission.semaphore ? 1 : 0;
+		submitInfo.pWaitSemaphores = &submission.semaphore;
+		submitInfo.pWaitDstStageMask = &waitStageMask;
+		submitInfo.commandBufferCount = cmdBufferCount;
+		submitInfo.pCommandBuffers = cmdBuffers;
+		submitInfo.signalSemaphoreCount = signalSemaphore ? 1 : 0;
+		submitInfo.pSignalSemaphores = &signalSemaphore;
+		if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, submission.fence) != VK_SUCCESS)
+			std::printf("vkQueueSubmit failed\n");
+
+		mStagingRing.close(submission.ticket);
+		mSubmissions.push_back(submission);
+
+		//without a fence completion can't be polled, so wait for it right away
+		if (submission.fence == VK_NULL_HANDLE)
+		{
+			vkQueueWaitIdle(mGraphicsQueue);
+			while (!mSubmissions.empty())
+			{
+				mCompletedTicket = mSubmissions.front().ticket;
+				_recycle(mSubmissions.front());
+				mSubmissions.pop_front();
+			}
+		}
+		return submission.ticket;
+	}
+
+	bool VulkanUploader::isComplete(uint64_t ticket)
+	{
+		_update();
+		return ticket <= mCompletedTicket;
+	}
+
+	void VulkanUploader::wait(uint64_t ticket)
+	{
+		if (ticket > mSubmittedTicket)
+			flush();
+
+		_update();
+		while (ticket > mCompletedTicket && !mSubmissions.empty())
+		{
+			vkWaitForFences(mDevice, 1, &mSubmissions.front().fence, VK_TRUE, UINT64_MAX);
+			_update();
+		}
+	}
+
+	VkCommandBuffer VulkanUploader::_beginCmdBuffer(VkCommandPool pool, std::vector<VkCommandBuffer> &freeCmdBuffers)
+	{
+		VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+		if (!freeCmdBuffers.empty())
+		{
+			cmdBuffer = freeCmdBuffers.back();
+			freeCmdBuffers.pop_back();
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo cmdBufAllocInfo = {};
+			cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdBufAllocInfo.commandPool = pool;
+			cmdBufAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			cmdBufAllocInfo.commandBufferCount = 1;
+			vkAllocateCommandBuffers(mDevice, &cmdBufAllocInfo, &cmdBuffer);
+		}
+
+		vkutils::beingSingleCommand(cmdBuffer);
+		return cmdBuffer;
+	}
+
+	//retires submissions in order, so a ticket completes only after every earlier one
+	void VulkanUploader::_update()
+	{
+		while (!mSubmissions.empty() && vkGetFenceStatus(mDevice, mSubmissions.front().fence) == VK_SUCCESS)
+		{
+			mCompletedTicket = mSubmissions.front().ticket;
+			_recycle(mSubmissions.front());
+			mSubmissions.pop_front();
+		}
+
+		const uint64_t completed = mCompletedTicket;
+		mStagingRing.retire([completed](const uint64_t &ticket) { return ticket <= completed; });
+	}
+
+	void VulkanUploader::_recycle(Submission &submission)
+	{
+		if (submission.fence)
+		{
+			vkResetFences(mDevice, 1, &submission.fence);
+			mFreeFences.push_back(submission.fence);
+		}
+
+		//a waited on semaphore is unsignaled again
+		if (submission.semaphore)
+			mFreeSemaphores.push_back(submission.semaphore);
+		if (submission.transferCmdBuffer)
+			mFreeTransferCmdBuffers.push_back(submission.transferCmdBuffer);
+		if (submission.acquireCmdBuffer)
+			mFreeGraphicsCmdBuffers.push_back(submission.acquireCmdBuffer);
+		if (submission.graphicsCmdBuffer)
+			mFreeGraphicsCmdBuffers.push_back(submission.graphicsCmdBuffer);
+		submission = Submission();
+	}
+}
@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_VULKAN_VULKANUPLOADER_HPP_
+#define _JIKKEN_VULKAN_VULKANUPLOADER_HPP_
+
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "vulkan/VulkanAllocator.hpp"
+#include "ringAllocator.hpp"
+
+namespace Jikken
+{
+	/// Streams data to the GPU through a host visible staging ring without
+	/// waiting on it. Copies into buffers the GPU doesn't use yet are recorded
+	/// for a transfer queue, which on most discrete GPUs is a DMA engine that
+	/// runs alongside rendering. Copies into resources the GPU may be reading,
+	/// and into images, are recorded for the graphics queue, ordered after
+	/// earlier frames. flush() submits both, and every flush gets a ticket;
+	/// staging memory is reused once its ticket has completed.
+	/// When the transfer queue is of another family than the graphics queue,
+	/// buffers written on it are released to the graphics family and acquired
+	/// there before anything submitted after the flush reads them, unless they
+	/// are shared by the families concurrently.
+	class VulkanUploader
+	{
+	public:
+		VulkanUploader();
+		~VulkanUploader();
+
+		/// @param transferQueue May be graphicsQueue when the device has no separate transfer queue.
+		bool init(VkDevice device, VkPhysicalDevice physicalDevice, VulkanAllocator *memory, VkQueue graphicsQueue, uint32_t graphicsFamily,
+			VkQueue transferQueue, uint32_t transferFamily, VkDeviceSize stagingSize, VkAllocationCallbacks *allocCallback);
+
+		/// The device must be idle. Recorded copies that weren't flushed are dropped.
+		void destroy();
+
+		/// Copies data into the staging ring. Only blocks when the ring is full,
+		/// then waits for the oldest tickets until the data fits.
+		/// @param offset Receives where in getStagingBuffer() the data is.
+		/// @return false if the data can never fit.
+		bool stage(const void *data, size_t size, size_t &offset);
+
+		/// Copies size bytes staged at stagingOffset into a buffer no submitted
+		/// work uses yet, on the transfer queue.
+		/// @param concurrent The buffer was created with VK_SHARING_MODE_CONCURRENT.
+		void copyToNewBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, size_t stagingOffset, bool concurrent = false);
+
+		/// Command buffer on the graphics queue for copies into resources in use,
+		/// it starts after everything submitted before. Valid until the next flush().
+		VkCommandBuffer getGraphicsCmdBuffer();
+
+		/// Submits the recorded copies. Graphics queue work submitted after this sees them.
+		/// @return The ticket of the submission, or the last one if nothing was recorded.
+		uint64_t flush();
+
+		/// Like flush(), and signalSemaphore is signaled on the graphics queue
+		/// once every copy submitted so far has completed, for another queue to wait on.
+		/// @return false if they already have, then nothing signals it.
+		bool flush(VkSemaphore signalSemaphore);
+
+		/// @return The ticket copies recorded now will complete with.
+		inline uint64_t getOpenTicket() const
+		{
+			return mSubmittedTicket + 1;
+		}
+
+		/// Never blocks.
+		bool isComplete(uint64_t ticket);
+
+		/// Flushes if ticket is still open, then blocks until it has completed.
+		void wait(uint64_t ticket);
+
+		inline VkBuffer getStagingBuffer() const
+		{
+			return mStagingBuffer;
+		}
+
+	private:
+		VulkanUploader(const VulkanUploader&);
+		VulkanUploader& operator=(const VulkanUploader&);
+
+		struct Submission
+		{
+			uint64_t ticket;
+			VkFence fence; //of the graphics queue submit, which waits for the transfer queue one
+			VkSemaphore semaphore; //signaled by the transfer queue submit
+			VkCommandBuffer transferCmdBuffer;
+			VkCommandBuffer acquireCmdBuffer; //ownership acquires, runs first on the graphics queue
+			VkCommandBuffer graphicsCmdBuffer;
+		};
+
+		bool _createStagingBuffer();
+		uint64_t _submit(VkSemaphore signalSemaphore);
+		VkCommandBuffer _beginCmdBuffer(VkCommandPool pool, std::vector<VkCommandBuffer> &freeCmdBuffers);
+		void _update();
+		void _recycle(Submission &submission);
+
+		VkDevice mDevice;
+		VkPhysicalDevice mPhysicalDevice;
+		VulkanAllocator *mMemory;
+		VkAllocationCallbacks *mAllocCallback;
+		VkQueue mGraphicsQueue;
+		VkQueue mTransferQueue;
+		uint32_t mGraphicsFamily;
+		uint32_t mTransferFamily;
+
+		//host visible, created at the first upload
+		VkDeviceSize mStagingSize;
+		VkBuffer mStagingBuffer;
+		VulkanAllocation mStagingAllocation;
+		RingAllocator<uint64_t> mStagingRing;
+
+		//copies recorded since the last flush
+		VkCommandBuffer mTransferCmdBuffer;
+		VkCommandBuffer mGraphicsCmdBuffer;
+		std::vector<VkBufferMemoryBarrier> mOwnershipBarriers; //released and acquired at the flush
+
+		uint64_t mSubmittedTicket;
+		uint64_t mCompletedTicket;
+		std::deque<Submission> mSubmissions; //oldest first
+
+		//objects of completed submissions, reused by later ones
+		VkCommandPool mTransferPool;
+		VkCommandPool mGraphicsPool;
+		std::vector<VkCommandBuffer> mFreeTransferCmdBuffers;
+		std::vector<VkCommandBuffer> mFreeGraphicsCmdBuffers;
+		std::vector<VkFence> mFreeFences;
+		std::vector<VkSemaphore> mFreeSemaphores;
+	};
+}
+
+#endif
@@ -110,7 +110,10 @@ namespace Jikken
 			if (result != VK_SUCCESS)
 				return false;
 
-			std::vector<const char*> requiredExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+			//without a surface nothing is presented, as on a headless device
+			std::vector<const char*> requiredExtensions;
+			if (surface != VK_NULL_HANDLE)
+				requiredExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 			//check we got required extensions
 			for (const auto &ext : requiredExtensions)
 			{
@@ -135,8 +138,9 @@ namespace Jikken
 
 			for (uint32_t i = 0; i < queueFamiliesCount; i++)
 			{
-				VkBool32 supportsPresent;
-				vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &supportsPresent);
+				VkBool32 supportsPresent = VK_TRUE;
+				if (surface != VK_NULL_HANDLE)
+					vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &supportsPresent);
 				if (supportsPresent && (queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
 					graphicsQueue = i;
 
@@ -151,9 +155,53 @@ namespace Jikken
 			return false;
 		}
 
-		uint32_t getSwapChainNumImages(const VkSurfaceCapabilitiesKHR &surfaceCaps)
+		uint32_t findTransferQueue(const VkPhysicalDevice physicalDevice, const uint32_t graphicsQueue)
 		{
-			uint32_t count = surfaceCaps.minImageCount + 1;
+			uint32_t queueFamiliesCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamiliesCount, nullptr);
+			std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamiliesCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamiliesCount, queueFamilyProperties.data());
+
+			//a family with only transfer is usually the dma engine, otherwise any non graphics family will do
+			uint32_t fallback = graphicsQueue;
+			for (uint32_t i = 0; i < queueFamiliesCount; i++)
+			{
+				const VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+				if (queueFamilyProperties[i].queueCount == 0 || i == graphicsQueue)
+					continue;
+
+				//compute and graphics queues support transfers without saying so
+				if (!(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && (flags & VK_QUEUE_TRANSFER_BIT))
+					return i;
+				if (fallback == graphicsQueue && !(flags & VK_QUEUE_GRAPHICS_BIT))
+					fallback = i;
+			}
+
+			return fallback;
+		}
+
+		uint32_t findComputeQueue(const VkPhysicalDevice physicalDevice, const uint32_t graphicsQueue)
+		{
+			uint32_t queueFamiliesCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamiliesCount, nullptr);
+			std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamiliesCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamiliesCount, queueFamilyProperties.data());
+
+			//a compute family without graphics runs alongside the graphics queue
+			for (uint32_t i = 0; i < queueFamiliesCount; i++)
+			{
+				const VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+				if (queueFamilyProperties[i].queueCount > 0 && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+					return i;
+			}
+
+			//every graphics family supports compute
+			return graphicsQueue;
+		}
+
+		uint32_t getSwapChainNumImages(const VkSurfaceCapabilitiesKHR &surfaceCaps, const uint32_t requested)
+		{
+			uint32_t count = requested > 0 ? std::max(requested, surfaceCaps.minImageCount) : surfaceCaps.minImageCount + 1;
 			if ((surfaceCaps.maxImageCount > 0) && (count > surfaceCaps.maxImageCount))
 			{
 				count = surfaceCaps.maxImageCount;
@@ -189,13 +237,19 @@ namespace Jikken
 				return surfaceCaps.currentTransform;
 		}
 
-		VkPresentModeKHR getSwapChainPresentMode(const std::vector<VkPresentModeKHR> &presentModes)
+		VkPresentModeKHR getSwapChainPresentMode(const std::vector<VkPresentModeKHR> &presentModes, const PresentMode mode)
 		{
-			
-			// Doesn't vsync or tear, more latency than tearing
+			VkPresentModeKHR desired = VK_PRESENT_MODE_FIFO_KHR;
+			switch (mode)
+			{
+			case PresentMode::eMailbox: desired = VK_PRESENT_MODE_MAILBOX_KHR; break;
+			case PresentMode::eImmediate: desired = VK_PRESENT_MODE_IMMEDIATE_KHR; break;
+			default: break;
+			}
+
 			for (const auto &presentMode : presentModes)
 			{
-				if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+				if (presentMode == desired)
 					return presentMode;
 			}
 
@@ -210,13 +264,13 @@ namespace Jikken
 			return static_cast<VkPresentModeKHR>(-1);
 		}
 
-		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
+		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, const VkExtent2D windowExtent)
 		{
 			if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
 				return capabilities.currentExtent;
 			else
 			{
-				VkExtent2D actualExtent;
+				VkExtent2D actualExtent = windowExtent;
 
 				actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
 				actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
@@ -331,6 +385,12 @@ namespace Jikken
 				// Make sure any shader reads from the image have been finished
 				imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
 				break;
+
+			case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+				// Image was rendered to by a render pass before being made presentable
+				// Make sure any writes to the color buffer have been finished
+				imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				break;
 			}
 
 			// Target layouts (new)
@@ -353,7 +413,7 @@ namespace Jikken
 			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
 				// Image will be used as a color attachment
 				// Make sure any writes to the color buffer have been finished
-				imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				imageMemoryBarrier.srcAccessMask = imageMemoryBarrier.srcAccessMask | VK_ACCESS_TRANSFER_READ_BIT;
 				imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 				break;
 
@@ -415,6 +475,273 @@ namespace Jikken
 			}
 		}
 
+		VkFormat getVertexAttributeFormat(const VertexInputLayout &attr)
+		{
+			if (attr.componentSize < 1 || attr.componentSize > 4)
+				return VK_FORMAT_UNDEFINED;
+
+			const uint32_t c = attr.componentSize - 1;
+			//integer types pick between normalized, integer and scaled (converted to float) formats
+			auto pick = [&attr, c](const VkFormat *norm, const VkFormat *integer, const VkFormat *scaled)
+			{
+				if (attr.integer)
+					return integer[c];
+				return attr.normalized ? norm[c] : scaled[c];
+			};
+
+			switch (attr.type)
+			{
+			case VertexAttributeType::eFLOAT:
+			{
+				static const VkFormat formats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+				return formats[c];
+			}
+			case VertexAttributeType::eHALF_FLOAT:
+			{
+				static const VkFormat formats[] = { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT };
+				return formats[c];
+			}
+			case VertexAttributeType::eBYTE:
+			{
+				static const VkFormat norm[] = { VK_FORMAT_R8_SNORM, VK_FORMAT_R8G8_SNORM, VK_FORMAT_R8G8B8_SNORM, VK_FORMAT_R8G8B8A8_SNORM };
+				static const VkFormat integer[] = { VK_FORMAT_R8_SINT, VK_FORMAT_R8G8_SINT, VK_FORMAT_R8G8B8_SINT, VK_FORMAT_R8G8B8A8_SINT };
+				static const VkFormat scaled[] = { VK_FORMAT_R8_SSCALED, VK_FORMAT_R8G8_SSCALED, VK_FORMAT_R8G8B8_SSCALED, VK_FORMAT_R8G8B8A8_SSCALED };
+				return pick(norm, integer, scaled);
+			}
+			case VertexAttributeType::eUNSIGNED_BYTE:
+			{
+				static const VkFormat norm[] = { VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_R8G8B8A8_UNORM };
+				static const VkFormat integer[] = { VK_FORMAT_R8_UINT, VK_FORMAT_R8G8_UINT, VK_FORMAT_R8G8B8_UINT, VK_FORMAT_R8G8B8A8_UINT };
+				static const VkFormat scaled[] = { VK_FORMAT_R8_USCALED, VK_FORMAT_R8G8_USCALED, VK_FORMAT_R8G8B8_USCALED, VK_FORMAT_R8G8B8A8_USCALED };
+				return pick(norm, integer, scaled);
+			}
+			case VertexAttributeType::eSHORT:
+			{
+				static const VkFormat norm[] = { VK_FORMAT_R16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16B16_SNORM, VK_FORMAT_R16G16B16A16_SNORM };
+				static const VkFormat integer[] = { VK_FORMAT_R16_SINT, VK_FORMAT_R16G16_SINT, VK_FORMAT_R16G16B16_SINT, VK_FORMAT_R16G16B16A16_SINT };
+				static const VkFormat scaled[] = { VK_FORMAT_R16_SSCALED, VK_FORMAT_R16G16_SSCALED, VK_FORMAT_R16G16B16_SSCALED, VK_FORMAT_R16G16B16A16_SSCALED };
+				return pick(norm, integer, scaled);
+			}
+			case VertexAttributeType::eUNSIGNED_SHORT:
+			{
+				static const VkFormat norm[] = { VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16A16_UNORM };
+				static const VkFormat integer[] = { VK_FORMAT_R16_UINT, VK_FORMAT_R16G16_UINT, VK_FORMAT_R16G16B16_UINT, VK_FORMAT_R16G16B16A16_UINT };
+				static const VkFormat scaled[] = { VK_FORMAT_R16_USCALED, VK_FORMAT_R16G16_USCALED, VK_FORMAT_R16G16B16_USCALED, VK_FORMAT_R16G16B16A16_USCALED };
+				return pick(norm, integer, scaled);
+			}
+			//vulkan has no normalized or scaled 32 bit formats
+			case VertexAttributeType::eINT:
+			{
+				static const VkFormat formats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+				return attr.integer ? formats[c] : VK_FORMAT_UNDEFINED;
+			}
+			case VertexAttributeType::eUNSIGNED_INT:
+			{
+				static const VkFormat formats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+				return attr.integer ? formats[c] : VK_FORMAT_UNDEFINED;
+			}
+			//gl's 2_10_10_10_REV keeps x in the low bits, which is vulkan's A2B10G10R10
+			case VertexAttributeType::eINT_2_10_10_10_REV:
+				if (c != 3 || attr.integer)
+					return VK_FORMAT_UNDEFINED;
+				return attr.normalized ? VK_FORMAT_A2B10G10R10_SNORM_PACK32 : VK_FORMAT_A2B10G10R10_SSCALED_PACK32;
+			case VertexAttributeType::eUNSIGNED_INT_2_10_10_10_REV:
+				if (c != 3 || attr.integer)
+					return VK_FORMAT_UNDEFINED;
+				return attr.normalized ? VK_FORMAT_A2B10G10R10_UNORM_PACK32 : VK_FORMAT_A2B10G10R10_USCALED_PACK32;
+			default:
+				return VK_FORMAT_UNDEFINED;
+			}
+		}
+
+		VkFormat getTextureFormat(const TextureFormat format)
+		{
+			switch (format)
+			{
+			case TextureFormat::eRGBA8: return VK_FORMAT_R8G8B8A8_UNORM;
+			case TextureFormat::eSRGBA8: return VK_FORMAT_R8G8B8A8_SRGB;
+			case TextureFormat::eRGBA16F: return VK_FORMAT_R16G16B16A16_SFLOAT;
+			case TextureFormat::eRGBA32F: return VK_FORMAT_R32G32B32A32_SFLOAT;
+			case TextureFormat::eRG16F: return VK_FORMAT_R16G16_SFLOAT;
+			case TextureFormat::eR32F: return VK_FORMAT_R32_SFLOAT;
+			case TextureFormat::eR11G11B10F: return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+			case TextureFormat::eDepth16: return VK_FORMAT_D16_UNORM;
+			case TextureFormat::eDepth24Stencil8: return VK_FORMAT_D24_UNORM_S8_UINT;
+			case TextureFormat::eDepth32F: return VK_FORMAT_D32_SFLOAT;
+			default: return VK_FORMAT_UNDEFINED;
+			}
+		}
+
+		VkImageAspectFlags getImageAspect(const TextureFormat format)
+		{
+			switch (format)
+			{
+			case TextureFormat::eDepth16:
+			case TextureFormat::eDepth32F:
+				return VK_IMAGE_ASPECT_DEPTH_BIT;
+			case TextureFormat::eDepth24Stencil8:
+				return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			default:
+				return VK_IMAGE_ASPECT_COLOR_BIT;
+			}
+		}
+
+		VkImageAspectFlags getDepthAspect(const VkFormat format)
+		{
+			switch (format)
+			{
+			case VK_FORMAT_S8_UINT:
+				return VK_IMAGE_ASPECT_STENCIL_BIT;
+			case VK_FORMAT_D16_UNORM_S8_UINT:
+			case VK_FORMAT_D24_UNORM_S8_UINT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT:
+				return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			default:
+				return VK_IMAGE_ASPECT_DEPTH_BIT;
+			}
+		}
+
+		VkSampleCountFlagBits getSampleCount(const uint32_t samples)
+		{
+			if (samples >= 64) return VK_SAMPLE_COUNT_64_BIT;
+			if (samples >= 32) return VK_SAMPLE_COUNT_32_BIT;
+			if (samples >= 16) return VK_SAMPLE_COUNT_16_BIT;
+			if (samples >= 8) return VK_SAMPLE_COUNT_8_BIT;
+			if (samples >= 4) return VK_SAMPLE_COUNT_4_BIT;
+			if (samples >= 2) return VK_SAMPLE_COUNT_2_BIT;
+			return VK_SAMPLE_COUNT_1_BIT;
+		}
+
+		VkFilter getFilter(const SamplerFilter filter)
+		{
+			return filter == SamplerFilter::eLinear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+		}
+
+		VkSamplerMipmapMode getMipmapMode(const SamplerMipFilter filter)
+		{
+			return filter == SamplerMipFilter::eLinear ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		}
+
+		VkSamplerAddressMode getAddressMode(const SamplerWrap wrap)
+		{
+			switch (wrap)
+			{
+			case SamplerWrap::eRepeat: return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			case SamplerWrap::eMirroredRepeat: return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+			case SamplerWrap::eClampToEdge: return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			default: return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			}
+		}
+
+		VkBufferUsageFlags getBufferUsage(const BufferType type)
+		{
+			//every buffer is the destination of uploads
+			switch (type)
+			{
+			case BufferType::eVertexBuffer: return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			case BufferType::eIndexBuffer: return VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			case BufferType::eConstantBuffer: return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			case BufferType::eStorageBuffer: return VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			default: return VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			}
+		}
+
+		void getMemoryBarrier(const uint32_t barriers, VkPipelineStageFlags &stages, VkAccessFlags &access)
+		{
+			const VkPipelineStageFlags shaderStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			stages = 0;
+			access = 0;
+			if (barriers & eStorageBarrier)
+			{
+				stages |= shaderStages;
+				access |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			}
+			if (barriers & eVertexBarrier)
+			{
+				stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+				access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+			}
+			if (barriers & eIndexBarrier)
+			{
+				stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+				access |= VK_ACCESS_INDEX_READ_BIT;
+			}
+			if (barriers & eIndirectBarrier)
+			{
+				stages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+				access |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			}
+			if (barriers & eConstantBarrier)
+			{
+				stages |= shaderStages;
+				access |= VK_ACCESS_UNIFORM_READ_BIT;
+			}
+			if (barriers & eTransferBarrier)
+			{
+				stages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+				access |= VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			}
+		}
+
+		VkPrimitiveTopology getPrimitiveTopology(const PrimitiveType primitive)
+		{
+			switch (primitive)
+			{
+			case PrimitiveType::eTriangles: return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			case PrimitiveType::eTriangleStrip: return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+			case PrimitiveType::eLines: return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+			case PrimitiveType::eLineStrip: return VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+			default: return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			}
+		}
+
+		VkBlendFactor getBlendFactor(const BlendState state)
+		{
+			switch (state)
+			{
+			case BlendState::eZero: return VK_BLEND_FACTOR_ZERO;
+			case BlendState::eOne: return VK_BLEND_FACTOR_ONE;
+			case BlendState::eSrcColor: return VK_BLEND_FACTOR_SRC_COLOR;
+			case BlendState::eOneMinusSrcColor: return VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+			case BlendState::eSrcAlpha: return VK_BLEND_FACTOR_SRC_ALPHA;
+			case BlendState::eOneMinusSrcAlpha: return VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			case BlendState::eDstAlpha: return VK_BLEND_FACTOR_DST_ALPHA;
+			case BlendState::eOneMinusDstAlpha: return VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+			case BlendState::eDstColor: return VK_BLEND_FACTOR_DST_COLOR;
+			case BlendState::eOneMinusDstColor: return VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR;
+			default: return VK_BLEND_FACTOR_ONE;
+			}
+		}
+
+		VkCompareOp getCompareOp(const DepthFunc func)
+		{
+			switch (func)
+			{
+			case DepthFunc::eNever: return VK_COMPARE_OP_NEVER;
+			case DepthFunc::eAlways: return VK_COMPARE_OP_ALWAYS;
+			case DepthFunc::eLess: return VK_COMPARE_OP_LESS;
+			case DepthFunc::eEqual: return VK_COMPARE_OP_EQUAL;
+			case DepthFunc::eNotEqual: return VK_COMPARE_OP_NOT_EQUAL;
+			case DepthFunc::eGreater: return VK_COMPARE_OP_GREATER;
+			case DepthFunc::eLessEqual: return VK_COMPARE_OP_LESS_OR_EQUAL;
+			case DepthFunc::eGreaterEqual: return VK_COMPARE_OP_GREATER_OR_EQUAL;
+			default: return VK_COMPARE_OP_LESS;
+			}
+		}
+
+		VkCullModeFlags getCullMode(const bool enabled, const CullFaceState face)
+		{
+			if (!enabled)
+				return VK_CULL_MODE_NONE;
+			return face == CullFaceState::eFront ? VK_CULL_MODE_FRONT_BIT : VK_CULL_MODE_BACK_BIT;
+		}
+
+		VkFrontFace getFrontFace(const WindingOrderState winding)
+		{
+			return winding == WindingOrderState::eCW ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		}
+
 		VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t obj, size_t location,
 			int32_t code, const char* layerPrefix, const char* msg, void* userData)
 		{
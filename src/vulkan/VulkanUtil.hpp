@@ -26,6 +26,7 @@
 #define _JIKKEN_VULKAN_VULKANUTIL_HPP_
 
 #include "jikken/enums.hpp"
+#include "jikken/structs.hpp"
 #include <vulkan/vulkan.h>
 #include <string>
 #include <vector>
@@ -37,6 +38,8 @@ namespace Jikken
 		bool checkExtension(const std::string &extensionName, const std::vector<VkExtensionProperties> &extensionList);
 		bool checkLayer(const std::string &layerName, const std::vector<VkLayerProperties> &layerList);
 		bool checkPhysicalDevice(const VkPhysicalDevice physicalDevice, const VkSurfaceKHR surface, uint32_t &graphicsQueue, uint32_t &computeQueue);
+		//prefers a transfer only family, falls back to graphicsQueue
+		uint32_t findTransferQueue(const VkPhysicalDevice physicalDevice, const uint32_t graphicsQueue);
 		uint32_t findMemoryType(const VkPhysicalDevice physicalDevice, const uint32_t typeFilter, const VkMemoryPropertyFlags properties);
 		void printDeviceInfo(const VkPhysicalDevice device);
 
@@ -64,18 +67,50 @@ namespace Jikken
 			VkPipelineStageFlags srcStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
 			VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
 
-		uint32_t getSwapChainNumImages(const VkSurfaceCapabilitiesKHR &surfaceCaps);
+		//requested of 0 asks for one more than the minimum
+		//family for async compute, one without graphics if there is one, otherwise graphicsQueue
+		uint32_t findComputeQueue(const VkPhysicalDevice physicalDevice, const uint32_t graphicsQueue);
+
+		uint32_t getSwapChainNumImages(const VkSurfaceCapabilitiesKHR &surfaceCaps, const uint32_t requested);
 		//todo add requested format
 		VkSurfaceFormatKHR getSwapChainFormat(const std::vector<VkSurfaceFormatKHR> &surfaceFormats);
 		VkSurfaceTransformFlagBitsKHR getSwapChainTransform(const VkSurfaceCapabilitiesKHR &surfaceCaps);
-		//todo should really let user have a say in this
-		VkPresentModeKHR getSwapChainPresentMode(const std::vector<VkPresentModeKHR> &presentModes);
-		//choose swapchain extent
-		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
+		//mode if the surface supports it, otherwise fifo
+		VkPresentModeKHR getSwapChainPresentMode(const std::vector<VkPresentModeKHR> &presentModes, const PresentMode mode);
+		//choose swapchain extent, windowExtent is used when the surface leaves it to the swapchain
+		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, const VkExtent2D windowExtent);
 
 		//VkShaderStageFlagBits - todo use static lookup tables
 		VkShaderStageFlagBits getShaderStageFlag(const ShaderStage stage);
 
+		//vertex attribute format, VK_FORMAT_UNDEFINED if vulkan has no match.
+		//scaled and 3 component 8/16 bit formats are optional, check VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT
+		VkFormat getVertexAttributeFormat(const VertexInputLayout &attr);
+
+		//texture formats
+		VkFormat getTextureFormat(const TextureFormat format);
+		VkImageAspectFlags getImageAspect(const TextureFormat format);
+		VkImageAspectFlags getDepthAspect(const VkFormat format);
+		VkSampleCountFlagBits getSampleCount(const uint32_t samples);
+
+		//samplers
+		VkFilter getFilter(const SamplerFilter filter);
+		VkSamplerMipmapMode getMipmapMode(const SamplerMipFilter filter);
+		VkSamplerAddressMode getAddressMode(const SamplerWrap wrap);
+
+		//buffers
+		VkBufferUsageFlags getBufferUsage(const BufferType type);
+
+		//destination stages and accesses of MemoryBarrierFlags
+		void getMemoryBarrier(const uint32_t barriers, VkPipelineStageFlags &stages, VkAccessFlags &access);
+
+		//pipeline state
+		VkPrimitiveTopology getPrimitiveTopology(const PrimitiveType primitive);
+		VkBlendFactor getBlendFactor(const BlendState state);
+		VkCompareOp getCompareOp(const DepthFunc func);
+		VkCullModeFlags getCullMode(const bool enabled, const CullFaceState face);
+		VkFrontFace getFrontFace(const WindingOrderState winding);
+
 		//debug callback
 		VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t obj, size_t location,
 			int32_t code, const char* layerPrefix, const char* msg, void* userData);
@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "workerPool.hpp"
+
+namespace Jikken
+{
+	WorkerPool::WorkerPool() :
+		mJob(nullptr),
+		mJobNumber(0),
+		mBusy(0),
+		mStopping(false)
+	{
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		stop();
+	}
+
+	void WorkerPool::start(uint32_t count)
+	{
+		stop();
+
+		//threads wait for the job after the last one that ran
+		mStopping = false;
+		for (uint32_t i = 1; i < count; ++i)
+			mThreads.emplace_back(&WorkerPool::_threadMain, this, i, mJobNumber);
+	}
+
+	void WorkerPool::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+		mStartCondition.notify_all();
+
+		for (std::thread &thread : mThreads)
+			thread.join();
+		mThreads.clear();
+	}
+
+	void WorkerPool::run(const std::function<void(uint32_t)> &job)
+	{
+		if (mThreads.empty())
+		{
+			job(0);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJob = &job;
+			mBusy = static_cast<uint32_t>(mThreads.size());
+			++mJobNumber;
+		}
+		mStartCondition.notify_all();
+
+		job(0);
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDoneCondition.wait(lock, [this]() { return mBusy == 0; });
+		mJob = nullptr;
+	}
+
+	void WorkerPool::_threadMain(uint32_t worker, uint64_t jobNumber)
+	{
+		for (;;)
+		{
+			const std::function<void(uint32_t)> *job;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mStartCondition.wait(lock, [&]() { return mStopping || mJobNumber != jobNumber; });
+				if (mStopping)
+					return;
+				jobNumber = mJobNumber;
+				job = mJob;
+			}
+
+			(*job)(worker);
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (--mBusy == 0)
+				mDoneCondition.notify_one();
+		}
+	}
+}
@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+// Jikken - 3D Abstract High Performance Graphics API
+// Copyright(c) 2017 Jeff Hutchinson
+// Copyright(c) 2017 Tim Barnes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef _JIKKEN_WORKERPOOL_HPP_
+#define _JIKKEN_WORKERPOOL_HPP_
+
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Jikken
+{
+	/// A fixed set of threads that run one job at a time in parallel, for work
+	/// that is split up every frame. The threads sleep between jobs, so handing
+	/// out a job doesn't pay for creating threads.
+	class WorkerPool
+	{
+	public:
+		WorkerPool();
+		~WorkerPool();
+
+		/// Starts count - 1 threads, the thread calling run() is the last worker.
+		void start(uint32_t count);
+
+		/// Joins the threads. Must not be called while a job runs.
+		void stop();
+
+		/// Calls job(worker) once on every worker, with worker in [0, getCount()),
+		/// and returns when all calls have returned. The caller is worker 0.
+		void run(const std::function<void(uint32_t)> &job);
+
+		inline uint32_t getCount() const
+		{
+			return static_cast<uint32_t>(mThreads.size()) + 1;
+		}
+
+	private:
+		WorkerPool(const WorkerPool&);
+		WorkerPool& operator=(const WorkerPool&);
+
+		void _threadMain(uint32_t worker, uint64_t jobNumber);
+
+		std::vector<std::thread> mThreads;
+		std::mutex mMutex;
+		std::condition_variable mStartCondition;
+		std::condition_variable mDoneCondition;
+		const std::function<void(uint32_t)> *mJob;
+		uint64_t mJobNumber; //incremented for every job, threads wait for it to change
+		uint32_t mBusy; //threads still running the current job
+		bool mStopping;
+	};
+}
+
+#endif